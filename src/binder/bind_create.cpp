@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -129,7 +130,25 @@ auto Binder::BindIndex(duckdb_libpgquery::PGIndexStmt *stmt) -> std::unique_ptr<
     }
   }
 
-  return std::make_unique<IndexStatement>(stmt->idxname, std::move(table), std::move(cols));
+  // The parser fills in its own default access method when the USING clause is missing, so keep the B+ tree as the
+  // default unless the statement spells out USING.
+  bool has_using = std::any_of(using_locations_.begin(), using_locations_.end(), [&](int32_t location) {
+    return location >= statement_location_ &&
+           (statement_length_ == 0 || location < statement_location_ + statement_length_);
+  });
+
+  auto index_type = IndexType::BPlusTreeIndex;
+  std::string access_method = has_using ? stmt->accessMethod : "bplustree";
+  if (access_method == "art") {
+    index_type = IndexType::ARTIndex;
+  } else if (access_method == "bwtree") {
+    index_type = IndexType::BwTreeIndex;
+  } else if (access_method != "bplustree" && access_method != "btree") {
+    throw NotImplementedException(fmt::format("index type {} is not supported", access_method));
+  }
+
+  return std::make_unique<IndexStatement>(stmt->idxname, std::move(table), std::move(cols), stmt->unique,
+                                          index_type);
 }
 
 }  // namespace bustub
@@ -43,6 +43,20 @@ namespace bustub {
 Binder::Binder(const Catalog &catalog) : catalog_(catalog) {}
 
 void Binder::ParseAndSave(const std::string &query) {
+  using_locations_.clear();
+  auto tokens = Tokenize(query);
+  for (size_t i = 0; i < tokens.size(); i++) {
+    if (tokens[i].type_ != SimplifiedTokenType::SIMPLIFIED_TOKEN_KEYWORD) {
+      continue;
+    }
+    auto end = i + 1 < tokens.size() ? static_cast<size_t>(tokens[i + 1].start_) : query.size();
+    auto keyword = query.substr(tokens[i].start_, end - tokens[i].start_);
+    StringUtil::RTrim(&keyword);
+    if (StringUtil::Lower(keyword) == "using") {
+      using_locations_.push_back(tokens[i].start_);
+    }
+  }
+
   parser_.Parse(query);
   if (!parser_.success) {
     LOG_INFO("Query failed to parse!");
@@ -7,14 +7,23 @@
 namespace bustub {
 
 IndexStatement::IndexStatement(std::string index_name, std::unique_ptr<BoundBaseTableRef> table,
-                               std::vector<std::unique_ptr<BoundColumnRef>> cols)
+                               std::vector<std::unique_ptr<BoundColumnRef>> cols, bool is_unique,
+                               IndexType index_type)
     : BoundStatement(StatementType::INDEX_STATEMENT),
       index_name_(std::move(index_name)),
       table_(std::move(table)),
-      cols_(std::move(cols)) {}
+      cols_(std::move(cols)),
+      is_unique_(is_unique),
+      index_type_(index_type) {}
 
 auto IndexStatement::ToString() const -> std::string {
-  return fmt::format("BoundIndex {{ index_name={}, table={}, cols={} }}", index_name_, *table_, cols_);
+  std::string type = "bplustree";
+  if (index_type_ == IndexType::ARTIndex) {
+    type = "art";
+  } else if (index_type_ == IndexType::BwTreeIndex) {
+    type = "bwtree";
+  }
+  return fmt::format("BoundIndex {{ index_name={}, table={}, cols={}, type={} }}", index_name_, *table_, cols_, type);
 }
 
 }  // namespace bustub
@@ -12,7 +12,6 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
-#include "common/exception.h"
 #include "common/macros.h"
 
 namespace bustub {
@@ -29,11 +28,6 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManag
   for (size_t i = 0; i < pool_size_; ++i) {
     free_list_.emplace_back(static_cast<int>(i));
   }
-
-  // TODO(students): remove this line after you have implemented the buffer pool manager
-  throw NotImplementedException(
-      "BufferPoolManager is not implemented yet. If you have finished implementing BPM, please remove the throw "
-      "exception line in `buffer_pool_manager_instance.cpp`.");
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
@@ -42,18 +36,175 @@ BufferPoolManagerInstance::~BufferPoolManagerInstance() {
   delete replacer_;
 }
 
-auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * { return nullptr; }
+auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
+  std::unique_lock latch(latch_);
+  frame_id_t frame_id;
+  if (!AcquireFrame(&frame_id, &latch)) {
+    return nullptr;
+  }
+  *page_id = AllocatePage();
+  Page *page = &pages_[frame_id];
+  page->page_id_ = *page_id;
+  page->pin_count_ = 1;
+  page_table_->Insert(*page_id, frame_id);
+  replacer_->RecordAccess(frame_id);
+  replacer_->SetEvictable(frame_id, false);
+  return page;
+}
 
-auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * { return nullptr; }
+auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
+  std::unique_lock latch(latch_);
+  frame_id_t frame_id;
+  if (!page_table_->Find(page_id, frame_id)) {
+    if (!AcquireFrame(&frame_id, &latch)) {
+      return nullptr;
+    }
+    frame_id_t read_frame_id;
+    if (page_table_->Find(page_id, read_frame_id)) {
+      // the page was read while the latch was released for the victim
+      free_list_.push_back(frame_id);
+      frame_id = read_frame_id;
+    } else {
+      Page *page = &pages_[frame_id];
+      page->page_id_ = page_id;
+      disk_manager_->ReadPage(page_id, page->GetData());
+      page_table_->Insert(page_id, frame_id);
+    }
+  }
+  Page *page = &pages_[frame_id];
+  page->pin_count_++;
+  replacer_->RecordAccess(frame_id);
+  replacer_->SetEvictable(frame_id, false);
+  return page;
+}
 
-auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool { return false; }
+auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
+  std::scoped_lock latch(latch_);
+  frame_id_t frame_id;
+  if (!page_table_->Find(page_id, frame_id)) {
+    return false;
+  }
+  Page *page = &pages_[frame_id];
+  if (page->pin_count_ <= 0) {
+    return false;
+  }
+  page->is_dirty_ = page->is_dirty_ || is_dirty;
+  if (--page->pin_count_ == 0) {
+    replacer_->SetEvictable(frame_id, true);
+  }
+  return true;
+}
 
-auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool { return false; }
+auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
+  std::unique_lock latch(latch_);
+  frame_id_t frame_id;
+  if (page_id == INVALID_PAGE_ID || !page_table_->Find(page_id, frame_id)) {
+    return false;
+  }
+  WriteBack(&pages_[frame_id], &latch);
+  return true;
+}
 
-void BufferPoolManagerInstance::FlushAllPgsImp() {}
+void BufferPoolManagerInstance::FlushAllPgsImp() {
+  std::unique_lock latch(latch_);
+  for (size_t i = 0; i < pool_size_; i++) {
+    if (pages_[i].page_id_ != INVALID_PAGE_ID) {
+      WriteBack(&pages_[i], &latch);
+    }
+  }
+}
 
-auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool { return false; }
+auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
+  std::scoped_lock latch(latch_);
+  frame_id_t frame_id;
+  if (!page_table_->Find(page_id, frame_id)) {
+    return true;
+  }
+  Page *page = &pages_[frame_id];
+  if (page->pin_count_ > 0) {
+    return false;
+  }
+  replacer_->Remove(frame_id);
+  page_table_->Remove(page_id);
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->ResetRecLSN();
+  free_list_.push_back(frame_id);
+  DeallocatePage(page_id);
+  return true;
+}
+
+auto BufferPoolManagerInstance::GetDirtyPageTable() -> std::vector<std::pair<page_id_t, lsn_t>> {
+  std::scoped_lock latch(latch_);
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  for (size_t i = 0; i < pool_size_; i++) {
+    lsn_t rec_lsn = pages_[i].GetRecLSN();
+    if (pages_[i].GetPageId() != INVALID_PAGE_ID && rec_lsn != INVALID_LSN) {
+      dirty_pages.emplace_back(pages_[i].GetPageId(), rec_lsn);
+    }
+  }
+  return dirty_pages;
+}
 
 auto BufferPoolManagerInstance::AllocatePage() -> page_id_t { return next_page_id_++; }
 
+auto BufferPoolManagerInstance::AcquireFrame(frame_id_t *frame_id, std::unique_lock<std::mutex> *lock) -> bool {
+  Page *page = nullptr;
+  while (true) {
+    if (!free_list_.empty()) {
+      *frame_id = free_list_.front();
+      free_list_.pop_front();
+      return true;
+    }
+    // an unpinned page is not latched, its lsn does not change while it is considered; a clean page is never written
+    auto log_safe = [this](frame_id_t victim) { return !pages_[victim].is_dirty_ || IsLogSafe(&pages_[victim]); };
+    if (!replacer_->Evict(frame_id, log_safe)) {
+      return false;
+    }
+    page = &pages_[*frame_id];
+    if (!page->is_dirty_ || WriteBack(page, lock)) {
+      break;
+    }
+    // the victim stays in its frame if it was fetched while the log was forced, a page that was fetched and unpinned
+    // again is back in the replacer
+    if (page->pin_count_ == 0) {
+      replacer_->Remove(*frame_id);
+      break;
+    }
+  }
+  page_table_->Remove(page->page_id_);
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  page->pin_count_ = 0;
+  page->ResetRecLSN();
+  return true;
+}
+
+auto BufferPoolManagerInstance::WriteBack(Page *page, std::unique_lock<std::mutex> *lock) -> bool {
+  bool latched = true;
+  // the page may change while the log is forced, it is written once the log covers its lsn
+  while (!IsLogSafe(page)) {
+    lsn_t lsn = page->GetLSN();
+    auto frame_id = static_cast<frame_id_t>(page - pages_);
+    if (page->pin_count_++ == 0) {
+      replacer_->SetEvictable(frame_id, false);
+    }
+    lock->unlock();
+    log_manager_->FlushUntil(lsn);
+    lock->lock();
+    if (--page->pin_count_ == 0) {
+      replacer_->SetEvictable(frame_id, true);
+    }
+    latched = false;
+  }
+  disk_manager_->WritePage(page->page_id_, page->GetData());
+  page->is_dirty_ = false;
+  return latched;
+}
+
+auto BufferPoolManagerInstance::IsLogSafe(Page *page) -> bool {
+  return log_manager_ == nullptr || !enable_logging || page->GetLSN() <= log_manager_->GetPersistentLSN();
+}
+
 }  // namespace bustub
@@ -16,14 +16,84 @@ namespace bustub {
 
 LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) {}
 
-auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool { return false; }
+auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool { return Evict(frame_id, nullptr); }
 
-void LRUKReplacer::RecordAccess(frame_id_t frame_id) {}
+auto LRUKReplacer::Evict(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &prefer) -> bool {
+  std::scoped_lock latch(latch_);
+  auto victim = entries_.end();
+  auto preferred = entries_.end();
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (!it->second.evictable_) {
+      continue;
+    }
+    if (victim == entries_.end() || EvictsBefore(it->second, victim->second)) {
+      victim = it;
+    }
+    if (prefer && (preferred == entries_.end() || EvictsBefore(it->second, preferred->second)) && prefer(it->first)) {
+      preferred = it;
+    }
+  }
+  if (preferred != entries_.end()) {
+    victim = preferred;
+  }
+  if (victim == entries_.end()) {
+    return false;
+  }
+  *frame_id = victim->first;
+  entries_.erase(victim);
+  curr_size_--;
+  return true;
+}
 
-void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {}
+void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "invalid frame id");
+  std::scoped_lock latch(latch_);
+  auto &history = entries_[frame_id].history_;
+  history.push_back(current_timestamp_++);
+  if (history.size() > k_) {
+    history.pop_front();
+  }
+}
 
-void LRUKReplacer::Remove(frame_id_t frame_id) {}
+void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "invalid frame id");
+  std::scoped_lock latch(latch_);
+  auto it = entries_.find(frame_id);
+  if (it == entries_.end() || it->second.evictable_ == set_evictable) {
+    return;
+  }
+  it->second.evictable_ = set_evictable;
+  if (set_evictable) {
+    curr_size_++;
+  } else {
+    curr_size_--;
+  }
+}
 
-auto LRUKReplacer::Size() -> size_t { return 0; }
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  auto it = entries_.find(frame_id);
+  if (it == entries_.end()) {
+    return;
+  }
+  BUSTUB_ASSERT(it->second.evictable_, "cannot remove a frame that is not evictable");
+  entries_.erase(it);
+  curr_size_--;
+}
+
+auto LRUKReplacer::Size() -> size_t {
+  std::scoped_lock latch(latch_);
+  return curr_size_;
+}
+
+auto LRUKReplacer::EvictsBefore(const FrameEntry &a, const FrameEntry &b) const -> bool {
+  bool a_infinite = a.history_.size() < k_;
+  bool b_infinite = b.history_.size() < k_;
+  if (a_infinite != b_infinite) {
+    return a_infinite;
+  }
+  // the oldest of the last k accesses is the k-th most recent one, or the first access of a frame with fewer
+  return a.history_.front() < b.history_.front();
+}
 
 }  // namespace bustub
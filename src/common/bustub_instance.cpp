@@ -175,7 +175,9 @@ see the execution plan of your query.
 auto BustubInstance::ExecuteSql(const std::string &sql, ResultWriter &writer) -> bool {
   auto txn = txn_manager_->Begin();
   auto result = ExecuteSqlTxn(sql, writer, txn);
-  txn_manager_->Commit(txn);
+  txn->SetSynchronousCommit(IsSynchronousCommit());
+  // a transaction wounded by an older one is rolled back instead
+  result = txn_manager_->Commit(txn) && result;
   delete txn;
   return result;
 }
@@ -240,7 +242,7 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
         std::unique_lock<std::shared_mutex> l(catalog_lock_);
         auto info = catalog_->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
             txn, index_stmt.index_name_, index_stmt.table_->table_, index_stmt.table_->schema_, key_schema, col_ids,
-            INTEGER_SIZE, IntegerHashFunctionType{});
+            INTEGER_SIZE, IntegerHashFunctionType{}, index_stmt.is_unique_, index_stmt.index_type_);
         l.unlock();
 
         if (info == nullptr) {
@@ -18,6 +18,12 @@ std::atomic<bool> enable_logging(false);
 
 std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 
+std::chrono::microseconds group_commit_window = std::chrono::microseconds(1000);
+
+size_t group_commit_size = 16;
+
+std::atomic<bool> enable_log_compression(false);
+
 std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
 
 }  // namespace bustub
@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util.cpp
+//
+// Identification: src/common/util/compression_util.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/compression_util.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+/** No match starts in the last MATCH_LIMIT bytes, the block ends with at least LAST_LITERALS literals */
+constexpr size_t MATCH_LIMIT = 12;
+constexpr size_t LAST_LITERALS = 5;
+constexpr int HASH_BITS = 12;
+
+inline auto Load32(const uint8_t *data) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline auto Hash(uint32_t sequence) -> uint32_t { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+/** Write a length that did not fit into its 4 bits of the token as a run of 255s and the rest */
+inline auto WriteLength(size_t length, uint8_t *out) -> uint8_t * {
+  for (; length >= 255; length -= 255) {
+    *out++ = 255;
+  }
+  *out++ = static_cast<uint8_t>(length);
+  return out;
+}
+
+/** Read the rest of a length whose token bits are all set, @return false if it runs past end */
+inline auto ReadLength(const uint8_t **in, const uint8_t *end, size_t *length) -> bool {
+  uint8_t byte;
+  do {
+    if (*in >= end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+auto WriteSequence(const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length, uint8_t *out)
+    -> uint8_t * {
+  uint8_t *token = out++;
+  *token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+  if (literal_length >= 15) {
+    out = WriteLength(literal_length - 15, out);
+  }
+  memcpy(out, literals, literal_length);
+  out += literal_length;
+  if (match_length == 0) {
+    return out;
+  }
+  *out++ = static_cast<uint8_t>(offset);
+  *out++ = static_cast<uint8_t>(offset >> 8);
+  size_t length = match_length - CompressionUtil::MIN_MATCH;
+  *token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+  if (length >= 15) {
+    out = WriteLength(length - 15, out);
+  }
+  return out;
+}
+
+}  // namespace
+
+auto CompressionUtil::Compress(const char *src, size_t size, char *dst) -> size_t {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  // positions plus one of the last sequences with a hash, zero for none
+  std::array<uint32_t, 1 << HASH_BITS> table{};
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + MATCH_LIMIT <= size) {
+    uint32_t sequence = Load32(in + pos);
+    uint32_t &entry = table[Hash(sequence)];
+    size_t candidate = entry;
+    entry = static_cast<uint32_t>(pos + 1);
+    if (candidate == 0 || pos + 1 - candidate > MAX_OFFSET || Load32(in + candidate - 1) != sequence) {
+      pos++;
+      continue;
+    }
+    candidate--;
+    size_t match_length = MIN_MATCH;
+    while (pos + match_length < size - LAST_LITERALS && in[candidate + match_length] == in[pos + match_length]) {
+      match_length++;
+    }
+    out = WriteSequence(in + anchor, pos - anchor, pos - candidate, match_length, out);
+    pos += match_length;
+    anchor = pos;
+  }
+  out = WriteSequence(in + anchor, size - anchor, 0, 0, out);
+  return out - reinterpret_cast<uint8_t *>(dst);
+}
+
+auto CompressionUtil::Decompress(const char *src, size_t size, char *dst, size_t decompressed_size) -> bool {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  const auto *in_end = in + size;
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  auto *out_begin = out;
+  auto *out_end = out + decompressed_size;
+  while (in < in_end) {
+    uint8_t token = *in++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !ReadLength(&in, in_end, &literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<size_t>(in_end - in) || literal_length > static_cast<size_t>(out_end - out)) {
+      return false;
+    }
+    memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == in_end) {
+      // the last sequence has no match
+      break;
+    }
+
+    if (in_end - in < 2) {
+      return false;
+    }
+    size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+    in += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !ReadLength(&in, in_end, &match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > static_cast<size_t>(out - out_begin) ||
+        match_length > static_cast<size_t>(out_end - out)) {
+      return false;
+    }
+    // a match may overlap the bytes it produces, it is copied byte by byte
+    const uint8_t *match = out - offset;
+    for (size_t i = 0; i < match_length; i++) {
+      out[i] = match[i];
+    }
+    out += match_length;
+  }
+  return out == out_end;
+}
+
+}  // namespace bustub
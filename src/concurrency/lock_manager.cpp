@@ -12,39 +12,830 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <functional>
+
 #include "common/config.h"
 #include "concurrency/transaction.h"
 #include "concurrency/transaction_manager.h"
 
 namespace bustub {
 
-auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool { return true; }
+namespace {
+
+/**
+ * Per-thread cache of unused lock requests. Requests are taken from and
+ * returned to the cache of whichever thread runs the lock or unlock call, so
+ * allocating a request never touches state shared with other threads.
+ */
+class LockRequestFreeList {
+ public:
+  static constexpr size_t MAX_CACHED = 256;
+
+  ~LockRequestFreeList() {
+    for (auto *request : requests_) {
+      delete request;
+    }
+  }
+
+  auto Pop() -> LockManager::LockRequest * {
+    if (requests_.empty()) {
+      return nullptr;
+    }
+    auto *request = requests_.back();
+    requests_.pop_back();
+    return request;
+  }
+
+  void Push(LockManager::LockRequest *request) {
+    if (requests_.size() >= MAX_CACHED) {
+      delete request;
+      return;
+    }
+    requests_.push_back(request);
+  }
+
+ private:
+  std::vector<LockManager::LockRequest *> requests_;
+};
+
+thread_local LockRequestFreeList free_list;
+
+}  // namespace
+
+LockManager::LockManager(DeadlockPolicy deadlock_policy) : deadlock_policy_(DeadlockPolicy::DETECTION) {
+  SetDeadlockPolicy(deadlock_policy);
+}
+
+LockManager::~LockManager() {
+  if (cycle_detection_thread_ != nullptr) {
+    enable_cycle_detection_ = false;
+    cycle_detection_thread_->join();
+    delete cycle_detection_thread_;
+  }
+
+  // requests of transactions that never released their locks
+  for (auto &[oid, queue] : table_lock_map_) {
+    for (auto *request : queue->request_queue_) {
+      delete request;
+    }
+  }
+  for (auto &shard : row_lock_shards_) {
+    for (auto &[rid, queue] : shard.row_lock_map_) {
+      for (auto *request : queue->request_queue_) {
+        delete request;
+      }
+    }
+  }
+}
+
+auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  CheckIsolationLevel(txn, lock_mode);
+
+  auto queue = GetTableQueue(oid);
+  return AcquireLock(txn, queue, NewRequest(txn->GetTransactionId(), lock_mode, oid));
+}
+
+auto LockManager::UnlockTable(Transaction *txn, const table_oid_t &oid) -> bool {
+  auto s_rows = txn->GetSharedRowLockSet()->find(oid);
+  auto x_rows = txn->GetExclusiveRowLockSet()->find(oid);
+  if ((s_rows != txn->GetSharedRowLockSet()->end() && !s_rows->second.empty()) ||
+      (x_rows != txn->GetExclusiveRowLockSet()->end() && !x_rows->second.empty())) {
+    AbortImplicitly(txn, AbortReason::TABLE_UNLOCKED_BEFORE_UNLOCKING_ROWS);
+  }
 
-auto LockManager::UnlockTable(Transaction *txn, const table_oid_t &oid) -> bool { return true; }
+  auto *request = ReleaseTableLock(txn, oid);
+  if (request == nullptr) {
+    AbortImplicitly(txn, AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
+  }
+
+  txn->GetEscalatedTableSet()->erase(oid);
+  UpdateStateOnUnlock(txn, request->lock_mode_);
+  UpdateLockSets(txn, request, false);
+  FreeRequest(request);
+  return true;
+}
 
 auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_t &oid, const RID &rid) -> bool {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (lock_mode != LockMode::SHARED && lock_mode != LockMode::EXCLUSIVE) {
+    AbortImplicitly(txn, AbortReason::ATTEMPTED_INTENTION_LOCK_ON_ROW);
+  }
+  CheckIsolationLevel(txn, lock_mode);
+
+  // a row lock needs a table lock that covers it
+  bool table_locked = txn->IsTableExclusiveLocked(oid) || txn->IsTableIntentionExclusiveLocked(oid) ||
+                      txn->IsTableSharedIntentionExclusiveLocked(oid);
+  if (lock_mode == LockMode::SHARED) {
+    table_locked = table_locked || txn->IsTableSharedLocked(oid) || txn->IsTableIntentionSharedLocked(oid);
+  }
+  if (!table_locked) {
+    AbortImplicitly(txn, AbortReason::TABLE_LOCK_NOT_PRESENT);
+  }
+
+  // after escalation the table lock covers the row
+  if (txn->IsTableEscalated(oid)) {
+    bool covered = txn->IsTableExclusiveLocked(oid) ||
+                   (lock_mode == LockMode::SHARED &&
+                    (txn->IsTableSharedLocked(oid) || txn->IsTableSharedIntentionExclusiveLocked(oid)));
+    if (covered) {
+      return true;
+    }
+  }
+
+  auto queue = GetRowQueue(rid);
+  bool granted = AcquireLock(txn, queue, NewRequest(txn->GetTransactionId(), lock_mode, oid, rid));
+  PutRowQueue(rid, std::move(queue));
+  if (!granted) {
+    return false;
+  }
+
+  size_t threshold = lock_escalation_threshold_;
+  size_t row_locks = (*txn->GetSharedRowLockSet())[oid].size() + (*txn->GetExclusiveRowLockSet())[oid].size();
+  if (threshold > 0 && row_locks > threshold) {
+    Escalate(txn, oid);
+  }
   return true;
 }
 
-auto LockManager::UnlockRow(Transaction *txn, const table_oid_t &oid, const RID &rid) -> bool { return true; }
+auto LockManager::UnlockRow(Transaction *txn, const table_oid_t &oid, const RID &rid) -> bool {
+  if (txn->IsTableEscalated(oid) && !txn->IsRowSharedLocked(oid, rid) && !txn->IsRowExclusiveLocked(oid, rid)) {
+    // the row is covered by the escalated table lock, which stays until the table is unlocked
+    UpdateStateOnUnlock(txn, txn->IsTableExclusiveLocked(oid) ? LockMode::EXCLUSIVE : LockMode::SHARED);
+    return true;
+  }
+
+  auto *request = ReleaseRowLock(txn, rid);
+  if (request == nullptr) {
+    AbortImplicitly(txn, AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
+  }
+
+  UpdateStateOnUnlock(txn, request->lock_mode_);
+  UpdateLockSets(txn, request, false);
+  FreeRequest(request);
+  return true;
+}
+
+void LockManager::UnlockAll(Transaction *txn) {
+  std::vector<LockRequest *> released;
+  std::vector<RID> rows;
+  std::vector<table_oid_t> tables;
+  txn->LockTxn();
+  for (const auto &row_lock_set : {txn->GetSharedRowLockSet(), txn->GetExclusiveRowLockSet()}) {
+    for (const auto &[oid, rids] : *row_lock_set) {
+      rows.insert(rows.end(), rids.begin(), rids.end());
+    }
+  }
+  for (const auto &table_lock_set :
+       {txn->GetSharedTableLockSet(), txn->GetExclusiveTableLockSet(), txn->GetIntentionSharedTableLockSet(),
+        txn->GetIntentionExclusiveTableLockSet(), txn->GetSharedIntentionExclusiveTableLockSet()}) {
+    tables.insert(tables.end(), table_lock_set->begin(), table_lock_set->end());
+  }
+  txn->UnlockTxn();
+
+  for (const RID &rid : rows) {
+    released.push_back(ReleaseRowLock(txn, rid));
+  }
+  for (table_oid_t oid : tables) {
+    released.push_back(ReleaseTableLock(txn, oid));
+  }
+  for (auto *request : released) {
+    if (request != nullptr) {
+      UpdateLockSets(txn, request, false);
+      FreeRequest(request);
+    }
+  }
+  txn->GetEscalatedTableSet()->clear();
+}
+
+void LockManager::SetDeadlockPolicy(DeadlockPolicy deadlock_policy) {
+  deadlock_policy_ = deadlock_policy;
+  if (deadlock_policy == DeadlockPolicy::DETECTION && cycle_detection_thread_ == nullptr) {
+    enable_cycle_detection_ = true;
+    cycle_detection_thread_ = new std::thread(&LockManager::RunCycleDetection, this);
+  } else if (deadlock_policy != DeadlockPolicy::DETECTION && cycle_detection_thread_ != nullptr) {
+    enable_cycle_detection_ = false;
+    cycle_detection_thread_->join();
+    delete cycle_detection_thread_;
+    cycle_detection_thread_ = nullptr;
+  }
+}
 
-void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {}
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
+  auto &edges = waits_for_[t1];
+  auto it = std::lower_bound(edges.begin(), edges.end(), t2);
+  if (it == edges.end() || *it != t2) {
+    edges.insert(it, t2);
+  }
+}
 
-void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {}
+void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
+  auto from = waits_for_.find(t1);
+  if (from == waits_for_.end()) {
+    return;
+  }
+  auto &edges = from->second;
+  auto it = std::lower_bound(edges.begin(), edges.end(), t2);
+  if (it != edges.end() && *it == t2) {
+    edges.erase(it);
+  }
+  if (edges.empty()) {
+    waits_for_.erase(from);
+  }
+}
 
-auto LockManager::HasCycle(txn_id_t *txn_id) -> bool { return false; }
+auto LockManager::HasCycle(txn_id_t *txn_id) -> bool {
+  // search from the transactions in ascending id order, edges are kept sorted, so the search and thereby the victim
+  // are deterministic
+  std::vector<txn_id_t> sources;
+  for (const auto &[from, edges] : waits_for_) {
+    sources.push_back(from);
+  }
+  std::sort(sources.begin(), sources.end());
+  return FindCycle(sources, txn_id);
+}
 
 auto LockManager::GetEdgeList() -> std::vector<std::pair<txn_id_t, txn_id_t>> {
+  std::scoped_lock graph_latch(waits_for_latch_);
   std::vector<std::pair<txn_id_t, txn_id_t>> edges(0);
+  for (const auto &[from, to_list] : waits_for_) {
+    for (txn_id_t to : to_list) {
+      edges.emplace_back(from, to);
+    }
+  }
   return edges;
 }
 
 void LockManager::RunCycleDetection() {
   while (enable_cycle_detection_) {
     std::this_thread::sleep_for(cycle_detection_interval);
-    {  // TODO(students): detect deadlock
+    std::vector<txn_id_t> victims;
+    {
+      std::scoped_lock graph_latch(waits_for_latch_);
+      std::vector<txn_id_t> sources;
+      sources.swap(new_waiters_);
+      std::sort(sources.begin(), sources.end());
+      sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+      txn_id_t victim;
+      while (FindCycle(sources, &victim)) {
+        // without out edges the victim is on no cycle any more, its waiters find new blockers once it rolled back
+        waits_for_.erase(victim);
+        victims.push_back(victim);
+      }
+    }
+    // the victims remove their own requests once woken, do not hold the graph latch while taking queue latches
+    for (txn_id_t victim : victims) {
+      TransactionManager::Wound(victim);
+    }
+    WakeWounded(victims);
+  }
+}
+
+auto LockManager::RowLockShardOf(const RID &rid) -> RowLockShard & {
+  // std::hash<RID> is the identity on most standard libraries, mix the bits before picking a shard
+  auto hash = static_cast<uint64_t>(std::hash<RID>()(rid)) * 0x9E3779B97F4A7C15ULL;
+  return row_lock_shards_[hash >> 58 & (ROW_LOCK_SHARDS - 1)];
+}
+
+auto LockManager::GetTableQueue(table_oid_t oid) -> std::shared_ptr<LockRequestQueue> {
+  std::scoped_lock latch(table_lock_map_latch_);
+  auto &queue = table_lock_map_[oid];
+  if (queue == nullptr) {
+    queue = std::make_shared<LockRequestQueue>();
+  }
+  return queue;
+}
+
+auto LockManager::GetRowQueue(const RID &rid) -> std::shared_ptr<LockRequestQueue> {
+  auto &shard = RowLockShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  auto &queue = shard.row_lock_map_[rid];
+  if (queue == nullptr) {
+    queue = std::make_shared<LockRequestQueue>();
+  }
+  return queue;
+}
+
+void LockManager::PutRowQueue(const RID &rid, std::shared_ptr<LockRequestQueue> queue) {
+  auto &shard = RowLockShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.row_lock_map_.find(rid);
+  // new references are only handed out under the shard latch, or through waiting_on_ while a request waits
+  if (it == shard.row_lock_map_.end() || it->second != queue || queue.use_count() > 2) {
+    return;
+  }
+  std::scoped_lock queue_latch(queue->latch_);
+  if (queue->request_queue_.empty()) {
+    shard.row_lock_map_.erase(it);
+  }
+}
+
+auto LockManager::GetRowQueueCount() -> size_t {
+  size_t count = 0;
+  for (auto &shard : row_lock_shards_) {
+    std::scoped_lock latch(shard.latch_);
+    count += shard.row_lock_map_.size();
+  }
+  return count;
+}
+
+void LockManager::Escalate(Transaction *txn, table_oid_t oid) {
+  auto &s_rows = (*txn->GetSharedRowLockSet())[oid];
+  auto &x_rows = (*txn->GetExclusiveRowLockSet())[oid];
+
+  LockMode held = LockMode::INTENTION_SHARED;
+  if (txn->IsTableExclusiveLocked(oid)) {
+    held = LockMode::EXCLUSIVE;
+  } else if (txn->IsTableSharedIntentionExclusiveLocked(oid)) {
+    held = LockMode::SHARED_INTENTION_EXCLUSIVE;
+  } else if (txn->IsTableIntentionExclusiveLocked(oid)) {
+    held = LockMode::INTENTION_EXCLUSIVE;
+  } else if (txn->IsTableSharedLocked(oid)) {
+    held = LockMode::SHARED;
+  }
+
+  LockMode target = held;
+  if (!x_rows.empty()) {
+    target = LockMode::EXCLUSIVE;
+  } else if (held == LockMode::INTENTION_SHARED) {
+    target = LockMode::SHARED;
+  } else if (held == LockMode::INTENTION_EXCLUSIVE) {
+    target = LockMode::SHARED_INTENTION_EXCLUSIVE;
+  }
+  if (target != held && !TryUpgradeTable(txn, oid, target)) {
+    return;
+  }
+  txn->GetEscalatedTableSet()->insert(oid);
+
+  // drop the row locks the table lock covers now, without touching the 2PL state
+  std::vector<RID> released(s_rows.begin(), s_rows.end());
+  if (target == LockMode::EXCLUSIVE) {
+    released.insert(released.end(), x_rows.begin(), x_rows.end());
+  }
+  for (const RID &rid : released) {
+    auto *request = ReleaseRowLock(txn, rid);
+    UpdateLockSets(txn, request, false);
+    FreeRequest(request);
+  }
+}
+
+auto LockManager::TryUpgradeTable(Transaction *txn, table_oid_t oid, LockMode lock_mode) -> bool {
+  auto queue = GetTableQueue(oid);
+  std::scoped_lock latch(queue->latch_);
+  if (queue->upgrading_ != INVALID_TXN_ID) {
+    return false;
+  }
+  LockRequest *held = nullptr;
+  for (auto *request : queue->request_queue_) {
+    if (request->txn_id_ == txn->GetTransactionId()) {
+      held = request;
+    } else if (request->granted_ && !AreCompatible(request->lock_mode_, lock_mode)) {
+      return false;
+    }
+  }
+  if (held == nullptr || !held->granted_) {
+    return false;
+  }
+  // only a stronger mode replaces the old one, so no waiter becomes grantable
+  UpdateLockSets(txn, held, false);
+  held->lock_mode_ = lock_mode;
+  UpdateLockSets(txn, held, true);
+  return true;
+}
+
+auto LockManager::ReleaseRowLock(Transaction *txn, const RID &rid) -> LockRequest * {
+  std::shared_ptr<LockRequestQueue> queue;
+  {
+    auto &shard = RowLockShardOf(rid);
+    std::scoped_lock latch(shard.latch_);
+    auto it = shard.row_lock_map_.find(rid);
+    if (it == shard.row_lock_map_.end()) {
+      return nullptr;
+    }
+    queue = it->second;
+  }
+
+  LockRequest *request;
+  {
+    std::scoped_lock latch(queue->latch_);
+    request = ReleaseLock(txn, queue.get());
+    if (request != nullptr) {
+      GrantWaiters(queue.get());
+    }
+  }
+  PutRowQueue(rid, std::move(queue));
+  return request;
+}
+
+auto LockManager::ReleaseTableLock(Transaction *txn, table_oid_t oid) -> LockRequest * {
+  std::shared_ptr<LockRequestQueue> queue;
+  {
+    std::scoped_lock latch(table_lock_map_latch_);
+    auto it = table_lock_map_.find(oid);
+    if (it == table_lock_map_.end()) {
+      return nullptr;
+    }
+    queue = it->second;
+  }
+
+  std::scoped_lock latch(queue->latch_);
+  auto *request = ReleaseLock(txn, queue.get());
+  if (request != nullptr) {
+    GrantWaiters(queue.get());
+  }
+  return request;
+}
+
+auto LockManager::AcquireLock(Transaction *txn, const std::shared_ptr<LockRequestQueue> &shared_queue,
+                              LockRequest *request) -> bool {
+  auto *queue = shared_queue.get();
+  std::unique_lock latch(queue->latch_);
+
+  auto held = std::find_if(queue->request_queue_.begin(), queue->request_queue_.end(),
+                           [request](const LockRequest *other) { return other->txn_id_ == request->txn_id_; });
+  if (held != queue->request_queue_.end()) {
+    auto *old_request = *held;
+    if (old_request->lock_mode_ == request->lock_mode_) {
+      FreeRequest(request);
+      return true;
+    }
+    if (queue->upgrading_ != INVALID_TXN_ID) {
+      FreeRequest(request);
+      latch.unlock();
+      AbortImplicitly(txn, AbortReason::UPGRADE_CONFLICT);
+    }
+    if (!CanUpgrade(old_request->lock_mode_, request->lock_mode_)) {
+      FreeRequest(request);
+      latch.unlock();
+      AbortImplicitly(txn, AbortReason::INCOMPATIBLE_UPGRADE);
+    }
+
+    // drop the old lock and queue the upgrade ahead of every other waiting request
+    queue->request_queue_.erase(held);
+    UpdateLockSets(txn, old_request, false);
+    FreeRequest(old_request);
+    auto first_waiting = std::find_if(queue->request_queue_.begin(), queue->request_queue_.end(),
+                                      [](const LockRequest *other) { return !other->granted_; });
+    queue->request_queue_.insert(first_waiting, request);
+    queue->upgrading_ = request->txn_id_;
+    // the waiters behind now wait for the upgrade as well
+    for (auto it = first_waiting; it != queue->request_queue_.end(); ++it) {
+      if ((*it)->granted_) {
+        continue;
+      }
+      if (deadlock_policy_ == DeadlockPolicy::DETECTION) {
+        UpdateWaitsFor((*it)->txn_id_, GetBlockers(queue, *it));
+      } else {
+        (*it)->cv_.notify_one();
+      }
+    }
+  } else {
+    queue->request_queue_.push_back(request);
+  }
+
+  bool registered = false;
+  bool in_graph = false;
+  std::vector<txn_id_t> wounded;
+  while (txn->GetState() != TransactionState::ABORTED && !request->granted_ && !CanGrant(queue, request)) {
+    if (deadlock_policy_ != DeadlockPolicy::WAIT_DIE && !registered) {
+      // register before checking the state again, a transaction that aborts this one after the check finds it
+      std::scoped_lock waiting_latch(waiting_on_latch_);
+      waiting_on_[request->txn_id_] = shared_queue;
+      registered = true;
+      continue;
+    }
+    if (deadlock_policy_ == DeadlockPolicy::DETECTION) {
+      // later changes to the blockers are tracked by whoever changes the queue, see GrantWaiters
+      if (!in_graph) {
+        UpdateWaitsFor(request->txn_id_, GetBlockers(queue, request));
+        in_graph = true;
+      }
+      request->cv_.wait(latch);
+      continue;
+    }
+    if (!PreventDeadlock(queue, request, &wounded)) {
+      txn->SetState(TransactionState::ABORTED);
+      break;
+    }
+    if (!wounded.empty()) {
+      // wounded transactions may wait on other queues, do not hold this latch while taking theirs
+      latch.unlock();
+      WakeWounded(wounded);
+      wounded.clear();
+      latch.lock();
+      continue;
+    }
+    request->cv_.wait(latch);
+  }
+  if (in_graph) {
+    RemoveWaiter(request->txn_id_);
+  }
+  if (registered) {
+    std::scoped_lock waiting_latch(waiting_on_latch_);
+    waiting_on_.erase(request->txn_id_);
+  }
+
+  if (queue->upgrading_ == request->txn_id_) {
+    queue->upgrading_ = INVALID_TXN_ID;
+  }
+  if (txn->GetState() == TransactionState::ABORTED) {
+    // the request may have been handed the lock in the meantime, either way the ones behind may be grantable now
+    queue->request_queue_.remove(request);
+    FreeRequest(request);
+    GrantWaiters(queue);
+    return false;
+  }
+
+  request->granted_ = true;
+  UpdateLockSets(txn, request, true);
+  return true;
+}
+
+auto LockManager::ReleaseLock(Transaction *txn, LockRequestQueue *queue) -> LockRequest * {
+  for (auto it = queue->request_queue_.begin(); it != queue->request_queue_.end(); ++it) {
+    auto *request = *it;
+    if (request->txn_id_ == txn->GetTransactionId() && request->granted_) {
+      queue->request_queue_.erase(it);
+      return request;
+    }
+  }
+  return nullptr;
+}
+
+auto LockManager::CanGrant(LockRequestQueue *queue, LockRequest *request) -> bool {
+  // every granted request and every request waiting ahead of this one has to be compatible with it
+  for (const auto *other : queue->request_queue_) {
+    if (other == request) {
+      return true;
+    }
+    if (!AreCompatible(other->lock_mode_, request->lock_mode_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void LockManager::GrantWaiters(LockRequestQueue *queue) {
+  // grant in FIFO order, a waiter that cannot be granted blocks every waiter behind it
+  auto it = queue->request_queue_.begin();
+  for (; it != queue->request_queue_.end(); ++it) {
+    auto *request = *it;
+    if (request->granted_) {
+      continue;
+    }
+    if (!CanGrant(queue, request)) {
+      break;
+    }
+    request->granted_ = true;
+    if (deadlock_policy_ == DeadlockPolicy::DETECTION) {
+      // the granted waiter waits for nobody now, even before it wakes up
+      RemoveWaiter(request->txn_id_);
+    }
+    request->cv_.notify_one();
+  }
+  // the others keep waiting for fewer transactions
+  if (deadlock_policy_ == DeadlockPolicy::DETECTION) {
+    for (; it != queue->request_queue_.end(); ++it) {
+      if (!(*it)->granted_) {
+        UpdateWaitsFor((*it)->txn_id_, GetBlockers(queue, *it));
+      }
     }
   }
 }
 
+auto LockManager::PreventDeadlock(LockRequestQueue *queue, LockRequest *request, std::vector<txn_id_t> *wounded)
+    -> bool {
+  for (txn_id_t blocker : GetBlockers(queue, request)) {
+    bool older = request->txn_id_ < blocker;
+    if (deadlock_policy_ == DeadlockPolicy::WAIT_DIE && !older) {
+      return false;
+    }
+    if (deadlock_policy_ == DeadlockPolicy::WOUND_WAIT && older && TransactionManager::Wound(blocker)) {
+      wounded->push_back(blocker);
+    }
+  }
+  return true;
+}
+
+auto LockManager::GetBlockers(LockRequestQueue *queue, LockRequest *request) -> std::vector<txn_id_t> {
+  // the conflicting requests are the ones CanGrant has to wait for
+  std::vector<txn_id_t> blockers;
+  for (const auto *other : queue->request_queue_) {
+    if (other == request) {
+      break;
+    }
+    if (!AreCompatible(other->lock_mode_, request->lock_mode_)) {
+      blockers.push_back(other->txn_id_);
+    }
+  }
+  return blockers;
+}
+
+void LockManager::UpdateWaitsFor(txn_id_t txn_id, std::vector<txn_id_t> blockers) {
+  std::sort(blockers.begin(), blockers.end());
+  blockers.erase(std::unique(blockers.begin(), blockers.end()), blockers.end());
+  std::scoped_lock graph_latch(waits_for_latch_);
+  auto &edges = waits_for_[txn_id];
+  if (edges != blockers) {
+    edges = std::move(blockers);
+    new_waiters_.push_back(txn_id);
+  }
+}
+
+void LockManager::RemoveWaiter(txn_id_t txn_id) {
+  std::scoped_lock graph_latch(waits_for_latch_);
+  waits_for_.erase(txn_id);
+}
+
+auto LockManager::FindCycle(const std::vector<txn_id_t> &sources, txn_id_t *txn_id) -> bool {
+  std::unordered_set<txn_id_t> finished;
+  std::vector<txn_id_t> path;
+  std::unordered_set<txn_id_t> on_path;
+  std::function<bool(txn_id_t)> visit = [&](txn_id_t txn) -> bool {
+    if (on_path.count(txn) > 0) {
+      // the cycle is the part of the path starting at txn, the victim is its youngest transaction
+      auto start = std::find(path.begin(), path.end(), txn);
+      *txn_id = *std::max_element(start, path.end());
+      return true;
+    }
+    if (finished.count(txn) > 0) {
+      return false;
+    }
+    path.push_back(txn);
+    on_path.insert(txn);
+    auto it = waits_for_.find(txn);
+    if (it != waits_for_.end()) {
+      for (txn_id_t next : it->second) {
+        if (visit(next)) {
+          return true;
+        }
+      }
+    }
+    path.pop_back();
+    on_path.erase(txn);
+    finished.insert(txn);
+    return false;
+  };
+
+  for (txn_id_t source : sources) {
+    if (visit(source)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LockManager::WakeWounded(const std::vector<txn_id_t> &wounded) {
+  for (txn_id_t txn_id : wounded) {
+    // the transactions are aborted already, a running one notices on its next lock request, tuple or commit
+    std::shared_ptr<LockRequestQueue> queue;
+    {
+      std::scoped_lock waiting_latch(waiting_on_latch_);
+      auto it = waiting_on_.find(txn_id);
+      if (it != waiting_on_.end()) {
+        queue = it->second;
+      }
+    }
+    if (queue != nullptr) {
+      std::scoped_lock latch(queue->latch_);
+      for (auto *request : queue->request_queue_) {
+        if (request->txn_id_ == txn_id) {
+          request->cv_.notify_one();
+        }
+      }
+    }
+  }
+}
+
+auto LockManager::AreCompatible(LockMode held, LockMode requested) -> bool {
+  switch (held) {
+    case LockMode::INTENTION_SHARED:
+      return requested != LockMode::EXCLUSIVE;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return requested == LockMode::INTENTION_SHARED || requested == LockMode::INTENTION_EXCLUSIVE;
+    case LockMode::SHARED:
+      return requested == LockMode::INTENTION_SHARED || requested == LockMode::SHARED;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return requested == LockMode::INTENTION_SHARED;
+    case LockMode::EXCLUSIVE:
+      return false;
+  }
+  return false;
+}
+
+auto LockManager::CanUpgrade(LockMode held, LockMode requested) -> bool {
+  switch (held) {
+    case LockMode::INTENTION_SHARED:
+      return true;
+    case LockMode::SHARED:
+    case LockMode::INTENTION_EXCLUSIVE:
+      return requested == LockMode::EXCLUSIVE || requested == LockMode::SHARED_INTENTION_EXCLUSIVE;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return requested == LockMode::EXCLUSIVE;
+    case LockMode::EXCLUSIVE:
+      return false;
+  }
+  return false;
+}
+
+void LockManager::AbortImplicitly(Transaction *txn, AbortReason reason) {
+  txn->SetState(TransactionState::ABORTED);
+  throw TransactionAbortException(txn->GetTransactionId(), reason);
+}
+
+void LockManager::CheckIsolationLevel(Transaction *txn, LockMode lock_mode) {
+  bool shared = lock_mode == LockMode::SHARED || lock_mode == LockMode::INTENTION_SHARED ||
+                lock_mode == LockMode::SHARED_INTENTION_EXCLUSIVE;
+  switch (txn->GetIsolationLevel()) {
+    case IsolationLevel::READ_UNCOMMITTED:
+      if (shared) {
+        AbortImplicitly(txn, AbortReason::LOCK_SHARED_ON_READ_UNCOMMITTED);
+      }
+      if (txn->GetState() == TransactionState::SHRINKING) {
+        AbortImplicitly(txn, AbortReason::LOCK_ON_SHRINKING);
+      }
+      return;
+    case IsolationLevel::READ_COMMITTED:
+      if (txn->GetState() == TransactionState::SHRINKING && lock_mode != LockMode::SHARED &&
+          lock_mode != LockMode::INTENTION_SHARED) {
+        AbortImplicitly(txn, AbortReason::LOCK_ON_SHRINKING);
+      }
+      return;
+    case IsolationLevel::REPEATABLE_READ:
+    case IsolationLevel::SNAPSHOT_ISOLATION:
+      if (txn->GetState() == TransactionState::SHRINKING) {
+        AbortImplicitly(txn, AbortReason::LOCK_ON_SHRINKING);
+      }
+      return;
+  }
+}
+
+void LockManager::UpdateLockSets(Transaction *txn, const LockRequest *request, bool insert) {
+  auto update_table = [&](const std::shared_ptr<std::unordered_set<table_oid_t>> &lock_set) {
+    if (insert) {
+      lock_set->insert(request->oid_);
+    } else {
+      lock_set->erase(request->oid_);
+    }
+  };
+  auto update_row = [&](const std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> &lock_set) {
+    if (insert) {
+      (*lock_set)[request->oid_].insert(request->rid_);
+    } else {
+      (*lock_set)[request->oid_].erase(request->rid_);
+    }
+  };
+
+  bool row = request->rid_.GetPageId() != INVALID_PAGE_ID;
+  switch (request->lock_mode_) {
+    case LockMode::SHARED:
+      row ? update_row(txn->GetSharedRowLockSet()) : update_table(txn->GetSharedTableLockSet());
+      return;
+    case LockMode::EXCLUSIVE:
+      row ? update_row(txn->GetExclusiveRowLockSet()) : update_table(txn->GetExclusiveTableLockSet());
+      return;
+    case LockMode::INTENTION_SHARED:
+      update_table(txn->GetIntentionSharedTableLockSet());
+      return;
+    case LockMode::INTENTION_EXCLUSIVE:
+      update_table(txn->GetIntentionExclusiveTableLockSet());
+      return;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      update_table(txn->GetSharedIntentionExclusiveTableLockSet());
+      return;
+  }
+}
+
+void LockManager::UpdateStateOnUnlock(Transaction *txn, LockMode lock_mode) {
+  if (txn->GetState() != TransactionState::GROWING) {
+    return;
+  }
+  if (lock_mode == LockMode::EXCLUSIVE ||
+      (lock_mode == LockMode::SHARED && (txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ ||
+                                         txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION))) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+}
+
+auto LockManager::NewRequest(txn_id_t txn_id, LockMode lock_mode, table_oid_t oid, RID rid) -> LockRequest * {
+  auto *request = free_list.Pop();
+  if (request == nullptr) {
+    return new LockRequest(txn_id, lock_mode, oid, rid);
+  }
+  // the condition variable is reused as is, nobody waits on a free request
+  request->txn_id_ = txn_id;
+  request->lock_mode_ = lock_mode;
+  request->oid_ = oid;
+  request->rid_ = rid;
+  request->granted_ = false;
+  return request;
+}
+
+void LockManager::FreeRequest(LockRequest *request) { free_list.Push(request); }
+
 }  // namespace bustub
@@ -16,107 +16,443 @@
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "catalog/catalog.h"
 #include "storage/table/table_heap.h"
 namespace bustub {
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
-std::shared_mutex TransactionManager::txn_map_mutex = {};
-
-auto TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) -> Transaction * {
-  // Acquire the global transaction latch in shared mode.
-  global_txn_latch_.RLock();
+std::array<TransactionManager::TxnMapShard, TransactionManager::TXN_SLOTS> TransactionManager::txn_map_shards = {};
+std::atomic<int64_t> TransactionManager::snapshot_txns{0};
+std::atomic<int64_t> TransactionManager::unversioned_writers{0};
+std::mutex TransactionManager::unversioned_latch;
+std::condition_variable TransactionManager::unversioned_cv;
 
+auto TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level,
+                               ConcurrencyControl concurrency_control) -> Transaction * {
   if (txn == nullptr) {
-    txn = new Transaction(next_txn_id_++, isolation_level);
+    txn = new Transaction(next_txn_id_++, isolation_level, concurrency_control);
+  }
+  EnterActive(txn);
+
+  if (txn->IsSnapshotRead()) {
+    // writes made without versions must not be visible to the snapshot, wait for the transactions that made them
+    snapshot_txns++;
+    WaitForUnversionedWriters();
+    // take the snapshot and register it atomically, so garbage collection cannot prune it in between
+    std::scoped_lock latch(active_read_ts_latch_);
+    txn->SetReadTs(last_commit_ts_);
+    active_read_ts_.insert(txn->GetReadTs());
+  } else {
+    txn->SetReadTs(last_commit_ts_);
   }
 
   if (enable_logging) {
     LogRecord record = LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
     lsn_t lsn = log_manager_->AppendLogRecord(&record);
     txn->SetPrevLSN(lsn);
+    txn->SetBeginLSN(lsn);
   }
 
-  std::unique_lock<std::shared_mutex> l(txn_map_mutex);
-  txn_map[txn->GetTransactionId()] = txn;
+  auto &shard = TxnMapShardOf(txn->GetTransactionId());
+  std::scoped_lock latch(shard.latch_);
+  shard.txn_map_[txn->GetTransactionId()] = txn;
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
-  txn->SetState(TransactionState::COMMITTED);
+auto TransactionManager::Commit(Transaction *txn) -> bool {
+  std::unique_lock commit_latch(commit_latch_, std::defer_lock);
 
-  // Perform all deletes before we commit.
+  // An optimistic transaction validates and installs its writes under the commit latch, so no other transaction
+  // commits in between. Read-only ones are serialized at their snapshot and skip the validation.
+  if (txn->IsOptimistic() && !txn->GetBufferedWriteSet()->empty()) {
+    commit_latch.lock();
+    if (!Validate(txn) || !InstallWrites(txn)) {
+      commit_latch.unlock();
+      Abort(txn);
+      return false;
+    }
+  }
+  // An older transaction may wound this one until the state changes, whichever changes it first wins.
+  auto state = txn->GetState();
+  while (state != TransactionState::ABORTED && !txn->CompareAndSetState(state, TransactionState::COMMITTED)) {
+    state = txn->GetState();
+  }
+  if (state == TransactionState::ABORTED) {
+    if (commit_latch.owns_lock()) {
+      commit_latch.unlock();
+    }
+    Abort(txn);
+    return false;
+  }
+  txn->GetReadSet()->clear();
+
+  // Stamp the new versions with the commit timestamp before publishing it, so that every snapshot that includes the
+  // timestamp sees them as committed.
   auto write_set = txn->GetWriteSet();
-  while (!write_set->empty()) {
-    auto &item = write_set->back();
-    auto *table = item.table_;
-    if (item.wtype_ == WType::DELETE) {
-      // Note that this also releases the lock when holding the page latch.
-      table->ApplyDelete(item.rid_, txn);
+  std::vector<const TableWriteRecord *> deletes;
+  if (txn->HasVersionedWrites()) {
+    if (!commit_latch.owns_lock()) {
+      commit_latch.lock();
+    }
+    timestamp_t commit_ts = last_commit_ts_ + 1;
+    txn->SetCommitTs(commit_ts);
+    std::vector<GarbageRecord> versioned;
+    for (const auto &item : *write_set) {
+      if (item.table_->GetVersionStore()->Commit(txn->GetTransactionId(), item.rid_, commit_ts)) {
+        // Deletes are applied by the garbage collection once no snapshot can see the deleted tuples.
+        versioned.push_back({commit_ts, item.table_, item.rid_, item.wtype_ == WType::DELETE});
+      } else if (item.wtype_ == WType::DELETE) {
+        deletes.push_back(&item);
+      }
+    }
+    {
+      std::scoped_lock garbage_latch(garbage_latch_);
+      garbage_.insert(garbage_.end(), versioned.begin(), versioned.end());
+      garbage_size_ = garbage_.size();
+    }
+    last_commit_ts_ = commit_ts;
+  } else {
+    for (const auto &item : *write_set) {
+      if (item.wtype_ == WType::DELETE) {
+        deletes.push_back(&item);
+      }
     }
-    write_set->pop_back();
   }
-  write_set->clear();
+  // No snapshot can see a tuple deleted without a version, apply the delete before the lock on it is released.
+  for (const auto *item : deletes) {
+    item->table_->ApplyDelete(item->rid_, txn);
+  }
+  lsn_t commit_lsn = INVALID_LSN;
+  if (enable_logging) {
+    // appended under the commit latch if the transaction saved versions, so the log orders commits by timestamp
+    LogRecord record = LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    commit_lsn = log_manager_->AppendLogRecord(&record);
+    txn->SetPrevLSN(commit_lsn);
+  }
+  if (commit_latch.owns_lock()) {
+    commit_latch.unlock();
+  }
 
-  // Release all the locks.
+  // Early lock release: once the commit record is ordered in the log, every transaction that sees the released data
+  // commits after this one, so it cannot become durable first. Release the locks before anything else.
   ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  write_set->clear();
+  FinishUnversionedWrites(txn);
+  FinishSnapshot(txn);
+  if (txn->IsSnapshotRead() || txn->HasVersionedWrites()) {
+    GarbageCollect();
+  }
+  if (commit_lsn != INVALID_LSN && txn->IsSynchronousCommit()) {
+    // the commit returns once its record is durable, the flush is shared with the transactions committing alongside;
+    // an asynchronous commit leaves the record to the flush thread and may be lost in a crash, but only together with
+    // every commit after it, since the log is written in order
+    log_manager_->WaitForDurable(commit_lsn);
+  }
+  LeaveActive(txn);
+  return true;
+}
+
+void TransactionManager::RollbackTableWrite(const TableWriteRecord &item, Transaction *txn) {
+  auto *table = item.table_;
+  txn->SetUndoNextLSN(item.prev_lsn_);
+  if (item.wtype_ == WType::DELETE) {
+    table->RollbackDelete(item.rid_, txn);
+  } else if (item.wtype_ == WType::INSERT) {
+    // Note that this also releases the lock when holding the page latch.
+    table->ApplyDelete(item.rid_, txn);
+  } else if (item.wtype_ == WType::UPDATE) {
+    table->UpdateTuple(item.tuple_, item.rid_, txn);
+  }
+}
+
+void TransactionManager::RollbackIndexWrite(IndexWriteRecord &item, Transaction *txn) {
+  auto *catalog = item.catalog_;
+  // Metadata identifying the table that should be deleted from.
+  TableInfo *table_info = catalog->GetTable(item.table_oid_);
+  IndexInfo *index_info = catalog->GetIndex(item.index_oid_);
+  auto new_key = item.tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetKeySchema()),
+                                          index_info->index_->GetKeyAttrs());
+  if (item.wtype_ == WType::DELETE) {
+    txn->SetUndoNextLSN(item.prev_lsn_);
+    index_info->index_->InsertEntry(new_key, item.rid_, txn);
+  } else if (item.wtype_ == WType::INSERT) {
+    txn->SetUndoNextLSN(item.prev_lsn_);
+    index_info->index_->DeleteEntry(new_key, item.rid_, txn);
+  } else if (item.wtype_ == WType::UPDATE) {
+    // Delete the new key and insert the old key
+    txn->SetUndoNextLSN(item.old_key_lsn_);
+    index_info->index_->DeleteEntry(new_key, item.rid_, txn);
+    txn->SetUndoNextLSN(item.prev_lsn_);
+    auto old_key = item.old_tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetKeySchema()),
+                                                index_info->index_->GetKeyAttrs());
+    index_info->index_->InsertEntry(old_key, item.rid_, txn);
+  }
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
-  // Rollback before releasing the lock.
+  // Buffered writes never reached the pages.
+  txn->GetReadSet()->clear();
+  txn->GetBufferedWriteSet()->clear();
+  // Rollback before releasing the lock. The table and index writes are rolled back together, in the reverse order of
+  // their log records, so that every compensation record points back past the records left to roll back.
   auto table_write_set = txn->GetWriteSet();
-  while (!table_write_set->empty()) {
-    auto &item = table_write_set->back();
-    auto *table = item.table_;
-    if (item.wtype_ == WType::DELETE) {
-      table->RollbackDelete(item.rid_, txn);
-    } else if (item.wtype_ == WType::INSERT) {
-      // Note that this also releases the lock when holding the page latch.
-      table->ApplyDelete(item.rid_, txn);
-    } else if (item.wtype_ == WType::UPDATE) {
-      table->UpdateTuple(item.tuple_, item.rid_, txn);
-    }
-    table_write_set->pop_back();
-  }
-  table_write_set->clear();
-  // Rollback index updates
   auto index_write_set = txn->GetIndexWriteSet();
-  while (!index_write_set->empty()) {
-    auto &item = index_write_set->back();
-    auto *catalog = item.catalog_;
-    // Metadata identifying the table that should be deleted from.
-    TableInfo *table_info = catalog->GetTable(item.table_oid_);
-    IndexInfo *index_info = catalog->GetIndex(item.index_oid_);
-    auto new_key = item.tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetKeySchema()),
-                                            index_info->index_->GetKeyAttrs());
-    if (item.wtype_ == WType::DELETE) {
-      index_info->index_->InsertEntry(new_key, item.rid_, txn);
-    } else if (item.wtype_ == WType::INSERT) {
-      index_info->index_->DeleteEntry(new_key, item.rid_, txn);
-    } else if (item.wtype_ == WType::UPDATE) {
-      // Delete the new key and insert the old key
-      index_info->index_->DeleteEntry(new_key, item.rid_, txn);
-      auto old_key = item.old_tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetKeySchema()),
-                                                  index_info->index_->GetKeyAttrs());
-      index_info->index_->InsertEntry(old_key, item.rid_, txn);
-    }
-    index_write_set->pop_back();
-  }
-  table_write_set->clear();
-  index_write_set->clear();
+  std::vector<GarbageRecord> written;
+  if (txn->HasVersionedWrites()) {
+    for (const auto &item : *table_write_set) {
+      written.push_back({last_commit_ts_, item.table_, item.rid_, false});
+    }
+  }
+  while (!table_write_set->empty() || !index_write_set->empty()) {
+    if (index_write_set->empty() ||
+        (!table_write_set->empty() && table_write_set->back().prev_lsn_ >= index_write_set->back().prev_lsn_)) {
+      RollbackTableWrite(table_write_set->back(), txn);
+      table_write_set->pop_back();
+    } else {
+      RollbackIndexWrite(index_write_set->back(), txn);
+      index_write_set->pop_back();
+    }
+  }
+  if (enable_logging) {
+    // the writes are rolled back, recovery does not undo the transaction again
+    LogRecord record = LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&record));
+  }
+
+  // The pages are rolled back, drop the versions saved for them. Whatever is left of the chains is pruned later.
+  if (txn->HasVersionedWrites()) {
+    std::vector<GarbageRecord> versioned;
+    for (const auto &record : written) {
+      if (record.table_->GetVersionStore()->Abort(txn->GetTransactionId(), record.rid_)) {
+        versioned.push_back(record);
+      }
+    }
+    std::scoped_lock garbage_latch(garbage_latch_);
+    garbage_.insert(garbage_.end(), versioned.begin(), versioned.end());
+    garbage_size_ = garbage_.size();
+  }
 
   // Release all the locks.
   ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  FinishUnversionedWrites(txn);
+  FinishSnapshot(txn);
+  if (txn->IsSnapshotRead() || txn->HasVersionedWrites()) {
+    GarbageCollect();
+  }
+  LeaveActive(txn);
 }
 
-void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
+void TransactionManager::GarbageCollect() {
+  if (garbage_size_ == 0) {
+    return;
+  }
+  timestamp_t watermark = Watermark();
+  std::vector<GarbageRecord> deletes;
+  {
+    std::scoped_lock garbage_latch(garbage_latch_);
+    while (!garbage_.empty() && garbage_.front().ts_ <= watermark) {
+      const auto &record = garbage_.front();
+      if (record.table_->GetVersionStore()->Prune(record.rid_, watermark) && record.deleted_) {
+        deletes.push_back(record);
+      }
+      garbage_.pop_front();
+    }
+    garbage_size_ = garbage_.size();
+  }
+  // The page latches are taken outside the garbage latch, the same order as writers take them.
+  for (const auto &record : deletes) {
+    record.table_->ApplyDelete(record.rid_, nullptr);
+  }
+}
+
+auto TransactionManager::Validate(Transaction *txn) -> bool {
+  // The transaction read the versions of its snapshot, they are still the newest ones if nothing was committed to
+  // the tuples since. The snapshot keeps the versions committed after it from being pruned.
+  for (const auto &record : *txn->GetReadSet()) {
+    if (record.table_->GetVersionStore()->LatestCommitTs(record.rid_) > txn->GetReadTs()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto TransactionManager::InstallWrites(Transaction *txn) -> bool {
+  auto buffered_write_set = txn->GetBufferedWriteSet();
+  while (!buffered_write_set->empty()) {
+    // installed writes move to the write set, so that an abort rolls them back
+    if (!buffered_write_set->front().table_->InstallWrite(buffered_write_set->front(), txn)) {
+      return false;
+    }
+    buffered_write_set->pop_front();
+  }
+  return true;
+}
 
-void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
+void TransactionManager::FinishSnapshot(Transaction *txn) {
+  if (!txn->IsSnapshotRead()) {
+    return;
+  }
+  {
+    std::scoped_lock latch(active_read_ts_latch_);
+    active_read_ts_.erase(active_read_ts_.find(txn->GetReadTs()));
+  }
+  snapshot_txns--;
+}
+
+auto TransactionManager::SavesVersions(Transaction *txn) -> bool {
+  if (txn->IsSnapshotRead()) {
+    return true;
+  }
+  if (txn->HasUnversionedWrites()) {
+    // snapshot transactions wait for this one to finish
+    return false;
+  }
+  unversioned_writers++;
+  if (snapshot_txns == 0) {
+    txn->SetUnversionedWrites(true);
+    return false;
+  }
+  // a snapshot transaction is running or about to take its snapshot, keep the older version for it
+  txn->SetUnversionedWrites(true);
+  FinishUnversionedWrites(txn);
+  return true;
+}
+
+void TransactionManager::WaitForUnversionedWriters() {
+  if (unversioned_writers == 0) {
+    return;
+  }
+  std::unique_lock latch(unversioned_latch);
+  unversioned_cv.wait(latch, [] { return unversioned_writers == 0; });
+}
+
+void TransactionManager::FinishUnversionedWrites(Transaction *txn) {
+  if (!txn->HasUnversionedWrites()) {
+    return;
+  }
+  txn->SetUnversionedWrites(false);
+  if (--unversioned_writers == 0 && snapshot_txns > 0) {
+    std::scoped_lock latch(unversioned_latch);
+    unversioned_cv.notify_all();
+  }
+}
+
+auto TransactionManager::Watermark() -> timestamp_t {
+  // A snapshot transaction counts itself before it reads last_commit_ts_, so if none is counted after the load,
+  // every later snapshot is at least as new.
+  timestamp_t last_commit_ts = last_commit_ts_;
+  if (snapshot_txns == 0) {
+    return last_commit_ts;
+  }
+  std::scoped_lock latch(active_read_ts_latch_);
+  return active_read_ts_.empty() ? last_commit_ts_.load() : *active_read_ts_.begin();
+}
+
+auto TransactionManager::GetTransaction(txn_id_t txn_id) -> Transaction * {
+  auto &shard = TxnMapShardOf(txn_id);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.txn_map_.find(txn_id);
+  return it == shard.txn_map_.end() ? nullptr : it->second;
+}
+
+auto TransactionManager::Wound(txn_id_t txn_id) -> bool {
+  // LeaveActive takes the same latch, so the transaction is neither finished nor freed while its state changes
+  auto &shard = TxnMapShardOf(txn_id);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.txn_map_.find(txn_id);
+  if (it == shard.txn_map_.end()) {
+    return false;
+  }
+  return it->second->CompareAndSetState(TransactionState::GROWING, TransactionState::ABORTED) ||
+         it->second->CompareAndSetState(TransactionState::SHRINKING, TransactionState::ABORTED);
+}
+
+auto TransactionManager::TxnMapShardOf(txn_id_t txn_id) -> TxnMapShard & {
+  return txn_map_shards[static_cast<size_t>(txn_id) & (TXN_SLOTS - 1)];
+}
+
+void TransactionManager::EnterActive(Transaction *txn) {
+  auto &slot = active_slots_[static_cast<size_t>(txn->GetTransactionId()) & (TXN_SLOTS - 1)];
+  while (true) {
+    // count first, then check: either the checkpoint sees the count or this sees blocked_ (both sequentially
+    // consistent)
+    slot.count_++;
+    if (!blocked_) {
+      return;
+    }
+    slot.count_--;
+    std::unique_lock latch(quiesce_latch_);
+    quiesce_cv_.notify_all();
+    quiesce_cv_.wait(latch, [this] { return !blocked_; });
+  }
+}
+
+void TransactionManager::LeaveActive(Transaction *txn) {
+  {
+    auto &shard = TxnMapShardOf(txn->GetTransactionId());
+    std::scoped_lock latch(shard.latch_);
+    auto it = shard.txn_map_.find(txn->GetTransactionId());
+    if (it != shard.txn_map_.end() && it->second == txn) {
+      shard.txn_map_.erase(it);
+    }
+  }
+  active_slots_[static_cast<size_t>(txn->GetTransactionId()) & (TXN_SLOTS - 1)].count_--;
+  if (blocked_) {
+    std::scoped_lock latch(quiesce_latch_);
+    quiesce_cv_.notify_all();
+  }
+}
+
+auto TransactionManager::ActiveCount() -> int64_t {
+  int64_t count = 0;
+  for (const auto &slot : active_slots_) {
+    count += slot.count_;
+  }
+  return count;
+}
+
+auto TransactionManager::GetActiveTransactions() -> std::vector<std::pair<txn_id_t, lsn_t>> {
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  for (auto &shard : txn_map_shards) {
+    std::scoped_lock latch(shard.latch_);
+    for (const auto &[txn_id, txn] : shard.txn_map_) {
+      lsn_t last_lsn = txn->GetPrevLSN();
+      if (last_lsn != INVALID_LSN) {
+        active_txns.emplace_back(txn_id, last_lsn);
+      }
+    }
+  }
+  return active_txns;
+}
+
+auto TransactionManager::GetOldestActiveLSN() -> lsn_t {
+  lsn_t oldest_lsn = INVALID_LSN;
+  for (auto &shard : txn_map_shards) {
+    std::scoped_lock latch(shard.latch_);
+    for (const auto &[txn_id, txn] : shard.txn_map_) {
+      lsn_t begin_lsn = txn->GetBeginLSN();
+      if (begin_lsn != INVALID_LSN && (oldest_lsn == INVALID_LSN || begin_lsn < oldest_lsn)) {
+        oldest_lsn = begin_lsn;
+      }
+    }
+  }
+  return oldest_lsn;
+}
+
+void TransactionManager::BlockAllTransactions() {
+  std::unique_lock latch(quiesce_latch_);
+  // one checkpoint at a time
+  quiesce_cv_.wait(latch, [this] { return !blocked_; });
+  blocked_ = true;
+  quiesce_cv_.wait(latch, [this] { return ActiveCount() == 0; });
+}
+
+void TransactionManager::ResumeTransactions() {
+  std::scoped_lock latch(quiesce_latch_);
+  blocked_ = false;
+  quiesce_cv_.notify_all();
+}
 
 }  // namespace bustub
@@ -0,0 +1,166 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/concurrency/version_store.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/version_store.h"
+
+#include <functional>
+
+namespace bustub {
+
+auto VersionStore::BeginWrite(Transaction *txn, const RID &rid, const Tuple *before, bool *first_write) -> bool {
+  auto &shard = ShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  *first_write = false;
+
+  if (before == nullptr) {
+    // an insert may reuse the slot of a tuple whose chain was pruned, whatever is left there is stale
+    auto &chain = shard.chains_[rid];
+    chain.writer_ = txn->GetTransactionId();
+    chain.ts_ = 0;
+    chain.undo_.clear();
+    chain.undo_.push_back({false, Tuple{}, 0});
+    *first_write = true;
+    return true;
+  }
+
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end()) {
+    // without a chain the version in the page is older than every active snapshot
+    auto &chain = shard.chains_[rid];
+    chain.writer_ = txn->GetTransactionId();
+    chain.undo_.push_back({true, *before, 0});
+    *first_write = true;
+    return true;
+  }
+
+  auto &chain = it->second;
+  if (chain.writer_ == txn->GetTransactionId()) {
+    return true;
+  }
+  bool conflict = chain.writer_ != INVALID_TXN_ID;
+  if (txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION) {
+    // a version committed after the snapshot was taken must not be overwritten
+    conflict = conflict || chain.ts_ > txn->GetReadTs();
+  }
+  if (conflict) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  chain.writer_ = txn->GetTransactionId();
+  chain.undo_.insert(chain.undo_.begin(), {true, *before, chain.ts_});
+  *first_write = true;
+  return true;
+}
+
+auto VersionStore::GetVisible(Transaction *txn, const RID &rid, Tuple *tuple) -> Visibility {
+  auto &shard = ShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end()) {
+    return Visibility::IN_PLACE;
+  }
+  auto &chain = it->second;
+  if (chain.writer_ == txn->GetTransactionId() ||
+      (chain.writer_ == INVALID_TXN_ID && chain.ts_ <= txn->GetReadTs())) {
+    return Visibility::IN_PLACE;
+  }
+  for (const auto &version : chain.undo_) {
+    if (version.ts_ <= txn->GetReadTs()) {
+      if (!version.exists_) {
+        return Visibility::INVISIBLE;
+      }
+      *tuple = version.tuple_;
+      return Visibility::UNDO;
+    }
+  }
+  return Visibility::INVISIBLE;
+}
+
+auto VersionStore::LatestCommitTs(const RID &rid) -> timestamp_t {
+  auto &shard = ShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end()) {
+    return 0;
+  }
+  const auto &chain = it->second;
+  if (chain.writer_ == INVALID_TXN_ID) {
+    return chain.ts_;
+  }
+  // the version in the page is not committed yet
+  return chain.undo_.empty() ? 0 : chain.undo_.front().ts_;
+}
+
+auto VersionStore::Commit(txn_id_t txn_id, const RID &rid, timestamp_t commit_ts) -> bool {
+  auto &shard = ShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end() || it->second.writer_ != txn_id) {
+    return false;
+  }
+  it->second.writer_ = INVALID_TXN_ID;
+  it->second.ts_ = commit_ts;
+  return true;
+}
+
+auto VersionStore::Abort(txn_id_t txn_id, const RID &rid) -> bool {
+  auto &shard = ShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end() || it->second.writer_ != txn_id) {
+    return false;
+  }
+  auto &chain = it->second;
+  chain.writer_ = INVALID_TXN_ID;
+  chain.undo_.erase(chain.undo_.begin());
+  if (chain.undo_.empty()) {
+    shard.chains_.erase(it);
+    return false;
+  }
+  return true;
+}
+
+auto VersionStore::Prune(const RID &rid, timestamp_t watermark) -> bool {
+  auto &shard = ShardOf(rid);
+  std::scoped_lock latch(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end()) {
+    return true;
+  }
+  auto &chain = it->second;
+  if (chain.writer_ == INVALID_TXN_ID && chain.ts_ <= watermark) {
+    shard.chains_.erase(it);
+    return true;
+  }
+  // the oldest snapshot reads the first version at or before the watermark, everything older is garbage
+  for (size_t i = 0; i < chain.undo_.size(); i++) {
+    if (chain.undo_[i].ts_ <= watermark) {
+      chain.undo_.erase(chain.undo_.begin() + i + 1, chain.undo_.end());
+      break;
+    }
+  }
+  return false;
+}
+
+auto VersionStore::Size() -> size_t {
+  size_t size = 0;
+  for (auto &shard : shards_) {
+    std::scoped_lock latch(shard.latch_);
+    size += shard.chains_.size();
+  }
+  return size;
+}
+
+auto VersionStore::ShardOf(const RID &rid) -> Shard & {
+  auto hash = static_cast<uint64_t>(std::hash<RID>()(rid)) * 0x9E3779B97F4A7C15ULL;
+  return shards_[hash >> 60 & (SHARDS - 1)];
+}
+
+}  // namespace bustub
@@ -0,0 +1,897 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree.cpp
+//
+// Identification: src/container/art/adaptive_radix_tree.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "container/art/adaptive_radix_tree.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>  // NOLINT
+#include <utility>
+
+namespace bustub {
+
+namespace {
+
+// leaves are told apart from inner nodes by the lowest bit of the child pointer
+inline auto IsLeaf(const void *child) -> bool { return (reinterpret_cast<uintptr_t>(child) & 1) == 1; }
+
+inline auto KeyByte(const std::string &key, uint32_t depth) -> uint8_t { return static_cast<uint8_t>(key[depth]); }
+
+}  // namespace
+
+enum class ArtNodeType : uint8_t { NODE4, NODE16, NODE48, NODE256 };
+
+struct AdaptiveRadixTree::Leaf {
+  Leaf(std::string key, RID value) : key_(std::move(key)), value_(value) {}
+
+  auto Tagged() -> void * { return reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(this) | 1); }
+
+  static auto Untag(void *child) -> Leaf * {
+    return reinterpret_cast<Leaf *>(reinterpret_cast<uintptr_t>(child) & ~static_cast<uintptr_t>(1));
+  }
+
+  // leaves are immutable once published, an update replaces the leaf
+  const std::string key_;
+  const RID value_;
+};
+
+/**
+ * Common header of all inner nodes. The version word holds the obsolete flag
+ * (bit 0), the lock flag (bit 1) and a counter that is bumped by every
+ * modification (the remaining bits).
+ */
+struct AdaptiveRadixTree::Node {
+  explicit Node(ArtNodeType type) : type_(type) {}
+
+  /** @return the current version, sets restart if the node is locked or obsolete */
+  auto ReadLock(bool *restart) const -> uint64_t {
+    uint64_t version = version_.load();
+    if ((version & 3) != 0) {
+      if ((version & 2) != 0) {
+        std::this_thread::yield();
+      }
+      *restart = true;
+    }
+    return version;
+  }
+
+  /** @return true if the node did not change since version was read */
+  auto Validate(uint64_t version) const -> bool { return version_.load() == version; }
+
+  /** Turn a read of version into the write lock, fails if the node changed in between */
+  auto Upgrade(uint64_t version) -> bool { return version_.compare_exchange_strong(version, version + 2); }
+
+  /** Take the write lock without a previous read */
+  auto Lock() -> bool {
+    bool restart = false;
+    uint64_t version = ReadLock(&restart);
+    return !restart && Upgrade(version);
+  }
+
+  void WriteUnlock() { version_.fetch_add(2); }
+
+  void WriteUnlockObsolete() { version_.fetch_add(3); }
+
+  auto Capacity() const -> uint16_t;
+  auto IsFull() const -> bool { return count_.load() == Capacity(); }
+  auto FindChild(uint8_t byte) const -> void *;
+  auto AnyChild() const -> void *;
+  void AddChild(uint8_t byte, void *child);
+  void ChangeChild(uint8_t byte, void *child);
+  void RemoveChild(uint8_t byte);
+  // call f(byte, child) for every child in key order
+  template <typename F>
+  void ForEachChild(F &&f) const;
+
+  /** Set the prefix to the length bytes at prefix, only the first MAX_STORED_PREFIX are kept */
+  void SetPrefix(const uint8_t *prefix, uint32_t length) {
+    memcpy(prefix_, prefix, std::min(length, MAX_STORED_PREFIX));
+    prefix_len_.store(length);
+  }
+
+  std::atomic<uint64_t> version_{0};
+  const ArtNodeType type_;
+  std::atomic<uint16_t> count_{0};
+  std::atomic<uint32_t> prefix_len_{0};
+  uint8_t prefix_[MAX_STORED_PREFIX]{};
+};
+
+struct AdaptiveRadixTree::Node4 : public Node {
+  Node4() : Node(ArtNodeType::NODE4) {}
+  uint8_t keys_[4]{};
+  std::atomic<void *> children_[4]{};
+};
+
+struct AdaptiveRadixTree::Node16 : public Node {
+  Node16() : Node(ArtNodeType::NODE16) {}
+  uint8_t keys_[16]{};
+  std::atomic<void *> children_[16]{};
+};
+
+struct AdaptiveRadixTree::Node48 : public Node {
+  static constexpr uint8_t EMPTY = 0;
+  Node48() : Node(ArtNodeType::NODE48) {}
+  // slot of the child of a key byte plus one, EMPTY if there is no child
+  std::atomic<uint8_t> child_index_[256]{};
+  std::atomic<void *> children_[48]{};
+};
+
+struct AdaptiveRadixTree::Node256 : public Node {
+  Node256() : Node(ArtNodeType::NODE256) {}
+  std::atomic<void *> children_[256]{};
+};
+
+/*****************************************************************************
+ * NODE OPERATIONS
+ *
+ * Lookups may run concurrently with a writer and see a half-done change; the
+ * caller validates the node version before trusting the result.
+ *****************************************************************************/
+namespace {
+
+template <typename N>
+auto FindInSorted(const N *node, uint8_t byte) -> void * {
+  uint16_t count = std::min<uint16_t>(node->count_.load(), std::size(node->keys_));
+  for (uint16_t i = 0; i < count; i++) {
+    if (node->keys_[i] == byte) {
+      return node->children_[i].load();
+    }
+  }
+  return nullptr;
+}
+
+template <typename N>
+void AddToSorted(N *node, uint8_t byte, void *child) {
+  uint16_t count = node->count_.load();
+  uint16_t pos = 0;
+  while (pos < count && node->keys_[pos] < byte) {
+    pos++;
+  }
+  for (uint16_t i = count; i > pos; i--) {
+    node->keys_[i] = node->keys_[i - 1];
+    node->children_[i].store(node->children_[i - 1].load());
+  }
+  node->keys_[pos] = byte;
+  node->children_[pos].store(child);
+  node->count_.store(count + 1);
+}
+
+template <typename N>
+void ChangeInSorted(N *node, uint8_t byte, void *child) {
+  for (uint16_t i = 0; i < node->count_.load(); i++) {
+    if (node->keys_[i] == byte) {
+      node->children_[i].store(child);
+      return;
+    }
+  }
+}
+
+template <typename N>
+void RemoveFromSorted(N *node, uint8_t byte) {
+  uint16_t count = node->count_.load();
+  for (uint16_t i = 0; i < count; i++) {
+    if (node->keys_[i] == byte) {
+      for (uint16_t j = i; j + 1 < count; j++) {
+        node->keys_[j] = node->keys_[j + 1];
+        node->children_[j].store(node->children_[j + 1].load());
+      }
+      node->children_[count - 1].store(nullptr);
+      node->count_.store(count - 1);
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+auto AdaptiveRadixTree::Node::Capacity() const -> uint16_t {
+  switch (type_) {
+    case ArtNodeType::NODE4:
+      return 4;
+    case ArtNodeType::NODE16:
+      return 16;
+    case ArtNodeType::NODE48:
+      return 48;
+    case ArtNodeType::NODE256:
+      return 256;
+  }
+  return 0;
+}
+
+auto AdaptiveRadixTree::Node::FindChild(uint8_t byte) const -> void * {
+  switch (type_) {
+    case ArtNodeType::NODE4:
+      return FindInSorted(static_cast<const Node4 *>(this), byte);
+    case ArtNodeType::NODE16:
+      return FindInSorted(static_cast<const Node16 *>(this), byte);
+    case ArtNodeType::NODE48: {
+      const auto *node = static_cast<const Node48 *>(this);
+      uint8_t index = node->child_index_[byte].load();
+      return index == Node48::EMPTY ? nullptr : node->children_[index - 1].load();
+    }
+    case ArtNodeType::NODE256:
+      return static_cast<const Node256 *>(this)->children_[byte].load();
+  }
+  return nullptr;
+}
+
+auto AdaptiveRadixTree::Node::AnyChild() const -> void * {
+  void *any = nullptr;
+  ForEachChild([&any](uint8_t /*byte*/, void *child) {
+    if (any == nullptr) {
+      any = child;
+    }
+  });
+  return any;
+}
+
+void AdaptiveRadixTree::Node::AddChild(uint8_t byte, void *child) {
+  switch (type_) {
+    case ArtNodeType::NODE4:
+      AddToSorted(static_cast<Node4 *>(this), byte, child);
+      return;
+    case ArtNodeType::NODE16:
+      AddToSorted(static_cast<Node16 *>(this), byte, child);
+      return;
+    case ArtNodeType::NODE48: {
+      auto *node = static_cast<Node48 *>(this);
+      uint8_t slot = 0;
+      while (node->children_[slot].load() != nullptr) {
+        slot++;
+      }
+      // publish the child before the index that points to it
+      node->children_[slot].store(child);
+      node->child_index_[byte].store(slot + 1);
+      count_.fetch_add(1);
+      return;
+    }
+    case ArtNodeType::NODE256:
+      static_cast<Node256 *>(this)->children_[byte].store(child);
+      count_.fetch_add(1);
+      return;
+  }
+}
+
+void AdaptiveRadixTree::Node::ChangeChild(uint8_t byte, void *child) {
+  switch (type_) {
+    case ArtNodeType::NODE4:
+      ChangeInSorted(static_cast<Node4 *>(this), byte, child);
+      return;
+    case ArtNodeType::NODE16:
+      ChangeInSorted(static_cast<Node16 *>(this), byte, child);
+      return;
+    case ArtNodeType::NODE48: {
+      auto *node = static_cast<Node48 *>(this);
+      node->children_[node->child_index_[byte].load() - 1].store(child);
+      return;
+    }
+    case ArtNodeType::NODE256:
+      static_cast<Node256 *>(this)->children_[byte].store(child);
+      return;
+  }
+}
+
+void AdaptiveRadixTree::Node::RemoveChild(uint8_t byte) {
+  switch (type_) {
+    case ArtNodeType::NODE4:
+      RemoveFromSorted(static_cast<Node4 *>(this), byte);
+      return;
+    case ArtNodeType::NODE16:
+      RemoveFromSorted(static_cast<Node16 *>(this), byte);
+      return;
+    case ArtNodeType::NODE48: {
+      auto *node = static_cast<Node48 *>(this);
+      uint8_t index = node->child_index_[byte].load();
+      node->child_index_[byte].store(Node48::EMPTY);
+      node->children_[index - 1].store(nullptr);
+      count_.fetch_sub(1);
+      return;
+    }
+    case ArtNodeType::NODE256:
+      static_cast<Node256 *>(this)->children_[byte].store(nullptr);
+      count_.fetch_sub(1);
+      return;
+  }
+}
+
+template <typename F>
+void AdaptiveRadixTree::Node::ForEachChild(F &&f) const {
+  switch (type_) {
+    case ArtNodeType::NODE4:
+    case ArtNodeType::NODE16: {
+      const uint8_t *keys = type_ == ArtNodeType::NODE4 ? static_cast<const Node4 *>(this)->keys_
+                                                        : static_cast<const Node16 *>(this)->keys_;
+      const std::atomic<void *> *children = type_ == ArtNodeType::NODE4
+                                                ? static_cast<const Node4 *>(this)->children_
+                                                : static_cast<const Node16 *>(this)->children_;
+      uint16_t count = std::min(count_.load(), Capacity());
+      for (uint16_t i = 0; i < count; i++) {
+        void *child = children[i].load();
+        if (child != nullptr) {
+          f(keys[i], child);
+        }
+      }
+      return;
+    }
+    case ArtNodeType::NODE48: {
+      const auto *node = static_cast<const Node48 *>(this);
+      for (int byte = 0; byte < 256; byte++) {
+        uint8_t index = node->child_index_[byte].load();
+        if (index != Node48::EMPTY) {
+          void *child = node->children_[index - 1].load();
+          if (child != nullptr) {
+            f(static_cast<uint8_t>(byte), child);
+          }
+        }
+      }
+      return;
+    }
+    case ArtNodeType::NODE256: {
+      const auto *node = static_cast<const Node256 *>(this);
+      for (int byte = 0; byte < 256; byte++) {
+        void *child = node->children_[byte].load();
+        if (child != nullptr) {
+          f(static_cast<uint8_t>(byte), child);
+        }
+      }
+      return;
+    }
+  }
+}
+
+/*
+ * Copy node into the next larger node type together with one more child
+ */
+auto AdaptiveRadixTree::GrowAndInsert(Node *node, uint8_t byte, void *child) -> Node * {
+  Node *bigger;
+  switch (node->type_) {
+    case ArtNodeType::NODE4:
+      bigger = new Node16();
+      break;
+    case ArtNodeType::NODE16:
+      bigger = new Node48();
+      break;
+    default:
+      bigger = new Node256();
+      break;
+  }
+  bigger->SetPrefix(node->prefix_, node->prefix_len_.load());
+  node->ForEachChild([bigger](uint8_t b, void *c) { bigger->AddChild(b, c); });
+  bigger->AddChild(byte, child);
+  return bigger;
+}
+
+/*
+ * Copy node into the next smaller node type
+ */
+auto AdaptiveRadixTree::Shrink(Node *node) -> Node * {
+  Node *smaller;
+  switch (node->type_) {
+    case ArtNodeType::NODE256:
+      smaller = new Node48();
+      break;
+    case ArtNodeType::NODE48:
+      smaller = new Node16();
+      break;
+    default:
+      smaller = new Node4();
+      break;
+  }
+  smaller->SetPrefix(node->prefix_, node->prefix_len_.load());
+  node->ForEachChild([smaller](uint8_t b, void *c) { smaller->AddChild(b, c); });
+  return smaller;
+}
+
+namespace {
+
+// a node is replaced by the next smaller type once it drops to this many children, a bit below the capacity of the
+// smaller type so that alternating inserts and removes do not resize every time
+auto ShrinkThreshold(ArtNodeType type) -> uint16_t {
+  switch (type) {
+    case ArtNodeType::NODE16:
+      return 3;
+    case ArtNodeType::NODE48:
+      return 12;
+    case ArtNodeType::NODE256:
+      return 37;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+void AdaptiveRadixTree::DeleteNode(Node *node) {
+  switch (node->type_) {
+    case ArtNodeType::NODE4:
+      delete static_cast<Node4 *>(node);
+      return;
+    case ArtNodeType::NODE16:
+      delete static_cast<Node16 *>(node);
+      return;
+    case ArtNodeType::NODE48:
+      delete static_cast<Node48 *>(node);
+      return;
+    case ArtNodeType::NODE256:
+      delete static_cast<Node256 *>(node);
+      return;
+  }
+}
+
+void AdaptiveRadixTree::DeleteSubtree(void *child) {
+  if (IsLeaf(child)) {
+    delete Leaf::Untag(child);
+    return;
+  }
+  auto *node = static_cast<Node *>(child);
+  node->ForEachChild([](uint8_t /*byte*/, void *c) { DeleteSubtree(c); });
+  DeleteNode(node);
+}
+
+void AdaptiveRadixTree::Retire(void *child) {
+  if (IsLeaf(child)) {
+    epoch_manager_.Retire(Leaf::Untag(child));
+  } else {
+    auto *node = static_cast<Node *>(child);
+    epoch_manager_.Retire([node] { DeleteNode(node); });
+  }
+}
+
+/*****************************************************************************
+ * TREE OPERATIONS
+ *****************************************************************************/
+// the root is a Node256 without prefix, so it never grows, shrinks or is replaced
+AdaptiveRadixTree::AdaptiveRadixTree() : root_(new Node256()) {}
+
+AdaptiveRadixTree::~AdaptiveRadixTree() { DeleteSubtree(root_); }
+
+auto AdaptiveRadixTree::Get(const std::string &key, RID *value) -> bool {
+  EpochGuard guard(&epoch_manager_);
+  Attempt attempt;
+  while ((attempt = TryGet(key, value)) == Attempt::RESTART) {
+  }
+  return attempt == Attempt::SUCCEEDED;
+}
+
+auto AdaptiveRadixTree::ScanPrefix(const std::string &prefix, std::vector<RID> *result) -> bool {
+  EpochGuard guard(&epoch_manager_);
+  size_t size = result->size();
+  Attempt attempt;
+  while ((attempt = TryScanPrefix(prefix, result)) == Attempt::RESTART) {
+    result->resize(size);
+  }
+  return attempt == Attempt::SUCCEEDED;
+}
+
+auto AdaptiveRadixTree::Insert(const std::string &key, RID value) -> bool {
+  EpochGuard guard(&epoch_manager_);
+  Attempt attempt;
+  while ((attempt = TryInsert(key, value)) == Attempt::RESTART) {
+  }
+  return attempt == Attempt::SUCCEEDED;
+}
+
+auto AdaptiveRadixTree::Remove(const std::string &key) -> bool {
+  EpochGuard guard(&epoch_manager_);
+  Attempt attempt;
+  while ((attempt = TryRemove(key)) == Attempt::RESTART) {
+  }
+  return attempt == Attempt::SUCCEEDED;
+}
+
+auto AdaptiveRadixTree::TryGet(const std::string &key, RID *value) -> Attempt {
+  bool restart = false;
+  Node *node = root_;
+  uint64_t version = node->ReadLock(&restart);
+  if (restart) {
+    return Attempt::RESTART;
+  }
+  uint32_t depth = 0;
+  while (true) {
+    // only the stored part of the prefix is compared, the leaf holds the full key
+    uint32_t prefix_len = node->prefix_len_.load();
+    for (uint32_t i = 0; i < std::min(prefix_len, MAX_STORED_PREFIX); i++) {
+      if (depth + i >= key.size() || node->prefix_[i] != KeyByte(key, depth + i)) {
+        return node->Validate(version) ? Attempt::FAILED : Attempt::RESTART;
+      }
+    }
+    depth += prefix_len;
+    if (depth >= key.size()) {
+      return node->Validate(version) ? Attempt::FAILED : Attempt::RESTART;
+    }
+
+    void *child = node->FindChild(KeyByte(key, depth));
+    if (!node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+    if (child == nullptr) {
+      return Attempt::FAILED;
+    }
+    if (IsLeaf(child)) {
+      Leaf *leaf = Leaf::Untag(child);
+      if (leaf->key_ != key) {
+        return Attempt::FAILED;
+      }
+      *value = leaf->value_;
+      return Attempt::SUCCEEDED;
+    }
+
+    auto *next = static_cast<Node *>(child);
+    uint64_t next_version = next->ReadLock(&restart);
+    if (restart || !node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+    node = next;
+    version = next_version;
+    depth++;
+  }
+}
+
+auto AdaptiveRadixTree::TryScanPrefix(const std::string &prefix, std::vector<RID> *result) -> Attempt {
+  bool restart = false;
+  Node *node = root_;
+  uint64_t version = node->ReadLock(&restart);
+  if (restart) {
+    return Attempt::RESTART;
+  }
+  uint32_t depth = 0;
+  std::vector<Leaf *> leaves;
+  while (true) {
+    uint32_t prefix_len = node->prefix_len_.load();
+    for (uint32_t i = 0; i < std::min(prefix_len, MAX_STORED_PREFIX) && depth + i < prefix.size(); i++) {
+      if (node->prefix_[i] != KeyByte(prefix, depth + i)) {
+        return node->Validate(version) ? Attempt::FAILED : Attempt::RESTART;
+      }
+    }
+    if (depth + prefix_len >= prefix.size()) {
+      // the prefix ends inside this node, every key below it is a candidate
+      if (!CollectLeaves(node, version, &leaves)) {
+        return Attempt::RESTART;
+      }
+      break;
+    }
+    depth += prefix_len;
+
+    void *child = node->FindChild(KeyByte(prefix, depth));
+    if (!node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+    if (child == nullptr) {
+      return Attempt::FAILED;
+    }
+    if (IsLeaf(child)) {
+      leaves.push_back(Leaf::Untag(child));
+      break;
+    }
+    auto *next = static_cast<Node *>(child);
+    uint64_t next_version = next->ReadLock(&restart);
+    if (restart || !node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+    node = next;
+    version = next_version;
+    depth++;
+  }
+
+  bool found = false;
+  for (Leaf *leaf : leaves) {
+    if (leaf->key_.compare(0, prefix.size(), prefix) == 0) {
+      result->push_back(leaf->value_);
+      found = true;
+    }
+  }
+  return found ? Attempt::SUCCEEDED : Attempt::FAILED;
+}
+
+auto AdaptiveRadixTree::CollectLeaves(Node *node, uint64_t version, std::vector<Leaf *> *leaves) -> bool {
+  std::vector<void *> children;
+  node->ForEachChild([&children](uint8_t /*byte*/, void *child) { children.push_back(child); });
+  if (!node->Validate(version)) {
+    return false;
+  }
+  for (void *child : children) {
+    if (IsLeaf(child)) {
+      leaves->push_back(Leaf::Untag(child));
+      continue;
+    }
+    bool restart = false;
+    auto *next = static_cast<Node *>(child);
+    uint64_t next_version = next->ReadLock(&restart);
+    if (restart || !CollectLeaves(next, next_version, leaves)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto AdaptiveRadixTree::LoadPrefix(Node *node, uint64_t version, uint32_t depth, std::string *prefix) -> bool {
+  uint32_t prefix_len = node->prefix_len_.load();
+  if (prefix_len <= MAX_STORED_PREFIX) {
+    prefix->assign(reinterpret_cast<const char *>(node->prefix_), prefix_len);
+    return node->Validate(version);
+  }
+  // all keys below node share the prefix, so any leaf has the bytes that are not stored
+  void *child = node;
+  while (child != nullptr && !IsLeaf(child)) {
+    child = static_cast<Node *>(child)->AnyChild();
+  }
+  if (child == nullptr || !node->Validate(version)) {
+    return false;
+  }
+  const std::string &key = Leaf::Untag(child)->key_;
+  if (key.size() < depth + prefix_len) {
+    return false;
+  }
+  prefix->assign(key, depth, prefix_len);
+  return true;
+}
+
+auto AdaptiveRadixTree::TryInsert(const std::string &key, RID value) -> Attempt {
+  bool restart = false;
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  Node *node = root_;
+  uint64_t version = node->ReadLock(&restart);
+  if (restart) {
+    return Attempt::RESTART;
+  }
+  uint32_t depth = 0;
+  while (true) {
+    uint32_t prefix_len = node->prefix_len_.load();
+    if (prefix_len > 0) {
+      std::string prefix;
+      if (!LoadPrefix(node, version, depth, &prefix)) {
+        return Attempt::RESTART;
+      }
+      uint32_t mismatch = 0;
+      while (mismatch < prefix_len && depth + mismatch < key.size() &&
+             static_cast<uint8_t>(prefix[mismatch]) == KeyByte(key, depth + mismatch)) {
+        mismatch++;
+      }
+      if (mismatch < prefix_len) {
+        if (depth + mismatch >= key.size()) {
+          // the key is a prefix of keys in the tree
+          return Attempt::FAILED;
+        }
+        // split the prefix: a new node takes the common part and branches to node and the new leaf
+        if (!parent->Upgrade(parent_version)) {
+          return Attempt::RESTART;
+        }
+        if (!node->Upgrade(version)) {
+          parent->WriteUnlock();
+          return Attempt::RESTART;
+        }
+        const auto *bytes = reinterpret_cast<const uint8_t *>(prefix.data());
+        auto *branch = new Node4();
+        branch->SetPrefix(bytes, mismatch);
+        branch->AddChild(bytes[mismatch], node);
+        branch->AddChild(KeyByte(key, depth + mismatch), (new Leaf(key, value))->Tagged());
+        node->SetPrefix(bytes + mismatch + 1, prefix_len - mismatch - 1);
+        parent->ChangeChild(parent_byte, branch);
+        node->WriteUnlock();
+        parent->WriteUnlock();
+        return Attempt::SUCCEEDED;
+      }
+      depth += prefix_len;
+    }
+    if (depth >= key.size()) {
+      return node->Validate(version) ? Attempt::FAILED : Attempt::RESTART;
+    }
+
+    uint8_t byte = KeyByte(key, depth);
+    void *child = node->FindChild(byte);
+    if (!node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+
+    if (child == nullptr) {
+      if (node->IsFull()) {
+        // the root never fills up, so a full node always has a parent
+        if (!parent->Upgrade(parent_version)) {
+          return Attempt::RESTART;
+        }
+        if (!node->Upgrade(version)) {
+          parent->WriteUnlock();
+          return Attempt::RESTART;
+        }
+        Node *bigger = GrowAndInsert(node, byte, (new Leaf(key, value))->Tagged());
+        parent->ChangeChild(parent_byte, bigger);
+        node->WriteUnlockObsolete();
+        parent->WriteUnlock();
+        Retire(node);
+        return Attempt::SUCCEEDED;
+      }
+      if (!node->Upgrade(version)) {
+        return Attempt::RESTART;
+      }
+      node->AddChild(byte, (new Leaf(key, value))->Tagged());
+      node->WriteUnlock();
+      return Attempt::SUCCEEDED;
+    }
+
+    if (IsLeaf(child)) {
+      Leaf *leaf = Leaf::Untag(child);
+      if (leaf->key_ == key) {
+        return Attempt::FAILED;
+      }
+      // both keys share the path so far, branch where they start to differ
+      uint32_t next_depth = depth + 1;
+      uint32_t common = 0;
+      while (next_depth + common < key.size() && next_depth + common < leaf->key_.size() &&
+             key[next_depth + common] == leaf->key_[next_depth + common]) {
+        common++;
+      }
+      if (next_depth + common >= key.size() || next_depth + common >= leaf->key_.size()) {
+        return Attempt::FAILED;
+      }
+      if (!node->Upgrade(version)) {
+        return Attempt::RESTART;
+      }
+      auto *branch = new Node4();
+      branch->SetPrefix(reinterpret_cast<const uint8_t *>(key.data()) + next_depth, common);
+      branch->AddChild(KeyByte(leaf->key_, next_depth + common), child);
+      branch->AddChild(KeyByte(key, next_depth + common), (new Leaf(key, value))->Tagged());
+      node->ChangeChild(byte, branch);
+      node->WriteUnlock();
+      return Attempt::SUCCEEDED;
+    }
+
+    auto *next = static_cast<Node *>(child);
+    uint64_t next_version = next->ReadLock(&restart);
+    if (restart || !node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = next;
+    version = next_version;
+    depth++;
+  }
+}
+
+auto AdaptiveRadixTree::TryRemove(const std::string &key) -> Attempt {
+  bool restart = false;
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  Node *node = root_;
+  uint64_t version = node->ReadLock(&restart);
+  if (restart) {
+    return Attempt::RESTART;
+  }
+  uint32_t depth = 0;
+  while (true) {
+    uint32_t prefix_len = node->prefix_len_.load();
+    for (uint32_t i = 0; i < std::min(prefix_len, MAX_STORED_PREFIX); i++) {
+      if (depth + i >= key.size() || node->prefix_[i] != KeyByte(key, depth + i)) {
+        return node->Validate(version) ? Attempt::FAILED : Attempt::RESTART;
+      }
+    }
+    depth += prefix_len;
+    if (depth >= key.size()) {
+      return node->Validate(version) ? Attempt::FAILED : Attempt::RESTART;
+    }
+
+    uint8_t byte = KeyByte(key, depth);
+    void *child = node->FindChild(byte);
+    if (!node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+    if (child == nullptr) {
+      return Attempt::FAILED;
+    }
+
+    if (IsLeaf(child)) {
+      if (Leaf::Untag(child)->key_ != key) {
+        return Attempt::FAILED;
+      }
+      uint16_t count = node->count_.load();
+      if (node != root_ && node->type_ == ArtNodeType::NODE4 && count <= 2) {
+        // node is left with a single child, which takes its place in the parent
+        if (!parent->Upgrade(parent_version)) {
+          return Attempt::RESTART;
+        }
+        if (!node->Upgrade(version)) {
+          parent->WriteUnlock();
+          return Attempt::RESTART;
+        }
+        if (!CompressPath(node, byte, parent, parent_byte)) {
+          node->WriteUnlock();
+          parent->WriteUnlock();
+          return Attempt::RESTART;
+        }
+        node->WriteUnlockObsolete();
+        parent->WriteUnlock();
+        Retire(node);
+      } else if (node != root_ && count - 1 <= ShrinkThreshold(node->type_)) {
+        if (!parent->Upgrade(parent_version)) {
+          return Attempt::RESTART;
+        }
+        if (!node->Upgrade(version)) {
+          parent->WriteUnlock();
+          return Attempt::RESTART;
+        }
+        node->RemoveChild(byte);
+        parent->ChangeChild(parent_byte, Shrink(node));
+        node->WriteUnlockObsolete();
+        parent->WriteUnlock();
+        Retire(node);
+      } else {
+        if (!node->Upgrade(version)) {
+          return Attempt::RESTART;
+        }
+        node->RemoveChild(byte);
+        node->WriteUnlock();
+      }
+      Retire(child);
+      return Attempt::SUCCEEDED;
+    }
+
+    auto *next = static_cast<Node *>(child);
+    uint64_t next_version = next->ReadLock(&restart);
+    if (restart || !node->Validate(version)) {
+      return Attempt::RESTART;
+    }
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = next;
+    version = next_version;
+    depth++;
+  }
+}
+
+/*
+ * Both node and parent are write locked. The child of node that is left after
+ * removing removed_byte is hung into parent directly; an inner child absorbs
+ * the prefix of node and the key byte that led to it. Fails without any change
+ * if the child cannot be locked.
+ */
+auto AdaptiveRadixTree::CompressPath(Node *node, uint8_t removed_byte, Node *parent, uint8_t parent_byte) -> bool {
+  uint8_t child_byte = 0;
+  void *child = nullptr;
+  node->ForEachChild([&](uint8_t b, void *c) {
+    if (b != removed_byte) {
+      child_byte = b;
+      child = c;
+    }
+  });
+  if (child == nullptr) {
+    parent->RemoveChild(parent_byte);
+    return true;
+  }
+  if (IsLeaf(child)) {
+    parent->ChangeChild(parent_byte, child);
+    return true;
+  }
+
+  auto *next = static_cast<Node *>(child);
+  if (!next->Lock()) {
+    return false;
+  }
+  // only the stored bytes are known, which is enough as the rest is only ever read from leaves
+  uint32_t node_prefix_len = node->prefix_len_.load();
+  uint32_t next_prefix_len = next->prefix_len_.load();
+  std::string prefix(reinterpret_cast<const char *>(node->prefix_), std::min(node_prefix_len, MAX_STORED_PREFIX));
+  if (node_prefix_len < MAX_STORED_PREFIX) {
+    prefix.push_back(static_cast<char>(child_byte));
+    prefix.append(reinterpret_cast<const char *>(next->prefix_), std::min(next_prefix_len, MAX_STORED_PREFIX));
+  }
+  prefix.resize(std::min<size_t>(prefix.size(), MAX_STORED_PREFIX));
+  memcpy(next->prefix_, prefix.data(), prefix.size());
+  next->prefix_len_.store(node_prefix_len + 1 + next_prefix_len);
+  parent->ChangeChild(parent_byte, next);
+  next->WriteUnlock();
+  return true;
+}
+
+}  // namespace bustub
@@ -12,8 +12,10 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <list>
+#include <string>
 #include <utility>
 
 #include "container/hash/extendible_hash_table.h"
@@ -23,7 +25,9 @@ namespace bustub {
 
 template <typename K, typename V>
 ExtendibleHashTable<K, V>::ExtendibleHashTable(size_t bucket_size)
-    : global_depth_(0), bucket_size_(bucket_size), num_buckets_(1) {}
+    : global_depth_(0), bucket_size_(bucket_size), num_buckets_(1) {
+  dir_.push_back(std::make_shared<Bucket>(bucket_size_, 0));
+}
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::IndexOf(const K &key) -> size_t {
@@ -33,7 +37,7 @@ auto ExtendibleHashTable<K, V>::IndexOf(const K &key) -> size_t {
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::GetGlobalDepth() const -> int {
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::shared_lock lock(latch_);
   return GetGlobalDepthInternal();
 }
 
@@ -44,7 +48,7 @@ auto ExtendibleHashTable<K, V>::GetGlobalDepthInternal() const -> int {
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::GetLocalDepth(int dir_index) const -> int {
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::shared_lock lock(latch_);
   return GetLocalDepthInternal(dir_index);
 }
 
@@ -55,7 +59,7 @@ auto ExtendibleHashTable<K, V>::GetLocalDepthInternal(int dir_index) const -> in
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::GetNumBuckets() const -> int {
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::shared_lock lock(latch_);
   return GetNumBucketsInternal();
 }
 
@@ -66,38 +70,170 @@ auto ExtendibleHashTable<K, V>::GetNumBucketsInternal() const -> int {
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Find(const K &key, V &value) -> bool {
-  UNREACHABLE("not implemented");
+  std::shared_lock lock(latch_);
+  return dir_[IndexOf(key)]->Find(key, value);
 }
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Remove(const K &key) -> bool {
-  UNREACHABLE("not implemented");
+  std::shared_lock lock(latch_);
+  return dir_[IndexOf(key)]->Remove(key);
 }
 
 template <typename K, typename V>
 void ExtendibleHashTable<K, V>::Insert(const K &key, const V &value) {
-  UNREACHABLE("not implemented");
+  {
+    // the common case does not change the directory
+    std::shared_lock lock(latch_);
+    if (dir_[IndexOf(key)]->Insert(key, value)) {
+      return;
+    }
+  }
+
+  std::unique_lock lock(latch_);
+  while (true) {
+    auto bucket = dir_[IndexOf(key)];
+    if (bucket->Insert(key, value)) {
+      return;
+    }
+    if (bucket->GetDepth() == global_depth_) {
+      // the second half of the doubled directory points to the same buckets as the first
+      size_t size = dir_.size();
+      dir_.reserve(size * 2);
+      for (size_t i = 0; i < size; i++) {
+        dir_.push_back(dir_[i]);
+      }
+      global_depth_++;
+    }
+    RedistributeBucket(bucket);
+  }
+}
+
+template <typename K, typename V>
+auto ExtendibleHashTable<K, V>::RedistributeBucket(std::shared_ptr<Bucket> bucket) -> void {
+  size_t high_bit = 1 << bucket->GetDepth();
+  bucket->IncrementDepth();
+  auto image = std::make_shared<Bucket>(bucket_size_, bucket->GetDepth());
+  num_buckets_++;
+
+  for (size_t i = 0; i < dir_.size(); i++) {
+    if (dir_[i] == bucket && (i & high_bit) != 0) {
+      dir_[i] = image;
+    }
+  }
+  for (auto &[key, value] : bucket->TakeItems()) {
+    dir_[IndexOf(key)]->Insert(key, value);
+  }
 }
 
 //===--------------------------------------------------------------------===//
 // Bucket
 //===--------------------------------------------------------------------===//
 template <typename K, typename V>
-ExtendibleHashTable<K, V>::Bucket::Bucket(size_t array_size, int depth) : size_(array_size), depth_(depth) {}
+ExtendibleHashTable<K, V>::Bucket::Bucket(size_t array_size, int depth)
+    : size_(array_size),
+      depth_(depth),
+      tags_((array_size + GROUP_WIDTH - 1) / GROUP_WIDTH * GROUP_WIDTH, EMPTY_TAG),
+      slots_(array_size) {}
+
+template <typename K, typename V>
+auto ExtendibleHashTable<K, V>::Bucket::TagOf(const K &key) -> uint8_t {
+  // the directory uses the low bits of the hash, so the tag takes the high bits of a remixed hash
+  uint64_t hash = static_cast<uint64_t>(std::hash<K>()(key)) * 0x9E3779B97F4A7C15ULL;
+  return static_cast<uint8_t>(hash >> 57) | 0x80;
+}
+
+template <typename K, typename V>
+auto ExtendibleHashTable<K, V>::Bucket::MatchGroup(size_t group, uint8_t tag) const -> uint64_t {
+  constexpr uint64_t lsbs = 0x0101010101010101ULL;
+  constexpr uint64_t msbs = 0x8080808080808080ULL;
+  uint64_t word;
+  memcpy(&word, &tags_[group * GROUP_WIDTH], sizeof(word));
+  // a byte of x is zero where the tag matches; may report false positives, which the key compare filters out
+  uint64_t x = word ^ (lsbs * tag);
+  return (x - lsbs) & ~x & msbs;
+}
+
+template <typename K, typename V>
+auto ExtendibleHashTable<K, V>::Bucket::FindSlot(const K &key, uint8_t tag) const -> size_t {
+  for (size_t group = 0; group * GROUP_WIDTH < size_; group++) {
+    for (uint64_t match = MatchGroup(group, tag); match != 0; match &= match - 1) {
+      size_t slot = group * GROUP_WIDTH + __builtin_ctzll(match) / 8;
+      if (slot < size_ && tags_[slot] == tag && slots_[slot].first == key) {
+        return slot;
+      }
+    }
+  }
+  return size_;
+}
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Bucket::Find(const K &key, V &value) -> bool {
-  UNREACHABLE("not implemented");
+  latch_.RLock();
+  size_t slot = FindSlot(key, TagOf(key));
+  bool found = slot < size_;
+  if (found) {
+    value = slots_[slot].second;
+  }
+  latch_.RUnlock();
+  return found;
 }
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Bucket::Remove(const K &key) -> bool {
-  UNREACHABLE("not implemented");
+  latch_.WLock();
+  size_t slot = FindSlot(key, TagOf(key));
+  bool found = slot < size_;
+  if (found) {
+    tags_[slot] = EMPTY_TAG;
+    slots_[slot] = {};
+    count_--;
+  }
+  latch_.WUnlock();
+  return found;
 }
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Bucket::Insert(const K &key, const V &value) -> bool {
-  UNREACHABLE("not implemented");
+  uint8_t tag = TagOf(key);
+  latch_.WLock();
+  size_t slot = FindSlot(key, tag);
+  if (slot < size_) {
+    slots_[slot].second = value;
+    latch_.WUnlock();
+    return true;
+  }
+  if (IsFull()) {
+    latch_.WUnlock();
+    return false;
+  }
+  // the bucket is not full, so a free slot comes before the padding
+  for (size_t group = 0; slot == size_; group++) {
+    uint64_t match = MatchGroup(group, EMPTY_TAG);
+    if (match != 0) {
+      slot = group * GROUP_WIDTH + __builtin_ctzll(match) / 8;
+    }
+  }
+  tags_[slot] = tag;
+  slots_[slot] = {key, value};
+  count_++;
+  latch_.WUnlock();
+  return true;
+}
+
+template <typename K, typename V>
+auto ExtendibleHashTable<K, V>::Bucket::TakeItems() -> std::vector<std::pair<K, V>> {
+  std::vector<std::pair<K, V>> items;
+  items.reserve(count_);
+  for (size_t slot = 0; slot < size_; slot++) {
+    if (tags_[slot] != EMPTY_TAG) {
+      items.push_back(std::move(slots_[slot]));
+      slots_[slot] = {};
+      tags_[slot] = EMPTY_TAG;
+    }
+  }
+  count_ = 0;
+  return items;
 }
 
 template class ExtendibleHashTable<page_id_t, Page *>;
@@ -13,10 +13,31 @@
 
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan) {}
 
-void IndexScanExecutor::Init() { throw NotImplementedException("IndexScanExecutor is not implemented"); }
+void IndexScanExecutor::Init() {
+  auto *catalog = exec_ctx_->GetCatalog();
+  auto *index_info = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info->table_name_);
+  tree_ = dynamic_cast<BPlusTreeIndexForOneIntegerColumn *>(index_info->index_.get());
+  // a reverse scan starts at the last leaf and walks the prev links, so a limit above it only touches the leaves
+  // it needs
+  iterator_ = plan_->IsReverse() ? tree_->GetReverseBeginIterator() : tree_->GetBeginIterator();
+}
 
-auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  while (!iterator_.IsEnd()) {
+    *rid = (*iterator_).second;
+    if (plan_->IsReverse()) {
+      --iterator_;
+    } else {
+      ++iterator_;
+    }
+    if (table_info_->table_->GetTuple(*rid, tuple, exec_ctx_->GetTransaction())) {
+      return true;
+    }
+  }
+  return false;
+}
 
 }  // namespace bustub
@@ -252,6 +252,13 @@ class Binder {
   /** Sometimes we will need to assign a name to some unnamed items. This variable gives them a universal ID. */
   size_t universal_id_{0};
 
+  /** Locations of the USING keywords in the query, found before parsing since tokenizing resets the parser state. */
+  std::vector<int32_t> using_locations_;
+
+  /** Location and length of the statement being bound, a length of 0 means it runs to the end of the query. */
+  int32_t statement_location_{0};
+  int32_t statement_length_{0};
+
   duckdb::PostgresParser parser_;
 };
 
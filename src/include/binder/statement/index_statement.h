@@ -15,13 +15,15 @@
 #include "binder/expressions/bound_column_ref.h"
 #include "binder/table_ref/bound_base_table_ref.h"
 #include "catalog/column.h"
+#include "storage/index/index.h"
 
 namespace bustub {
 
 class IndexStatement : public BoundStatement {
  public:
   explicit IndexStatement(std::string index_name, std::unique_ptr<BoundBaseTableRef> table,
-                          std::vector<std::unique_ptr<BoundColumnRef>> cols);
+                          std::vector<std::unique_ptr<BoundColumnRef>> cols, bool is_unique = false,
+                          IndexType index_type = IndexType::BPlusTreeIndex);
 
   /** Name of the index */
   std::string index_name_;
@@ -32,6 +34,12 @@ class IndexStatement : public BoundStatement {
   /** Name of the columns */
   std::vector<std::unique_ptr<BoundColumnRef>> cols_;
 
+  /** Whether the index is created with CREATE UNIQUE INDEX */
+  bool is_unique_;
+
+  /** The container chosen with USING */
+  IndexType index_type_;
+
   auto ToString() const -> std::string override;
 };
 
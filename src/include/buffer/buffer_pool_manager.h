@@ -15,6 +15,8 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
@@ -87,6 +89,9 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual auto GetPoolSize() -> size_t = 0;
 
+  /** @return the dirty page table, the pages in the pool with changes that are not on disk and their recLSNs */
+  virtual auto GetDirtyPageTable() -> std::vector<std::pair<page_id_t, lsn_t>> = 0;
+
  protected:
   /**
    * Grading function. Do not modify!
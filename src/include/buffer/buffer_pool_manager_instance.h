@@ -28,6 +28,11 @@ namespace bustub {
 
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * With a log manager and logging enabled, pages are written out under the write-ahead rule: a page whose lsn is past
+ * the persistent lsn of the log forces the log up to that lsn first, and only that far. Eviction prefers the frames
+ * whose pages are clean or whose changes are in the durable log already, so a dirty eviction rarely waits for the
+ * log; a page ahead of the log is evicted only if there is no other choice.
  */
 class BufferPoolManagerInstance : public BufferPoolManager {
  public:
@@ -36,7 +41,7 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param replacer_k the lookback constant k for the LRU-K replacer
-   * @param log_manager the log manager (for testing only: nullptr = disable logging). Please ignore this for P1.
+   * @param log_manager the log manager, nullptr writes pages out without regard to the log
    */
   BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, size_t replacer_k = LRUK_REPLACER_K,
                             LogManager *log_manager = nullptr);
@@ -49,6 +54,9 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @brief Return the size (number of frames) of the buffer pool. */
   auto GetPoolSize() -> size_t override { return pool_size_; }
 
+  /** @brief Return the pages in the pool that have a recLSN, read without their latches. */
+  auto GetDirtyPageTable() -> std::vector<std::pair<page_id_t, lsn_t>> override;
+
   /** @brief Return the pointer to all the pages in the buffer pool. */
   auto GetPages() -> Page * { return pages_; }
 
@@ -61,7 +69,9 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    *
    * You should pick the replacement frame from either the free list or the replacer (always find from the free list
    * first), and then call the AllocatePage() method to get a new page id. If the replacement frame has a dirty page,
-   * you should write it back to the disk first. You also need to reset the memory and metadata for the new page.
+   * you should write it back to the disk first, after the log if the page is ahead of it. The replacer is asked for a
+   * frame that can be written out without forcing the log. You also need to reset the memory and metadata for the new
+   * page.
    *
    * Remember to "Pin" the frame by calling replacer.SetEvictable(frame_id, false)
    * so that the replacer wouldn't evict the frame before the buffer pool manager "Unpin"s it.
@@ -110,8 +120,10 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    *
    * @brief Flush the target page to disk.
    *
-   * Use the DiskManager::WritePage() method to flush a page to disk, REGARDLESS of the dirty flag.
-   * Unset the dirty flag of the page after flushing.
+   * Use the DiskManager::WritePage() method to flush a page to disk, REGARDLESS of the dirty flag. The log is forced
+   * up to the page lsn first if the page is ahead of the persistent lsn.
+   * Unset the dirty flag of the page after flushing. Reset the recLSN of a page that is written out while
+   * nobody can change it, e.g. when it is evicted.
    *
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
    * @return false if the page could not be found in the page table, true otherwise
@@ -150,16 +162,16 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** Array of buffer pool pages. */
   Page *pages_;
   /** Pointer to the disk manager. */
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  /** Pointer to the log manager. Please ignore this for P1. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
+  /** Pointer to the log manager, nullptr if pages are written out without regard to the log. */
+  LogManager *log_manager_;
   /** Page table for keeping track of buffer pool pages. */
   ExtendibleHashTable<page_id_t, frame_id_t> *page_table_;
   /** Replacer to find unpinned pages for replacement. */
   LRUKReplacer *replacer_;
   /** List of free frames that don't have any pages on them. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /** Protects the page table, the free list and the pin counts and dirty flags of the frames. */
   std::mutex latch_;
 
   /**
@@ -176,6 +188,26 @@ class BufferPoolManagerInstance : public BufferPoolManager {
     // This is a no-nop right now without a more complex data structure to track deallocated pages
   }
 
-  // TODO(student): You may add additional private members and helper functions
+  /**
+   * @brief Take a frame from the free list, or evict a page and write it out if it is dirty. The frame is left reset.
+   * Caller should acquire the latch before calling this function. The latch may be released in between, see
+   * WriteBack(); pages may have been read into the pool then.
+   * @param[out] frame_id the frame
+   * @param lock the caller's lock on the latch
+   * @return false if all frames are pinned
+   */
+  auto AcquireFrame(frame_id_t *frame_id, std::unique_lock<std::mutex> *lock) -> bool;
+
+  /**
+   * @brief Write a page to disk under the write-ahead rule and clear its dirty flag. Caller should acquire the latch
+   * before calling this function. If the log has to be forced first, the latch is released meanwhile and the page is
+   * pinned so that it stays in its frame; others may fetch and change it then.
+   * @param lock the caller's lock on the latch
+   * @return false if the latch was released
+   */
+  auto WriteBack(Page *page, std::unique_lock<std::mutex> *lock) -> bool;
+
+  /** @return true if the page can be written out without forcing the log first */
+  auto IsLogSafe(Page *page) -> bool;
 };
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <limits>
 #include <list>
 #include <mutex>  // NOLINT
@@ -72,6 +73,16 @@ class LRUKReplacer {
    */
   auto Evict(frame_id_t *frame_id) -> bool;
 
+  /**
+   * @brief Evict the frame with the largest backward k-distance among the evictable frames that prefer accepts. If it
+   * accepts none of them, evict the frame Evict(frame_id) would.
+   *
+   * @param[out] frame_id id of frame that is evicted.
+   * @param prefer called for the evictable frames with the latch of the replacer held
+   * @return true if a frame is evicted successfully, false if no frames can be evicted.
+   */
+  auto Evict(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &prefer) -> bool;
+
   /**
    * TODO(P1): Add implementation
    *
@@ -133,12 +144,20 @@ class LRUKReplacer {
   auto Size() -> size_t;
 
  private:
-  // TODO(student): implement me! You can replace these member variables as you like.
-  // Remove maybe_unused if you start using them.
-  [[maybe_unused]] size_t current_timestamp_{0};
-  [[maybe_unused]] size_t curr_size_{0};
-  [[maybe_unused]] size_t replacer_size_;
-  [[maybe_unused]] size_t k_;
+  struct FrameEntry {
+    /** Timestamps of the last k accesses, oldest first */
+    std::list<size_t> history_;
+    bool evictable_{false};
+  };
+
+  /** @return true if frame a goes before frame b: a has less than k accesses and b not, or an older oldest access */
+  auto EvictsBefore(const FrameEntry &a, const FrameEntry &b) const -> bool;
+
+  size_t current_timestamp_{0};
+  size_t curr_size_{0};
+  size_t replacer_size_;
+  size_t k_;
+  std::unordered_map<frame_id_t, FrameEntry> entries_;
   std::mutex latch_;
 };
 
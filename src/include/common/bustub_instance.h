@@ -266,6 +266,12 @@ class BustubInstance {
     return variable == "1" || variable == "true" || variable == "yes";
   }
 
+  /** Commits of the session wait for their commit record to be durable unless `SET synchronous_commit = off` */
+  auto IsSynchronousCommit() -> bool {
+    auto variable = StringUtil::Lower(GetSessionVariable("synchronous_commit"));
+    return variable != "0" && variable != "false" && variable != "no" && variable != "off";
+  }
+
  private:
   void CmdDisplayTables(ResultWriter &writer);
   void CmdDisplayIndices(ResultWriter &writer);
@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <chrono>  // NOLINT
+#include <cstddef>
 #include <cstdint>
 
 namespace bustub {
@@ -27,6 +28,15 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** A committer waits at most GROUP_COMMIT_WINDOW for other commits to share the log flush with. */
+extern std::chrono::microseconds group_commit_window;
+
+/** The log is flushed before the window ends once GROUP_COMMIT_SIZE committers wait for it. */
+extern size_t group_commit_size;
+
+/** True if the log blocks are compressed before they are written. */
+extern std::atomic<bool> enable_log_compression;
+
 static constexpr int INVALID_PAGE_ID = -1;                                           // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                            // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                               // invalid log sequence number
@@ -34,15 +44,19 @@ static constexpr int HEADER_PAGE_ID = 0;
 static constexpr int BUSTUB_PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                          // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * BUSTUB_PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_SEGMENT_SIZE = 64 * LOG_BUFFER_SIZE;                        // size of a log segment file
 static constexpr int BUCKET_SIZE = 50;                                               // size of extendible hash bucket
 static constexpr int LRUK_REPLACER_K = 10;  // lookback window for lru-k replacer
+static constexpr size_t LOCK_ESCALATION_THRESHOLD = 1000;  // row locks on one table before escalating to the table
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
+using log_offset_t = int64_t;  // log offset type, offsets grow for the life of the log
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
+using timestamp_t = int64_t;   // commit timestamp type
 
 static constexpr int VARCHAR_DEFAULT_LENGTH = 128;  // default length for varchar when constructing the column
 
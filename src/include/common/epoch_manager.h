@@ -0,0 +1,156 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_manager.h
+//
+// Identification: src/include/common/epoch_manager.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * Epoch based memory reclamation for latch-free readers.
+ *
+ * A reader enters an epoch (EpochGuard) before it dereferences shared nodes
+ * and leaves it once it holds no more pointers into the structure. A writer
+ * that unlinks a node retires it instead of deleting it; the node is freed
+ * only after every thread that was inside an epoch at retirement time has
+ * left it, so a reader never touches freed memory.
+ */
+class EpochManager {
+ public:
+  /** Retired objects are reclaimed in batches of this size. */
+  static constexpr size_t RECLAIM_BATCH_SIZE = 64;
+
+  EpochManager() : id_(next_id_.fetch_add(1)) {}
+
+  ~EpochManager() {
+    // no thread may be inside an epoch once the owning structure is destroyed
+    for (auto &[epoch, deleter] : retired_) {
+      deleter();
+    }
+  }
+
+  DISALLOW_COPY_AND_MOVE(EpochManager);
+
+  /** Announce that the calling thread starts reading shared nodes. Epochs nest. */
+  void Enter() {
+    ThreadRecord *record = GetThreadRecord();
+    if (record->depth_++ == 0) {
+      record->epoch_.store(global_epoch_.load());
+    }
+  }
+
+  /** Announce that the calling thread no longer holds pointers into the structure. */
+  void Exit() {
+    ThreadRecord *record = GetThreadRecord();
+    if (--record->depth_ == 0) {
+      record->epoch_.store(INACTIVE);
+    }
+  }
+
+  /** Free object once no reader can still observe it. */
+  template <typename T>
+  void Retire(T *object) {
+    Retire([object] { delete object; });
+  }
+
+  /** Run deleter once no reader can still observe the unlinked object. */
+  void Retire(std::function<void()> deleter) {
+    std::scoped_lock lock(retired_latch_);
+    retired_.emplace_back(global_epoch_.load(), std::move(deleter));
+    if (retired_.size() % RECLAIM_BATCH_SIZE == 0) {
+      Reclaim();
+    }
+  }
+
+  /** @return number of retired objects that are not freed yet */
+  auto RetiredCount() -> size_t {
+    std::scoped_lock lock(retired_latch_);
+    return retired_.size();
+  }
+
+ private:
+  static constexpr uint64_t INACTIVE = std::numeric_limits<uint64_t>::max();
+
+  struct ThreadRecord {
+    std::atomic<uint64_t> epoch_{INACTIVE};
+    uint32_t depth_{0};
+  };
+
+  auto GetThreadRecord() -> ThreadRecord * {
+    // managers are told apart by id rather than address, as a new manager can reuse the address of a dead one
+    thread_local std::unordered_map<uint64_t, ThreadRecord *> records;
+    auto it = records.find(id_);
+    if (it != records.end()) {
+      return it->second;
+    }
+    std::scoped_lock lock(records_latch_);
+    auto *record = records_.emplace_back(std::make_unique<ThreadRecord>()).get();
+    records.emplace(id_, record);
+    return record;
+  }
+
+  /** Advance the global epoch and free what was retired before the oldest active epoch. */
+  void Reclaim() {
+    global_epoch_.fetch_add(1);
+    uint64_t min_epoch = global_epoch_.load();
+    {
+      std::scoped_lock lock(records_latch_);
+      for (const auto &record : records_) {
+        min_epoch = std::min(min_epoch, record->epoch_.load());
+      }
+    }
+    std::vector<std::pair<uint64_t, std::function<void()>>> remaining;
+    for (auto &[epoch, deleter] : retired_) {
+      if (epoch < min_epoch) {
+        deleter();
+      } else {
+        remaining.emplace_back(epoch, std::move(deleter));
+      }
+    }
+    retired_ = std::move(remaining);
+  }
+
+  inline static std::atomic<uint64_t> next_id_{0};
+
+  const uint64_t id_;
+  std::atomic<uint64_t> global_epoch_{0};
+  std::mutex records_latch_;
+  std::vector<std::unique_ptr<ThreadRecord>> records_;
+  std::mutex retired_latch_;
+  std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+};
+
+/**
+ * RAII guard that keeps the calling thread inside an epoch of manager.
+ */
+class EpochGuard {
+ public:
+  explicit EpochGuard(EpochManager *manager) : manager_(manager) { manager_->Enter(); }
+  ~EpochGuard() { manager_->Exit(); }
+
+  DISALLOW_COPY_AND_MOVE(EpochGuard);
+
+ private:
+  EpochManager *manager_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,45 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util.h
+//
+// Identification: src/include/common/util/compression_util.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * CompressionUtil provides LZ4-style block compression. The compressed block is a sequence of literal runs each
+ * followed by a back reference of at least MIN_MATCH bytes into the last MAX_OFFSET bytes, the block ends with a
+ * literal run. Compression is fast and greedy, it trades ratio for speed.
+ */
+class CompressionUtil {
+ public:
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t MAX_OFFSET = 65535;
+
+  /** @return the largest compressed size of size bytes, which incompressible data can take */
+  static inline auto MaxCompressedSize(size_t size) -> size_t { return size + size / 255 + 16; }
+
+  /**
+   * Compress size bytes of src into dst, which has room for MaxCompressedSize(size) bytes.
+   * @return the compressed size
+   */
+  static auto Compress(const char *src, size_t size, char *dst) -> size_t;
+
+  /**
+   * Decompress a block of size bytes from src into dst.
+   * @return false if the block is corrupt or does not decompress to exactly decompressed_size bytes
+   */
+  static auto Decompress(const char *src, size_t size, char *dst, size_t decompressed_size) -> bool;
+};
+
+}  // namespace bustub
@@ -0,0 +1,110 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// varint_util.h
+//
+// Identification: src/include/common/util/varint_util.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bustub {
+
+/**
+ * VarintUtil provides LEB128-style variable length integer encoding. Small values take a single byte, a full
+ * 64-bit value takes at most MAX_VARINT_SIZE bytes.
+ */
+class VarintUtil {
+ public:
+  /** The maximum number of bytes a single encoded uint64_t can take. */
+  static constexpr size_t MAX_VARINT_SIZE = 10;
+
+  /** @return the number of bytes needed to encode value */
+  static inline auto EncodedSize(uint64_t value) -> size_t {
+    size_t size = 1;
+    while (value >= 0x80) {
+      value >>= 7;
+      size++;
+    }
+    return size;
+  }
+
+  /**
+   * Encode value into dst.
+   * @return the number of bytes written
+   */
+  static inline auto Encode(uint64_t value, char *dst) -> size_t {
+    auto *ptr = reinterpret_cast<uint8_t *>(dst);
+    size_t size = 0;
+    while (value >= 0x80) {
+      ptr[size++] = static_cast<uint8_t>(value | 0x80);
+      value >>= 7;
+    }
+    ptr[size++] = static_cast<uint8_t>(value);
+    return size;
+  }
+
+  /**
+   * Decode a value from src.
+   * @return the number of bytes consumed
+   */
+  static inline auto Decode(const char *src, uint64_t *value) -> size_t {
+    const auto *ptr = reinterpret_cast<const uint8_t *>(src);
+    uint64_t result = 0;
+    size_t size = 0;
+    int shift = 0;
+    while ((ptr[size] & 0x80) != 0) {
+      result |= static_cast<uint64_t>(ptr[size++] & 0x7f) << shift;
+      shift += 7;
+    }
+    result |= static_cast<uint64_t>(ptr[size++]) << shift;
+    *value = result;
+    return size;
+  }
+
+  /** @return the number of bytes needed to delta encode a sorted sequence */
+  static inline auto DeltaEncodedSize(const std::vector<uint64_t> &values) -> size_t {
+    size_t size = 0;
+    uint64_t prev = 0;
+    for (auto value : values) {
+      size += EncodedSize(value - prev);
+      prev = value;
+    }
+    return size;
+  }
+
+  /**
+   * Encode an ascending sequence as varint deltas, the first value is stored as a delta from zero.
+   * @return the number of bytes written
+   */
+  static inline auto DeltaEncode(const std::vector<uint64_t> &values, char *dst) -> size_t {
+    size_t size = 0;
+    uint64_t prev = 0;
+    for (auto value : values) {
+      size += Encode(value - prev, dst + size);
+      prev = value;
+    }
+    return size;
+  }
+
+  /** Decode count delta encoded values from src and append them to values. */
+  static inline void DeltaDecode(const char *src, size_t count, std::vector<uint64_t> *values) {
+    uint64_t prev = 0;
+    for (size_t i = 0; i < count; i++) {
+      uint64_t delta;
+      src += Decode(src, &delta);
+      prev += delta;
+      values->push_back(prev);
+    }
+  }
+};
+
+}  // namespace bustub
@@ -13,10 +13,13 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <list>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -59,14 +62,14 @@ class LockManager {
     RID rid_;
     /** Whether the lock has been granted or not */
     bool granted_{false};
+    /** For notifying the transaction waiting on this request once it is granted or aborted */
+    std::condition_variable cv_;
   };
 
   class LockRequestQueue {
    public:
     /** List of lock requests for the same resource (table or row) */
     std::list<LockRequest *> request_queue_;
-    /** For notifying blocked transactions on this rid */
-    std::condition_variable cv_;
     /** txn_id of an upgrading transaction (if any) */
     txn_id_t upgrading_ = INVALID_TXN_ID;
     /** coordination */
@@ -74,18 +77,24 @@ class LockManager {
   };
 
   /**
-   * Creates a new lock manager configured for the deadlock detection policy.
+   * How the lock manager deals with deadlocks.
+   *
+   * DETECTION lets transactions wait freely and a background thread aborts the youngest transaction of every cycle
+   * in the waits-for graph each cycle_detection_interval. WOUND_WAIT and WAIT_DIE prevent deadlocks when a request
+   * has to wait, using the transaction id as timestamp (a smaller id is older):
+   * - WOUND_WAIT: an older requester aborts (wounds) the younger transactions it conflicts with, a younger
+   *   requester waits for older ones.
+   * - WAIT_DIE: an older requester waits for younger transactions, a younger requester aborts itself (dies).
+   * Neither needs the background thread, a transaction is aborted as soon as the conflict shows up.
+   */
+  enum class DeadlockPolicy { DETECTION, WOUND_WAIT, WAIT_DIE };
+
+  /**
+   * Creates a new lock manager configured for the given deadlock handling policy.
    */
-  LockManager() {
-    enable_cycle_detection_ = true;
-    cycle_detection_thread_ = new std::thread(&LockManager::RunCycleDetection, this);
-  }
+  explicit LockManager(DeadlockPolicy deadlock_policy = DeadlockPolicy::DETECTION);
 
-  ~LockManager() {
-    enable_cycle_detection_ = false;
-    cycle_detection_thread_->join();
-    delete cycle_detection_thread_;
-  }
+  ~LockManager();
 
   /**
    * [LOCK_NOTE]
@@ -264,6 +273,43 @@ class LockManager {
    */
   auto UnlockRow(Transaction *txn, const table_oid_t &oid, const RID &rid) -> bool;
 
+  /**
+   * Release every lock the transaction holds, rows before tables, when it commits or aborts.
+   * Unlike UnlockRow/UnlockTable this never aborts and leaves the 2PL state alone, the transaction is finishing.
+   * @param txn the finishing transaction
+   */
+  void UnlockAll(Transaction *txn);
+
+  /**
+   * Switch the deadlock handling policy, starting or stopping the cycle detection thread as needed.
+   * Must not be called while any locks are held or requested.
+   */
+  void SetDeadlockPolicy(DeadlockPolicy deadlock_policy);
+
+  /** @return the deadlock handling policy */
+  auto GetDeadlockPolicy() const -> DeadlockPolicy { return deadlock_policy_; }
+
+  /**
+   * [ESCALATION_NOTE]
+   *
+   * Once a transaction holds more than the escalation threshold of row locks on one table, LockRow() tries to
+   * replace them by a single table lock: X if any of the row locks is X, otherwise S (or SIX when the transaction
+   * holds IX on the table). The table lock is only upgraded if that is possible without waiting, otherwise the
+   * row locks are kept and escalation is tried again on the next row lock.
+   *
+   * After escalation, row locks on the table that the table lock covers are granted without queueing and unlocking
+   * them only updates the transaction state. Row locks the table lock does not cover (X rows under S/SIX) are
+   * still taken one by one.
+   *
+   * @param threshold the number of row locks on one table that triggers escalation, 0 disables escalation
+   */
+  void SetLockEscalationThreshold(size_t threshold) { lock_escalation_threshold_ = threshold; }
+
+  /**
+   * @return the number of rows that have a request queue, a row loses its queue once no request is left in it
+   */
+  auto GetRowQueueCount() -> size_t;
+
   /*** Graph API ***/
 
   /**
@@ -294,25 +340,115 @@ class LockManager {
 
   /**
    * Runs cycle detection in the background.
+   *
+   * The waits-for graph is maintained incrementally: a blocked request sets the edges of its transaction to the
+   * transactions it waits for, and removes them once it is granted or aborted. Each pass only searches from the
+   * transactions whose edges changed since the previous pass, a cycle formed since then has to go through one of them.
    */
   auto RunCycleDetection() -> void;
 
  private:
+  /** Number of partitions of the row lock table, a power of two */
+  static constexpr size_t ROW_LOCK_SHARDS = 64;
+
+  /**
+   * One partition of the row lock table. Each shard sits on its own cache
+   * line(s), so row lock requests on different shards never touch the same
+   * latch or map.
+   */
+  struct alignas(64) RowLockShard {
+    /** Structure that holds lock requests for the RIDs of this shard */
+    std::unordered_map<RID, std::shared_ptr<LockRequestQueue>> row_lock_map_;
+    /** Coordination */
+    std::mutex latch_;
+  };
+
+  /** @return the shard of the row lock table that rid belongs to */
+  auto RowLockShardOf(const RID &rid) -> RowLockShard &;
+  /** @return the request queue of the table, created if it does not exist yet */
+  auto GetTableQueue(table_oid_t oid) -> std::shared_ptr<LockRequestQueue>;
+  /** @return the request queue of the row, created if it does not exist yet */
+  auto GetRowQueue(const RID &rid) -> std::shared_ptr<LockRequestQueue>;
+  /** Drop the reference GetRowQueue() returned, and the queue of the row if no request or other thread uses it */
+  void PutRowQueue(const RID &rid, std::shared_ptr<LockRequestQueue> queue);
+
+  /** Replace the row locks of txn on table oid by a table lock, see [ESCALATION_NOTE] */
+  void Escalate(Transaction *txn, table_oid_t oid);
+  /** Upgrade the table lock of txn in place if no other granted lock conflicts, never waits or aborts */
+  auto TryUpgradeTable(Transaction *txn, table_oid_t oid, LockMode lock_mode) -> bool;
+  /** Remove the granted row lock of txn and wake its waiters, returns the removed request or nullptr */
+  auto ReleaseRowLock(Transaction *txn, const RID &rid) -> LockRequest *;
+  /** Remove the granted table lock of txn and wake its waiters, returns the removed request or nullptr */
+  auto ReleaseTableLock(Transaction *txn, table_oid_t oid) -> LockRequest *;
+
+  /** Enqueue a request (or upgrade the one txn already holds) and wait until it is granted or txn is aborted. */
+  auto AcquireLock(Transaction *txn, const std::shared_ptr<LockRequestQueue> &shared_queue, LockRequest *request)
+      -> bool;
+  /** Remove the granted request of txn from the queue, returns the removed request or nullptr */
+  static auto ReleaseLock(Transaction *txn, LockRequestQueue *queue) -> LockRequest *;
+  /** @return true if request can be granted without violating FIFO order or any granted lock */
+  static auto CanGrant(LockRequestQueue *queue, LockRequest *request) -> bool;
+  /**
+   * Hand the lock to the waiting requests at the head of the queue that became grantable after a request left it,
+   * waking only them. The queue latch must be held.
+   */
+  void GrantWaiters(LockRequestQueue *queue);
+  /**
+   * Apply WOUND_WAIT or WAIT_DIE to a request that cannot be granted yet.
+   * @param[out] wounded the younger transactions an older requester wounded under WOUND_WAIT, to be woken up
+   * @return false if the requester has to die under WAIT_DIE
+   */
+  auto PreventDeadlock(LockRequestQueue *queue, LockRequest *request, std::vector<txn_id_t> *wounded) -> bool;
+  /** @return the transactions whose requests ahead of request conflict with it, the ones it waits for */
+  static auto GetBlockers(LockRequestQueue *queue, LockRequest *request) -> std::vector<txn_id_t>;
+  /** Replace the out edges of the blocked transaction txn_id in the waits-for graph */
+  void UpdateWaitsFor(txn_id_t txn_id, std::vector<txn_id_t> blockers);
+  /** Remove the out edges of txn_id from the waits-for graph once it stopped waiting */
+  void RemoveWaiter(txn_id_t txn_id);
+  /** Search for a cycle reachable from the sources, in order; returns the newest transaction in it through txn_id */
+  auto FindCycle(const std::vector<txn_id_t> &sources, txn_id_t *txn_id) -> bool;
+  /** Wake up the wounded transactions if they are waiting for a lock */
+  void WakeWounded(const std::vector<txn_id_t> &wounded);
+  static auto AreCompatible(LockMode held, LockMode requested) -> bool;
+  static auto CanUpgrade(LockMode held, LockMode requested) -> bool;
+
+  /** Abort txn for the given reason, throws TransactionAbortException */
+  [[noreturn]] static void AbortImplicitly(Transaction *txn, AbortReason reason);
+  /** Check that the isolation level and 2PL state of txn permit taking a lock in lock_mode */
+  static void CheckIsolationLevel(Transaction *txn, LockMode lock_mode);
+  /** Update the lock sets of txn when request is granted (insert is true) or released */
+  static void UpdateLockSets(Transaction *txn, const LockRequest *request, bool insert);
+  /** Update the 2PL state of txn after it released a lock in lock_mode */
+  static void UpdateStateOnUnlock(Transaction *txn, LockMode lock_mode);
+
+  /** Allocate a lock request from the free list of the calling thread */
+  static auto NewRequest(txn_id_t txn_id, LockMode lock_mode, table_oid_t oid, RID rid = RID()) -> LockRequest *;
+  /** Return a lock request to the free list of the calling thread */
+  static void FreeRequest(LockRequest *request);
+
   /** Fall 2022 */
   /** Structure that holds lock requests for a given table oid */
   std::unordered_map<table_oid_t, std::shared_ptr<LockRequestQueue>> table_lock_map_;
   /** Coordination */
   std::mutex table_lock_map_latch_;
 
-  /** Structure that holds lock requests for a given RID */
-  std::unordered_map<RID, std::shared_ptr<LockRequestQueue>> row_lock_map_;
-  /** Coordination */
-  std::mutex row_lock_map_latch_;
+  /** Row lock table partitioned by RID hash */
+  std::array<RowLockShard, ROW_LOCK_SHARDS> row_lock_shards_;
 
-  std::atomic<bool> enable_cycle_detection_;
-  std::thread *cycle_detection_thread_;
+  DeadlockPolicy deadlock_policy_;
+  std::atomic<size_t> lock_escalation_threshold_{LOCK_ESCALATION_THRESHOLD};
+  std::atomic<bool> enable_cycle_detection_{false};
+  std::thread *cycle_detection_thread_{nullptr};
+  /**
+   * Queue each blocked transaction waits on, maintained under DETECTION and WOUND_WAIT to wake aborted waiters.
+   * Shared, so that a queue being woken up is not freed by PutRowQueue() in the meantime.
+   */
+  std::unordered_map<txn_id_t, std::shared_ptr<LockRequestQueue>> waiting_on_;
+  std::mutex waiting_on_latch_;
   /** Waits-for graph representation. */
   std::unordered_map<txn_id_t, std::vector<txn_id_t>> waits_for_;
+  /** Transactions whose edges changed since the last detection pass */
+  std::vector<txn_id_t> new_waiters_;
   std::mutex waits_for_latch_;
 };
 
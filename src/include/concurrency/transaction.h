@@ -46,8 +46,21 @@ enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 
 /**
  * Transaction isolation level.
+ *
+ * SNAPSHOT_ISOLATION reads the versions committed before the transaction began without taking shared locks, see
+ * VersionStore. Its write locks follow the REPEATABLE_READ rules.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT_ISOLATION };
+
+/**
+ * Concurrency control of a transaction.
+ *
+ * OPTIMISTIC transactions take no locks. They read the snapshot at their read timestamp and record what they read
+ * in the read set, their updates and deletes are buffered in the buffered write set. At commit the read set is
+ * validated against the versions committed since the snapshot and only then the buffered writes are installed.
+ * Inserts go to the table heap right away, they are invisible to other snapshots until the commit.
+ */
+enum class ConcurrencyControl { TWO_PHASE_LOCKING, OPTIMISTIC };
 
 /**
  * Type of write operation.
@@ -64,8 +77,8 @@ using index_oid_t = uint32_t;
  */
 class TableWriteRecord {
  public:
-  TableWriteRecord(RID rid, WType wtype, const Tuple &tuple, TableHeap *table)
-      : rid_(rid), wtype_(wtype), tuple_(tuple), table_(table) {}
+  TableWriteRecord(RID rid, WType wtype, const Tuple &tuple, TableHeap *table, lsn_t prev_lsn = INVALID_LSN)
+      : rid_(rid), wtype_(wtype), tuple_(tuple), table_(table), prev_lsn_(prev_lsn) {}
 
   RID rid_;
   WType wtype_;
@@ -73,6 +86,20 @@ class TableWriteRecord {
   Tuple tuple_;
   /** The table heap specifies which table this write record is for. */
   TableHeap *table_;
+  /** The last LSN of the transaction before the write, the rollback of the write compensates back to it. */
+  lsn_t prev_lsn_;
+};
+
+/**
+ * ReadRecord tracks a tuple an OPTIMISTIC transaction read.
+ */
+class TableReadRecord {
+ public:
+  TableReadRecord(RID rid, TableHeap *table) : rid_(rid), table_(table) {}
+
+  RID rid_;
+  /** The table heap specifies which table this read record is for. */
+  TableHeap *table_;
 };
 
 /**
@@ -98,6 +125,10 @@ class IndexWriteRecord {
   index_oid_t index_oid_;
   /** The catalog contains metadata required to locate index. */
   Catalog *catalog_;
+  /** The last LSN of the transaction before the write, the rollback of the write compensates back to it. */
+  lsn_t prev_lsn_{INVALID_LSN};
+  /** The LSN of the delete of the old key of an update, which is logged before the insert of the new key. */
+  lsn_t old_key_lsn_{INVALID_LSN};
 };
 
 /**
@@ -158,8 +189,10 @@ class TransactionAbortException : public std::exception {
  */
 class Transaction {
  public:
-  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ)
+  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ,
+                       ConcurrencyControl concurrency_control = ConcurrencyControl::TWO_PHASE_LOCKING)
       : isolation_level_(isolation_level),
+        concurrency_control_(concurrency_control),
         thread_id_(std::this_thread::get_id()),
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
@@ -171,10 +204,13 @@ class Transaction {
         ix_table_lock_set_{new std::unordered_set<table_oid_t>},
         six_table_lock_set_{new std::unordered_set<table_oid_t>},
         s_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>},
-        x_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>} {
+        x_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>},
+        escalated_table_set_{new std::unordered_set<table_oid_t>} {
     // Initialize the sets that will be tracked.
     table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
+    table_read_set_ = std::make_shared<std::deque<TableReadRecord>>();
+    buffered_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     page_set_ = std::make_shared<std::deque<bustub::Page *>>();
     deleted_page_set_ = std::make_shared<std::unordered_set<page_id_t>>();
   }
@@ -192,9 +228,48 @@ class Transaction {
   /** @return the isolation level of this transaction */
   inline auto GetIsolationLevel() const -> IsolationLevel { return isolation_level_; }
 
+  /** @return the concurrency control of this transaction */
+  inline auto GetConcurrencyControl() const -> ConcurrencyControl { return concurrency_control_; }
+
+  /** @return true if this transaction runs under optimistic concurrency control */
+  inline auto IsOptimistic() const -> bool { return concurrency_control_ == ConcurrencyControl::OPTIMISTIC; }
+
+  /** @return true if this transaction reads the snapshot at its read timestamp */
+  inline auto IsSnapshotRead() const -> bool {
+    return isolation_level_ == IsolationLevel::SNAPSHOT_ISOLATION || IsOptimistic();
+  }
+
+  /** @return true if the commit of this transaction waits until its commit record is durable */
+  inline auto IsSynchronousCommit() const -> bool { return synchronous_commit_; }
+
+  /**
+   * Set whether the commit waits for the commit record to be durable. An asynchronous commit returns once the
+   * record is in the log buffer and the flush thread writes it within log_timeout.
+   * @param synchronous_commit false to commit asynchronously
+   */
+  inline void SetSynchronousCommit(bool synchronous_commit) { synchronous_commit_ = synchronous_commit; }
+
+  /** @return true if some write of this transaction saved the older version for snapshots */
+  inline auto HasVersionedWrites() const -> bool { return versioned_writes_; }
+
+  /** @param versioned_writes whether some write of this transaction saved the older version */
+  inline void SetVersionedWrites(bool versioned_writes) { versioned_writes_ = versioned_writes; }
+
+  /** @return true if this transaction wrote in place without versions, snapshots begin only once it finished */
+  inline auto HasUnversionedWrites() const -> bool { return unversioned_writes_; }
+
+  /** @param unversioned_writes whether this transaction wrote in place without versions */
+  inline void SetUnversionedWrites(bool unversioned_writes) { unversioned_writes_ = unversioned_writes; }
+
   /** @return the list of table write records of this transaction */
   inline auto GetWriteSet() -> std::shared_ptr<std::deque<TableWriteRecord>> { return table_write_set_; }
 
+  /** @return the tuples read by this OPTIMISTIC transaction, validated at commit */
+  inline auto GetReadSet() -> std::shared_ptr<std::deque<TableReadRecord>> { return table_read_set_; }
+
+  /** @return the writes of this OPTIMISTIC transaction, installed at commit; the tuple is the new one */
+  inline auto GetBufferedWriteSet() -> std::shared_ptr<std::deque<TableWriteRecord>> { return buffered_write_set_; }
+
   /** @return the list of index write records of this transaction */
   inline auto GetIndexWriteSet() -> std::shared_ptr<std::deque<IndexWriteRecord>> { return index_write_set_; }
 
@@ -301,6 +376,16 @@ class Transaction {
     return six_table_lock_set_->find(oid) != six_table_lock_set_->end();
   }
 
+  /** @return the set of tables whose row locks were escalated to the table lock */
+  inline auto GetEscalatedTableSet() -> std::shared_ptr<std::unordered_set<table_oid_t>> {
+    return escalated_table_set_;
+  }
+
+  /** @return true if the row locks on table oid were escalated to the table lock */
+  auto IsTableEscalated(const table_oid_t &oid) -> bool {
+    return escalated_table_set_->find(oid) != escalated_table_set_->end();
+  }
+
   /** @return the current state of the transaction */
   inline auto GetState() -> TransactionState { return state_; }
 
@@ -314,6 +399,28 @@ class Transaction {
    */
   inline void SetState(TransactionState state) { state_ = state; }
 
+  /**
+   * Change the state only if it still is the expected one, so that a concurrent wound cannot overwrite a commit.
+   * @param expected the state the transaction has to be in
+   * @param state new state
+   * @return true if the state was changed
+   */
+  inline auto CompareAndSetState(TransactionState expected, TransactionState state) -> bool {
+    return state_.compare_exchange_strong(expected, state);
+  }
+
+  /** @return the timestamp of the snapshot the transaction reads */
+  inline auto GetReadTs() const -> timestamp_t { return read_ts_; }
+
+  /** @param read_ts the timestamp of the snapshot the transaction reads */
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
+  /** @return the commit timestamp, valid once the transaction committed */
+  inline auto GetCommitTs() const -> timestamp_t { return commit_ts_; }
+
+  /** @param commit_ts the commit timestamp */
+  inline void SetCommitTs(timestamp_t commit_ts) { commit_ts_ = commit_ts; }
+
   /** @return the previous LSN */
   inline auto GetPrevLSN() -> lsn_t { return prev_lsn_; }
 
@@ -323,22 +430,64 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the LSN of the begin record, INVALID_LSN without logging */
+  inline auto GetBeginLSN() -> lsn_t { return begin_lsn_; }
+
+  /**
+   * Set the LSN of the begin record.
+   * @param begin_lsn the lsn of the begin record
+   */
+  inline void SetBeginLSN(lsn_t begin_lsn) { begin_lsn_ = begin_lsn; }
+
+  /** @return true while the rollback runs, the writes log compensation records then */
+  inline auto IsRollingBack() -> bool { return rolling_back_; }
+
+  /** @return the undo next lsn of the compensation record of the write being rolled back */
+  inline auto GetUndoNextLSN() -> lsn_t { return undo_next_lsn_; }
+
+  /**
+   * Start the rollback of a write, the compensation records its undo logs go on at undo_next_lsn.
+   * @param undo_next_lsn the prevLSN of the record of the write
+   */
+  inline void SetUndoNextLSN(lsn_t undo_next_lsn) {
+    rolling_back_ = true;
+    undo_next_lsn_ = undo_next_lsn;
+  }
+
  private:
-  /** The current transaction state. */
-  TransactionState state_{TransactionState::GROWING};
+  /** The current transaction state, other transactions abort it under WOUND_WAIT. */
+  std::atomic<TransactionState> state_{TransactionState::GROWING};
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
+  /** The concurrency control of the transaction. */
+  ConcurrencyControl concurrency_control_;
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
   txn_id_t txn_id_;
+  /** Whether the commit waits for the commit record to be durable. */
+  bool synchronous_commit_{true};
+  /** MVCC: whether the transaction saved versions, and whether it wrote without them. */
+  bool versioned_writes_{false};
+  bool unversioned_writes_{false};
 
   /** The undo set of table tuples. */
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
   /** The undo set of indexes. */
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
-  /** The LSN of the last record written by the transaction. */
-  lsn_t prev_lsn_;
+  /** OCC: the tuples read and the writes not installed yet. */
+  std::shared_ptr<std::deque<TableReadRecord>> table_read_set_;
+  std::shared_ptr<std::deque<TableWriteRecord>> buffered_write_set_;
+  /** The LSN of the last record written by the transaction, checkpoints read it while the transaction runs. */
+  std::atomic<lsn_t> prev_lsn_;
+  /** The LSN of the first record of the transaction, the log is kept from the oldest running one on. */
+  lsn_t begin_lsn_{INVALID_LSN};
+  /** The rollback runs, its records compensate the records of the writes, up to the undo next lsn. */
+  bool rolling_back_{false};
+  lsn_t undo_next_lsn_{INVALID_LSN};
+  /** MVCC: the snapshot timestamp and the commit timestamp. */
+  timestamp_t read_ts_{0};
+  timestamp_t commit_ts_{0};
 
   std::mutex latch_;
 
@@ -362,6 +511,8 @@ class Transaction {
   /** LockManager: the set of row locks held by this transaction. */
   std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> s_row_lock_set_;
   std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> x_row_lock_set_;
+  /** LockManager: the tables whose table lock covers all row locks of this transaction after lock escalation. */
+  std::shared_ptr<std::unordered_set<table_oid_t>> escalated_table_set_;
 };
 
 }  // namespace bustub
@@ -12,10 +12,16 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
-#include <shared_mutex>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -39,16 +45,18 @@ class TransactionManager {
    * Begins a new transaction.
    * @param txn an optional transaction object to be initialized, otherwise a new transaction is created.
    * @param isolation_level an optional isolation level of the transaction.
+   * @param concurrency_control an optional concurrency control of the transaction.
    * @return an initialized transaction
    */
-  auto Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ)
-      -> Transaction *;
+  auto Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ,
+             ConcurrencyControl concurrency_control = ConcurrencyControl::TWO_PHASE_LOCKING) -> Transaction *;
 
   /**
    * Commits a transaction.
    * @param txn the transaction to commit
+   * @return false if an OPTIMISTIC transaction failed validation, it is aborted then
    */
-  void Commit(Transaction *txn);
+  auto Commit(Transaction *txn) -> bool;
 
   /**
    * Aborts a transaction
@@ -57,27 +65,52 @@ class TransactionManager {
   void Abort(Transaction *txn);
 
   /**
-   * Global list of running transactions
+   * Locates and returns the transaction with the given transaction ID.
+   * @param txn_id the id of the transaction to be found
+   * @return the transaction with the given transaction id, nullptr if it is not running (any more)
+   */
+  static auto GetTransaction(txn_id_t txn_id) -> Transaction *;
+
+  /**
+   * Abort a running transaction on behalf of another one. Only a growing or shrinking transaction is wounded, one
+   * that already started to commit or abort is left alone. The transaction notices on its next lock request, at its
+   * next tuple or when it commits.
+   * @param txn_id the id of the transaction to wound
+   * @return true if this call aborted the transaction
    */
+  static auto Wound(txn_id_t txn_id) -> bool;
 
-  /** The transaction map is a global list of all the running transactions in the system. */
-  static std::unordered_map<txn_id_t, Transaction *> txn_map;
-  static std::shared_mutex txn_map_mutex;
+  /** @return the commit timestamp of the latest committed transaction that wrote anything */
+  auto GetLastCommitTs() const -> timestamp_t { return last_commit_ts_; }
 
   /**
-   * Locates and returns the transaction with the given transaction ID.
-   * @param txn_id the id of the transaction to be found, it must exist!
-   * @return the transaction with the given transaction id
+   * Decide whether a write of txn has to save the older version of the tuple. Snapshot transactions always do, the
+   * others only while a snapshot transaction is running. A transaction that writes without versions keeps new
+   * snapshot transactions waiting in Begin until it finished, so no snapshot ever sees its writes.
+   * @return true if the write has to go through the version store
+   */
+  static auto SavesVersions(Transaction *txn) -> bool;
+
+  /**
+   * Prune the tuple versions that no active snapshot can see any more and apply the deletes whose tuples nobody
+   * can see. Runs at the end of every commit and abort that dealt with versions. The deletes are applied without a
+   * transaction, the one that deleted the tuples committed long ago.
+   */
+  void GarbageCollect();
+
+  /**
+   * @return the active transaction table for a fuzzy checkpoint, the running transactions that wrote log records
+   * and the LSN of their last record
+   */
+  static auto GetActiveTransactions() -> std::vector<std::pair<txn_id_t, lsn_t>>;
+
+  /** @return the LSN of the begin record of the oldest running transaction, INVALID_LSN if none wrote one */
+  static auto GetOldestActiveLSN() -> lsn_t;
+
+  /**
+   * Prevents all transactions from performing operations, used for checkpointing.
+   * New transactions wait in Begin, the call returns once every running transaction finished.
    */
-  static auto GetTransaction(txn_id_t txn_id) -> Transaction * {
-    std::shared_lock<std::shared_mutex> l(TransactionManager::txn_map_mutex);
-    assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-    auto *res = TransactionManager::txn_map[txn_id];
-    assert(res != nullptr);
-    return res;
-  }
-
-  /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
   /** Resumes all transactions, used for checkpointing. */
@@ -88,58 +121,99 @@ class TransactionManager {
    * Releases all the locks held by the given transaction.
    * @param txn the transaction whose locks should be released
    */
-  void ReleaseLocks(Transaction *txn) {
-    /** Drop all row locks */
-    txn->LockTxn();
-    std::unordered_map<table_oid_t, std::unordered_set<RID>> row_lock_set;
-    for (const auto &s_row_lock_set : *txn->GetSharedRowLockSet()) {
-      for (auto rid : s_row_lock_set.second) {
-        row_lock_set[s_row_lock_set.first].emplace(rid);
-      }
-    }
-    for (const auto &x_row_lock_set : *txn->GetExclusiveRowLockSet()) {
-      for (auto rid : x_row_lock_set.second) {
-        row_lock_set[x_row_lock_set.first].emplace(rid);
-      }
-    }
-
-    /** Drop all table locks */
-    std::unordered_set<table_oid_t> table_lock_set;
-    for (auto oid : *txn->GetSharedTableLockSet()) {
-      table_lock_set.emplace(oid);
-    }
-    for (table_oid_t oid : *(txn->GetIntentionSharedTableLockSet())) {
-      table_lock_set.emplace(oid);
-    }
-    for (auto oid : *txn->GetExclusiveTableLockSet()) {
-      table_lock_set.emplace(oid);
-    }
-    for (auto oid : *txn->GetIntentionExclusiveTableLockSet()) {
-      table_lock_set.emplace(oid);
-    }
-    for (auto oid : *txn->GetSharedIntentionExclusiveTableLockSet()) {
-      table_lock_set.emplace(oid);
-    }
-    txn->UnlockTxn();
-
-    for (const auto &locked_table_row_set : row_lock_set) {
-      table_oid_t oid = locked_table_row_set.first;
-      for (auto rid : locked_table_row_set.second) {
-        lock_manager_->UnlockRow(txn, oid, rid);
-      }
-    }
-
-    for (auto oid : table_lock_set) {
-      lock_manager_->UnlockTable(txn, oid);
-    }
-  }
+  void ReleaseLocks(Transaction *txn) { lock_manager_->UnlockAll(txn); }
+
+  /** A written tuple whose older versions can be garbage collected once no snapshot before ts_ is active. */
+  struct GarbageRecord {
+    timestamp_t ts_;
+    TableHeap *table_;
+    RID rid_;
+    /** The tuple was deleted, the delete is applied once no snapshot can see the tuple. */
+    bool deleted_;
+  };
+
+  /** Roll back a write of txn to a table heap, a compensation record is logged back to the write's prev lsn */
+  static void RollbackTableWrite(const TableWriteRecord &item, Transaction *txn);
+  /** Roll back a write of txn to an index, its compensation records point back like those of a table write */
+  static void RollbackIndexWrite(IndexWriteRecord &item, Transaction *txn);
+
+  /** OCC: @return true if no tuple in the read set of txn was committed to after its snapshot */
+  auto Validate(Transaction *txn) -> bool;
+  /** OCC: apply the buffered writes of txn to the table heaps, @return false on a failed write */
+  auto InstallWrites(Transaction *txn) -> bool;
+
+  /** Number of partitions of the running transactions, a power of two */
+  static constexpr size_t TXN_SLOTS = 64;
+
+  /**
+   * A partition of the global list of running transactions. Transactions are partitioned by id, consecutive
+   * transactions register in different partitions and Begin/Commit share no cache line with each other.
+   */
+  struct alignas(64) TxnMapShard {
+    std::unordered_map<txn_id_t, Transaction *> txn_map_;
+    std::mutex latch_;
+  };
+
+  /** Counts the running transactions of this manager in one partition, for checkpoint quiescence */
+  struct alignas(64) ActiveSlot {
+    std::atomic<int64_t> count_{0};
+  };
+
+  static auto TxnMapShardOf(txn_id_t txn_id) -> TxnMapShard &;
+  /** Count txn as running, waiting first while a checkpoint blocks all transactions */
+  void EnterActive(Transaction *txn);
+  /** Count txn as finished, waking a checkpoint that waits for it */
+  void LeaveActive(Transaction *txn);
+  auto ActiveCount() -> int64_t;
+
+  /** Unregister the snapshot of a finished snapshot-reading transaction */
+  void FinishSnapshot(Transaction *txn);
+  /** Wait until no transaction writes without versions, the snapshot transaction is counted already */
+  static void WaitForUnversionedWriters();
+  /** Stop counting txn as writing without versions, waking the snapshot transactions waiting for it */
+  static void FinishUnversionedWrites(Transaction *txn);
+  /** @return the oldest snapshot any active transaction reads */
+  auto Watermark() -> timestamp_t;
 
   std::atomic<txn_id_t> next_txn_id_{0};
+
+  /**
+   * MVCC: commit timestamps are handed out in commit order. Only commits that saved versions take the latch, a
+   * transaction that wrote in place commits without a timestamp.
+   */
+  std::atomic<timestamp_t> last_commit_ts_{0};
+  std::mutex commit_latch_;
+  /** MVCC: read timestamps of the active snapshot-reading transactions, only they take the latch. */
+  std::multiset<timestamp_t> active_read_ts_;
+  std::mutex active_read_ts_latch_;
+  /** MVCC: written tuples in commit timestamp order, the size lets commits skip the latch while there is none. */
+  std::deque<GarbageRecord> garbage_;
+  std::atomic<size_t> garbage_size_{0};
+  std::mutex garbage_latch_;
   LockManager *lock_manager_ __attribute__((__unused__));
   LogManager *log_manager_ __attribute__((__unused__));
 
-  /** The global transaction latch is used for checkpointing. */
-  ReaderWriterLatch global_txn_latch_;
+  /** The global list of running transactions in the system. */
+  static std::array<TxnMapShard, TXN_SLOTS> txn_map_shards;
+
+  /**
+   * MVCC: running snapshot transactions and transactions that wrote without versions. Each side counts itself
+   * first and checks the other second, so at most one of them goes ahead (both sequentially consistent). The latch
+   * and condition variable are only taken while a snapshot transaction waits.
+   */
+  static std::atomic<int64_t> snapshot_txns;
+  static std::atomic<int64_t> unversioned_writers;
+  static std::mutex unversioned_latch;
+  static std::condition_variable unversioned_cv;
+
+  /**
+   * Checkpoint quiescence. Begin and Commit only touch the slot of their own transaction and read blocked_, which
+   * is written by checkpoints alone; the latch and condition variable are only taken while a checkpoint runs.
+   */
+  std::array<ActiveSlot, TXN_SLOTS> active_slots_;
+  std::atomic<bool> blocked_{false};
+  std::mutex quiesce_latch_;
+  std::condition_variable quiesce_cv_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,122 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/concurrency/version_store.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the older versions of the tuples of one table heap for
+ * multi-version concurrency control.
+ *
+ * The newest version of a tuple always lives in place in the table page.
+ * Once a tuple is written, the store holds a version chain for it: the
+ * commit timestamp of the version in the page (or the transaction still
+ * writing it) and a list of undo versions, newest first, each with the
+ * image the tuple had before and the commit timestamp of that image. An
+ * undo version without an image means the tuple did not exist yet.
+ *
+ * A SNAPSHOT_ISOLATION transaction reads the version with the largest
+ * commit timestamp not after its read timestamp. Writers are serialized
+ * per tuple (first updater wins): writing a tuple that another transaction
+ * is writing, or that was committed after the writer's snapshot, aborts the
+ * writer. Chains that no active snapshot needs any more are pruned by the
+ * TransactionManager's garbage collection.
+ */
+class VersionStore {
+ public:
+  /** Outcome of a snapshot read */
+  enum class Visibility { IN_PLACE, UNDO, INVISIBLE };
+
+  VersionStore() = default;
+  DISALLOW_COPY_AND_MOVE(VersionStore);
+
+  /**
+   * Register a write of txn to rid before the page is modified.
+   * @param before the image of the tuple before the write, nullptr for an insert
+   * @param[out] first_write true if this is the first write of txn to rid, Abort() undoes it if the page write fails
+   * @return false on a write-write conflict, txn is set to ABORTED then
+   */
+  auto BeginWrite(Transaction *txn, const RID &rid, const Tuple *before, bool *first_write) -> bool;
+
+  /**
+   * Find the version of rid visible to txn.
+   * @param[out] tuple the visible image if it comes from the undo versions
+   * @return IN_PLACE if the version in the page is visible, UNDO if tuple holds it, INVISIBLE if the tuple did not
+   * exist at the snapshot of txn
+   */
+  auto GetVisible(Transaction *txn, const RID &rid, Tuple *tuple) -> Visibility;
+
+  /** @return the commit timestamp of the newest committed version of rid, 0 if it is older than every snapshot */
+  auto LatestCommitTs(const RID &rid) -> timestamp_t;
+
+  /**
+   * Stamp the version txn wrote to rid with its commit timestamp.
+   * @return false if txn wrote rid without saving a version
+   */
+  auto Commit(txn_id_t txn_id, const RID &rid, timestamp_t commit_ts) -> bool;
+
+  /**
+   * Drop the undo version txn added to rid, the page must have been (or be about to be) rolled back.
+   * @return true if older versions of rid are left for the garbage collection
+   */
+  auto Abort(txn_id_t txn_id, const RID &rid) -> bool;
+
+  /**
+   * Drop the versions of rid that no snapshot at or after watermark can see.
+   * @return true if the chain was removed, i.e. the version in the page is visible to everyone
+   */
+  auto Prune(const RID &rid, timestamp_t watermark) -> bool;
+
+  /** @return the number of tuples with a version chain */
+  auto Size() -> size_t;
+
+ private:
+  static constexpr size_t SHARDS = 16;
+
+  struct UndoVersion {
+    /** Whether the tuple existed in this version */
+    bool exists_;
+    /** The image of the tuple in this version */
+    Tuple tuple_;
+    /** Commit timestamp of this version */
+    timestamp_t ts_;
+  };
+
+  struct VersionChain {
+    /** The transaction that wrote the version in the page and has not committed yet */
+    txn_id_t writer_{INVALID_TXN_ID};
+    /** Commit timestamp of the version in the page, if it is committed */
+    timestamp_t ts_{0};
+    /** Older versions, newest first */
+    std::vector<UndoVersion> undo_;
+  };
+
+  struct alignas(64) Shard {
+    std::unordered_map<RID, VersionChain> chains_;
+    std::mutex latch_;
+  };
+
+  auto ShardOf(const RID &rid) -> Shard &;
+
+  std::array<Shard, SHARDS> shards_;
+};
+
+}  // namespace bustub
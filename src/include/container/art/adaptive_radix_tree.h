@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree.h
+//
+// Identification: src/include/container/art/adaptive_radix_tree.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/epoch_manager.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+/**
+ * AdaptiveRadixTree is an in-memory ordered map from binary comparable byte
+ * strings to record ids (Leis et al., "The Adaptive Radix Tree: ARTful
+ * Indexing for Main-Memory Databases").
+ *
+ * Inner nodes branch on one key byte and come in four sizes (Node4, Node16,
+ * Node48 and Node256) that grow and shrink with their fan-out. Single-child
+ * paths are collapsed into a prefix stored in the node below (path
+ * compression); only the first MAX_STORED_PREFIX bytes of a prefix are
+ * kept in the node, the rest is checked against the full key in the leaf.
+ *
+ * Keys must be prefix free, i.e. no key may be a proper prefix of another
+ * key. Fixed-size key encodings and terminated strings satisfy this.
+ *
+ * Concurrency uses optimistic lock coupling: every inner node carries a
+ * version, readers never write shared memory and restart if a version they
+ * read has changed, writers lock the (at most two) nodes they modify.
+ * Replaced nodes and leaves are reclaimed through an EpochManager.
+ */
+class AdaptiveRadixTree {
+ public:
+  AdaptiveRadixTree();
+  ~AdaptiveRadixTree();
+
+  DISALLOW_COPY_AND_MOVE(AdaptiveRadixTree);
+
+  /**
+   * Look up a key.
+   * @param key the binary comparable key
+   * @param[out] value the value of the key if it exists
+   * @return true if the key exists
+   */
+  auto Get(const std::string &key, RID *value) -> bool;
+
+  /**
+   * Collect the values of all keys that start with prefix, in key order.
+   * @return true if at least one key matched
+   */
+  auto ScanPrefix(const std::string &prefix, std::vector<RID> *result) -> bool;
+
+  /**
+   * Insert a key-value pair.
+   * @return false if the key already exists, the existing value is kept
+   */
+  auto Insert(const std::string &key, RID value) -> bool;
+
+  /**
+   * Remove a key.
+   * @return false if the key does not exist
+   */
+  auto Remove(const std::string &key) -> bool;
+
+ private:
+  static constexpr uint32_t MAX_STORED_PREFIX = 8;
+
+  struct Node;
+  struct Node4;
+  struct Node16;
+  struct Node48;
+  struct Node256;
+  struct Leaf;
+
+  // one optimistic attempt of an operation, returns RESTART if a version check failed
+  enum class Attempt { FAILED, SUCCEEDED, RESTART };
+  auto TryGet(const std::string &key, RID *value) -> Attempt;
+  auto TryScanPrefix(const std::string &prefix, std::vector<RID> *result) -> Attempt;
+  auto TryInsert(const std::string &key, RID value) -> Attempt;
+  auto TryRemove(const std::string &key) -> Attempt;
+
+  // read the full prefix of node, loading it from a leaf below node if only part of it is stored
+  auto LoadPrefix(Node *node, uint64_t version, uint32_t depth, std::string *prefix) -> bool;
+  auto CollectLeaves(Node *node, uint64_t version, std::vector<Leaf *> *leaves) -> bool;
+  // replace node in its parent by the only child left after removing removed_byte, node itself becomes obsolete
+  auto CompressPath(Node *node, uint8_t removed_byte, Node *parent, uint8_t parent_byte) -> bool;
+
+  static auto GrowAndInsert(Node *node, uint8_t byte, void *child) -> Node *;
+  static auto Shrink(Node *node) -> Node *;
+  static void DeleteNode(Node *node);
+  static void DeleteSubtree(void *child);
+  void Retire(void *child);
+
+  Node *root_;
+  EpochManager epoch_manager_;
+};
+
+}  // namespace bustub
@@ -17,18 +17,25 @@
 
 #pragma once
 
-#include <list>
+#include <cstdint>
 #include <memory>
-#include <mutex>  // NOLINT
+#include <shared_mutex>
 #include <utility>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "container/hash/hash_table.h"
 
 namespace bustub {
 
 /**
  * ExtendibleHashTable implements a hash table using the extendible hashing algorithm.
+ *
+ * The directory is guarded by a reader-writer latch: lookups, updates and
+ * inserts into a bucket with room only take it shared, so they run in parallel
+ * and only serialize on the latch of the bucket they touch. A bucket split
+ * takes the directory latch exclusively.
+ *
  * @tparam K key type
  * @tparam V value type
  */
@@ -107,13 +114,19 @@ class ExtendibleHashTable : public HashTable<K, V> {
 
   /**
    * Bucket class for each hash table bucket that the directory points to.
+   *
+   * Items live in a fixed-size array with one tag byte per slot, in the style
+   * of a Swiss table: a tag holds 7 bits of the key hash with the high bit set,
+   * an empty slot has tag 0. A lookup compares the tags a group of GROUP_WIDTH
+   * slots at a time with word-wide bit tricks and only compares keys whose tag
+   * matches. Every operation takes the latch of the bucket.
    */
   class Bucket {
    public:
     explicit Bucket(size_t size, int depth = 0);
 
     /** @brief Check if a bucket is full. */
-    inline auto IsFull() const -> bool { return list_.size() == size_; }
+    inline auto IsFull() const -> bool { return count_ == size_; }
 
     /** @brief Get the local depth of the bucket. */
     inline auto GetDepth() const -> int { return depth_; }
@@ -121,7 +134,8 @@ class ExtendibleHashTable : public HashTable<K, V> {
     /** @brief Increment the local depth of a bucket. */
     inline void IncrementDepth() { depth_++; }
 
-    inline auto GetItems() -> std::list<std::pair<K, V>> & { return list_; }
+    /** @brief Move all items out of the bucket, leaving it empty. */
+    auto TakeItems() -> std::vector<std::pair<K, V>>;
 
     /**
      *
@@ -158,10 +172,24 @@ class ExtendibleHashTable : public HashTable<K, V> {
     auto Insert(const K &key, const V &value) -> bool;
 
    private:
-    // TODO(student): You may add additional private members and helper functions
+    /** Number of tags compared at once */
+    static constexpr size_t GROUP_WIDTH = sizeof(uint64_t);
+    static constexpr uint8_t EMPTY_TAG = 0;
+
+    /** @return the tag of key, never EMPTY_TAG */
+    static auto TagOf(const K &key) -> uint8_t;
+    /** @return a mask with the high bit set in every byte of group whose tag equals tag */
+    auto MatchGroup(size_t group, uint8_t tag) const -> uint64_t;
+    /** @return the slot holding key, or size_ if there is none */
+    auto FindSlot(const K &key, uint8_t tag) const -> size_t;
+
     size_t size_;
     int depth_;
-    std::list<std::pair<K, V>> list_;
+    size_t count_{0};
+    // padded to whole groups, the padding stays EMPTY_TAG
+    std::vector<uint8_t> tags_;
+    std::vector<std::pair<K, V>> slots_;
+    ReaderWriterLatch latch_;
   };
 
  private:
@@ -171,7 +199,7 @@ class ExtendibleHashTable : public HashTable<K, V> {
   int global_depth_;    // The global depth of the directory
   size_t bucket_size_;  // The size of a bucket
   int num_buckets_;     // The number of buckets in the hash table
-  mutable std::mutex latch_;
+  mutable std::shared_mutex latch_;
   std::vector<std::shared_ptr<Bucket>> dir_;  // The directory of the hash table
 
   // The following functions are completely optional, you can delete them if you have your own ideas.
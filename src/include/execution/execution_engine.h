@@ -16,6 +16,7 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/catalog.h"
+#include "common/exception.h"
 #include "concurrency/transaction.h"
 #include "concurrency/transaction_manager.h"
 #include "execution/executor_context.h"
@@ -62,7 +63,7 @@ class ExecutionEngine {
 
     try {
       executor->Init();
-      PollExecutor(executor.get(), plan, result_set);
+      PollExecutor(executor.get(), plan, result_set, txn);
     } catch (const ExecutionException &ex) {
 #ifndef NDEBUG
       LOG_ERROR("Error Encountered in Executor Execution: %s", ex.what());
@@ -82,15 +83,19 @@ class ExecutionEngine {
    * @param executor The root executor
    * @param plan The plan to execute
    * @param result_set The tuple result set
+   * @param txn The transaction, a wounded one stops after the tuple it is working on and rolls back its locks
    */
-  static void PollExecutor(AbstractExecutor *executor, const AbstractPlanNodeRef &plan,
-                           std::vector<Tuple> *result_set) {
+  static void PollExecutor(AbstractExecutor *executor, const AbstractPlanNodeRef &plan, std::vector<Tuple> *result_set,
+                           Transaction *txn) {
     RID rid{};
     Tuple tuple{};
     while (executor->Next(&tuple, &rid)) {
       if (result_set != nullptr) {
         result_set->push_back(tuple);
       }
+      if (txn != nullptr && txn->GetState() == TransactionState::ABORTED) {
+        throw ExecutionException("transaction aborted by an older one");
+      }
     }
   }
 
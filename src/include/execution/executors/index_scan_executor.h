@@ -18,6 +18,7 @@
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
 #include "execution/plans/index_scan_plan.h"
+#include "storage/index/b_plus_tree_index.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -44,5 +45,11 @@ class IndexScanExecutor : public AbstractExecutor {
  private:
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  /** The table the index points into */
+  const TableInfo *table_info_{nullptr};
+  /** The scanned index */
+  BPlusTreeIndexForOneIntegerColumn *tree_{nullptr};
+  /** The current position, moved backward for a reverse scan */
+  BPlusTreeIndexIteratorForOneIntegerColumn iterator_;
 };
 }  // namespace bustub
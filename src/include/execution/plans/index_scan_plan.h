@@ -29,24 +29,34 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * Creates a new index scan plan node.
    * @param output the output format of this scan plan node
    * @param table_oid the identifier of table to be scanned
+   * @param reverse whether the index is scanned from the largest key to the smallest one
    */
-  IndexScanPlanNode(SchemaRef output, index_oid_t index_oid)
-      : AbstractPlanNode(std::move(output), {}), index_oid_(index_oid) {}
+  IndexScanPlanNode(SchemaRef output, index_oid_t index_oid, bool reverse = false)
+      : AbstractPlanNode(std::move(output), {}), index_oid_(index_oid), reverse_(reverse) {}
 
   auto GetType() const -> PlanType override { return PlanType::IndexScan; }
 
   /** @return the identifier of the table that should be scanned */
   auto GetIndexOid() const -> index_oid_t { return index_oid_; }
 
+  /** @return whether the index is scanned in descending key order */
+  auto IsReverse() const -> bool { return reverse_; }
+
   BUSTUB_PLAN_NODE_CLONE_WITH_CHILDREN(IndexScanPlanNode);
 
   /** The table whose tuples should be scanned. */
   index_oid_t index_oid_;
 
+  /** Whether the index is scanned in descending key order */
+  bool reverse_;
+
   // Add anything you want here for index lookup
 
  protected:
   auto PlanNodeToString() const -> std::string override {
+    if (reverse_) {
+      return fmt::format("IndexScan {{ index_oid={}, reverse=true }}", index_oid_);
+    }
     return fmt::format("IndexScan {{ index_oid={} }}", index_oid_);
   }
 };
@@ -85,8 +85,8 @@ class Optimizer {
    */
   auto OptimizeOrderByAsIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
-  /** @brief check if the index can be matched */
-  auto MatchIndex(const std::string &table_name, uint32_t index_key_idx)
+  /** @brief check if the index can be matched, ordered only matches indexes that can be iterated in key order */
+  auto MatchIndex(const std::string &table_name, uint32_t index_key_idx, bool ordered = false)
       -> std::optional<std::tuple<index_oid_t, std::string>>;
 
   /**
@@ -1,21 +1,25 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
-#include <stack>
+#include <mutex>  // NOLINT
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "common/epoch_manager.h"
 #include "common/exception.h"
 #include "common/logger.h"
-#include "common/rwlatch.h"
 
 namespace bustub {
 
 /**
  * TrieNode is a generic container for any node in Trie.
+ *
+ * Children are shared pointers so that the versions of a copy-on-write Trie
+ * can share every subtree a write did not touch.
  */
 class TrieNode {
  public:
@@ -42,11 +46,25 @@ class TrieNode {
         is_end_(other_trie_node.is_end_),
         children_(std::move(other_trie_node.children_)) {}
 
+  /**
+   * @brief Copy constructor for trie node object. The copy shares the child nodes of other_trie_node.
+   *
+   * @param other_trie_node Trie node to copy.
+   */
+  TrieNode(const TrieNode &other_trie_node) = default;
+
   /**
    * @brief Destroy the TrieNode object.
    */
   virtual ~TrieNode() = default;
 
+  /**
+   * @brief Copy this node, including its value if it holds one. The copy shares the child nodes.
+   *
+   * @return The copy of this trie node.
+   */
+  virtual std::unique_ptr<TrieNode> Clone() const { return std::make_unique<TrieNode>(*this); }
+
   /**
    * TODO(P0): Add implementation
    *
@@ -96,15 +114,15 @@ class TrieNode {
    * Note that parameter `child` is rvalue and should be moved when it is
    * inserted into children_map.
    *
-   * The return value is a pointer to unique_ptr because pointer to unique_ptr can access the
-   * underlying data without taking ownership of the unique_ptr. Further, we can set the return
+   * The return value is a pointer to shared_ptr because pointer to shared_ptr can access the
+   * underlying data without taking ownership of the node. Further, we can set the return
    * value to nullptr when error occurs.
    *
    * @param key Key of child node
    * @param child Unique pointer created for the child node. This should be added to children_ map.
-   * @return Pointer to unique_ptr of the inserted child node. If insertion fails, return nullptr.
+   * @return Pointer to shared_ptr of the inserted child node. If insertion fails, return nullptr.
    */
-  std::unique_ptr<TrieNode> *InsertChildNode(char key_char, std::unique_ptr<TrieNode> &&child) {
+  std::shared_ptr<TrieNode> *InsertChildNode(char key_char, std::unique_ptr<TrieNode> &&child) {
     if (HasChild((key_char))) {
       return nullptr;
     }
@@ -124,10 +142,10 @@ class TrieNode {
    * not exist, return nullptr.
    *
    * @param key Key of child node
-   * @return Pointer to unique_ptr of the child node, nullptr if child
+   * @return Pointer to shared_ptr of the child node, nullptr if child
    *         node does not exist.
    */
-  std::unique_ptr<TrieNode> *GetChildNode(char key_char) {
+  std::shared_ptr<TrieNode> *GetChildNode(char key_char) {
     if (children_.count(key_char) == 0) {
       return nullptr;
     }
@@ -139,21 +157,12 @@ class TrieNode {
    * TODO(P0): Add implementation
    *
    * @brief Remove child node from children_ map.
-   * If key_char does not exist in children_, return immediately.
+   * If key_char does not exist in children_, return immediately. The child node
+   * is freed once no other version of the trie shares it.
    *
    * @param key_char Key char of child node to be removed
    */
-  void RemoveChildNode(char key_char) {
-    if (children_.count(key_char) == 0) {
-      return;
-    }
-    //    std::cout << "2" << std::endl;
-    //    children_.at(key_char)->RemoveChildNode(key_char);
-    // weird , I don't know what this function should do, and the brief is unclear
-    delete children_.at(key_char).release();
-    children_.erase(key_char);
-    //    std::cout << "i am par, the sz is " << children_.size() << std::endl;
-  }
+  void RemoveChildNode(char key_char) { children_.erase(key_char); }
 
   /**
    * TODO(P0): Add implementation
@@ -171,7 +180,7 @@ class TrieNode {
   bool is_end_{false};
   /** A map of all child nodes of this trie node, which can be accessed by each
    * child node's key char. */
-  std::unordered_map<char, std::unique_ptr<TrieNode>> children_;
+  std::unordered_map<char, std::shared_ptr<TrieNode>> children_;
 };
 
 /**
@@ -225,6 +234,8 @@ class TrieNodeWithValue : public TrieNode {
    */
   ~TrieNodeWithValue() override = default;
 
+  std::unique_ptr<TrieNode> Clone() const override { return std::make_unique<TrieNodeWithValue>(*this); }
+
   /**
    * @brief Get the stored value_.
    *
@@ -236,13 +247,68 @@ class TrieNodeWithValue : public TrieNode {
 /**
  * Trie is a concurrent key-value store. Each key is a string and its corresponding
  * value can be any type.
+ *
+ * Readers never block: a published trie node is never modified again. A writer
+ * copies the nodes on the path to its key, links the copies to the untouched
+ * subtrees and swaps in the new root atomically. Writers are serialized by
+ * write_latch_. The old root is retired to an epoch manager, so the nodes only
+ * the old version owns are freed once no reader that could still see them is
+ * left.
  */
 class Trie {
  private:
-  /* Root node of the trie */
-  std::unique_ptr<TrieNode> root_;
-  /* Read-write lock for the trie */
-  ReaderWriterLatch latch_;
+  /* Root node of the latest version, only accessed by writers */
+  std::shared_ptr<TrieNode> root_;
+  /* Root node of the latest version, published to readers */
+  std::atomic<TrieNode *> root_view_;
+  /* Serializes writers */
+  std::mutex write_latch_;
+  /* Defers freeing old versions until no reader is inside them */
+  EpochManager epoch_manager_;
+
+  /**
+   * @brief Collect the nodes on the path to key in the current version, path[i] is
+   * the node of the first i key characters. Stops early if the path ends.
+   */
+  void FindPath(const std::string &key, std::vector<TrieNode *> *path) {
+    TrieNode *node = root_.get();
+    path->push_back(node);
+    for (char key_char : key) {
+      std::shared_ptr<TrieNode> *child = node->GetChildNode(key_char);
+      if (child == nullptr) {
+        return;
+      }
+      node = child->get();
+      path->push_back(node);
+    }
+  }
+
+  /**
+   * @brief Copy the path above a changed node and publish the new version.
+   *
+   * @param key Key whose path is copied
+   * @param path Nodes on the path to key in the current version
+   * @param depth Depth of the changed node
+   * @param node The new node at depth, nullptr if the node at depth is removed
+   */
+  void Publish(const std::string &key, const std::vector<TrieNode *> &path, size_t depth,
+               std::unique_ptr<TrieNode> node) {
+    for (size_t i = depth; i > 0; i--) {
+      std::unique_ptr<TrieNode> parent = path[i - 1]->Clone();
+      char key_char = key.at(i - 1);
+      parent->RemoveChildNode(key_char);
+      if (node != nullptr) {
+        parent->InsertChildNode(key_char, std::move(node));
+      } else if (i - 1 > 0 && !parent->HasChildren() && !parent->IsEndNode()) {
+        // a removed key leaves no dangling nodes behind, the parent goes as well
+        continue;
+      }
+      node = std::move(parent);
+    }
+    std::shared_ptr<TrieNode> old_root = std::exchange(root_, std::shared_ptr<TrieNode>(std::move(node)));
+    root_view_.store(root_.get());
+    epoch_manager_.Retire([old_root]() mutable { old_root.reset(); });
+  }
 
  public:
   /**
@@ -251,7 +317,7 @@ class Trie {
    * @brief Construct a new Trie object. Initialize the root node with '\0'
    * character.
    */
-  Trie() : root_(std::make_unique<TrieNode>('\0')) {}
+  Trie() : root_(std::make_shared<TrieNode>('\0')), root_view_(root_.get()) {}
 
   /**
    * TODO(P0): Add implementation
@@ -281,46 +347,33 @@ class Trie {
    */
   template <typename T>
   bool Insert(const std::string &key, T value) {
-    latch_.WLock();
-    int idx = 0;
-    int sz = key.size();
-
-    if (sz == 0) {
-      latch_.WUnlock();
+    if (key.empty()) {
       return false;
     }
 
-    std::unique_ptr<TrieNode> *ptr = &root_;
-    while ((idx < sz) && (*ptr)->HasChild(key.at(idx))) {
-      ptr = (*ptr)->GetChildNode(key.at(idx));
-      idx++;
-    }
-
-    if (idx < sz) {
-      // not exist
-      while (idx < sz) {
-        if (idx == sz - 1) {
-          ptr = (*ptr)->InsertChildNode(key.at(idx), std::make_unique<TrieNodeWithValue<T>>(key.at(idx), value));
-        } else {
-          ptr = (*ptr)->InsertChildNode(key.at(idx), std::make_unique<TrieNode>(key.at(idx)));
-        }
-
-        idx++;
-      }
-    } else {
-      if ((*ptr)->IsEndNode()) {
-        latch_.WUnlock();
+    std::scoped_lock lock(write_latch_);
+    std::vector<TrieNode *> path;
+    FindPath(key, &path);
 
+    size_t depth = key.size();
+    std::unique_ptr<TrieNode> node;
+    if (path.size() > depth) {
+      if (path[depth]->IsEndNode()) {
         // exist terminal node
         return false;
       }
-
       // is not end, but exist
-      ptr->reset(new TrieNodeWithValue<T>(std::move(*(*ptr)), value));
+      node = std::make_unique<TrieNodeWithValue<T>>(TrieNode(*path[depth]), value);
+    } else {
+      // not exist, build the missing suffix bottom up
+      node = std::make_unique<TrieNodeWithValue<T>>(key.at(depth - 1), value);
+      for (; depth > path.size(); depth--) {
+        auto parent = std::make_unique<TrieNode>(key.at(depth - 2));
+        parent->InsertChildNode(key.at(depth - 1), std::move(node));
+        node = std::move(parent);
+      }
     }
-
-    latch_.WUnlock();
-
+    Publish(key, path, depth, std::move(node));
     return true;
   }
 
@@ -342,55 +395,26 @@ class Trie {
    * @return True if the key exists and is removed, false otherwise
    */
   bool Remove(const std::string &key) {
-    latch_.WLock();
-    int idx = 0;
-    int sz = key.size();
-
-    if (sz == 0) {
-      latch_.WUnlock();
+    if (key.empty()) {
       return false;
     }
 
-    std::unique_ptr<TrieNode> *ptr = &root_;
-    std::stack<std::unique_ptr<TrieNode> *> st{};
-    st.push(ptr);
-
-    while ((idx < sz) && (*ptr)->HasChild(key.at(idx))) {
-      ptr = (*ptr)->GetChildNode(key.at(idx));
-      st.push(ptr);
-      idx++;
-    }
+    std::scoped_lock lock(write_latch_);
+    std::vector<TrieNode *> path;
+    FindPath(key, &path);
 
-    if (idx < sz) {
-      latch_.WUnlock();
+    size_t depth = key.size();
+    if (path.size() <= depth || !path[depth]->IsEndNode()) {
       return false;
     }
 
-    if (!((*ptr)->IsEndNode())) {
-      latch_.WUnlock();
-      return false;
-    }
-
-    if ((*ptr)->HasChildren()) {
-      (*ptr)->SetEndNode(false);
-    } else {
-      (*ptr)->SetEndNode(false);
-      std::unique_ptr<TrieNode> *child = ptr;
-      std::unique_ptr<TrieNode> *parent;
-
-      while (!((*child)->HasChildren()) && !((*child)->IsEndNode()) && st.size() > 1) {
-        child = st.top();
-        st.pop();
-
-        parent = st.top();
-
-        (*parent)->RemoveChildNode((*child)->GetKeyChar());
-
-        child = parent;
-        parent = nullptr;
-      }
+    std::unique_ptr<TrieNode> node;
+    if (path[depth]->HasChildren()) {
+      // keep the node for the longer keys, but without the value
+      node = std::make_unique<TrieNode>(*path[depth]);
+      node->SetEndNode(false);
     }
-    latch_.WUnlock();
+    Publish(key, path, depth, std::move(node));
     return true;
   }
 
@@ -414,36 +438,32 @@ class Trie {
    */
   template <typename T>
   T GetValue(const std::string &key, bool *success) {
-    latch_.RLock();
-    int idx = 0;
-    int sz = key.size();
-    std::unique_ptr<TrieNode> *ptr = &root_;
-    while ((idx < sz) && (*ptr)->HasChild(key.at(idx))) {
-      ptr = (*ptr)->GetChildNode(key.at(idx));
-      idx++;
+    *success = false;
+    if (key.empty()) {
+      return {};
     }
 
-    if (idx < sz) {
-      *success = false;
-      latch_.RUnlock();
-      return {};
+    // the version read here stays alive until the guard is released, however many writers commit meanwhile
+    EpochGuard guard(&epoch_manager_);
+    TrieNode *node = root_view_.load();
+    for (char key_char : key) {
+      std::shared_ptr<TrieNode> *child = node->GetChildNode(key_char);
+      if (child == nullptr) {
+        return {};
+      }
+      node = child->get();
     }
 
-    if (!((*ptr)->IsEndNode())) {
-      *success = false;
-      latch_.RUnlock();
+    if (!node->IsEndNode()) {
       return {};
     }
 
-    auto p = dynamic_cast<TrieNodeWithValue<T> *>(ptr->get());
+    auto p = dynamic_cast<TrieNodeWithValue<T> *>(node);
     if (p == nullptr) {
-      *success = false;
-      latch_.RUnlock();
       return {};
     }
 
     *success = true;
-    latch_.RUnlock();
     return p->GetValue();
   }
 };
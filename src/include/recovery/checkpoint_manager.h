@@ -12,6 +12,10 @@
 
 #pragma once
 
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,7 +23,13 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager takes fuzzy checkpoints (ARIES): transactions keep running while a checkpoint is taken.
+ *
+ * BeginCheckpoint() logs a begin checkpoint record and starts writing out the pages that were dirty at that point in
+ * the background. EndCheckpoint() waits for the writes, logs the active transaction table and the dirty page table
+ * in end checkpoint records, forces the log and points the master record at the checkpoint. Recovery analyzes the
+ * log from the begin checkpoint record on and redoes it from the oldest recLSN of the dirty pages, the pages written
+ * by the checkpoint move that point forward.
  */
 class CheckpointManager {
  public:
@@ -29,15 +39,31 @@ class CheckpointManager {
         log_manager_(log_manager),
         buffer_pool_manager_(buffer_pool_manager) {}
 
-  ~CheckpointManager() = default;
+  ~CheckpointManager();
 
   void BeginCheckpoint();
   void EndCheckpoint();
 
  private:
+  /**
+   * Write out the pages. The pages whose changes are in the durable log go first, the log is then forced once up to
+   * the newest of the others rather than once for every page ahead of it.
+   */
+  void FlushPages(const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages);
+  /**
+   * Write out a page, holding its read latch while it is written. A page ahead of the persistent lsn is skipped
+   * unless force_log is set, which forces the log up to the page first.
+   * @return the lsn of the skipped page, INVALID_LSN if it was not skipped
+   */
+  auto FlushPage(page_id_t page_id, bool force_log) -> lsn_t;
+
   TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+
+  /** The begin checkpoint record of the running checkpoint, INVALID_LSN if there is none */
+  lsn_t begin_lsn_{INVALID_LSN};
+  std::thread flush_thread_;
 };
 
 }  // namespace bustub
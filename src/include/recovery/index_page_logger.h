@@ -0,0 +1,111 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_page_logger.h
+//
+// Identification: src/include/recovery/index_page_logger.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "recovery/log_manager.h"
+
+namespace bustub {
+
+/**
+ * IndexPageLogger logs the page changes of index operations. An index reaches its buffer pool through the logger:
+ * while logging is enabled, the logger keeps an image of every page an operation of the thread fetches or creates
+ * between BeginOperation() and EndOperation(), and pins it until the end of the operation. The image of a page the
+ * operation write latches is taken under its latch, see Snapshot(). EndOperation() compares the pages with their
+ * images and appends the changed bytes as INDEX_PAGE records, then stamps the pages with the lsn. It runs while the
+ * operation still latches the pages it changed, so the records of a page follow the order of its changes; a page
+ * unlatched before the end is logged on its own by LogPage().
+ *
+ * A page the operation only read is forgotten once the operation unpins it clean, as it may be unlatched and
+ * changed by others afterwards. The changes of a split or a merge are redone as a whole or not at all, there is no
+ * undo of them: the keys are undone logically (see INDEX_INSERT and INDEX_DELETE).
+ */
+class IndexPageLogger : public BufferPoolManager {
+ public:
+  /** Records are cut at this size, a group of records carries the rest */
+  static constexpr size_t MAX_RECORD_SIZE = LOG_BUFFER_SIZE - 64;
+  /** Runs of changed bytes closer than this are logged as one run */
+  static constexpr uint32_t RUN_GAP = 4;
+
+  IndexPageLogger(BufferPoolManager *buffer_pool_manager, LogManager *log_manager)
+      : buffer_pool_manager_(buffer_pool_manager), log_manager_(log_manager) {}
+
+  ~IndexPageLogger() override = default;
+
+  /** Start tracking the pages of an operation of this thread, nothing is tracked unless logging is enabled */
+  void BeginOperation();
+
+  /** Log the changes of the operation and release the pages it tracked, before it unlatches them */
+  void EndOperation();
+
+  /** Log the changes to a page the operation is about to unlatch and stop tracking it */
+  void LogPage(Page *page);
+
+  /**
+   * Take the image of a tracked page again once the operation write latched it. Changes made by others between the
+   * fetch and the latch are theirs to log; the operation must not have changed the page yet.
+   */
+  void Snapshot(Page *page);
+
+  auto GetPoolSize() -> size_t override { return buffer_pool_manager_->GetPoolSize(); }
+
+  auto GetDirtyPageTable() -> std::vector<std::pair<page_id_t, lsn_t>> override {
+    return buffer_pool_manager_->GetDirtyPageTable();
+  }
+
+ protected:
+  auto FetchPgImp(page_id_t page_id) -> Page * override;
+  auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool override;
+  auto FlushPgImp(page_id_t page_id) -> bool override { return buffer_pool_manager_->FlushPage(page_id); }
+  auto NewPgImp(page_id_t *page_id) -> Page * override;
+  auto DeletePgImp(page_id_t page_id) -> bool override;
+  void FlushAllPgsImp() override { buffer_pool_manager_->FlushAllPages(); }
+
+ private:
+  struct TrackedPage {
+    Page *page_;
+    /** The page as the operation found it, zeros for a new page */
+    std::vector<char> image_;
+    /** Pins of the operation, the logger holds one more */
+    int pin_count_{1};
+    bool dirty_{false};
+    bool new_page_{false};
+  };
+
+  /** The pages an operation of a thread tracks, it belongs to the logger the operation runs on */
+  struct Operation {
+    IndexPageLogger *logger_{nullptr};
+    std::unordered_map<page_id_t, TrackedPage> pages_;
+    /** The last record of the operation so far, the next one is chained to it */
+    lsn_t last_lsn_{INVALID_LSN};
+  };
+
+  void Track(page_id_t page_id, Page *page, bool new_page);
+  /** Release the pin of the logger on a page and stop tracking it */
+  void Untrack(page_id_t page_id, bool is_dirty);
+  /** @return the changed bytes of a tracked page */
+  static auto Diff(page_id_t page_id, const TrackedPage &tracked) -> PageDelta;
+  /** Append the deltas as a group of records continuing the operation, set more if records follow the group */
+  void Append(std::vector<std::pair<PageDelta, Page *>> *deltas, bool more);
+
+  static thread_local Operation operation_;
+
+  BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+};
+
+}  // namespace bustub
@@ -13,10 +13,16 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>              // NOLINT
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
+#include <map>
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
+#include "common/util/compression_util.h"
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
 
@@ -25,20 +31,44 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * Commits are flushed in groups: a committer waits in WaitForDurable() until its commit record is on disk, and the
+ * flush thread writes everything appended so far with one write and one sync once group_commit_size committers
+ * are waiting or the first of them has waited group_commit_window. Asynchronous commits do not wait, the current
+ * buffer is flushed at the latest log_timeout after the previous flush of it, so no record stays volatile for longer.
+ *
+ * Appending takes no latch. The log buffers form a ring, appenders go to the current one and reserve space with a
+ * single fetch-add on its reservation word, which hands out the lsn and the offset of the record together, so lsns
+ * follow the order of the log. The record is copied in without any latch and the copied bytes are published in
+ * written_. A reservation that does not fit seals the buffer: the appender that overflows it first activates the
+ * next buffer of the ring, the flush thread waits until the sealed buffer is completely written and writes it out.
+ * Appenders only wait when all buffers of the ring are sealed. A sealed buffer is written as one log block, which is
+ * compressed first if enable_log_compression is set.
  */
 class LogManager {
  public:
+  /** Number of log buffers in the ring */
+  static constexpr size_t LOG_BUFFER_COUNT = 4;
+
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+      : persistent_lsn_(INVALID_LSN), log_size_(disk_manager->GetLogSize()), disk_manager_(disk_manager) {
+    // the log is appended to the log file of an earlier run
+    for (auto &buffer : buffers_) {
+      buffer.data_ = new char[LOG_BUFFER_SIZE];
+      buffer.compressed_ = new char[BLOCK_HEADER_SIZE + CompressionUtil::MaxCompressedSize(LOG_BUFFER_SIZE)];
+    }
+    buffers_[0].reserved_ = BLOCK_HEADER_SIZE;
+    buffers_[0].written_ = BLOCK_HEADER_SIZE;
   }
 
   ~LogManager() {
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
+    StopFlushThread();
+    for (auto &buffer : buffers_) {
+      delete[] buffer.data_;
+      delete[] buffer.compressed_;
+      buffer.data_ = nullptr;
+      buffer.compressed_ = nullptr;
+    }
   }
 
   void RunFlushThread();
@@ -46,29 +76,123 @@ class LogManager {
 
   auto AppendLogRecord(LogRecord *log_record) -> lsn_t;
 
-  inline auto GetNextLSN() -> lsn_t { return next_lsn_; }
+  /**
+   * Wait until the log is durable up to and including lsn. The flush is shared with the other committers of the
+   * same group. Without a flush thread the log is flushed right away.
+   */
+  void WaitForDurable(lsn_t lsn);
+
+  /** Write everything appended so far to disk without waiting for a group to form. */
+  void Flush();
+
+  /**
+   * Write the log up to and including lsn unless it is durable already, without waiting for a group to form. Page
+   * writers call it for the write-ahead rule when a page is ahead of the persistent lsn; only the log buffer holding
+   * lsn is sealed early, the records after it are left to their group.
+   */
+  void FlushUntil(lsn_t lsn);
+
+  /**
+   * @return the log file offset of the flushed log buffer that holds lsn, the records before lsn in the buffer have to
+   * be skipped; -1 if lsn was not flushed by this log manager or its block was recycled
+   */
+  auto GetLogOffset(lsn_t lsn) -> log_offset_t;
+
+  /** Continue the log of an earlier run at lsn, before the first record is appended */
+  void SetNextLSN(lsn_t lsn);
+
+  /** Recycle the log before offset, the log start of the master record, and forget the blocks there */
+  void RecycleLog(log_offset_t offset);
+
+  /** @return the lsn the next appended record gets */
+  auto GetNextLSN() -> lsn_t;
   inline auto GetPersistentLSN() -> lsn_t { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline auto GetLogBuffer() -> char * { return log_buffer_; }
+  inline auto GetDiskManager() -> DiskManager * { return disk_manager_; }
+  inline auto GetLogBuffer() -> char * { return buffers_[current_ % LOG_BUFFER_COUNT].data_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** A log buffer starts with the header of the log block it is written as */
+  static constexpr uint64_t BLOCK_HEADER_SIZE = sizeof(LogBlockHeader);
+
+  struct LogBuffer {
+    char *data_{nullptr};
+    /** The log block of the buffer if it is written compressed */
+    char *compressed_{nullptr};
+    /** Records reserved in the upper 32 bits, bytes reserved in the lower 32 bits, past the end once sealed */
+    std::atomic<uint64_t> reserved_{0};
+    /** Bytes copied in by the appenders that reserved them */
+    std::atomic<uint64_t> written_{0};
+    /** Position of the buffer in the sequence of buffers */
+    uint64_t seq_{0};
+    /** Lsn of the first record */
+    lsn_t base_lsn_{0};
+    /** The bytes and records that made it in, set when the buffer is sealed */
+    uint64_t sealed_bytes_{0};
+    lsn_t sealed_records_{0};
+  };
+
+  /** Reservation word of a log buffer: one record, and the mask of the reserved bytes */
+  static constexpr uint64_t RECORD_ONE = uint64_t{1} << 32;
+  static constexpr uint64_t OFFSET_MASK = RECORD_ONE - 1;
+
+  /** Serialize the record into data, the layout is described in log_record.h */
+  static void Serialize(const LogRecord *log_record, char *data);
+
+  /** Write the sealed buffer as the log block at offset, @return the size of the block */
+  auto WriteBlock(LogBuffer *buffer, log_offset_t offset) -> int;
+
+  // all of these are called with latch_ held
+  /** Seal the current buffer if it holds records, false if an appender overflowed it first and has yet to seal it */
+  auto SealCurrent(std::unique_lock<std::mutex> *lock) -> bool;
+  /** Without a flush thread, write the log up to lsn from the calling thread */
+  void FlushInline(lsn_t lsn, std::unique_lock<std::mutex> *lock);
+  /** Record what made it into the sealed buffer seq and make the next buffer current, flushes inline if asked to
+   * when the ring is full */
+  void Activate(uint64_t seq, uint64_t reserved, std::unique_lock<std::mutex> *lock, bool inline_flush);
+  /** Write the oldest sealed buffer, latch_ is released for the write. A failed write throws and leaves the buffer
+   * to the next flush; the flush thread does not catch it, the system stops when its log cannot be written. */
+  void FlushOne(std::unique_lock<std::mutex> *lock);
+  void FlushSealed(std::unique_lock<std::mutex> *lock);
+  /** @return the lsn of the last reserved record */
+  auto LastLSN(std::unique_lock<std::mutex> *lock) -> lsn_t;
 
-  /** The atomic counter which records the next log sequence number. */
-  std::atomic<lsn_t> next_lsn_;
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
-  char *log_buffer_;
-  char *flush_buffer_;
+  std::array<LogBuffer, LOG_BUFFER_COUNT> buffers_;
+  /** Sequence number of the buffer appended to, changes under latch_ only */
+  std::atomic<uint64_t> current_{0};
+  /** Buffers before this sequence number are on disk */
+  uint64_t flushed_{0};
+  /**
+   * Log file offsets of the flushed buffers by the lsn of their first record, and the size of the log file; the
+   * offsets of recycled blocks are dropped
+   */
+  std::map<lsn_t, log_offset_t> flushed_offsets_;
+  log_offset_t log_size_;
 
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
-
+  std::thread *flush_thread_{nullptr};
+  bool flush_thread_running_{false};
+  /** True while a buffer is written, there is only one flush at a time */
+  bool flushing_{false};
+  /** Flush() was called */
+  bool flush_requested_{false};
+  /** Committers waiting for records in the current buffer, and when the first of them started waiting */
+  size_t waiters_{0};
+  std::chrono::steady_clock::time_point group_start_;
+  std::chrono::steady_clock::time_point last_flush_;
+
+  /** Wakes the flush thread */
   std::condition_variable cv_;
+  /** Wakes appenders waiting for the next buffer */
+  std::condition_variable append_cv_;
+  /** Wakes committers waiting for the persistent lsn to advance */
+  std::condition_variable durable_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -12,10 +12,14 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "common/util/varint_util.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -32,42 +36,94 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** A fuzzy checkpoint starts, transactions keep running. */
+  BEGIN_CHECKPOINT,
+  /** The active transaction table and the dirty page table of a checkpoint. */
+  END_CHECKPOINT,
+  /** A key of an index, undone logically; the pages are redone from the index page records. */
+  INDEX_INSERT,
+  INDEX_DELETE,
+  /** The bytes an index operation changed on its pages, redo only. */
+  INDEX_PAGE,
+};
+
+/** The bytes an index operation changed on a page as runs of (offset, bytes), a new page starts out zeroed */
+struct PageDelta {
+  page_id_t page_id_{INVALID_PAGE_ID};
+  bool new_page_{false};
+  std::vector<std::pair<uint32_t, std::string>> runs_;
 };
 
 /**
  * For every write operation on the table page, you should write ahead a corresponding log record.
  *
- * For EACH log record, HEADER is like (5 fields in common, 20 bytes in total).
- *---------------------------------------------
- * | size | LSN | transID | prevLSN | LogType |
- *---------------------------------------------
+ * Records are compact: integers are varints, ids, lsns and counts are stored as varints of the value plus one so that
+ * the invalid ones take a single byte, and byte strings are prefixed by their varint length. The lsn is not stored,
+ * the records of a log block have consecutive lsns from the base lsn of the block on (see LogBlockHeader).
+ *
+ * For EACH log record, HEADER is like (4 fields in common, 4 to 16 bytes in total).
+ *-----------------------------------------------
+ * | size | LogType (1 byte) | transID | prevLSN |
+ *-----------------------------------------------
  * For insert type log record
- *---------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
- *---------------------------------------------------------------
+ *------------------------------------------------------------
+ * | HEADER | page_id | slot_num | tuple_size | tuple_data |
+ *------------------------------------------------------------
  * For delete type (including markdelete, rollbackdelete, applydelete)
- *----------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
- *---------------------------------------------------------------
- * For update type log record
- *-----------------------------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
- *-----------------------------------------------------------------------------------
+ *------------------------------------------------------------
+ * | HEADER | page_id | slot_num | tuple_size | tuple_data |
+ *------------------------------------------------------------
+ * For update type log record, only the bytes between the prefix and the suffix the old and the new tuple share are
+ * logged; redo and undo take the rest from the tuple on the page. The log does not know the schema of the tuples, so
+ * this is a diff of bytes rather than of columns: an update of one column logs at most the bytes of that column, an
+ * update of several columns also logs the unchanged bytes between them.
+ *--------------------------------------------------------------------------------------------------------------------
+ * | HEADER | page_id | slot_num | prefix_size | suffix_size | old_size | old_middle_data | new_size | new_middle_data |
+ *--------------------------------------------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *------------------------------------
+ * For index insert and delete type log record, the key tuple is inserted into or deleted from the index of that name
+ *--------------------------------------------------------------------------
+ * | HEADER | name_size | name | page_id | slot_num | key_size | key_data |
+ *--------------------------------------------------------------------------
+ * For index page type log record, transID is invalid. The pages of an index operation that do not fit into one record
+ * are logged in a group of records chained by prevLSN, all but the last have more set; redo skips a group that did not
+ * reach the log completely.
+ *--------------------------------------------------------------------------------------------------------------------
+ * | HEADER | more | page_count | (page_id | new_page | run_count | (offset | run_size | run_data) * run_count) * ... |
+ *--------------------------------------------------------------------------------------------------------------------
+ * For end checkpoint type log record, prevLSN is the lsn of the begin checkpoint record. Tables too large for one
+ * record are written in several end checkpoint records.
+ *-----------------------------------------------------------------------------------------------------
+ * | HEADER | txn_count | page_count | (txn_id, last_lsn) * txn_count | (page_id, rec_lsn) * page_count |
+ *-----------------------------------------------------------------------------------------------------
+ * A compensation log record (CLR) is the change that undoes a record of a rolled back transaction. It has the type of
+ * that change with COMPENSATION_FLAG set in the type byte, and the header is followed by the undo next lsn, the prevLSN
+ * of the record it undoes. CLRs are redone like any other change but never undone, undo goes on at the undo next lsn,
+ * so a crash during a rollback does not undo a record twice.
+ *-------------------------------------------
+ * | HEADER | undo_next_lsn | type's fields |
+ *-------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
   friend class LogRecovery;
 
  public:
+  /** The most bytes an entry of the active transaction table or the dirty page table takes */
+  static const int CHECKPOINT_ENTRY_SIZE = 2 * 5;
+  /** Set in the type byte of a compensation log record */
+  static const uint8_t COMPENSATION_FLAG = 0x80;
+
   LogRecord() = default;
 
   // constructor for Transaction type(BEGIN/COMMIT/ABORT)
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
-      : size_(HEADER_SIZE), txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
+      : txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {
+    size_ = Framed(0);
+  }
 
   // constructor for INSERT/DELETE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &rid, const Tuple &tuple)
@@ -82,7 +138,7 @@ class LogRecord {
       delete_tuple_ = tuple;
     }
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
+    size_ = Framed(RIDSize(rid) + BytesSize(tuple.GetLength()));
   }
 
   // constructor for UPDATE type
@@ -94,24 +150,100 @@ class LogRecord {
         update_rid_(update_rid),
         old_tuple_(old_tuple),
         new_tuple_(new_tuple) {
+    // the tuples differ in the bytes between their common prefix and suffix, which span the updated columns
+    uint32_t length = std::min(old_tuple.GetLength(), new_tuple.GetLength());
+    const char *old_data = old_tuple.GetData();
+    const char *new_data = new_tuple.GetData();
+    while (update_prefix_ < length && old_data[update_prefix_] == new_data[update_prefix_]) {
+      update_prefix_++;
+    }
+    while (update_prefix_ + update_suffix_ < length && old_data[old_tuple.GetLength() - update_suffix_ - 1] ==
+                                                           new_data[new_tuple.GetLength() - update_suffix_ - 1]) {
+      update_suffix_++;
+    }
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+    size_ = Framed(RIDSize(update_rid) + FieldSize(update_prefix_) + FieldSize(update_suffix_) +
+                   BytesSize(old_tuple.GetLength() - update_prefix_ - update_suffix_) +
+                   BytesSize(new_tuple.GetLength() - update_prefix_ - update_suffix_));
   }
 
   // constructor for NEWPAGE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, page_id_t prev_page_id, page_id_t page_id)
-      : size_(HEADER_SIZE),
-        txn_id_(txn_id),
+      : txn_id_(txn_id),
         prev_lsn_(prev_lsn),
         log_record_type_(log_record_type),
         prev_page_id_(prev_page_id),
         page_id_(page_id) {
-    // calculate log record size, header size + sizeof(prev_page_id) + sizeof(page_id)
-    size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
+    // calculate log record size, header size + size of prev_page_id + size of page_id
+    size_ = Framed(FieldSize(prev_page_id) + FieldSize(page_id));
+  }
+
+  // constructor for END_CHECKPOINT type
+  LogRecord(lsn_t begin_checkpoint_lsn, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : prev_lsn_(begin_checkpoint_lsn),
+        log_record_type_(LogRecordType::END_CHECKPOINT),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    size_t size = FieldSize(active_txns_.size()) + FieldSize(dirty_pages_.size());
+    for (const auto &[txn_id, last_lsn] : active_txns_) {
+      size += FieldSize(txn_id) + FieldSize(last_lsn);
+    }
+    for (const auto &[page_id, rec_lsn] : dirty_pages_) {
+      size += FieldSize(page_id) + FieldSize(rec_lsn);
+    }
+    size_ = Framed(size);
+  }
+
+  // constructor for INDEX_INSERT/INDEX_DELETE type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, std::string index_name, const RID &rid,
+            const Tuple &key)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        index_name_(std::move(index_name)),
+        index_rid_(rid),
+        index_key_(key) {
+    assert(log_record_type == LogRecordType::INDEX_INSERT || log_record_type == LogRecordType::INDEX_DELETE);
+    size_ = Framed(BytesSize(index_name_.size()) + RIDSize(rid) + BytesSize(key.GetLength()));
+  }
+
+  // constructor for INDEX_PAGE type
+  LogRecord(lsn_t prev_lsn, bool more, std::vector<PageDelta> page_deltas)
+      : prev_lsn_(prev_lsn),
+        log_record_type_(LogRecordType::INDEX_PAGE),
+        more_(more),
+        page_deltas_(std::move(page_deltas)) {
+    size_t size = FieldSize(static_cast<int64_t>(more_)) + FieldSize(page_deltas_.size());
+    for (const auto &page_delta : page_deltas_) {
+      size += DeltaSize(page_delta);
+    }
+    size_ = Framed(size);
   }
 
   ~LogRecord() = default;
 
+  /** Make the record the compensation of a record whose prevLSN is undo_next_lsn */
+  inline void SetUndoNext(lsn_t undo_next_lsn) {
+    size_t size = size_ - (1 + FieldSize(txn_id_) + FieldSize(prev_lsn_) + VarintUtil::EncodedSize(size_));
+    if (compensation_) {
+      size -= FieldSize(undo_next_lsn_);
+    }
+    compensation_ = true;
+    undo_next_lsn_ = undo_next_lsn;
+    size_ = Framed(size);
+  }
+
+  /** @return the bytes a page delta takes in an index page record */
+  static inline auto DeltaSize(const PageDelta &page_delta) -> size_t {
+    size_t size = FieldSize(page_delta.page_id_) + FieldSize(static_cast<int64_t>(page_delta.new_page_)) +
+                  FieldSize(page_delta.runs_.size());
+    for (const auto &[offset, bytes] : page_delta.runs_) {
+      size += FieldSize(offset) + BytesSize(bytes.size());
+    }
+    return size;
+  }
+
   inline auto GetDeleteTuple() -> Tuple & { return delete_tuple_; }
 
   inline auto GetDeleteRID() -> RID & { return delete_rid_; }
@@ -120,14 +252,35 @@ class LogRecord {
 
   inline auto GetInsertRID() -> RID & { return insert_rid_; }
 
+  /** @return the old tuple, of a record read from the log only the bytes between the shared prefix and suffix */
   inline auto GetOriginalTuple() -> Tuple & { return old_tuple_; }
 
+  /** @return the new tuple, of a record read from the log only the bytes between the shared prefix and suffix */
   inline auto GetUpdateTuple() -> Tuple & { return new_tuple_; }
 
   inline auto GetUpdateRID() -> RID & { return update_rid_; }
 
+  /** @return the number of leading and trailing bytes the old and the new tuple of an update share */
+  inline auto GetUpdatePrefix() -> uint32_t { return update_prefix_; }
+  inline auto GetUpdateSuffix() -> uint32_t { return update_suffix_; }
+
   inline auto GetNewPageRecord() -> page_id_t { return prev_page_id_; }
 
+  inline auto GetIndexName() -> const std::string & { return index_name_; }
+
+  inline auto GetIndexRID() -> RID & { return index_rid_; }
+
+  inline auto GetIndexKey() -> Tuple & { return index_key_; }
+
+  /** @return true if more records of the index operation follow this one */
+  inline auto HasMore() -> bool { return more_; }
+
+  inline auto GetPageDeltas() -> std::vector<PageDelta> & { return page_deltas_; }
+
+  inline auto GetActiveTxns() -> std::vector<std::pair<txn_id_t, lsn_t>> & { return active_txns_; }
+
+  inline auto GetDirtyPages() -> std::vector<std::pair<page_id_t, lsn_t>> & { return dirty_pages_; }
+
   inline auto GetSize() -> int32_t { return size_; }
 
   inline auto GetLSN() -> lsn_t { return lsn_; }
@@ -138,6 +291,12 @@ class LogRecord {
 
   inline auto GetLogRecordType() -> LogRecordType & { return log_record_type_; }
 
+  /** @return true if the record compensates a record of a rolled back transaction */
+  inline auto IsCompensation() -> bool { return compensation_; }
+
+  /** @return the lsn undo goes on at after a compensation log record */
+  inline auto GetUndoNextLSN() -> lsn_t { return undo_next_lsn_; }
+
   // For debug purpose
   inline auto ToString() const -> std::string {
     std::ostringstream os;
@@ -152,6 +311,29 @@ class LogRecord {
   }
 
  private:
+  /** @return the bytes of an id, lsn or count, which is stored as the varint of the value plus one */
+  static inline auto FieldSize(int64_t value) -> size_t {
+    return VarintUtil::EncodedSize(static_cast<uint32_t>(value) + 1U);
+  }
+  static inline auto RIDSize(const RID &rid) -> size_t {
+    return FieldSize(rid.GetPageId()) + FieldSize(rid.GetSlotNum());
+  }
+  static inline auto BytesSize(uint32_t length) -> size_t { return VarintUtil::EncodedSize(length) + length; }
+
+  /** @return the size of the record with size bytes after the header */
+  inline auto Framed(size_t size) const -> int32_t {
+    size += 1 + FieldSize(txn_id_) + FieldSize(prev_lsn_);
+    if (compensation_) {
+      size += FieldSize(undo_next_lsn_);
+    }
+    // the size field counts itself
+    size_t framed = size + 1;
+    while (framed != size + VarintUtil::EncodedSize(framed)) {
+      framed = size + VarintUtil::EncodedSize(framed);
+    }
+    return static_cast<int32_t>(framed);
+  }
+
   // the length of log record(for serialization, in bytes)
   int32_t size_{0};
   // must have fields
@@ -159,6 +341,9 @@ class LogRecord {
   txn_id_t txn_id_{INVALID_TXN_ID};
   lsn_t prev_lsn_{INVALID_LSN};
   LogRecordType log_record_type_{LogRecordType::INVALID};
+  // a compensation log record goes on undoing at undo_next_lsn_
+  bool compensation_{false};
+  lsn_t undo_next_lsn_{INVALID_LSN};
 
   // case1: for delete operation, delete_tuple_ for UNDO operation
   RID delete_rid_;
@@ -172,11 +357,53 @@ class LogRecord {
   RID update_rid_;
   Tuple old_tuple_;
   Tuple new_tuple_;
+  uint32_t update_prefix_{0};
+  uint32_t update_suffix_{0};
 
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
-  static const int HEADER_SIZE = 20;
+
+  // case5: for index operations, the key of a logical record or the changed bytes of the pages
+  std::string index_name_;
+  RID index_rid_;
+  Tuple index_key_;
+  bool more_{false};
+  std::vector<PageDelta> page_deltas_;
+
+  // case6: for end checkpoint, the last lsn of the active transactions and the rec lsn of the dirty pages
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
 };  // namespace bustub
 
+/**
+ * The master record tells recovery where to start. It is rewritten once a checkpoint is durable: analysis starts at
+ * the begin checkpoint record, redo at the oldest rec lsn of the dirty pages. Offsets are log file offsets of the
+ * flushed log buffers holding the lsns, records before the lsn in the same buffer are skipped. The log before the
+ * start offset, which is also before the oldest transaction running at the checkpoint, is recycled.
+ */
+struct MasterRecord {
+  lsn_t checkpoint_lsn_{INVALID_LSN};
+  log_offset_t checkpoint_offset_{0};
+  lsn_t redo_lsn_{INVALID_LSN};
+  log_offset_t redo_offset_{0};
+  log_offset_t log_start_offset_{0};
+};
+
+/**
+ * The log file is a sequence of blocks, one per flushed log buffer. The records of a block have consecutive lsns from
+ * the base lsn on; their bytes are compressed with CompressionUtil if enable_log_compression is set and that made
+ * them smaller, which is the case if the stored size is less than the raw size. A block is stamped with its offset in
+ * the log, which tells it from the stale blocks of a recycled log segment.
+ *---------------------------------------------------------------------------
+ * | stored_size | raw_size | base_lsn | offset | records (stored_size bytes) |
+ *---------------------------------------------------------------------------
+ */
+struct LogBlockHeader {
+  uint32_t stored_size_{0};
+  uint32_t raw_size_{0};
+  lsn_t base_lsn_{INVALID_LSN};
+  log_offset_t offset_{-1};
+};
+
 }  // namespace bustub
@@ -13,45 +13,160 @@
 #pragma once
 
 #include <algorithm>
-#include <mutex>  // NOLINT
+#include <functional>
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
 #include "recovery/log_record.h"
+#include "storage/index/index.h"
 
 namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Recovery follows ARIES. Analysis starts at the checkpoint the master record points at and rebuilds the active
+ * transaction table and the dirty page table from the end checkpoint records and the records after the checkpoint.
+ * Redo starts at the oldest recLSN of the dirty page table rather than at the start of the log and skips the records
+ * whose page is not dirty or already carries them. Undo rolls back the transactions that did not finish, each from its
+ * latest change back. Recovery runs before logging is enabled.
+ *
+ * The log is read sequentially in large chunks, the next chunk is read while the current one is parsed. Redo hands
+ * the records to worker threads by page id, so the records of a page are applied in log order while different pages
+ * are redone in parallel. Undo rolls back the transactions in parallel, one transaction per worker at a time; the
+ * records redo saw of the transactions to undo are kept, so undo only reads what came before the redo point.
+ *
+ * Index pages are redone from the bytes an index operation changed; the operations logged in a group of records that
+ * did not reach the log completely are skipped. The keys the transactions wrote are undone logically through the
+ * indexes registered with RegisterIndex().
+ *
+ * Undo skips the records a rollback compensated already, from a compensation log record on to its undo next lsn. With
+ * a log manager set, undo logs a compensation record for every record it undoes and stamps the table page with it,
+ * and an abort record once a transaction is rolled back, so a crash during undo neither undoes a change twice nor
+ * rolls the transaction back again.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
+  /** Bytes of the log read at a time */
+  static constexpr int PREFETCH_SIZE = 16 * LOG_BUFFER_SIZE;
+  /** Records handed to a redo worker at a time */
+  static constexpr size_t REDO_BATCH_SIZE = 64;
+
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager,
+              size_t num_threads = std::max(std::thread::hardware_concurrency(), 1U))
+      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), num_threads_(num_threads) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
+    block_buffer_ = new char[LOG_BUFFER_SIZE];
   }
 
   ~LogRecovery() {
     delete[] log_buffer_;
+    delete[] block_buffer_;
     log_buffer_ = nullptr;
+    block_buffer_ = nullptr;
   }
 
+  /**
+   * The analysis pass, Redo() and Undo() run it if it did not run yet.
+   * @return the lsn redo starts from, INVALID_LSN if there is nothing to redo
+   */
+  auto Analyze() -> lsn_t;
   void Redo();
   void Undo();
-  auto DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool;
+
+  /**
+   * Undo rolls back the writes of the transactions to the index of this name through it. Register the indexes after
+   * Redo(), opened on the redone pages; the writes to indexes that are not registered are not rolled back.
+   */
+  inline void RegisterIndex(Index *index) { indexes_[index->GetName()] = index; }
+
+  /**
+   * Undo logs its compensation records through the log manager, which continues the log after the last record the
+   * analysis read. Set it before Undo().
+   */
+  inline void SetLogManager(LogManager *log_manager) { log_manager_ = log_manager; }
+
+  /**
+   * Deserialize a log record of a log block, its lsn is not stored in the record and left to the caller.
+   * @param size bytes available at data
+   * @return false if there is no complete log record at data
+   */
+  auto DeserializeLogRecord(const char *data, LogRecord *log_record, size_t size = LOG_BUFFER_SIZE) -> bool;
+
+  /**
+   * Decode the log block at data, the records are decompressed into records if the block is compressed.
+   * @param size bytes of the log available at data
+   * @param offset the offset of data in the log
+   * @param records room for LOG_BUFFER_SIZE bytes
+   * @return the records of the block, nullptr if the block is cut off or invalid or was not written at offset
+   */
+  static auto DecodeLogBlock(const char *data, size_t size, log_offset_t offset, char *records, LogBlockHeader *header)
+      -> const char *;
+
+  /** @return the transactions to undo and their last lsn, valid after the analysis */
+  inline auto GetActiveTxns() -> const std::unordered_map<txn_id_t, lsn_t> & { return active_txn_; }
+
+  /** @return the dirty pages and their recLSN, valid after the analysis */
+  inline auto GetDirtyPages() -> const std::unordered_map<page_id_t, lsn_t> & { return dirty_pages_; }
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** Read the log from offset on, visiting every record and the offset of its block until visit returns false */
+  void ScanLog(log_offset_t offset, const std::function<bool(LogRecord *, log_offset_t)> &visit);
+  /**
+   * Read the blocks written in one run of the log manager from offset on.
+   * @param[out] end the offset after the last block read
+   * @return false if visit returned false or a block is corrupt
+   */
+  auto ScanLogRun(log_offset_t offset, log_offset_t log_size,
+                  const std::function<bool(LogRecord *, log_offset_t)> &visit, log_offset_t *end) -> bool;
+  /** Read the record at lsn, records older than the scans so far are looked up from the start of the log */
+  auto ReadLogRecord(lsn_t lsn, LogRecord *log_record) -> bool;
+  /** @return the page the record changes, INVALID_PAGE_ID if it changes none */
+  static auto PageOf(LogRecord *log_record) -> page_id_t;
+  /** Redo the change of the record to page_id, a new page record also links its predecessor to the new page */
+  void RedoLogRecord(LogRecord *log_record, page_id_t page_id);
+  /** Undo the change of the record, its compensation record is chained to last_lsn and becomes the last lsn */
+  void UndoLogRecord(LogRecord *log_record, lsn_t *last_lsn);
+  /** Undo the changes of a transaction, from its last record back */
+  void UndoTransaction(lsn_t last_lsn);
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  size_t num_threads_;
+  LogManager *log_manager_{nullptr};
+
+  bool analyzed_{false};
+  /** The master record, if there was a checkpoint */
+  bool has_master_{false};
+  MasterRecord master_;
+  lsn_t redo_lsn_{INVALID_LSN};
+  /** The lsn after the last record of the log */
+  lsn_t next_lsn_{0};
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  /** The dirty page table, the pages that may miss changes and the lsn of the oldest of them. */
+  std::unordered_map<page_id_t, lsn_t> dirty_pages_;
+  /** The index page records of the operations that did not reach the log completely */
+  std::unordered_set<lsn_t> torn_lsns_;
+  std::unordered_map<std::string, Index *> indexes_;
+  /** Mapping the log sequence number to the log file offset of its block for undos. */
+  std::unordered_map<lsn_t, log_offset_t> lsn_mapping_;
+  /** The whole log was scanned into lsn_mapping_ */
+  bool mapped_all_{false};
+  /** The records of the transactions to undo that redo read */
+  std::unordered_map<lsn_t, LogRecord> undo_records_;
+  /** Undo workers read the records before the redo point one at a time */
+  std::mutex read_latch_;
 
-  int offset_ __attribute__((__unused__));  // NOLINT
   char *log_buffer_;
+  /** The decompressed records of the block in log_buffer_ */
+  char *block_buffer_;
 };
 
 }  // namespace bustub
@@ -15,8 +15,10 @@
 #include <atomic>
 #include <fstream>
 #include <future>  // NOLINT
-#include <mutex>   // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
 #include <string>
+#include <vector>
 
 #include "common/config.h"
 
@@ -25,6 +27,11 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * The log is a sequence of preallocated segment files of LOG_SEGMENT_SIZE bytes, <db>.log.0, <db>.log.1 and so on,
+ * which make up one continuous range of log offsets. Segments before the start of the log are recycled: they are
+ * renamed to spares and reused as later segments, so the log does not grow without bound and files are not extended
+ * on every write. A restarted log begins at the next segment, leaving the rest of the last one unused.
  */
 class DiskManager {
  public:
@@ -37,7 +44,7 @@ class DiskManager {
   /** FOR TEST / LEADERBOARD ONLY, used by DiskManagerMemory */
   DiskManager() = default;
 
-  virtual ~DiskManager() = default;
+  virtual ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -59,20 +66,50 @@ class DiskManager {
   virtual void ReadPage(page_id_t page_id, char *page_data);
 
   /**
-   * Flush the entire log buffer into disk.
+   * Flush the entire log buffer into disk and sync it, one write and one fdatasync per call.
    * @param log_data raw log data
    * @param size size of log entry
+   * @throws Exception if the log could not be written or synced, the end of the log does not move then
    */
   void WriteLog(char *log_data, int size);
 
   /**
-   * Read a log entry from the log file.
+   * Read a log entry from the log, across segments. Bytes past the end of the log are read as zeros.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
-   * @return true if the read was successful, false otherwise
+   * @param offset offset of the log entry in the log
+   * @return true if the read was successful, false if the offset is past the end or before the start of the log
    */
-  auto ReadLog(char *log_data, int size, int offset) -> bool;
+  auto ReadLog(char *log_data, int size, log_offset_t offset) -> bool;
+
+  /** @return the offset the next log write goes to, 0 if there is no log */
+  auto GetLogSize() -> log_offset_t;
+
+  /**
+   * Recycle the log segments that end at or before offset, recovery never reads them again. Up to
+   * MAX_SPARE_LOG_SEGMENTS of them are kept as spares for new segments, the rest are deleted.
+   * @param offset the start of the log that is still needed
+   */
+  void RecycleLog(log_offset_t offset);
+
+  /** Delete the log segments, the spares and the master record of a database file */
+  static void RemoveLogFiles(const std::string &db_file);
+
+  /**
+   * Replace the master record, which tells recovery where the log starts. The record is written to a temporary file
+   * and synced before it is renamed over the old one, a crash leaves either the old or the new record.
+   * @param data the master record
+   * @param size size of the master record
+   */
+  void WriteMasterRecord(const char *data, int size);
+
+  /**
+   * Read the master record.
+   * @param[out] data output buffer
+   * @param size size of the master record
+   * @return false if there is no master record
+   */
+  auto ReadMasterRecord(char *data, int size) -> bool;
 
   /** @return the number of disk flushes */
   auto GetNumFlushes() const -> int;
@@ -93,10 +130,30 @@ class DiskManager {
   inline auto HasFlushLogFuture() -> bool { return flush_log_f_ != nullptr; }
 
  protected:
+  static constexpr int MAX_SPARE_LOG_SEGMENTS = 4;
+
   auto GetFileSize(const std::string &file_name) -> int;
-  // stream to write log file
-  std::fstream log_io_;
+  auto LogSegmentName(int segment) const -> std::string;
+  /**
+   * @return the descriptor of a log segment, -1 if it does not exist. With create, a missing segment is made from a
+   * spare or created at its full size.
+   */
+  auto OpenLogSegment(int segment, bool create) -> int;
+  void CloseLogSegments();
+  /** Make renames and new segments in the log directory durable */
+  void SyncLogDirectory();
+
   std::string log_name_;
+  std::string master_name_;
+  // descriptors of the open log segments by segment number
+  std::map<int, int> log_segment_fds_;
+  // the first segment that was not recycled
+  int first_log_segment_{0};
+  // the end of the log, where the next write goes
+  log_offset_t log_size_{0};
+  // recycled segment files waiting to become new segments
+  std::vector<std::string> spare_log_segments_;
+  std::mutex log_io_latch_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
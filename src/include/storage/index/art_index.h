@@ -0,0 +1,51 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_index.h
+//
+// Identification: src/include/storage/index/art_index.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "container/art/adaptive_radix_tree.h"
+#include "storage/index/index.h"
+
+namespace bustub {
+
+/**
+ * ARTIndex keeps the index in memory in an AdaptiveRadixTree. Keys are
+ * encoded column by column into binary comparable bytes, so the tree order is
+ * the order of the key values. A non-unique index appends the RID to the
+ * encoded key and finds all records of a key with a prefix scan.
+ *
+ * Unlike the B+ tree the ART does not live in the buffer pool, so it has to be
+ * rebuilt from the table heap after a restart.
+ */
+class ARTIndex : public Index {
+ public:
+  explicit ARTIndex(std::unique_ptr<IndexMetadata> &&metadata);
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+ private:
+  /** @return the binary comparable encoding of the key tuple */
+  auto EncodeKey(const Tuple &key) const -> std::string;
+  /** @return the tree key of an entry, with the rid appended for a non-unique index */
+  auto EntryKey(const Tuple &key, RID rid) const -> std::string;
+
+  // container
+  AdaptiveRadixTree container_;
+};
+
+}  // namespace bustub
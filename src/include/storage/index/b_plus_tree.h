@@ -10,14 +10,20 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <queue>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
+#include "recovery/index_page_logger.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/b_plus_tree_overflow_page.h"
 
 namespace bustub {
 
@@ -28,19 +34,28 @@ namespace bustub {
  *
  * Implementation of simple b+ tree data structure where internal pages direct
  * the search and leaf pages contain actual data.
- * (1) We only support unique key
+ * (1) Keys are unique by default. A non-unique tree stores every key once,
+ * followed by the sorted posting list of its values (see b_plus_tree_leaf_page.h)
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ * (5) Given a log manager, the page changes of every insert and remove are
+ * logged while logging is enabled (see IndexPageLogger)
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
   using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+  // a backward scan finds its leaf again from the root
+  friend class IndexIterator<KeyType, ValueType, KeyComparator>;
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     bool unique_keys = true, LogManager *log_manager = nullptr);
+
+  // Take the root page id of the tree from the header page, to open a tree that is on disk already
+  auto LoadRootPageId() -> bool;
 
   // Returns true if this B+ tree has no keys and values.
   auto IsEmpty() const -> bool;
@@ -48,10 +63,13 @@ class BPlusTree {
   // Insert a key-value pair into this B+ tree.
   auto Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr) -> bool;
 
-  // Remove a key and its value from this B+ tree.
+  // Remove a key and all of its values from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
-  // return the value associated with a given key
+  // Remove a single key-value pair from this B+ tree.
+  auto Remove(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr) -> bool;
+
+  // return the values associated with a given key
   auto GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr) -> bool;
 
   // return the page id of the root node
@@ -61,6 +79,9 @@ class BPlusTree {
   auto Begin() -> INDEXITERATOR_TYPE;
   auto Begin(const KeyType &key) -> INDEXITERATOR_TYPE;
   auto End() -> INDEXITERATOR_TYPE;
+  // reverse iteration with operator--, from the last pair or from the last pair whose key is not larger than key
+  auto RBegin() -> INDEXITERATOR_TYPE;
+  auto RBegin(const KeyType &key) -> INDEXITERATOR_TYPE;
 
   // print the B+ tree
   void Print(BufferPoolManager *bpm);
@@ -75,6 +96,49 @@ class BPlusTree {
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
 
  private:
+  enum class Operation { FIND, INSERT, REMOVE };
+  enum class LeafPosition { KEY, LEFTMOST, RIGHTMOST };
+
+  /** Pages write latched by the current operation, from the highest unsafe ancestor down to the leaf. */
+  struct WriteSet {
+    std::deque<Page *> pages_;
+    std::unordered_set<page_id_t> deleted_pages_;
+    bool root_latched_{false};
+  };
+
+  // search
+  auto FindLeafRead(const KeyType &key, LeafPosition position) -> Page *;
+  auto FindLeafOptimistic(const KeyType &key) -> Page *;
+  auto FindLeafWrite(const KeyType &key, Operation operation, WriteSet *write_set) -> Page *;
+  auto IsSafe(BPlusTreePage *node, Operation operation) -> bool;
+  void ReleaseAncestors(WriteSet *write_set);
+  void ReleaseWriteSet(WriteSet *write_set);
+
+  // logging
+  void BeginOperation();
+  void EndOperation();
+  void WLatch(Page *page);
+  void WUnlatchEarly(Page *page);
+
+  // insertion
+  void StartNewTree(const KeyType &key, const ValueType &value);
+  auto InsertIntoLeaf(LeafPage *leaf, const KeyType &key, const ValueType &value, bool allow_split) -> bool;
+  auto SplitLeaf(LeafPage *leaf) -> Page *;
+  void SetPrevLink(page_id_t page_id, page_id_t prev_page_id);
+  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node);
+
+  // deletion
+  auto RemoveImpl(const KeyType &key, const ValueType *value) -> bool;
+  auto RemoveFromLeaf(LeafPage *leaf, const KeyType &key, const ValueType *value, WriteSet *write_set) -> bool;
+  void CoalesceOrRedistribute(BPlusTreePage *node, WriteSet *write_set);
+  void AdjustRoot(BPlusTreePage *old_root_node, WriteSet *write_set);
+
+  // overflow chains of non-unique keys
+  auto WriteOverflowChain(const std::vector<ValueType> &values) -> page_id_t;
+  auto InsertIntoOverflowChain(page_id_t head, const ValueType &value) -> bool;
+  auto RemoveFromOverflowChain(page_id_t *head, const ValueType &value) -> bool;
+  void DeleteOverflowChain(page_id_t head);
+
   void UpdateRootPageId(int insert_record = 0);
 
   /* Debug Routines for FREE!! */
@@ -85,10 +149,15 @@ class BPlusTree {
   // member variable
   std::string index_name_;
   page_id_t root_page_id_;
+  // the logger in front of the buffer pool if the tree is logged
+  std::unique_ptr<IndexPageLogger> logger_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  bool unique_keys_;
+  // protects root_page_id_
+  ReaderWriterLatch root_latch_;
 };
 
 }  // namespace bustub
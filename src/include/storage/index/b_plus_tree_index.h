@@ -24,10 +24,15 @@ namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/**
+ * An index on a B+ tree. Given a log manager, a write of a transaction is logged as an index insert or delete record
+ * of the transaction, which undo rolls back logically, and the tree logs the page changes for redo.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                 LogManager *log_manager = nullptr);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
@@ -41,7 +46,18 @@ class BPlusTreeIndex : public Index {
 
   auto GetEndIterator() -> INDEXITERATOR_TYPE;
 
+  auto GetReverseBeginIterator() -> INDEXITERATOR_TYPE;
+
+  auto GetReverseBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE;
+
+  /** Open the tree of the index that is on disk already, e.g. after recovery */
+  auto LoadRootPageId() -> bool { return container_.LoadRootPageId(); }
+
  protected:
+  /** Log a write of the transaction to the index ahead of it */
+  void LogIndexWrite(LogRecordType log_record_type, const Tuple &key, RID rid, Transaction *transaction);
+
+  LogManager *log_manager_;
   // comparator for key
   KeyComparator comparator_;
   // container
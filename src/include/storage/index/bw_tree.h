@@ -0,0 +1,130 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree.h
+//
+// Identification: src/include/storage/index/bw_tree.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/epoch_manager.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define BWTREE_TYPE BwTree<KeyType, ValueType, KeyComparator>
+
+/**
+ * BwTree is an in-memory, latch-free B+ tree (Levandoski et al., "The
+ * Bw-Tree: A B-tree for New Hardware Platforms"; Wang et al., "Building a
+ * Bw-Tree Takes More Than Just Buzz Words").
+ *
+ * Nodes are addressed by logical page ids through a mapping table. A node is
+ * a chain of delta records on top of a base node; a writer never modifies a
+ * node in place but prepends a delta and installs it with a single CAS on the
+ * mapping table slot. Chains longer than a threshold are consolidated into a
+ * new base node, which is installed the same way.
+ *
+ * A node that grows past its max size is split in two steps, like a B-link
+ * tree: a split delta installed on the node hands the upper half of its key
+ * range to a new right sibling, then an index entry delta posts the separator
+ * to the parent. Until the second step is done, readers reach the sibling
+ * through the side link. Nodes are never merged; deletes only shrink nodes
+ * when they are consolidated.
+ *
+ * Keys are unique by default. A non-unique tree orders entries by key and
+ * then by value, so several values of a key may span leaves.
+ *
+ * Replaced delta chains are reclaimed through an EpochManager. Page ids are
+ * not reused.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BwTree {
+ public:
+  static constexpr int LEAF_MAX_SIZE = 128;
+  static constexpr int INNER_MAX_SIZE = 64;
+  /** Delta chains are consolidated once they reach these lengths */
+  static constexpr uint32_t LEAF_CHAIN_THRESHOLD = 8;
+  static constexpr uint32_t INNER_CHAIN_THRESHOLD = 4;
+
+  explicit BwTree(const KeyComparator &comparator, bool unique_keys = true, int leaf_max_size = LEAF_MAX_SIZE,
+                  int inner_max_size = INNER_MAX_SIZE);
+  ~BwTree();
+
+  DISALLOW_COPY_AND_MOVE(BwTree);
+
+  // Insert a key-value pair, returns false if the key (the pair for a non-unique tree) exists
+  auto Insert(const KeyType &key, const ValueType &value) -> bool;
+
+  // Remove a key-value pair, returns false if the pair does not exist
+  auto Remove(const KeyType &key, const ValueType &value) -> bool;
+
+  // Collect the values of a key, returns true if there is at least one
+  auto GetValue(const KeyType &key, std::vector<ValueType> *result) -> bool;
+
+  // Number of levels, a tree with a single leaf has height 1
+  auto GetHeight() -> uint32_t;
+
+ private:
+  static constexpr size_t MAPPING_CHUNK_SIZE = 1 << 12;
+  static constexpr size_t MAPPING_CHUNKS = 1 << 12;
+
+  struct Node;
+  struct LeafNode;
+  struct InnerNode;
+  struct InsertDelta;
+  struct DeleteDelta;
+  struct SplitDelta;
+  struct IndexEntryDelta;
+
+  /** Compare probe with entry, a lowest probe sorts before every entry with the same key */
+  auto Compare(const MappingType &probe, const MappingType &entry, bool lowest = false) const -> int;
+
+  // mapping table
+  auto NewPage(Node *node) -> page_id_t;
+  auto Slot(page_id_t page_id) -> std::atomic<Node *> &;
+  auto Cas(page_id_t page_id, Node *expected, Node *desired) -> bool;
+
+  /** Load the head of a node, moving right while probe is beyond the key range of the node */
+  auto LoadNode(page_id_t *page_id, const MappingType &probe, bool lowest) -> Node *;
+  /** Descend from page_id to the node on level that covers probe */
+  auto Descend(page_id_t *page_id, const MappingType &probe, bool lowest, uint32_t level) -> Node *;
+  auto FindChild(Node *head, const MappingType &probe, bool lowest) -> page_id_t;
+  auto LeafContains(Node *head, const MappingType &probe, ValueType *value) -> bool;
+
+  // replay a delta chain into the sorted content of the logical node
+  auto CollectLeaf(Node *head) -> std::vector<MappingType>;
+  void CollectInner(Node *head, std::vector<MappingType> *keys, std::vector<page_id_t> *children);
+
+  // structure modifications, all of them may lose a race and leave the node to the next writer
+  void Restructure(page_id_t page_id, Node *head);
+  void Consolidate(page_id_t page_id, Node *head);
+  void Split(page_id_t page_id, Node *head);
+  void PostSeparator(uint32_t level, const MappingType &separator, const std::optional<MappingType> &high,
+                     page_id_t left, page_id_t right);
+
+  static void DeleteChain(Node *head);
+
+  KeyComparator comparator_;
+  bool unique_keys_;
+  int leaf_max_size_;
+  int inner_max_size_;
+
+  std::atomic<page_id_t> root_page_id_;
+  std::atomic<page_id_t> next_page_id_{0};
+  // chunks of the mapping table are allocated on demand
+  std::array<std::atomic<std::atomic<Node *> *>, MAPPING_CHUNKS> mapping_{};
+  EpochManager epoch_manager_;
+};
+
+}  // namespace bustub
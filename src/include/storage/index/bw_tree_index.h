@@ -0,0 +1,50 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree_index.h
+//
+// Identification: src/include/storage/index/bw_tree_index.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "storage/index/bw_tree.h"
+#include "storage/index/generic_key.h"
+#include "storage/index/index.h"
+
+namespace bustub {
+
+#define BWTREE_INDEX_TYPE BwTreeIndex<KeyType, ValueType, KeyComparator>
+
+/**
+ * BwTreeIndex keeps the index in memory in a latch-free BwTree. Writers to
+ * neighbouring keys, e.g. inserts of increasing keys, do not serialize on
+ * page latches the way they do in the B+ tree.
+ *
+ * Like the ART index it does not live in the buffer pool and has to be
+ * rebuilt from the table heap after a restart.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BwTreeIndex : public Index {
+ public:
+  explicit BwTreeIndex(std::unique_ptr<IndexMetadata> &&metadata);
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+ protected:
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  BwTree<KeyType, ValueType, KeyComparator> container_;
+};
+
+}  // namespace bustub
@@ -25,6 +25,9 @@ namespace bustub {
 
 class Transaction;
 
+/** The container behind an index, chosen with CREATE INDEX ... USING */
+enum class IndexType { BPlusTreeIndex, ARTIndex, BwTreeIndex };
+
 /**
  * class IndexMetadata - Holds metadata of an index object.
  *
@@ -43,10 +46,14 @@ class IndexMetadata {
    * @param table_name The name of the table on which the index is created
    * @param tuple_schema The schema of the indexed key
    * @param key_attrs The mapping from indexed columns to base table columns
+   * @param is_unique Whether a key may only be associated with a single record
    */
   IndexMetadata(std::string index_name, std::string table_name, const Schema *tuple_schema,
-                std::vector<uint32_t> key_attrs)
-      : name_(std::move(index_name)), table_name_(std::move(table_name)), key_attrs_(std::move(key_attrs)) {
+                std::vector<uint32_t> key_attrs, bool is_unique = false)
+      : name_(std::move(index_name)),
+        table_name_(std::move(table_name)),
+        key_attrs_(std::move(key_attrs)),
+        is_unique_(is_unique) {
     key_schema_ = std::make_shared<Schema>(Schema::CopySchema(tuple_schema, key_attrs_));
   }
 
@@ -72,6 +79,9 @@ class IndexMetadata {
   /** @return The mapping relation between indexed columns and base table columns */
   inline auto GetKeyAttrs() const -> const std::vector<uint32_t> & { return key_attrs_; }
 
+  /** @return Whether a key may only be associated with a single record */
+  inline auto IsUnique() const -> bool { return is_unique_; }
+
   /** @return A string representation for debugging */
   auto ToString() const -> std::string {
     std::stringstream os;
@@ -92,6 +102,8 @@ class IndexMetadata {
   std::string table_name_;
   /** The mapping relation between key schema and tuple schema */
   const std::vector<uint32_t> key_attrs_;
+  /** Whether a key may only be associated with a single record */
+  bool is_unique_;
   /** The schema of the indexed key */
   std::shared_ptr<Schema> key_schema_;
 };
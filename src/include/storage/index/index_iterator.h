@@ -13,17 +13,45 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <vector>
+
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree;
+
+/**
+ * IndexIterator walks the (key, value) pairs of the leaf level in key order,
+ * operator++ moves forward along the next page links and operator-- moves
+ * backward along the prev page links. A key with several values yields one
+ * pair per value, in value order. The iterator keeps its current leaf pinned
+ * and only latches it while reading. Moving past either end of the leaf level
+ * turns the iterator into the end iterator.
+ *
+ * In both directions, the position is the last key handed out rather than an
+ * index, so splits and merges of the leaf between two steps neither skip nor
+ * repeat keys. A sibling leaf is only taken while both leaves are latched,
+ * otherwise the leaf of the key is found again from the root.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
+  // end iterator
   IndexIterator();
+  // iterator positioned at the first value of entry index of the pinned and read latched leaf page, or at the last
+  // value of the entry if the iterator starts backward; the iterator releases the latch
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, BufferPoolManager *buffer_pool_manager, Page *page,
+                int index, bool backward = false);
+  IndexIterator(const IndexIterator &other);
+  IndexIterator(IndexIterator &&other) noexcept;
+  auto operator=(const IndexIterator &other) -> IndexIterator &;
+  auto operator=(IndexIterator &&other) noexcept -> IndexIterator &;
   ~IndexIterator();  // NOLINT
 
   auto IsEnd() -> bool;
@@ -32,12 +60,42 @@ class IndexIterator {
 
   auto operator++() -> IndexIterator &;
 
-  auto operator==(const IndexIterator &itr) const -> bool { throw std::runtime_error("unimplemented"); }
+  auto operator--() -> IndexIterator &;
 
-  auto operator!=(const IndexIterator &itr) const -> bool { throw std::runtime_error("unimplemented"); }
+  auto operator==(const IndexIterator &itr) const -> bool {
+    return page_id_ == itr.page_id_ && index_ == itr.index_ && value_index_ == itr.value_index_;
+  }
+
+  auto operator!=(const IndexIterator &itr) const -> bool { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  // skip empty leaves and load the values of the current entry
+  void Settle();
+  void SettleBackward();
+  // move from the latched leaf to the next one, false at the end of the leaf level
+  auto MoveToNextLeaf(const LeafPage *leaf) -> bool;
+  // move from the latched leaf to the leaf before the position, false at the beginning of the leaf level
+  auto MoveToPrevLeaf(const LeafPage *leaf) -> bool;
+  auto FindLeafAgain() -> bool;
+  // note the next link and the last key of the latched leaf, HasChanged() compares the leaf with them
+  void Remember(const LeafPage *leaf);
+  auto HasChanged(const LeafPage *leaf) const -> bool;
+  // load the values of entry index_ of the latched leaf
+  void LoadValues(const LeafPage *leaf);
+  void Release();
+
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_{nullptr};
+  BufferPoolManager *buffer_pool_manager_{nullptr};
+  Page *page_{nullptr};
+  page_id_t page_id_{INVALID_PAGE_ID};
+  int index_{0};
+  int value_index_{0};
+  std::vector<ValueType> values_;
+  MappingType item_;
+  // item_.first bounds the next step
+  bool positioned_{false};
+  page_id_t next_page_id_{INVALID_PAGE_ID};
+  KeyType high_key_;
 };
 
 }  // namespace bustub
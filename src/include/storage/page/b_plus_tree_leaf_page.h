@@ -18,26 +18,50 @@
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
+#define LEAF_PAGE_HEADER_SIZE 36
 #define LEAF_PAGE_SIZE ((BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_SLOT_SIZE 4
+#define LEAF_PAGE_ENTRY_HEADER_SIZE 8
+// an inline posting list larger than this is moved to overflow pages, so that any entry takes at most a fraction of
+// the page and a split always leaves room for the entry that caused it
+#define LEAF_PAGE_MAX_INLINE_POSTING_SIZE ((BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / 8)
 
 /**
- * Store indexed key and record id(record id = page id combined with slot id,
- * see include/common/rid.h for detailed implementation) together within leaf
- * page. Only support unique key.
+ * Store indexed key and the posting list of record ids(record id = page id
+ * combined with slot id, see include/common/rid.h for detailed implementation)
+ * within leaf page. A key is stored only once no matter how many record ids
+ * share it.
  *
- * Leaf page format (keys are stored in order):
- *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
- *  ----------------------------------------------------------------------
+ * Leaf page format (slots are stored in key order, entries grow backwards
+ * from the end of the page):
+ *  ---------------------------------------------------------------------------
+ * | HEADER | SLOT(1) | SLOT(2) | ... | SLOT(n) | FREE | ENTRY(n) ... ENTRY(1) |
+ *  ---------------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Slot format (size in byte, 4 bytes in total):
+ *  ---------------------------
+ * | Offset (2) | Length (2) |
+ *  ---------------------------
+ *
+ *  Entry format (size in byte):
+ *  ------------------------------------------------------------------------
+ * | KEY | ValueCount (4) | OverflowPageId (4) | RID deltas (varint) ... |
+ *  ------------------------------------------------------------------------
+ *  The record ids of an entry are kept sorted and stored as varint encoded
+ *  deltas. Once the encoded list grows beyond LEAF_PAGE_MAX_INLINE_POSTING_SIZE
+ *  it is moved to a chain of overflow pages and OverflowPageId points to the
+ *  head of that chain.
+ *
+ *  Header format (size in byte, 36 bytes in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  -------------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | PrevPageId (4) |
+ *  -------------------------------------------------------------------------
+ *  ---------------------------------------------
+ * | FreeSpacePointer (2) | Fragmented (2) |
+ *  ---------------------------------------------
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
@@ -48,11 +72,55 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   // helper methods
   auto GetNextPageId() const -> page_id_t;
   void SetNextPageId(page_id_t next_page_id);
+  auto GetPrevPageId() const -> page_id_t;
+  void SetPrevPageId(page_id_t prev_page_id);
   auto KeyAt(int index) const -> KeyType;
+  auto KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int;
+
+  // posting list of an entry
+  auto ValueCountAt(int index) const -> int;
+  auto OverflowPageIdAt(int index) const -> page_id_t;
+  void ValuesAt(int index, std::vector<ValueType> *values) const;
+
+  // space accounting
+  auto GetFreeSpace() const -> int;
+  auto IsInsertSafe() const -> bool;
+  static auto PostingSize(const std::vector<ValueType> &values) -> int;
+
+  // insertion and deletion
+  auto InsertEntryAt(int index, const KeyType &key, const std::vector<ValueType> &values, page_id_t overflow_page_id,
+                     int value_count) -> bool;
+  auto SetPostingAt(int index, const std::vector<ValueType> &values, page_id_t overflow_page_id, int value_count)
+      -> bool;
+  void RemoveAt(int index);
+
+  // split and merge
+  void MoveHalfTo(BPlusTreeLeafPage *recipient);
+  auto CanMergeInto(const BPlusTreeLeafPage *recipient) const -> bool;
+  void MoveAllTo(BPlusTreeLeafPage *recipient);
+
+  // redistribute
+  auto MoveFirstToEndOf(BPlusTreeLeafPage *recipient) -> bool;
+  auto MoveLastToFrontOf(BPlusTreeLeafPage *recipient) -> bool;
 
  private:
+  struct Slot {
+    uint16_t offset_;
+    uint16_t length_;
+  };
+
+  auto SlotAt(int index) -> Slot *;
+  auto SlotAt(int index) const -> const Slot *;
+  auto EntryAt(int index) const -> const char *;
+  auto ContiguousFreeSpace() const -> int;
+  auto InsertRawAt(int index, const char *entry, int length) -> bool;
+  void Compact();
+
   page_id_t next_page_id_;
+  page_id_t prev_page_id_;
+  uint16_t free_space_pointer_;
+  uint16_t fragmented_bytes_;
   // Flexible array member for page data.
-  MappingType array_[1];
+  char data_[1];
 };
 }  // namespace bustub
@@ -0,0 +1,68 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/include/page/b_plus_tree_overflow_page.h
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <vector>
+
+#include "common/rid.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define OVERFLOW_PAGE_HEADER_SIZE 32
+#define OVERFLOW_PAGE_CAPACITY (BUSTUB_PAGE_SIZE - OVERFLOW_PAGE_HEADER_SIZE)
+
+/**
+ * Store part of a posting list that became too large to be kept inline in its
+ * leaf page. The overflow pages of one key form a singly linked chain, each
+ * page holds an ascending run of record ids and the runs are ordered along the
+ * chain. Overflow pages are only reached through their leaf entry, so they are
+ * protected by the latch of that leaf page.
+ *
+ * Overflow page format (record ids are stored as varint encoded deltas):
+ *  ---------------------------------------------
+ * | HEADER | RID(1) | RID(2) - RID(1) | ... |
+ *  ---------------------------------------------
+ *
+ *  Header format (size in byte, 32 bytes in total):
+ *  ---------------------------------------------------------------------
+ * | PageType (4) | LSN (4) | ValueCount (4) | MaxSize (4) |
+ *  ---------------------------------------------------------------------
+ *  -----------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | ByteSize (4) |
+ *  -----------------------------------------------------------------
+ */
+class BPlusTreeOverflowPage : public BPlusTreePage {
+ public:
+  // must call initialize method after "create" a new overflow page
+  void Init(page_id_t page_id, page_id_t next_page_id = INVALID_PAGE_ID);
+
+  auto GetNextPageId() const -> page_id_t;
+  void SetNextPageId(page_id_t next_page_id);
+
+  // the smallest value on this page, the page must not be empty
+  auto FirstValue() const -> RID;
+  // append all values on this page to values
+  void GetValues(std::vector<RID> *values) const;
+  // replace the content of this page with values[begin, end), returns false if they do not fit
+  auto SetValues(const std::vector<RID> &values, size_t begin, size_t end) -> bool;
+
+  // read the values of a whole chain
+  static void ReadChain(BufferPoolManager *buffer_pool_manager, page_id_t head, std::vector<RID> *values);
+
+ private:
+  page_id_t next_page_id_;
+  int32_t byte_size_;
+  // Flexible array member for page data.
+  char data_[1];
+};
+
+}  // namespace bustub
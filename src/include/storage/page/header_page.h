@@ -19,12 +19,13 @@ namespace bustub {
 /**
  * Database use the first page (page_id = 0) as header page to store metadata, in
  * our case, we will contain information about table/index name (length less than
- * 32 bytes) and their corresponding root_id
+ * 32 bytes) and their corresponding root_id. The page LSN is at the same offset
+ * as on every other page, the changes of the B+ trees to it are logged.
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  -------------------------------------------------------------------------
+ * | RecordCount (4) | LSN (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
+ *  -------------------------------------------------------------------------
  */
 class HeaderPage : public Page {
  public:
@@ -41,6 +42,9 @@ class HeaderPage : public Page {
   auto GetRecordCount() -> int;
 
  private:
+  static constexpr int RECORDS_OFFSET = 8;
+  static constexpr int RECORD_SIZE = 36;
+
   /**
    * helper functions
    */
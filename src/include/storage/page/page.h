@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -57,14 +58,27 @@ class Page {
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
 
+  /** Acquire the page read latch if nobody write latches the page. @return true if the latch was acquired */
+  inline auto TryRLatch() -> bool { return rwlatch_.TryRLock(); }
+
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
   /** @return the page LSN. */
   inline auto GetLSN() -> lsn_t { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
-  /** Sets the page LSN. */
-  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t)); }
+  /** Sets the page LSN, the first LSN since the page was written out becomes its recLSN. */
+  inline void SetLSN(lsn_t lsn) {
+    memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t));
+    lsn_t expected = INVALID_LSN;
+    rec_lsn_.compare_exchange_strong(expected, lsn);
+  }
+
+  /** @return the LSN of the oldest change that is not on disk yet, INVALID_LSN if there is none */
+  inline auto GetRecLSN() -> lsn_t { return rec_lsn_; }
+
+  /** Forget the recLSN once the page was written out while no change could be made to it. */
+  inline void ResetRecLSN() { rec_lsn_ = INVALID_LSN; }
 
  protected:
   static_assert(sizeof(page_id_t) == 4);
@@ -86,6 +100,8 @@ class Page {
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /** The recLSN of the page, changes before it are on disk. */
+  std::atomic<lsn_t> rec_lsn_{INVALID_LSN};
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
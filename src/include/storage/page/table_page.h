@@ -84,6 +84,15 @@ class TablePage : public Page {
   auto InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager)
       -> bool;
 
+  /**
+   * Insert a tuple into the given slot without logging, for recovery to put a tuple back where the log has it.
+   * Slots up to the given one are added as free slots if the page does not have them yet.
+   * @param tuple tuple to insert
+   * @param rid rid the tuple had, its slot must be free
+   * @return true if the insert is successful (i.e. the slot is free and there is enough space)
+   */
+  auto InsertTupleAt(const Tuple &tuple, const RID &rid) -> bool;
+
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
@@ -107,7 +116,10 @@ class TablePage : public Page {
   auto UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
                    LockManager *lock_manager, LogManager *log_manager) -> bool;
 
-  /** To be called on commit or abort. Actually perform the delete or rollback an insert. */
+  /**
+   * To be called on commit or abort. Actually perform the delete or rollback an insert. Without txn, garbage
+   * collection applies a committed delete, which is logged as a record of no transaction.
+   */
   void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
   /** To be called on abort. Rollback a delete, i.e. this reverses a MarkDelete. */
@@ -127,16 +139,18 @@ class TablePage : public Page {
 
   /**
    * @param[out] first_rid the RID of the first tuple in this page
+   * @param include_deleted also return tuples that are only marked as deleted, for snapshot reads
    * @return true if the first tuple exists, false otherwise
    */
-  auto GetFirstTupleRid(RID *first_rid) -> bool;
+  auto GetFirstTupleRid(RID *first_rid, bool include_deleted = false) -> bool;
 
   /**
    * @param cur_rid the RID of the current tuple
    * @param[out] next_rid the RID of the tuple following the current tuple
+   * @param include_deleted also return tuples that are only marked as deleted, for snapshot reads
    * @return true if the next tuple exists, false otherwise
    */
-  auto GetNextTupleRid(const RID &cur_rid, RID *next_rid) -> bool;
+  auto GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted = false) -> bool;
 
  private:
   static_assert(sizeof(page_id_t) == 4);
@@ -150,6 +164,15 @@ class TablePage : public Page {
   static constexpr size_t OFFSET_TUPLE_OFFSET = 24;  // Naming things is hard.
   static constexpr size_t OFFSET_TUPLE_SIZE = 28;
 
+  /**
+   * @return true if the changes of txn are logged as changes of txn. Changes without a transaction are made by
+   * recovery, which logs its own records, and by the garbage collector, see ApplyDelete().
+   */
+  static auto IsLogged(Transaction *txn, LogManager *log_manager) -> bool;
+
+  /** Append the record of a change of txn to the page, a compensation record while txn rolls back */
+  void AppendLogRecord(LogRecord *log_record, Transaction *txn, LogManager *log_manager);
+
   /** @return pointer to the end of the current free space, see header comment */
   auto GetFreeSpacePointer() -> uint32_t { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
 
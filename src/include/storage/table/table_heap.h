@@ -13,6 +13,7 @@
 #pragma once
 
 #include "buffer/buffer_pool_manager.h"
+#include "concurrency/version_store.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
 #include "storage/table/table_iterator.h"
@@ -61,6 +62,7 @@ class TableHeap {
 
   /**
    * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
+   * An OPTIMISTIC transaction only buffers the delete until it commits.
    * @param rid resource id of the tuple of delete
    * @param txn transaction performing the delete
    * @return true iff the delete is successful (i.e the tuple exists)
@@ -69,6 +71,7 @@ class TableHeap {
 
   /**
    * if the new tuple is too large to fit in the old page, return false (will delete and insert)
+   * An OPTIMISTIC transaction only buffers the update until it commits, it aborts at commit if the tuple does not fit.
    * @param tuple new tuple
    * @param rid rid of the old tuple
    * @param txn transaction performing the update
@@ -76,10 +79,18 @@ class TableHeap {
    */
   auto UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) -> bool;
 
+  /**
+   * Called on commit of an OPTIMISTIC transaction to apply a buffered write to the page.
+   * @param record the buffered write
+   * @param txn the committing transaction
+   * @return false if the write failed or conflicts with another writer, the transaction must abort then
+   */
+  auto InstallWrite(const TableWriteRecord &record, Transaction *txn) -> bool;
+
   /**
    * Called on Commit/Abort to actually delete a tuple or rollback an insert.
    * @param rid rid of the tuple to delete
-   * @param txn transaction performing the delete.
+   * @param txn transaction performing the delete, nullptr when the garbage collection applies a committed delete
    */
   void ApplyDelete(const RID &rid, Transaction *txn);
 
@@ -108,11 +119,27 @@ class TableHeap {
   /** @return the id of the first page of this table */
   inline auto GetFirstPageId() const -> page_id_t { return first_page_id_; }
 
+  /** @return the older versions of the tuples of this table */
+  inline auto GetVersionStore() -> VersionStore * { return &version_store_; }
+
  private:
+  /** @return true if txn reads a snapshot instead of the newest version */
+  static auto IsSnapshotRead(Transaction *txn) -> bool;
+
+  auto MarkDeleteInPlace(const RID &rid, Transaction *txn) -> bool;
+  auto UpdateTupleInPlace(const Tuple &tuple, const RID &rid, Transaction *txn) -> bool;
+
+  /**
+   * Save the version of rid that txn is about to overwrite if a snapshot may need it, the page must be write latched.
+   * @return false on a write-write conflict, txn is aborted then
+   */
+  auto BeginWrite(TablePage *page, const RID &rid, Transaction *txn, bool *first_write) -> bool;
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  VersionStore version_store_;
 };
 
 }  // namespace bustub
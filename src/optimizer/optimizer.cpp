@@ -12,8 +12,9 @@ auto Optimizer::Optimize(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef
     p = OptimizeMergeProjection(p);
     p = OptimizeMergeFilterNLJ(p);
     p = OptimizeNLJAsIndexJoin(p);
-    p = OptimizeOrderByAsIndexScan(p);
     p = OptimizeSortLimitAsTopN(p);
+    // after the TopN rule, so that a TopN over a matching index becomes a limit over the index scan
+    p = OptimizeOrderByAsIndexScan(p);
     return p;
   }
   // By default, use user-defined rules.
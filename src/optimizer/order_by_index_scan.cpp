@@ -12,10 +12,12 @@
 #include "execution/plans/abstract_plan.h"
 #include "execution/plans/filter_plan.h"
 #include "execution/plans/index_scan_plan.h"
+#include "execution/plans/limit_plan.h"
 #include "execution/plans/nested_loop_join_plan.h"
 #include "execution/plans/projection_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/sort_plan.h"
+#include "execution/plans/topn_plan.h"
 #include "optimizer/optimizer.h"
 #include "type/type_id.h"
 
@@ -28,46 +30,52 @@ auto Optimizer::OptimizeOrderByAsIndexScan(const AbstractPlanNodeRef &plan) -> A
   }
   auto optimized_plan = plan->CloneWithChildren(std::move(children));
 
-  if (optimized_plan->GetType() == PlanType::Sort) {
-    const auto &sort_plan = dynamic_cast<const SortPlanNode &>(*optimized_plan);
-    const auto &order_bys = sort_plan.GetOrderBy();
-
-    // Has exactly one order by column
-    if (order_bys.size() != 1) {
-      return optimized_plan;
-    }
-
-    // Order type is asc or default
-    const auto &[order_type, expr] = order_bys[0];
-    if (!(order_type == OrderByType::ASC || order_type == OrderByType::DEFAULT)) {
-      return optimized_plan;
-    }
+  // A TopN is rewritten as a limit over the index scan, so that only as many leaves are read as the limit needs.
+  if (optimized_plan->GetType() != PlanType::Sort && optimized_plan->GetType() != PlanType::TopN) {
+    return optimized_plan;
+  }
+  const auto &order_bys = optimized_plan->GetType() == PlanType::Sort
+                              ? dynamic_cast<const SortPlanNode &>(*optimized_plan).GetOrderBy()
+                              : dynamic_cast<const TopNPlanNode &>(*optimized_plan).GetOrderBy();
 
-    // Order expression is a column value expression
-    const auto *column_value_expr = dynamic_cast<ColumnValueExpression *>(expr.get());
-    if (column_value_expr == nullptr) {
-      return optimized_plan;
-    }
+  // Has exactly one order by column
+  if (order_bys.size() != 1) {
+    return optimized_plan;
+  }
 
-    auto order_by_column_id = column_value_expr->GetColIdx();
+  // Order type is asc, desc or default, desc is served by scanning the index backward
+  const auto &[order_type, expr] = order_bys[0];
+  if (order_type == OrderByType::INVALID) {
+    return optimized_plan;
+  }
+  const bool reverse = order_type == OrderByType::DESC;
 
-    // Has exactly one child
-    BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Sort with multiple children?? Impossible!");
-    const auto &child_plan = optimized_plan->children_[0];
+  // Order expression is a column value expression
+  const auto *column_value_expr = dynamic_cast<ColumnValueExpression *>(expr.get());
+  if (column_value_expr == nullptr) {
+    return optimized_plan;
+  }
 
-    if (child_plan->GetType() == PlanType::SeqScan) {
-      const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*child_plan);
-      const auto *table_info = catalog_.GetTable(seq_scan.GetTableOid());
-      const auto indices = catalog_.GetTableIndexes(table_info->name_);
+  // Has exactly one child
+  BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Sort with multiple children?? Impossible!");
+  const auto &child_plan = optimized_plan->children_[0];
 
-      for (const auto *index : indices) {
-        const auto &columns = index->key_schema_.GetColumns();
-        if (columns.size() == 1 &&
-            columns[0].GetName() == table_info->schema_.GetColumn(order_by_column_id).GetName()) {
-          // Index matched, return index scan instead
-          return std::make_shared<IndexScanPlanNode>(optimized_plan->output_schema_, index->index_oid_);
-        }
+  if (child_plan->GetType() == PlanType::SeqScan) {
+    const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*child_plan);
+    if (seq_scan.filter_predicate_ != nullptr) {
+      return optimized_plan;
+    }
+    if (auto index = MatchIndex(seq_scan.table_name_, column_value_expr->GetColIdx(), true);
+        index != std::nullopt) {
+      // Index matched, return index scan instead
+      auto [index_oid, index_name] = *index;
+      auto index_scan = std::make_shared<IndexScanPlanNode>(optimized_plan->output_schema_, index_oid, reverse);
+      if (optimized_plan->GetType() == PlanType::TopN) {
+        const auto &topn_plan = dynamic_cast<const TopNPlanNode &>(*optimized_plan);
+        return std::make_shared<LimitPlanNode>(optimized_plan->output_schema_, std::move(index_scan),
+                                               topn_plan.GetN());
       }
+      return index_scan;
     }
   }
 
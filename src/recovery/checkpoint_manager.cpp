@@ -12,16 +12,115 @@
 
 #include "recovery/checkpoint_manager.h"
 
+#include <algorithm>
+
 namespace bustub {
 
+CheckpointManager::~CheckpointManager() {
+  if (flush_thread_.joinable()) {
+    flush_thread_.join();
+  }
+}
+
 void CheckpointManager::BeginCheckpoint() {
-  // Block all the transactions and ensure that both the WAL and all dirty buffer pool pages are persisted to disk,
-  // creating a consistent checkpoint. Do NOT allow transactions to resume at the end of this method, resume them
-  // in CheckpointManager::EndCheckpoint() instead. This is for grading purposes.
+  if (begin_lsn_ != INVALID_LSN) {
+    EndCheckpoint();
+  }
+  LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+  begin_lsn_ = log_manager_->AppendLogRecord(&begin_record);
+  // only the pages dirtied before the checkpoint hold redo back, the others are written out by the buffer pool
+  auto dirty_pages = buffer_pool_manager_->GetDirtyPageTable();
+  flush_thread_ = std::thread([this, dirty_pages = std::move(dirty_pages)] { FlushPages(dirty_pages); });
 }
 
 void CheckpointManager::EndCheckpoint() {
-  // Allow transactions to resume, completing the checkpoint.
+  if (begin_lsn_ == INVALID_LSN) {
+    return;
+  }
+  flush_thread_.join();
+
+  auto active_txns = TransactionManager::GetActiveTransactions();
+  auto dirty_pages = buffer_pool_manager_->GetDirtyPageTable();
+  lsn_t redo_lsn = begin_lsn_;
+  for (const auto &[page_id, rec_lsn] : dirty_pages) {
+    redo_lsn = std::min(redo_lsn, rec_lsn);
+  }
+
+  // tables that do not fit into a log buffer are split into several records
+  const size_t max_entries = (LOG_BUFFER_SIZE - 64) / LogRecord::CHECKPOINT_ENTRY_SIZE;
+  size_t txn_pos = 0;
+  size_t page_pos = 0;
+  lsn_t end_lsn;
+  do {
+    size_t txn_count = std::min(active_txns.size() - txn_pos, max_entries);
+    size_t page_count = std::min(dirty_pages.size() - page_pos, max_entries - txn_count);
+    LogRecord end_record(begin_lsn_, {active_txns.begin() + txn_pos, active_txns.begin() + txn_pos + txn_count},
+                         {dirty_pages.begin() + page_pos, dirty_pages.begin() + page_pos + page_count});
+    end_lsn = log_manager_->AppendLogRecord(&end_record);
+    txn_pos += txn_count;
+    page_pos += page_count;
+  } while (txn_pos < active_txns.size() || page_pos < dirty_pages.size());
+  log_manager_->WaitForDurable(end_lsn);
+
+  // the checkpoint is complete once the master record points at it
+  MasterRecord master;
+  master.checkpoint_lsn_ = begin_lsn_;
+  master.checkpoint_offset_ = log_manager_->GetLogOffset(begin_lsn_);
+  master.redo_lsn_ = redo_lsn;
+  // a recLSN this log manager did not write itself is found by scanning the whole log
+  master.redo_offset_ = std::max<log_offset_t>(log_manager_->GetLogOffset(redo_lsn), 0);
+  // undo follows the running transactions back to their begin records, the log before them and redo is recycled
+  lsn_t start_lsn = redo_lsn;
+  lsn_t oldest_lsn = TransactionManager::GetOldestActiveLSN();
+  if (oldest_lsn != INVALID_LSN) {
+    start_lsn = std::min(start_lsn, oldest_lsn);
+  }
+  master.log_start_offset_ = std::max<log_offset_t>(log_manager_->GetLogOffset(start_lsn), 0);
+  auto *disk_manager = log_manager_->GetDiskManager();
+  disk_manager->WriteMasterRecord(reinterpret_cast<const char *>(&master), sizeof(master));
+  log_manager_->RecycleLog(master.log_start_offset_);
+  begin_lsn_ = INVALID_LSN;
+}
+
+void CheckpointManager::FlushPages(const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages) {
+  std::vector<page_id_t> ahead;
+  lsn_t ahead_lsn = INVALID_LSN;
+  for (const auto &[page_id, rec_lsn] : dirty_pages) {
+    if (lsn_t page_lsn = FlushPage(page_id, false); page_lsn != INVALID_LSN) {
+      ahead.push_back(page_id);
+      ahead_lsn = std::max(ahead_lsn, page_lsn);
+    }
+  }
+  if (ahead.empty()) {
+    return;
+  }
+  log_manager_->FlushUntil(ahead_lsn);
+  for (page_id_t page_id : ahead) {
+    FlushPage(page_id, true);
+  }
+}
+
+auto CheckpointManager::FlushPage(page_id_t page_id, bool force_log) -> lsn_t {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    return INVALID_LSN;
+  }
+  // the read latch keeps writers out, the page on disk is the page in memory afterwards
+  page->RLatch();
+  lsn_t page_lsn = page->GetLSN();
+  bool log_safe = page_lsn <= log_manager_->GetPersistentLSN();
+  if (log_safe || force_log) {
+    // write ahead: the log goes to disk before the page
+    if (!log_safe) {
+      log_manager_->FlushUntil(page_lsn);
+    }
+    if (buffer_pool_manager_->FlushPage(page_id)) {
+      page->ResetRecLSN();
+    }
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return log_safe || force_log ? INVALID_LSN : page_lsn;
 }
 
 }  // namespace bustub
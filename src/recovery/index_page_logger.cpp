@@ -0,0 +1,204 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_page_logger.cpp
+//
+// Identification: src/recovery/index_page_logger.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/index_page_logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace bustub {
+
+thread_local IndexPageLogger::Operation IndexPageLogger::operation_;
+
+void IndexPageLogger::BeginOperation() {
+  if (operation_.logger_ != nullptr) {
+    // the last operation of the thread failed halfway, its pages are released unlogged
+    for (const auto &[page_id, tracked] : operation_.pages_) {
+      operation_.logger_->buffer_pool_manager_->UnpinPage(page_id, tracked.dirty_);
+    }
+    operation_.pages_.clear();
+    operation_.last_lsn_ = INVALID_LSN;
+  }
+  operation_.logger_ = enable_logging ? this : nullptr;
+}
+
+void IndexPageLogger::EndOperation() {
+  if (operation_.logger_ != this) {
+    return;
+  }
+  std::vector<std::pair<PageDelta, Page *>> deltas;
+  for (auto &[page_id, tracked] : operation_.pages_) {
+    PageDelta delta = Diff(page_id, tracked);
+    if (!delta.runs_.empty() || tracked.new_page_) {
+      tracked.dirty_ = true;
+      deltas.emplace_back(std::move(delta), tracked.page_);
+    }
+  }
+  // a group of records is closed by its last one, which may hold no page
+  if (!deltas.empty() || operation_.last_lsn_ != INVALID_LSN) {
+    Append(&deltas, false);
+  }
+  for (const auto &[page_id, tracked] : operation_.pages_) {
+    buffer_pool_manager_->UnpinPage(page_id, tracked.dirty_);
+  }
+  operation_.pages_.clear();
+  operation_.last_lsn_ = INVALID_LSN;
+  operation_.logger_ = nullptr;
+}
+
+void IndexPageLogger::LogPage(Page *page) {
+  if (operation_.logger_ != this) {
+    return;
+  }
+  auto it = std::find_if(operation_.pages_.begin(), operation_.pages_.end(),
+                         [page](const auto &entry) { return entry.second.page_ == page; });
+  if (it == operation_.pages_.end()) {
+    return;
+  }
+  page_id_t page_id = it->first;
+  PageDelta delta = Diff(page_id, it->second);
+  bool changed = !delta.runs_.empty() || it->second.new_page_;
+  if (changed) {
+    std::vector<std::pair<PageDelta, Page *>> deltas;
+    deltas.emplace_back(std::move(delta), page);
+    Append(&deltas, true);
+  }
+  Untrack(page_id, it->second.dirty_ || changed);
+}
+
+auto IndexPageLogger::FetchPgImp(page_id_t page_id) -> Page * {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page != nullptr && operation_.logger_ == this) {
+    Track(page_id, page, false);
+  }
+  return page;
+}
+
+auto IndexPageLogger::NewPgImp(page_id_t *page_id) -> Page * {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page != nullptr && operation_.logger_ == this) {
+    Track(*page_id, page, true);
+  }
+  return page;
+}
+
+auto IndexPageLogger::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
+  bool unpinned = buffer_pool_manager_->UnpinPage(page_id, is_dirty);
+  if (operation_.logger_ == this) {
+    if (auto it = operation_.pages_.find(page_id); it != operation_.pages_.end()) {
+      it->second.dirty_ = it->second.dirty_ || is_dirty;
+      if (--it->second.pin_count_ == 0 && !it->second.dirty_) {
+        Untrack(page_id, false);
+      }
+    }
+  }
+  return unpinned;
+}
+
+auto IndexPageLogger::DeletePgImp(page_id_t page_id) -> bool {
+  // a page freed by the operation is not logged
+  if (operation_.logger_ == this && operation_.pages_.count(page_id) > 0) {
+    Untrack(page_id, false);
+  }
+  return buffer_pool_manager_->DeletePage(page_id);
+}
+
+void IndexPageLogger::Track(page_id_t page_id, Page *page, bool new_page) {
+  if (auto it = operation_.pages_.find(page_id); it != operation_.pages_.end()) {
+    it->second.pin_count_++;
+    return;
+  }
+  // the pin of the logger keeps the page in the pool until the end of the operation
+  buffer_pool_manager_->FetchPage(page_id);
+  TrackedPage tracked;
+  tracked.page_ = page;
+  tracked.image_.resize(BUSTUB_PAGE_SIZE);
+  tracked.new_page_ = new_page;
+  if (!new_page) {
+    // a writer may hold the page until the caller latches it, the copy waits for it; a page the caller then write
+    // latches is copied again by Snapshot()
+    page->RLatch();
+    memcpy(tracked.image_.data(), page->GetData(), BUSTUB_PAGE_SIZE);
+    page->RUnlatch();
+  }
+  operation_.pages_.emplace(page_id, std::move(tracked));
+}
+
+void IndexPageLogger::Snapshot(Page *page) {
+  if (operation_.logger_ != this) {
+    return;
+  }
+  auto it = operation_.pages_.find(page->GetPageId());
+  if (it != operation_.pages_.end() && !it->second.new_page_) {
+    memcpy(it->second.image_.data(), page->GetData(), BUSTUB_PAGE_SIZE);
+  }
+}
+
+void IndexPageLogger::Untrack(page_id_t page_id, bool is_dirty) {
+  operation_.pages_.erase(page_id);
+  buffer_pool_manager_->UnpinPage(page_id, is_dirty);
+}
+
+auto IndexPageLogger::Diff(page_id_t page_id, const TrackedPage &tracked) -> PageDelta {
+  PageDelta delta;
+  delta.page_id_ = page_id;
+  delta.new_page_ = tracked.new_page_;
+  const char *image = tracked.image_.data();
+  const char *data = tracked.page_->GetData();
+  uint32_t pos = 0;
+  while (pos < BUSTUB_PAGE_SIZE) {
+    if (image[pos] == data[pos]) {
+      pos++;
+      continue;
+    }
+    uint32_t begin = pos;
+    uint32_t end = pos + 1;
+    for (pos = end; pos < BUSTUB_PAGE_SIZE && pos < end + RUN_GAP; pos++) {
+      if (image[pos] != data[pos]) {
+        end = pos + 1;
+      }
+    }
+    delta.runs_.emplace_back(begin, std::string(data + begin, end - begin));
+  }
+  // scattered changes are cheaper to log as the whole page
+  if (LogRecord::DeltaSize(delta) > BUSTUB_PAGE_SIZE) {
+    delta.runs_.clear();
+    delta.runs_.emplace_back(0, std::string(data, BUSTUB_PAGE_SIZE));
+  }
+  return delta;
+}
+
+void IndexPageLogger::Append(std::vector<std::pair<PageDelta, Page *>> *deltas, bool more) {
+  size_t pos = 0;
+  do {
+    // a delta takes little more than a page, a record always has room for one
+    std::vector<PageDelta> record_deltas;
+    std::vector<Page *> pages;
+    size_t size = 0;
+    while (pos < deltas->size() &&
+           (record_deltas.empty() || size + LogRecord::DeltaSize((*deltas)[pos].first) <= MAX_RECORD_SIZE)) {
+      size += LogRecord::DeltaSize((*deltas)[pos].first);
+      record_deltas.push_back(std::move((*deltas)[pos].first));
+      pages.push_back((*deltas)[pos].second);
+      pos++;
+    }
+    LogRecord log_record(operation_.last_lsn_, more || pos < deltas->size(), std::move(record_deltas));
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    for (Page *page : pages) {
+      page->SetLSN(lsn);
+    }
+    operation_.last_lsn_ = lsn;
+  } while (pos < deltas->size());
+}
+
+}  // namespace bustub
@@ -12,7 +12,34 @@
 
 #include "recovery/log_manager.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "common/macros.h"
+
 namespace bustub {
+
+namespace {
+
+/** Write an id, lsn or count as the varint of the value plus one */
+void WriteField(char **data, int64_t value) {
+  *data += VarintUtil::Encode(static_cast<uint32_t>(value) + 1U, *data);
+}
+
+void WriteRID(char **data, const RID &rid) {
+  WriteField(data, rid.GetPageId());
+  WriteField(data, rid.GetSlotNum());
+}
+
+void WriteBytes(char **data, const char *bytes, uint32_t length) {
+  *data += VarintUtil::Encode(length, *data);
+  memcpy(*data, bytes, length);
+  *data += length;
+}
+
+}  // namespace
+
 /*
  * set enable_logging = true
  * Start a separate thread to execute flush to disk operation periodically
@@ -22,33 +49,389 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::unique_lock lock(latch_);
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  enable_logging = true;
+  flush_thread_running_ = true;
+  last_flush_ = std::chrono::steady_clock::now();
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock lock(latch_);
+    while (flush_thread_running_) {
+      // an open group flushes when its window closes, without committers the log is flushed every log_timeout
+      auto deadline = waiters_ > 0 ? group_start_ + group_commit_window : last_flush_ + log_timeout;
+      bool sealed = flushed_ < current_.load();
+      if (!sealed && !flush_requested_ && waiters_ < group_commit_size &&
+          std::chrono::steady_clock::now() < deadline) {
+        cv_.wait_until(lock, deadline);
+        continue;
+      }
+      // buffers sealed by appenders are written first, the current buffer only once a flush is due
+      if (!sealed) {
+        flush_requested_ = false;
+        waiters_ = 0;
+        // only a flush of the current buffer restarts the timeout, every record appended before it is written now;
+        // this bounds how long an asynchronous commit stays volatile
+        last_flush_ = std::chrono::steady_clock::now();
+        SealCurrent(&lock);
+      }
+      FlushSealed(&lock);
+    }
+    SealCurrent(&lock);
+    FlushSealed(&lock);
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  std::thread *flush_thread;
+  {
+    std::scoped_lock lock(latch_);
+    flush_thread = flush_thread_;
+    flush_thread_running_ = false;
+  }
+  if (flush_thread == nullptr) {
+    return;
+  }
+  cv_.notify_one();
+  flush_thread->join();
+  delete flush_thread;
+  std::scoped_lock lock(latch_);
+  flush_thread_ = nullptr;
+  enable_logging = false;
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
- *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
  */
-auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t { return INVALID_LSN; }
+auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t {
+  auto size = static_cast<uint64_t>(log_record->size_);
+  BUSTUB_ASSERT(size <= LOG_BUFFER_SIZE - BLOCK_HEADER_SIZE, "log record does not fit into a log buffer");
+  while (true) {
+    uint64_t seq = current_.load();
+    LogBuffer &buffer = buffers_[seq % LOG_BUFFER_COUNT];
+    uint64_t reserved = buffer.reserved_.fetch_add(RECORD_ONE | size);
+    uint64_t offset = reserved & OFFSET_MASK;
+    if (offset + size <= LOG_BUFFER_SIZE) {
+      // the base lsn is read after the reservation, the buffer cannot be recycled before this record is written
+      log_record->lsn_ = buffer.base_lsn_ + static_cast<lsn_t>(reserved >> 32);
+      Serialize(log_record, buffer.data_ + offset);
+      buffer.written_.fetch_add(size);
+      return log_record->lsn_;
+    }
+
+    std::unique_lock lock(latch_);
+    if (offset <= LOG_BUFFER_SIZE) {
+      // the first reservation past the end seals the buffer and moves the appenders on to the next one
+      Activate(buffer.seq_, reserved, &lock, flush_thread_ == nullptr);
+    } else {
+      append_cv_.wait(lock, [&] { return current_.load() != seq; });
+    }
+  }
+}
+
+void LogManager::WaitForDurable(lsn_t lsn) {
+  std::unique_lock lock(latch_);
+  if (flush_thread_ == nullptr) {
+    FlushInline(lsn, &lock);
+    return;
+  }
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  if (lsn >= buffers_[current_ % LOG_BUFFER_COUNT].base_lsn_) {
+    // join the group of the records in the current buffer, the first member opens its window
+    if (waiters_++ == 0) {
+      group_start_ = std::chrono::steady_clock::now();
+    }
+    cv_.notify_one();
+  }
+  durable_cv_.wait(lock, [&] { return persistent_lsn_ >= lsn; });
+}
+
+void LogManager::Flush() {
+  std::unique_lock lock(latch_);
+  lsn_t lsn = LastLSN(&lock);
+  if (flush_thread_ == nullptr) {
+    FlushInline(lsn, &lock);
+    return;
+  }
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  flush_requested_ = true;
+  cv_.notify_one();
+  durable_cv_.wait(lock, [&] { return persistent_lsn_ >= lsn; });
+}
+
+void LogManager::FlushUntil(lsn_t lsn) {
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  std::unique_lock lock(latch_);
+  // a page may carry the lsn of an earlier run, which was never handed out by this log manager
+  lsn = std::min(lsn, LastLSN(&lock));
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  // the buffers before the current one are sealed and written by now or soon, the current one is sealed early only if
+  // it holds lsn
+  bool in_current = lsn >= buffers_[current_ % LOG_BUFFER_COUNT].base_lsn_;
+  if (flush_thread_ == nullptr) {
+    FlushInline(lsn, &lock);
+    return;
+  }
+  if (in_current) {
+    flush_requested_ = true;
+  }
+  cv_.notify_one();
+  durable_cv_.wait(lock, [&] { return persistent_lsn_ >= lsn; });
+}
+
+auto LogManager::GetNextLSN() -> lsn_t {
+  std::unique_lock lock(latch_);
+  return LastLSN(&lock) + 1;
+}
+
+void LogManager::SetNextLSN(lsn_t lsn) {
+  std::scoped_lock lock(latch_);
+  LogBuffer &buffer = buffers_[current_ % LOG_BUFFER_COUNT];
+  BUSTUB_ASSERT(flushed_ == current_.load() && (buffer.reserved_.load() >> 32) == 0,
+                "the next lsn is set before the first record is appended");
+  buffer.base_lsn_ = lsn;
+  // everything before lsn is in the log file already
+  persistent_lsn_ = lsn - 1;
+}
+
+void LogManager::RecycleLog(log_offset_t offset) {
+  {
+    std::scoped_lock lock(latch_);
+    // the blocks follow the order of their lsns in the log file
+    auto it = std::find_if(flushed_offsets_.begin(), flushed_offsets_.end(),
+                           [offset](const auto &entry) { return entry.second >= offset; });
+    flushed_offsets_.erase(flushed_offsets_.begin(), it);
+  }
+  disk_manager_->RecycleLog(offset);
+}
+
+auto LogManager::GetLogOffset(lsn_t lsn) -> log_offset_t {
+  std::scoped_lock lock(latch_);
+  auto it = flushed_offsets_.upper_bound(lsn);
+  if (it == flushed_offsets_.begin() || lsn > persistent_lsn_) {
+    return -1;
+  }
+  return std::prev(it)->second;
+}
+
+auto LogManager::LastLSN(std::unique_lock<std::mutex> *lock) -> lsn_t {
+  while (true) {
+    uint64_t seq = current_.load();
+    LogBuffer &buffer = buffers_[seq % LOG_BUFFER_COUNT];
+    uint64_t reserved = buffer.reserved_.load();
+    if ((reserved & OFFSET_MASK) <= LOG_BUFFER_SIZE) {
+      return buffer.base_lsn_ + static_cast<lsn_t>(reserved >> 32) - 1;
+    }
+    // an appender sealed the buffer and is about to activate the next one
+    append_cv_.wait(*lock, [&] { return current_.load() != seq; });
+  }
+}
+
+auto LogManager::SealCurrent(std::unique_lock<std::mutex> *lock) -> bool {
+  uint64_t seq = current_.load();
+  LogBuffer &buffer = buffers_[seq % LOG_BUFFER_COUNT];
+  if ((buffer.reserved_.load() >> 32) == 0) {
+    return true;
+  }
+  // a reservation that cannot fit, unless an appender overflowed the buffer first and activates the next one itself
+  uint64_t reserved = buffer.reserved_.fetch_add(LOG_BUFFER_SIZE + 1);
+  if ((reserved & OFFSET_MASK) > LOG_BUFFER_SIZE) {
+    return false;
+  }
+  Activate(seq, reserved, lock, true);
+  return true;
+}
+
+void LogManager::FlushInline(lsn_t lsn, std::unique_lock<std::mutex> *lock) {
+  // only records handed out so far can become durable, a later lsn would keep the loop going forever
+  lsn = std::min(lsn, LastLSN(lock));
+  while (persistent_lsn_ < lsn) {
+    uint64_t seq = current_.load();
+    if (lsn >= buffers_[seq % LOG_BUFFER_COUNT].base_lsn_ && !SealCurrent(lock)) {
+      // the appender that overflowed the buffer is blocked on the latch, wait until it made the next buffer current
+      append_cv_.wait(*lock, [&] { return current_.load() != seq; });
+      continue;
+    }
+    FlushSealed(lock);
+  }
+}
+
+void LogManager::Activate(uint64_t seq, uint64_t reserved, std::unique_lock<std::mutex> *lock, bool inline_flush) {
+  LogBuffer &buffer = buffers_[seq % LOG_BUFFER_COUNT];
+  buffer.sealed_bytes_ = reserved & OFFSET_MASK;
+  buffer.sealed_records_ = static_cast<lsn_t>(reserved >> 32);
+  // the records waited for are sealed now, the flush thread picks them up right away
+  waiters_ = 0;
+  cv_.notify_one();
+
+  while (seq + 1 - flushed_ >= LOG_BUFFER_COUNT) {
+    if (inline_flush) {
+      FlushOne(lock);
+    } else {
+      append_cv_.wait(*lock);
+    }
+  }
+  LogBuffer &next = buffers_[(seq + 1) % LOG_BUFFER_COUNT];
+  next.seq_ = seq + 1;
+  next.base_lsn_ = buffer.base_lsn_ + buffer.sealed_records_;
+  next.written_.store(BLOCK_HEADER_SIZE);
+  next.reserved_.store(BLOCK_HEADER_SIZE);
+  current_.store(seq + 1);
+  append_cv_.notify_all();
+}
+
+void LogManager::FlushOne(std::unique_lock<std::mutex> *lock) {
+  while (flushing_) {
+    durable_cv_.wait(*lock);
+  }
+  if (flushed_ == current_.load()) {
+    return;
+  }
+  LogBuffer &buffer = buffers_[flushed_ % LOG_BUFFER_COUNT];
+  log_offset_t block_offset = log_size_;
+  flushing_ = true;
+
+  lock->unlock();
+  // the appenders that reserved space in the buffer are done copying soon
+  while (buffer.written_.load() != buffer.sealed_bytes_) {
+    std::this_thread::yield();
+  }
+  int block_size = 0;
+  if (buffer.sealed_records_ > 0) {
+    try {
+      block_size = WriteBlock(&buffer, block_offset);
+    } catch (...) {
+      // nothing became durable, the buffer stays sealed and the next flush writes it again
+      lock->lock();
+      flushing_ = false;
+      durable_cv_.notify_all();
+      throw;
+    }
+  }
+  lock->lock();
+
+  if (buffer.sealed_records_ > 0) {
+    persistent_lsn_ = buffer.base_lsn_ + buffer.sealed_records_ - 1;
+    flushed_offsets_.emplace(buffer.base_lsn_, block_offset);
+    log_size_ += block_size;
+  }
+  flushed_++;
+  flushing_ = false;
+  durable_cv_.notify_all();
+  append_cv_.notify_all();
+}
+
+auto LogManager::WriteBlock(LogBuffer *buffer, log_offset_t offset) -> int {
+  LogBlockHeader header;
+  header.offset_ = offset;
+  header.raw_size_ = static_cast<uint32_t>(buffer->sealed_bytes_ - BLOCK_HEADER_SIZE);
+  header.stored_size_ = header.raw_size_;
+  header.base_lsn_ = buffer->base_lsn_;
+  char *block = buffer->data_;
+  if (enable_log_compression) {
+    size_t compressed_size = CompressionUtil::Compress(buffer->data_ + BLOCK_HEADER_SIZE, header.raw_size_,
+                                                       buffer->compressed_ + BLOCK_HEADER_SIZE);
+    if (compressed_size < header.raw_size_) {
+      header.stored_size_ = static_cast<uint32_t>(compressed_size);
+      block = buffer->compressed_;
+    }
+  }
+  memcpy(block, &header, BLOCK_HEADER_SIZE);
+  int block_size = static_cast<int>(BLOCK_HEADER_SIZE + header.stored_size_);
+  disk_manager_->WriteLog(block, block_size);
+  return block_size;
+}
+
+void LogManager::FlushSealed(std::unique_lock<std::mutex> *lock) {
+  while (flushed_ < current_.load() || flushing_) {
+    FlushOne(lock);
+  }
+}
+
+void LogManager::Serialize(const LogRecord *log_record, char *data) {
+  data += VarintUtil::Encode(log_record->size_, data);
+  auto type = static_cast<uint8_t>(log_record->log_record_type_);
+  *data++ = static_cast<char>(log_record->compensation_ ? type | LogRecord::COMPENSATION_FLAG : type);
+  WriteField(&data, log_record->txn_id_);
+  WriteField(&data, log_record->prev_lsn_);
+  if (log_record->compensation_) {
+    WriteField(&data, log_record->undo_next_lsn_);
+  }
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      WriteRID(&data, log_record->insert_rid_);
+      WriteBytes(&data, log_record->insert_tuple_.GetData(), log_record->insert_tuple_.GetLength());
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      WriteRID(&data, log_record->delete_rid_);
+      WriteBytes(&data, log_record->delete_tuple_.GetData(), log_record->delete_tuple_.GetLength());
+      break;
+    case LogRecordType::UPDATE: {
+      uint32_t shared = log_record->update_prefix_ + log_record->update_suffix_;
+      WriteRID(&data, log_record->update_rid_);
+      WriteField(&data, log_record->update_prefix_);
+      WriteField(&data, log_record->update_suffix_);
+      WriteBytes(&data, log_record->old_tuple_.GetData() + log_record->update_prefix_,
+                 log_record->old_tuple_.GetLength() - shared);
+      WriteBytes(&data, log_record->new_tuple_.GetData() + log_record->update_prefix_,
+                 log_record->new_tuple_.GetLength() - shared);
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      WriteField(&data, log_record->prev_page_id_);
+      WriteField(&data, log_record->page_id_);
+      break;
+    case LogRecordType::INDEX_INSERT:
+    case LogRecordType::INDEX_DELETE:
+      WriteBytes(&data, log_record->index_name_.data(), log_record->index_name_.size());
+      WriteRID(&data, log_record->index_rid_);
+      WriteBytes(&data, log_record->index_key_.GetData(), log_record->index_key_.GetLength());
+      break;
+    case LogRecordType::INDEX_PAGE:
+      WriteField(&data, static_cast<int64_t>(log_record->more_));
+      WriteField(&data, log_record->page_deltas_.size());
+      for (const auto &page_delta : log_record->page_deltas_) {
+        WriteField(&data, page_delta.page_id_);
+        WriteField(&data, static_cast<int64_t>(page_delta.new_page_));
+        WriteField(&data, page_delta.runs_.size());
+        for (const auto &[offset, bytes] : page_delta.runs_) {
+          WriteField(&data, offset);
+          WriteBytes(&data, bytes.data(), bytes.size());
+        }
+      }
+      break;
+    case LogRecordType::END_CHECKPOINT:
+      WriteField(&data, log_record->active_txns_.size());
+      WriteField(&data, log_record->dirty_pages_.size());
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        WriteField(&data, txn_id);
+        WriteField(&data, last_lsn);
+      }
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        WriteField(&data, page_id);
+        WriteField(&data, rec_lsn);
+      }
+      break;
+    default:
+      break;
+  }
+}
 
 }  // namespace bustub
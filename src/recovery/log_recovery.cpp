@@ -12,29 +12,790 @@
 
 #include "recovery/log_recovery.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>  // NOLINT
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/macros.h"
+#include "common/util/compression_util.h"
+#include "common/util/varint_util.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
+
+namespace {
+
+/** Read an id, lsn or count stored as the varint of the value plus one */
+template <typename T>
+void ReadField(const char **data, T *value) {
+  uint64_t field;
+  *data += VarintUtil::Decode(*data, &field);
+  *value = static_cast<T>(static_cast<uint32_t>(field) - 1U);
+}
+
+void ReadRID(const char **data, RID *rid) {
+  page_id_t page_id;
+  uint32_t slot_num;
+  ReadField(data, &page_id);
+  ReadField(data, &slot_num);
+  rid->Set(page_id, slot_num);
+}
+
+/** Read a length prefixed byte string into tuple, @return false if it runs past end */
+auto ReadTuple(const char **data, const char *end, Tuple *tuple) -> bool {
+  uint64_t length;
+  *data += VarintUtil::Decode(*data, &length);
+  if (*data > end || length > static_cast<uint64_t>(end - *data)) {
+    return false;
+  }
+  std::vector<char> storage(sizeof(int32_t) + length);
+  auto size = static_cast<int32_t>(length);
+  memcpy(storage.data(), &size, sizeof(int32_t));
+  memcpy(storage.data() + sizeof(int32_t), *data, length);
+  tuple->DeserializeFrom(storage.data());
+  *data += length;
+  return true;
+}
+
+/** Read a length prefixed byte string, @return false if it runs past end */
+auto ReadBytes(const char **data, const char *end, std::string *bytes) -> bool {
+  uint64_t length;
+  *data += VarintUtil::Decode(*data, &length);
+  if (*data > end || length > static_cast<uint64_t>(end - *data)) {
+    return false;
+  }
+  bytes->assign(*data, length);
+  *data += length;
+  return true;
+}
+
+/** Read the page deltas of an index page record, @return false if they run past end or off a page */
+auto ReadPageDeltas(const char **data, const char *end, std::vector<PageDelta> *page_deltas) -> bool {
+  size_t page_count;
+  ReadField(data, &page_count);
+  if (page_count > static_cast<size_t>(end - *data)) {
+    return false;
+  }
+  page_deltas->resize(page_count);
+  for (auto &page_delta : *page_deltas) {
+    size_t run_count;
+    ReadField(data, &page_delta.page_id_);
+    ReadField(data, &page_delta.new_page_);
+    ReadField(data, &run_count);
+    if (*data > end || run_count > static_cast<size_t>(end - *data)) {
+      return false;
+    }
+    page_delta.runs_.resize(run_count);
+    for (auto &[offset, bytes] : page_delta.runs_) {
+      ReadField(data, &offset);
+      if (!ReadBytes(data, end, &bytes) || offset > BUSTUB_PAGE_SIZE || bytes.size() > BUSTUB_PAGE_SIZE - offset) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * An update record holds only the bytes that changed, the shared prefix and suffix are taken from the tuple on the
+ * page: the old tuple on redo, the new one on undo.
+ * @return the tuple with the changed bytes spliced in
+ */
+auto Patch(const Tuple &image, uint32_t prefix, uint32_t suffix, const Tuple &middle) -> Tuple {
+  BUSTUB_ASSERT(image.GetLength() >= prefix + suffix, "the tuple on the page does not match the update");
+  auto length = static_cast<int32_t>(prefix + middle.GetLength() + suffix);
+  std::vector<char> storage(sizeof(int32_t) + length);
+  char *data = storage.data();
+  memcpy(data, &length, sizeof(int32_t));
+  data += sizeof(int32_t);
+  memcpy(data, image.GetData(), prefix);
+  memcpy(data + prefix, middle.GetData(), middle.GetLength());
+  memcpy(data + prefix + middle.GetLength(), image.GetData() + image.GetLength() - suffix, suffix);
+  Tuple tuple;
+  tuple.DeserializeFrom(storage.data());
+  return tuple;
+}
+
+}  // namespace
+
 /*
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool { return false; }
+auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record, size_t size) -> bool {
+  // the smallest record is a size, a type, a transaction id and an lsn of one byte each
+  if (size < 4) {
+    return false;
+  }
+  const char *pos = data;
+  uint64_t record_size;
+  pos += VarintUtil::Decode(pos, &record_size);
+  if (record_size < 4 || record_size > size) {
+    return false;
+  }
+  const char *end = data + record_size;
+  log_record->size_ = static_cast<int32_t>(record_size);
+  auto type = static_cast<uint8_t>(*pos++);
+  log_record->compensation_ = (type & LogRecord::COMPENSATION_FLAG) != 0;
+  log_record->log_record_type_ = static_cast<LogRecordType>(type & ~LogRecord::COMPENSATION_FLAG);
+  if (log_record->log_record_type_ == LogRecordType::INVALID ||
+      log_record->log_record_type_ > LogRecordType::INDEX_PAGE) {
+    return false;
+  }
+  ReadField(&pos, &log_record->txn_id_);
+  ReadField(&pos, &log_record->prev_lsn_);
+  if (log_record->compensation_) {
+    ReadField(&pos, &log_record->undo_next_lsn_);
+  }
+
+  bool complete = true;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      ReadRID(&pos, &log_record->insert_rid_);
+      complete = ReadTuple(&pos, end, &log_record->insert_tuple_);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      ReadRID(&pos, &log_record->delete_rid_);
+      complete = ReadTuple(&pos, end, &log_record->delete_tuple_);
+      break;
+    case LogRecordType::UPDATE:
+      ReadRID(&pos, &log_record->update_rid_);
+      ReadField(&pos, &log_record->update_prefix_);
+      ReadField(&pos, &log_record->update_suffix_);
+      complete = ReadTuple(&pos, end, &log_record->old_tuple_) && ReadTuple(&pos, end, &log_record->new_tuple_);
+      break;
+    case LogRecordType::NEWPAGE:
+      ReadField(&pos, &log_record->prev_page_id_);
+      ReadField(&pos, &log_record->page_id_);
+      break;
+    case LogRecordType::INDEX_INSERT:
+    case LogRecordType::INDEX_DELETE:
+      complete = ReadBytes(&pos, end, &log_record->index_name_);
+      if (complete) {
+        ReadRID(&pos, &log_record->index_rid_);
+        complete = ReadTuple(&pos, end, &log_record->index_key_);
+      }
+      break;
+    case LogRecordType::INDEX_PAGE:
+      ReadField(&pos, &log_record->more_);
+      complete = ReadPageDeltas(&pos, end, &log_record->page_deltas_);
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      size_t txn_count;
+      size_t page_count;
+      ReadField(&pos, &txn_count);
+      ReadField(&pos, &page_count);
+      if (txn_count + page_count > record_size) {
+        return false;
+      }
+      log_record->active_txns_.resize(txn_count);
+      for (auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        ReadField(&pos, &txn_id);
+        ReadField(&pos, &last_lsn);
+      }
+      log_record->dirty_pages_.resize(page_count);
+      for (auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        ReadField(&pos, &page_id);
+        ReadField(&pos, &rec_lsn);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return complete && pos == end;
+}
+
+auto LogRecovery::DecodeLogBlock(const char *data, size_t size, log_offset_t offset, char *records,
+                                 LogBlockHeader *header) -> const char * {
+  if (size < sizeof(LogBlockHeader)) {
+    return nullptr;
+  }
+  memcpy(header, data, sizeof(LogBlockHeader));
+  if (header->raw_size_ == 0 || header->raw_size_ > LOG_BUFFER_SIZE - sizeof(LogBlockHeader) ||
+      header->stored_size_ == 0 || header->stored_size_ > header->raw_size_ ||
+      sizeof(LogBlockHeader) + header->stored_size_ > size || header->offset_ != offset) {
+    return nullptr;
+  }
+  data += sizeof(LogBlockHeader);
+  if (header->stored_size_ == header->raw_size_) {
+    return data;
+  }
+  return CompressionUtil::Decompress(data, header->stored_size_, records, header->raw_size_) ? records : nullptr;
+}
+
+void LogRecovery::ScanLog(log_offset_t offset, const std::function<bool(LogRecord *, log_offset_t)> &visit) {
+  // a block torn by a crash at the end of the log is never parsed
+  log_offset_t log_size = disk_manager_->GetLogSize();
+  // every run of the log manager starts at a segment, the log goes on at the segment after the end of a run
+  while (offset < log_size) {
+    log_offset_t end = offset;
+    if (!ScanLogRun(offset, log_size, visit, &end)) {
+      return;
+    }
+    offset = (end / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+  }
+}
+
+auto LogRecovery::ScanLogRun(log_offset_t offset, log_offset_t log_size,
+                             const std::function<bool(LogRecord *, log_offset_t)> &visit, log_offset_t *end) -> bool {
+  // A chunk is read behind the tail of the chunk before it, which holds the start of a block cut off at the end of
+  // the chunk. The next chunk is read while this one is parsed. No block is longer than a log buffer.
+  std::array<std::vector<char>, 2> buffers;
+  for (auto &buffer : buffers) {
+    buffer.resize(LOG_BUFFER_SIZE + PREFETCH_SIZE);
+  }
+  std::vector<char> records(LOG_BUFFER_SIZE);
+  auto read_chunk = [this, &buffers](size_t index, log_offset_t chunk_offset) {
+    return disk_manager_->ReadLog(buffers[index].data() + LOG_BUFFER_SIZE, PREFETCH_SIZE, chunk_offset);
+  };
+
+  size_t current = 0;
+  size_t tail = 0;
+  log_offset_t chunk_offset = offset;
+  bool has_chunk = read_chunk(current, chunk_offset);
+  while (has_chunk) {
+    auto next_chunk = std::async(std::launch::async, read_chunk, 1 - current, chunk_offset + PREFETCH_SIZE);
+    const char *data = buffers[current].data() + LOG_BUFFER_SIZE - tail;
+    size_t size = tail + static_cast<size_t>(std::min<log_offset_t>(PREFETCH_SIZE, log_size - chunk_offset));
+    size_t pos = 0;
+    bool stopped = false;
+    while (!stopped) {
+      LogBlockHeader header;
+      log_offset_t block_offset = chunk_offset - static_cast<log_offset_t>(tail) + static_cast<log_offset_t>(pos);
+      const char *block = DecodeLogBlock(data + pos, size - pos, block_offset, records.data(), &header);
+      if (block == nullptr) {
+        break;
+      }
+      size_t record_pos = 0;
+      for (lsn_t lsn = header.base_lsn_; !stopped && record_pos < header.raw_size_; lsn++) {
+        LogRecord log_record;
+        if (!DeserializeLogRecord(block + record_pos, &log_record, header.raw_size_ - record_pos)) {
+          // a corrupt block ends the log
+          stopped = true;
+          break;
+        }
+        log_record.lsn_ = lsn;
+        stopped = !visit(&log_record, block_offset);
+        record_pos += log_record.size_;
+      }
+      pos += sizeof(LogBlockHeader) + header.stored_size_;
+    }
+    has_chunk = next_chunk.get();
+    *end = chunk_offset - static_cast<log_offset_t>(tail) + static_cast<log_offset_t>(pos);
+    tail = size - pos;
+    if (stopped || tail >= LOG_BUFFER_SIZE) {
+      // no block is that long, this is the end of the run
+      return !stopped;
+    }
+    memcpy(buffers[1 - current].data() + LOG_BUFFER_SIZE - tail, data + pos, tail);
+    chunk_offset += PREFETCH_SIZE;
+    current = 1 - current;
+  }
+  return true;
+}
+
+auto LogRecovery::PageOf(LogRecord *log_record) -> page_id_t {
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      return log_record->insert_rid_.GetPageId();
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return log_record->delete_rid_.GetPageId();
+    case LogRecordType::UPDATE:
+      return log_record->update_rid_.GetPageId();
+    case LogRecordType::NEWPAGE:
+      return log_record->page_id_;
+    default:
+      return INVALID_PAGE_ID;
+  }
+}
+
+/*
+ * analysis phase: rebuild the active transaction table and the dirty page table, starting at the last checkpoint
+ */
+auto LogRecovery::Analyze() -> lsn_t {
+  active_txn_.clear();
+  dirty_pages_.clear();
+  lsn_mapping_.clear();
+  mapped_all_ = false;
+  has_master_ = disk_manager_->ReadMasterRecord(reinterpret_cast<char *>(&master_), sizeof(master_));
+  lsn_t checkpoint_lsn = has_master_ ? master_.checkpoint_lsn_ : INVALID_LSN;
+
+  // transactions that finished after the checkpoint began, the checkpoint may still have seen them running
+  std::unordered_set<txn_id_t> finished;
+  // the groups of index page records whose last record was not seen yet, by their latest record
+  struct Group {
+    lsn_t prev_lsn_;
+    std::vector<lsn_t> lsns_;
+  };
+  std::unordered_map<lsn_t, Group> open_groups;
+  next_lsn_ = has_master_ ? master_.checkpoint_lsn_ + 1 : 0;
+  ScanLog(has_master_ ? master_.checkpoint_offset_ : 0, [&](LogRecord *log_record, log_offset_t offset) {
+    lsn_mapping_[log_record->lsn_] = offset;
+    next_lsn_ = std::max(next_lsn_, log_record->lsn_ + 1);
+    if (log_record->log_record_type_ == LogRecordType::INDEX_PAGE &&
+        (log_record->more_ || log_record->prev_lsn_ != INVALID_LSN)) {
+      Group group{log_record->prev_lsn_, {}};
+      if (auto it = open_groups.find(log_record->prev_lsn_); it != open_groups.end()) {
+        group = std::move(it->second);
+        open_groups.erase(it);
+      }
+      group.lsns_.push_back(log_record->lsn_);
+      if (log_record->more_) {
+        open_groups.emplace(log_record->lsn_, std::move(group));
+      }
+    }
+    if (log_record->lsn_ < checkpoint_lsn) {
+      return true;
+    }
+    switch (log_record->log_record_type_) {
+      case LogRecordType::BEGIN_CHECKPOINT:
+        break;
+      case LogRecordType::END_CHECKPOINT:
+        if (log_record->prev_lsn_ != checkpoint_lsn) {
+          break;
+        }
+        for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+          if (finished.count(txn_id) == 0) {
+            auto [it, inserted] = active_txn_.emplace(txn_id, last_lsn);
+            it->second = std::max(it->second, last_lsn);
+          }
+        }
+        for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+          auto [it, inserted] = dirty_pages_.emplace(page_id, rec_lsn);
+          it->second = std::min(it->second, rec_lsn);
+        }
+        break;
+      case LogRecordType::COMMIT:
+      case LogRecordType::ABORT:
+        active_txn_.erase(log_record->txn_id_);
+        finished.insert(log_record->txn_id_);
+        break;
+      case LogRecordType::INDEX_PAGE:
+        for (const auto &page_delta : log_record->page_deltas_) {
+          dirty_pages_.emplace(page_delta.page_id_, log_record->lsn_);
+        }
+        break;
+      default:
+        // records without a transaction, like the deletes of garbage collection, are redone but never undone
+        if (log_record->txn_id_ != INVALID_TXN_ID) {
+          active_txn_[log_record->txn_id_] = log_record->lsn_;
+        }
+        if (page_id_t page_id = PageOf(log_record); page_id != INVALID_PAGE_ID) {
+          dirty_pages_.emplace(page_id, log_record->lsn_);
+        }
+        if (log_record->log_record_type_ == LogRecordType::NEWPAGE && log_record->prev_page_id_ != INVALID_PAGE_ID) {
+          dirty_pages_.emplace(log_record->prev_page_id_, log_record->lsn_);
+        }
+        break;
+    }
+    return true;
+  });
+
+  // the log ends within these groups, their records before the analysis are found through the prev lsns
+  torn_lsns_.clear();
+  for (auto &[last_lsn, group] : open_groups) {
+    torn_lsns_.insert(group.lsns_.begin(), group.lsns_.end());
+    LogRecord log_record;
+    for (lsn_t lsn = group.prev_lsn_; lsn != INVALID_LSN && ReadLogRecord(lsn, &log_record);
+         lsn = log_record.prev_lsn_) {
+      torn_lsns_.insert(lsn);
+    }
+  }
+
+  redo_lsn_ = INVALID_LSN;
+  for (const auto &[page_id, rec_lsn] : dirty_pages_) {
+    if (redo_lsn_ == INVALID_LSN || rec_lsn < redo_lsn_) {
+      redo_lsn_ = rec_lsn;
+    }
+  }
+  analyzed_ = true;
+  return redo_lsn_;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
- *read log file from the beginning to end (you must prefetch log records into
- *log buffer to reduce unnecessary I/O operations), remember to compare page's
- *LSN with log_record's sequence number, and also build active_txn_ table &
- *lsn_mapping_ table
+ *read the log from the oldest recLSN of the dirty page table on, a record is applied if its page is dirty since
+ *before the record and the page LSN is older than the record; the records are applied by workers partitioned by
+ *page id
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  BUSTUB_ASSERT(!enable_logging, "recovery runs before logging is enabled");
+  if (!analyzed_) {
+    Analyze();
+  }
+  if (redo_lsn_ == INVALID_LSN) {
+    return;
+  }
+
+  // every page belongs to one worker, which applies its records in log order
+  struct RedoWorker {
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::deque<std::vector<std::pair<LogRecord, page_id_t>>> batches_;
+    bool done_{false};
+  };
+  std::vector<RedoWorker> workers(num_threads_);
+  std::vector<std::vector<std::pair<LogRecord, page_id_t>>> batches(num_threads_);
+  std::vector<std::thread> threads;
+  std::mutex error_latch;
+  std::exception_ptr error;
+  for (size_t index = 0; index < num_threads_; index++) {
+    threads.emplace_back([&, index] {
+      RedoWorker &worker = workers[index];
+      while (true) {
+        std::unique_lock latch(worker.latch_);
+        worker.cv_.wait(latch, [&] { return worker.done_ || !worker.batches_.empty(); });
+        if (worker.batches_.empty()) {
+          return;
+        }
+        auto batch = std::move(worker.batches_.front());
+        worker.batches_.pop_front();
+        latch.unlock();
+        try {
+          for (auto &[log_record, page_id] : batch) {
+            RedoLogRecord(&log_record, page_id);
+          }
+        } catch (...) {
+          std::scoped_lock error_lock(error_latch);
+          error = std::current_exception();
+        }
+      }
+    });
+  }
+  auto hand_over = [&](size_t index) {
+    {
+      std::scoped_lock latch(workers[index].latch_);
+      workers[index].batches_.push_back(std::move(batches[index]));
+    }
+    workers[index].cv_.notify_one();
+    batches[index].clear();
+  };
+  auto dispatch = [&](const LogRecord &log_record, page_id_t page_id) {
+    auto dirty = dirty_pages_.find(page_id);
+    if (dirty == dirty_pages_.end() || log_record.lsn_ < dirty->second) {
+      return;
+    }
+    size_t index = std::hash<page_id_t>()(page_id) % num_threads_;
+    batches[index].emplace_back(log_record, page_id);
+    if (batches[index].size() == REDO_BATCH_SIZE) {
+      hand_over(index);
+    }
+  };
+
+  // the redo point is mapped if it is after the checkpoint, the master record locates it otherwise
+  auto it = lsn_mapping_.find(redo_lsn_);
+  log_offset_t offset = it != lsn_mapping_.end() ? it->second : has_master_ ? master_.redo_offset_ : 0;
+  ScanLog(offset, [&](LogRecord *log_record, log_offset_t record_offset) {
+    lsn_mapping_.emplace(log_record->lsn_, record_offset);
+    if (active_txn_.count(log_record->txn_id_) > 0) {
+      undo_records_.emplace(log_record->lsn_, *log_record);
+    }
+    if (log_record->lsn_ >= redo_lsn_) {
+      if (page_id_t page_id = PageOf(log_record); page_id != INVALID_PAGE_ID) {
+        dispatch(*log_record, page_id);
+      }
+      if (log_record->log_record_type_ == LogRecordType::NEWPAGE && log_record->prev_page_id_ != INVALID_PAGE_ID) {
+        dispatch(*log_record, log_record->prev_page_id_);
+      }
+      if (log_record->log_record_type_ == LogRecordType::INDEX_PAGE && torn_lsns_.count(log_record->lsn_) == 0) {
+        // every page gets a record with only its own bytes
+        for (auto &page_delta : log_record->page_deltas_) {
+          page_id_t page_id = page_delta.page_id_;
+          LogRecord page_record(INVALID_LSN, false, {std::move(page_delta)});
+          page_record.lsn_ = log_record->lsn_;
+          dispatch(page_record, page_id);
+        }
+      }
+    }
+    return true;
+  });
+
+  for (size_t index = 0; index < num_threads_; index++) {
+    if (!batches[index].empty()) {
+      hand_over(index);
+    }
+    {
+      std::scoped_lock latch(workers[index].latch_);
+      workers[index].done_ = true;
+    }
+    workers[index].cv_.notify_one();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void LogRecovery::RedoLogRecord(LogRecord *log_record, page_id_t page_id) {
+  auto *page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no frame for a page to redo");
+  }
+  page->WLatch();
+  bool applied = false;
+  if (log_record->log_record_type_ == LogRecordType::INDEX_PAGE) {
+    // the bytes are the ones after the change, applying them to a page that carries the record already is harmless
+    applied = page->GetLSN() <= log_record->lsn_;
+    if (applied) {
+      for (const auto &page_delta : log_record->page_deltas_) {
+        if (page_delta.new_page_) {
+          memset(page->GetData(), 0, BUSTUB_PAGE_SIZE);
+        }
+        for (const auto &[offset, bytes] : page_delta.runs_) {
+          memcpy(page->GetData() + offset, bytes.data(), bytes.size());
+        }
+      }
+      page->SetLSN(log_record->lsn_);
+    }
+  } else if (page_id != PageOf(log_record)) {
+    // the table heap links the new page to its predecessor, which is idempotent
+    applied = page->GetNextPageId() != log_record->page_id_;
+    if (applied) {
+      page->SetNextPageId(log_record->page_id_);
+    }
+  } else if (page->GetLSN() < log_record->lsn_ ||
+             (log_record->log_record_type_ == LogRecordType::NEWPAGE && page->GetTablePageId() != page_id)) {
+    // a page that never made it to disk reads as zeros, lsn 0 included
+    Tuple old_tuple;
+    switch (log_record->log_record_type_) {
+      case LogRecordType::INSERT: {
+        // repeating history puts the tuple into the slot it had, the indexes point there
+        [[maybe_unused]] bool inserted = page->InsertTupleAt(log_record->insert_tuple_, log_record->insert_rid_);
+        BUSTUB_ASSERT(inserted, "the logged slot of an insert is taken on redo");
+        break;
+      }
+      case LogRecordType::MARKDELETE:
+        page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+        break;
+      case LogRecordType::APPLYDELETE:
+        page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::ROLLBACKDELETE:
+        page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::UPDATE: {
+        Tuple image;
+        page->GetTuple(log_record->update_rid_, &image, nullptr, nullptr);
+        Tuple new_tuple = Patch(image, log_record->update_prefix_, log_record->update_suffix_, log_record->new_tuple_);
+        page->UpdateTuple(new_tuple, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+        break;
+      }
+      case LogRecordType::NEWPAGE:
+        page->Init(page_id, BUSTUB_PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+        break;
+      default:
+        break;
+    }
+    page->SetLSN(log_record->lsn_);
+    applied = true;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, applied);
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
- *iterate through active txn map and undo each operation
+ *roll back the transactions of the active transaction table in parallel, each from its latest change back
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  BUSTUB_ASSERT(!enable_logging, "recovery runs before logging is enabled");
+  if (!analyzed_) {
+    Analyze();
+  }
+  if (log_manager_ != nullptr && log_manager_->GetNextLSN() < next_lsn_) {
+    log_manager_->SetNextLSN(next_lsn_);
+  }
+  // the transactions are independent, they never wrote the same tuple; pages they share are latched
+  std::vector<lsn_t> last_lsns;
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    last_lsns.push_back(last_lsn);
+  }
+  std::atomic<size_t> next{0};
+  std::mutex error_latch;
+  std::exception_ptr error;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < std::min(num_threads_, last_lsns.size()); i++) {
+    threads.emplace_back([&] {
+      for (size_t index = next++; index < last_lsns.size(); index = next++) {
+        try {
+          UndoTransaction(last_lsns[index]);
+        } catch (...) {
+          std::scoped_lock error_lock(error_latch);
+          error = std::current_exception();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  active_txn_.clear();
+  undo_records_.clear();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void LogRecovery::UndoTransaction(lsn_t last_lsn) {
+  txn_id_t txn_id = INVALID_TXN_ID;
+  lsn_t prev_lsn = last_lsn;
+  for (lsn_t lsn = last_lsn; lsn != INVALID_LSN;) {
+    LogRecord log_record;
+    if (auto it = undo_records_.find(lsn); it != undo_records_.end()) {
+      log_record = it->second;
+    } else {
+      std::scoped_lock latch(read_latch_);
+      if (!ReadLogRecord(lsn, &log_record)) {
+        return;
+      }
+    }
+    // a transaction the checkpoint saw between writing its commit record and finishing
+    if (log_record.log_record_type_ == LogRecordType::COMMIT || log_record.log_record_type_ == LogRecordType::ABORT) {
+      return;
+    }
+    txn_id = log_record.txn_id_;
+    if (log_record.compensation_) {
+      // the rollback before the crash undid the records up to here
+      lsn = log_record.undo_next_lsn_;
+      continue;
+    }
+    UndoLogRecord(&log_record, &prev_lsn);
+    lsn = log_record.prev_lsn_;
+  }
+  if (log_manager_ != nullptr && txn_id != INVALID_TXN_ID) {
+    LogRecord abort_record(txn_id, prev_lsn, LogRecordType::ABORT);
+    log_manager_->AppendLogRecord(&abort_record);
+  }
+}
+
+auto LogRecovery::ReadLogRecord(lsn_t lsn, LogRecord *log_record) -> bool {
+  auto it = lsn_mapping_.find(lsn);
+  if (it == lsn_mapping_.end() && !mapped_all_) {
+    // a transaction older than the scans, map the log from its start up to the records that are mapped already
+    ScanLog(has_master_ ? master_.log_start_offset_ : 0,
+            [&](LogRecord *record, log_offset_t offset) { return lsn_mapping_.emplace(record->lsn_, offset).second; });
+    mapped_all_ = true;
+    it = lsn_mapping_.find(lsn);
+  }
+  if (it == lsn_mapping_.end()) {
+    return false;
+  }
+  LogBlockHeader header;
+  const char *block = nullptr;
+  if (disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, it->second)) {
+    block = DecodeLogBlock(log_buffer_, LOG_BUFFER_SIZE, it->second, block_buffer_, &header);
+  }
+  if (block == nullptr || lsn < header.base_lsn_) {
+    return false;
+  }
+  // skip the records before lsn in the block
+  size_t pos = 0;
+  for (lsn_t record_lsn = header.base_lsn_; record_lsn < lsn && pos < header.raw_size_; record_lsn++) {
+    uint64_t record_size;
+    VarintUtil::Decode(block + pos, &record_size);
+    pos += record_size;
+  }
+  if (pos >= header.raw_size_ || !DeserializeLogRecord(block + pos, log_record, header.raw_size_ - pos)) {
+    return false;
+  }
+  log_record->lsn_ = lsn;
+  return true;
+}
+
+void LogRecovery::UndoLogRecord(LogRecord *log_record, lsn_t *last_lsn) {
+  txn_id_t txn_id = log_record->txn_id_;
+  if (log_record->log_record_type_ == LogRecordType::INDEX_INSERT ||
+      log_record->log_record_type_ == LogRecordType::INDEX_DELETE) {
+    // the tree may have split or merged since, the key is rolled back wherever it is now
+    auto it = indexes_.find(log_record->index_name_);
+    if (it == indexes_.end()) {
+      return;
+    }
+    bool inserted = log_record->log_record_type_ == LogRecordType::INDEX_INSERT;
+    if (log_manager_ != nullptr) {
+      LogRecord compensation(txn_id, *last_lsn, inserted ? LogRecordType::INDEX_DELETE : LogRecordType::INDEX_INSERT,
+                             log_record->index_name_, log_record->index_rid_, log_record->index_key_);
+      compensation.SetUndoNext(log_record->prev_lsn_);
+      *last_lsn = log_manager_->AppendLogRecord(&compensation);
+    }
+    if (inserted) {
+      it->second->DeleteEntry(log_record->index_key_, log_record->index_rid_, nullptr);
+    } else {
+      it->second->InsertEntry(log_record->index_key_, log_record->index_rid_, nullptr);
+    }
+    return;
+  }
+  page_id_t page_id = PageOf(log_record);
+  if (page_id == INVALID_PAGE_ID || log_record->log_record_type_ == LogRecordType::NEWPAGE) {
+    return;
+  }
+  auto *page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no frame for a page to undo");
+  }
+  page->WLatch();
+  Tuple new_tuple;
+  // the change that undoes the record, which redo applies like any other
+  LogRecord compensation;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      compensation = LogRecord(txn_id, *last_lsn, LogRecordType::APPLYDELETE, log_record->insert_rid_,
+                               log_record->insert_tuple_);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      compensation = LogRecord(txn_id, *last_lsn, LogRecordType::ROLLBACKDELETE, log_record->delete_rid_,
+                               log_record->delete_tuple_);
+      break;
+    case LogRecordType::APPLYDELETE: {
+      // the tuple goes back to its own slot, undoing an earlier mark delete of the transaction expects it there
+      [[maybe_unused]] bool inserted = page->InsertTupleAt(log_record->delete_tuple_, log_record->delete_rid_);
+      BUSTUB_ASSERT(inserted, "the slot of a deleted tuple is taken on undo");
+      compensation = LogRecord(txn_id, *last_lsn, LogRecordType::INSERT, log_record->delete_rid_,
+                               log_record->delete_tuple_);
+      break;
+    }
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      compensation =
+          LogRecord(txn_id, *last_lsn, LogRecordType::MARKDELETE, log_record->delete_rid_, log_record->delete_tuple_);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple image;
+      page->GetTuple(log_record->update_rid_, &image, nullptr, nullptr);
+      Tuple old_tuple = Patch(image, log_record->update_prefix_, log_record->update_suffix_, log_record->old_tuple_);
+      page->UpdateTuple(old_tuple, &new_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      compensation = LogRecord(txn_id, *last_lsn, LogRecordType::UPDATE, log_record->update_rid_, new_tuple, old_tuple);
+      break;
+    }
+    default:
+      break;
+  }
+  if (log_manager_ != nullptr && compensation.log_record_type_ != LogRecordType::INVALID) {
+    compensation.SetUndoNext(log_record->prev_lsn_);
+    *last_lsn = log_manager_->AppendLogRecord(&compensation);
+    page->SetLSN(*last_lsn);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 }  // namespace bustub
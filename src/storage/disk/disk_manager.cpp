@@ -10,13 +10,19 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <iostream>
 #include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
@@ -26,6 +32,39 @@ namespace bustub {
 
 static char *buffer_used;
 
+namespace {
+
+auto LogDirectory(const std::string &log_name) -> std::string {
+  std::string::size_type n = log_name.rfind('/');
+  return n == std::string::npos ? "." : log_name.substr(0, n + 1);
+}
+
+/** @return the suffixes of the files named <log_name>.<suffix>, the log segments and spares */
+auto ListLogFiles(const std::string &log_name) -> std::vector<std::string> {
+  std::string::size_type n = log_name.rfind('/');
+  std::string prefix = (n == std::string::npos ? log_name : log_name.substr(n + 1)) + ".";
+  std::vector<std::string> suffixes;
+  DIR *dir = opendir(LogDirectory(log_name).c_str());
+  if (dir == nullptr) {
+    return suffixes;
+  }
+  for (dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0) {
+      suffixes.push_back(name.substr(prefix.size()));
+    }
+  }
+  closedir(dir);
+  return suffixes;
+}
+
+auto IsSegmentNumber(const std::string &suffix) -> bool {
+  return !suffix.empty() && suffix.size() < 10 &&
+         std::all_of(suffix.begin(), suffix.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+}  // namespace
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
@@ -37,17 +76,25 @@ DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  master_name_ = file_name_.substr(0, n) + ".master";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::out | std::ios::in);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
+  // segments are opened when they are first read or written, a log left by an earlier run is continued at the segment
+  // after its last one
+  int last_segment = -1;
+  first_log_segment_ = INT_MAX;
+  for (const auto &suffix : ListLogFiles(log_name_)) {
+    if (IsSegmentNumber(suffix)) {
+      int segment = std::stoi(suffix);
+      first_log_segment_ = std::min(first_log_segment_, segment);
+      last_segment = std::max(last_segment, segment);
+    } else if (suffix.compare(0, 6, "spare.") == 0) {
+      spare_log_segments_.push_back(log_name_ + "." + suffix);
     }
   }
+  if (last_segment < 0) {
+    first_log_segment_ = 0;
+  }
+  log_size_ = static_cast<log_offset_t>(last_segment + 1) * LOG_SEGMENT_SIZE;
 
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
   db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
@@ -63,6 +110,8 @@ DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
   buffer_used = nullptr;
 }
 
+DiskManager::~DiskManager() { CloseLogSegments(); }
+
 /**
  * Close all file streams
  */
@@ -71,7 +120,7 @@ void DiskManager::ShutDown() {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
   }
-  log_io_.close();
+  CloseLogSegments();
 }
 
 /**
@@ -125,6 +174,8 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
+ * The end of the log moves past the data only once it is synced, a failed write throws and is retried at the same
+ * offset
  */
 void DiskManager::WriteLog(char *log_data, int size) {
   // enforce swap log buffer
@@ -142,46 +193,126 @@ void DiskManager::WriteLog(char *log_data, int size) {
     assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
   }
 
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  // sequence write, split at the ends of segments
+  log_offset_t offset = log_size_;
+  std::vector<int> written_fds;
+  bool failed = false;
+  for (int written = 0; written < size && !failed;) {
+    auto segment_offset = static_cast<int>((offset + written) % LOG_SEGMENT_SIZE);
+    int length = std::min(size - written, LOG_SEGMENT_SIZE - segment_offset);
+    int fd = OpenLogSegment(static_cast<int>((offset + written) / LOG_SEGMENT_SIZE), true);
+    // check for I/O error
+    failed = fd < 0 || pwrite(fd, log_data + written, length, segment_offset) != length;
+    if (!failed && (written_fds.empty() || written_fds.back() != fd)) {
+      written_fds.push_back(fd);
+    }
+    written += length;
+  }
+  // the segments are preallocated, syncing the data does not have to sync their size
+  for (int fd : written_fds) {
+    failed = fdatasync(fd) != 0 || failed;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
+  if (failed) {
+    // the same buffer is written again by the retry
+    buffer_used = nullptr;
+    throw Exception("I/O error while writing log");
+  }
+  log_size_ += size;
 }
 
 /**
  * Read the contents of the log into the given memory area
- * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
  */
-auto DiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+auto DiskManager::ReadLog(char *log_data, int size, log_offset_t offset) -> bool {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  if (offset >= log_size_ || offset < static_cast<log_offset_t>(first_log_segment_) * LOG_SEGMENT_SIZE) {
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  for (int read_count = 0; read_count < size;) {
+    log_offset_t position = offset + read_count;
+    auto segment_offset = static_cast<int>(position % LOG_SEGMENT_SIZE);
+    int length = std::min(size - read_count, LOG_SEGMENT_SIZE - segment_offset);
+    // the rest of a segment past the end of the log is preallocated or holds a recycled segment, it reads as zeros
+    auto file_length = static_cast<int>(std::clamp<log_offset_t>(log_size_ - position, 0, length));
+    int fd = file_length > 0 ? OpenLogSegment(static_cast<int>(position / LOG_SEGMENT_SIZE), false) : -1;
+    int segment_count = fd >= 0 ? static_cast<int>(pread(fd, log_data + read_count, file_length, segment_offset)) : 0;
+    if (segment_count < 0) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    memset(log_data + read_count + segment_count, 0, length - segment_count);
+    read_count += length;
+  }
+  return true;
+}
 
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
+auto DiskManager::GetLogSize() -> log_offset_t {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  return log_size_;
+}
+
+void DiskManager::RecycleLog(log_offset_t offset) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  auto end_segment = static_cast<int>(std::min(offset, log_size_) / LOG_SEGMENT_SIZE);
+  if (end_segment <= first_log_segment_) {
+    return;
+  }
+  for (int segment = first_log_segment_; segment < end_segment; segment++) {
+    auto it = log_segment_fds_.find(segment);
+    if (it != log_segment_fds_.end()) {
+      close(it->second);
+      log_segment_fds_.erase(it);
+    }
+    std::string name = LogSegmentName(segment);
+    std::string spare_name = log_name_ + ".spare." + std::to_string(segment);
+    if (spare_log_segments_.size() < MAX_SPARE_LOG_SEGMENTS && rename(name.c_str(), spare_name.c_str()) == 0) {
+      spare_log_segments_.push_back(spare_name);
+    } else {
+      unlink(name.c_str());
+    }
+  }
+  first_log_segment_ = end_segment;
+  SyncLogDirectory();
+}
+
+void DiskManager::RemoveLogFiles(const std::string &db_file) {
+  std::string::size_type n = db_file.rfind('.');
+  if (n == std::string::npos) {
+    return;
+  }
+  std::string log_name = db_file.substr(0, n) + ".log";
+  for (const auto &suffix : ListLogFiles(log_name)) {
+    unlink((log_name + "." + suffix).c_str());
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+  unlink(log_name.c_str());
+  unlink((db_file.substr(0, n) + ".master").c_str());
+}
+
+void DiskManager::WriteMasterRecord(const char *data, int size) {
+  std::string tmp_name = master_name_ + ".tmp";
+  int fd = open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw Exception("can't open master record file");
   }
+  bool written = write(fd, data, size) == size && fsync(fd) == 0;
+  close(fd);
+  if (!written || rename(tmp_name.c_str(), master_name_.c_str()) != 0) {
+    throw Exception("I/O error while writing master record");
+  }
+}
 
-  return true;
+auto DiskManager::ReadMasterRecord(char *data, int size) -> bool {
+  int fd = open(master_name_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool read_all = read(fd, data, size) == size;
+  close(fd);
+  return read_all;
 }
 
 /**
@@ -199,6 +330,60 @@ auto DiskManager::GetNumWrites() const -> int { return num_writes_; }
  */
 auto DiskManager::GetFlushState() const -> bool { return flush_log_; }
 
+auto DiskManager::LogSegmentName(int segment) const -> std::string {
+  return log_name_ + "." + std::to_string(segment);
+}
+
+auto DiskManager::OpenLogSegment(int segment, bool create) -> int {
+  auto it = log_segment_fds_.find(segment);
+  if (it != log_segment_fds_.end()) {
+    return it->second;
+  }
+  if (log_name_.empty()) {
+    return -1;
+  }
+  std::string name = LogSegmentName(segment);
+  int fd = open(name.c_str(), O_RDWR);
+  if (fd < 0) {
+    if (!create) {
+      return -1;
+    }
+    // a spare already has its blocks, a new segment allocates them all at once
+    if (!spare_log_segments_.empty()) {
+      if (rename(spare_log_segments_.back().c_str(), name.c_str()) == 0) {
+        fd = open(name.c_str(), O_RDWR);
+      }
+      spare_log_segments_.pop_back();
+    }
+    if (fd < 0) {
+      fd = open(name.c_str(), O_RDWR | O_CREAT, 0644);
+      if (fd < 0) {
+        return -1;
+      }
+      posix_fallocate(fd, 0, LOG_SEGMENT_SIZE);
+    }
+    SyncLogDirectory();
+  }
+  log_segment_fds_.emplace(segment, fd);
+  return fd;
+}
+
+void DiskManager::CloseLogSegments() {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  for (const auto &[segment, fd] : log_segment_fds_) {
+    close(fd);
+  }
+  log_segment_fds_.clear();
+}
+
+void DiskManager::SyncLogDirectory() {
+  int fd = open(LogDirectory(log_name_).c_str(), O_RDONLY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+}
+
 /**
  * Private helper function to get disk file size
  */
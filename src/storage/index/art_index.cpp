@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_index.cpp
+//
+// Identification: src/storage/index/art_index.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/art_index.h"
+
+#include <cstring>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+namespace {
+
+// append the low size bytes of bits most significant first, so that bytewise order is numeric order
+void AppendBigEndian(std::string *out, uint64_t bits, size_t size) {
+  for (size_t i = size; i > 0; i--) {
+    out->push_back(static_cast<char>((bits >> ((i - 1) * 8)) & 0xFF));
+  }
+}
+
+// flipping the sign bit orders negative integers before positive ones
+template <typename T>
+void AppendSigned(std::string *out, T value) {
+  constexpr size_t size = sizeof(T);
+  auto bits = static_cast<uint64_t>(static_cast<int64_t>(value)) ^ (uint64_t{1} << (size * 8 - 1));
+  AppendBigEndian(out, bits, size);
+}
+
+void AppendValue(std::string *out, const Value &value) {
+  // nulls sort first, the flag also keeps a null apart from a value that encodes to the same bytes
+  if (value.IsNull()) {
+    out->push_back(0);
+    return;
+  }
+  out->push_back(1);
+  switch (value.GetTypeId()) {
+    case TypeId::BOOLEAN:
+      out->push_back(static_cast<char>(value.GetAs<int8_t>()));
+      return;
+    case TypeId::TINYINT:
+      AppendSigned(out, value.GetAs<int8_t>());
+      return;
+    case TypeId::SMALLINT:
+      AppendSigned(out, value.GetAs<int16_t>());
+      return;
+    case TypeId::INTEGER:
+      AppendSigned(out, value.GetAs<int32_t>());
+      return;
+    case TypeId::BIGINT:
+      AppendSigned(out, value.GetAs<int64_t>());
+      return;
+    case TypeId::TIMESTAMP:
+      AppendBigEndian(out, value.GetAs<uint64_t>(), sizeof(uint64_t));
+      return;
+    case TypeId::DECIMAL: {
+      // positive doubles order like their bits once the sign bit is set, negative ones with all bits flipped
+      auto decimal = value.GetAs<double>();
+      uint64_t bits;
+      memcpy(&bits, &decimal, sizeof(bits));
+      bits = (bits >> 63) != 0 ? ~bits : bits | (uint64_t{1} << 63);
+      AppendBigEndian(out, bits, sizeof(bits));
+      return;
+    }
+    case TypeId::VARCHAR: {
+      // a zero byte is escaped as 0x00 0xFF and the string ends with 0x00 0x00, so no encoding is a prefix of another
+      for (char c : value.ToString()) {
+        out->push_back(c);
+        if (c == 0) {
+          out->push_back(static_cast<char>(0xFF));
+        }
+      }
+      out->push_back(0);
+      out->push_back(0);
+      return;
+    }
+    default:
+      throw NotImplementedException("unsupported key type for ART index");
+  }
+}
+
+}  // namespace
+
+/*
+ * Constructor
+ */
+ARTIndex::ARTIndex(std::unique_ptr<IndexMetadata> &&metadata) : Index(std::move(metadata)) {}
+
+void ARTIndex::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  container_.Insert(EntryKey(key, rid), rid);
+}
+
+void ARTIndex::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  if (GetMetadata()->IsUnique()) {
+    // only remove the entry if it still belongs to the record
+    RID current;
+    if (!container_.Get(EncodeKey(key), &current) || !(current == rid)) {
+      return;
+    }
+  }
+  container_.Remove(EntryKey(key, rid));
+}
+
+void ARTIndex::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  if (GetMetadata()->IsUnique()) {
+    RID rid;
+    if (container_.Get(EncodeKey(key), &rid)) {
+      result->push_back(rid);
+    }
+    return;
+  }
+  container_.ScanPrefix(EncodeKey(key), result);
+}
+
+auto ARTIndex::EncodeKey(const Tuple &key) const -> std::string {
+  std::string encoded;
+  const Schema *key_schema = GetKeySchema();
+  for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+    AppendValue(&encoded, key.GetValue(key_schema, i));
+  }
+  return encoded;
+}
+
+auto ARTIndex::EntryKey(const Tuple &key, RID rid) const -> std::string {
+  std::string encoded = EncodeKey(key);
+  if (!GetMetadata()->IsUnique()) {
+    AppendBigEndian(&encoded, static_cast<uint64_t>(rid.Get()), sizeof(uint64_t));
+  }
+  return encoded;
+}
+
+}  // namespace bustub
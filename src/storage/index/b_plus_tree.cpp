@@ -1,38 +1,278 @@
+#include <algorithm>
 #include <string>
 
 #include "common/exception.h"
 #include "common/logger.h"
 #include "common/rid.h"
+#include "common/util/varint_util.h"
 #include "storage/index/b_plus_tree.h"
 #include "storage/page/header_page.h"
 
 namespace bustub {
+namespace {
+// posting lists are kept in the order of the 64-bit representation of the record id
+inline auto ValueLess(const RID &lhs, const RID &rhs) -> bool {
+  return static_cast<uint64_t>(lhs.Get()) < static_cast<uint64_t>(rhs.Get());
+}
+}  // namespace
+
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, bool unique_keys, LogManager *log_manager)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
-      buffer_pool_manager_(buffer_pool_manager),
+      logger_(log_manager != nullptr ? std::make_unique<IndexPageLogger>(buffer_pool_manager, log_manager) : nullptr),
+      buffer_pool_manager_(logger_ != nullptr ? logger_.get() : buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      internal_max_size_(internal_max_size),
+      unique_keys_(unique_keys) {}
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::IsEmpty() const -> bool { return true; }
+auto BPLUSTREE_TYPE::IsEmpty() const -> bool { return root_page_id_ == INVALID_PAGE_ID; }
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 /*
- * Return the only value that associated with input key
+ * Return all values that associated with input key, the whole posting list is
+ * read during a single visit of the leaf page
  * This method is used for point query
  * @return : true means key exists
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) -> bool {
-  return false;
+  Page *page = FindLeafRead(key, LeafPosition::KEY);
+  if (page == nullptr) {
+    return false;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key, comparator_);
+  bool found = index < leaf->GetSize() && comparator_(leaf->KeyAt(index), key) == 0;
+  if (found) {
+    page_id_t overflow_page_id = leaf->OverflowPageIdAt(index);
+    if (overflow_page_id == INVALID_PAGE_ID) {
+      leaf->ValuesAt(index, result);
+    } else {
+      BPlusTreeOverflowPage::ReadChain(buffer_pool_manager_, overflow_page_id, result);
+    }
+  }
+  page_id_t page_id = leaf->GetPageId();
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return found;
+}
+
+/*
+ * Descend to the leaf page that contains key (or the leftmost or rightmost
+ * leaf) with read latch crabbing
+ * @return : the read latched and pinned leaf page, nullptr if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafRead(const KeyType &key, LeafPosition position) -> Page * {
+  root_latch_.RLock();
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return nullptr;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  page->RLatch();
+  root_latch_.RUnlock();
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  while (!node->IsLeafPage()) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    page_id_t child_page_id;
+    if (position == LeafPosition::LEFTMOST) {
+      child_page_id = internal->ValueAt(0);
+    } else if (position == LeafPosition::RIGHTMOST) {
+      child_page_id = internal->ValueAt(internal->GetSize() - 1);
+    } else {
+      child_page_id = internal->Lookup(key, comparator_);
+    }
+    Page *child = buffer_pool_manager_->FetchPage(child_page_id);
+    child->RLatch();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
+    page = child;
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  }
+  return page;
+}
+
+/*
+ * Optimistically descend with read latches and only write latch the leaf. The
+ * parent stays read latched while the leaf latch is upgraded, so the leaf can
+ * neither split nor merge in between.
+ * @return : the write latched and pinned leaf page, nullptr if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafOptimistic(const KeyType &key) -> Page * {
+  root_latch_.RLock();
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return nullptr;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  page->RLatch();
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (node->IsLeafPage()) {
+    page->RUnlatch();
+    WLatch(page);
+    root_latch_.RUnlock();
+    return page;
+  }
+  root_latch_.RUnlock();
+  while (true) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    Page *child = buffer_pool_manager_->FetchPage(internal->Lookup(key, comparator_));
+    child->RLatch();
+    auto *child_node = reinterpret_cast<BPlusTreePage *>(child->GetData());
+    if (child_node->IsLeafPage()) {
+      child->RUnlatch();
+      WLatch(child);
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
+    page = child;
+    node = child_node;
+    if (node->IsLeafPage()) {
+      return page;
+    }
+  }
+}
+
+/*
+ * Descend to the leaf page that contains key with write latch crabbing. The
+ * caller must hold the root latch in write mode. Latches of ancestors are
+ * released as soon as a page is safe for the operation.
+ * @return : the write latched and pinned leaf page, which is also the last page
+ * of the write set
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafWrite(const KeyType &key, Operation operation, WriteSet *write_set) -> Page * {
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  WLatch(page);
+  write_set->pages_.push_back(page);
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (IsSafe(node, operation)) {
+    ReleaseAncestors(write_set);
+  }
+  while (!node->IsLeafPage()) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    page = buffer_pool_manager_->FetchPage(internal->Lookup(key, comparator_));
+    WLatch(page);
+    write_set->pages_.push_back(page);
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (IsSafe(node, operation)) {
+      ReleaseAncestors(write_set);
+    }
+  }
+  return page;
+}
+
+/*
+ * A page is safe if the operation cannot split or merge it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation operation) -> bool {
+  if (operation == Operation::INSERT) {
+    if (node->IsLeafPage()) {
+      return reinterpret_cast<LeafPage *>(node)->IsInsertSafe();
+    }
+    return node->GetSize() < node->GetMaxSize();
+  }
+  if (operation == Operation::REMOVE) {
+    if (node->IsRootPage()) {
+      return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+    }
+    return node->GetSize() > node->GetMinSize();
+  }
+  return true;
+}
+
+/*
+ * Release the root latch and every page of the write set except the last one
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseAncestors(WriteSet *write_set) {
+  if (write_set->root_latched_) {
+    root_latch_.WUnlock();
+    write_set->root_latched_ = false;
+  }
+  while (write_set->pages_.size() > 1) {
+    Page *page = write_set->pages_.front();
+    write_set->pages_.pop_front();
+    auto page_id = reinterpret_cast<BPlusTreePage *>(page->GetData())->GetPageId();
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+}
+
+/*
+ * Log the changes of the operation and release every latch it holds, then drop
+ * the pages it emptied
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseWriteSet(WriteSet *write_set) {
+  EndOperation();
+  if (write_set->root_latched_) {
+    root_latch_.WUnlock();
+    write_set->root_latched_ = false;
+  }
+  for (Page *page : write_set->pages_) {
+    auto page_id = reinterpret_cast<BPlusTreePage *>(page->GetData())->GetPageId();
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, true);
+  }
+  write_set->pages_.clear();
+  for (page_id_t page_id : write_set->deleted_pages_) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  write_set->deleted_pages_.clear();
+}
+
+/*
+ * With logging, start tracking the pages an insert or remove changes. The
+ * changes are logged by EndOperation() while the pages are still latched.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BeginOperation() {
+  if (logger_ != nullptr) {
+    logger_->BeginOperation();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::EndOperation() {
+  if (logger_ != nullptr) {
+    logger_->EndOperation();
+  }
+}
+
+/*
+ * Write latch a page the operation fetched, with logging the image its changes
+ * are compared with is taken again now that no one else can change it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::WLatch(Page *page) {
+  page->WLatch();
+  if (logger_ != nullptr) {
+    logger_->Snapshot(page);
+  }
+}
+
+/*
+ * Release the write latch of a page before the operation ends, its changes are
+ * logged first so that the records of a page follow the order of its changes
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::WUnlatchEarly(Page *page) {
+  if (logger_ != nullptr) {
+    logger_->LogPage(page);
+  }
+  page->WUnlatch();
 }
 
 /*****************************************************************************
@@ -42,26 +282,584 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: false if the key-value pair already exists, or if the tree only
+ * supports unique keys and the key already exists, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
-  return false;
+  BeginOperation();
+  // most inserts do not split, try with only the leaf write latched first
+  Page *page = FindLeafOptimistic(key);
+  if (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    page_id_t page_id = leaf->GetPageId();
+    if (IsSafe(leaf, Operation::INSERT)) {
+      bool inserted = InsertIntoLeaf(leaf, key, value, false);
+      EndOperation();
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, inserted);
+      return inserted;
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+
+  WriteSet write_set;
+  root_latch_.WLock();
+  write_set.root_latched_ = true;
+  if (IsEmpty()) {
+    StartNewTree(key, value);
+    ReleaseWriteSet(&write_set);
+    return true;
+  }
+  page = FindLeafWrite(key, Operation::INSERT, &write_set);
+  bool inserted = InsertIntoLeaf(reinterpret_cast<LeafPage *>(page->GetData()), key, value, true);
+  ReleaseWriteSet(&write_set);
+  return inserted;
+}
+
+/*
+ * Create a leaf page as the new root holding the single key-value pair
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new page");
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+  leaf->InsertEntryAt(0, key, {value}, INVALID_PAGE_ID, 1);
+  root_page_id_ = page_id;
+  UpdateRootPageId(1);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+/*
+ * Insert the key-value pair into the write latched leaf. A new key gets its own
+ * entry, a value of an existing key is merged into the posting list of that
+ * key, which is moved to overflow pages once it grows too large for the leaf.
+ * When allow_split is set the leaf is split when it reaches max size or runs
+ * out of bytes; the caller must then hold the latches of all unsafe ancestors.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::InsertIntoLeaf(LeafPage *leaf, const KeyType &key, const ValueType &value, bool allow_split)
+    -> bool {
+  int index = leaf->KeyIndex(key, comparator_);
+  bool fits;
+  if (index < leaf->GetSize() && comparator_(leaf->KeyAt(index), key) == 0) {
+    if (unique_keys_) {
+      return false;
+    }
+    int count = leaf->ValueCountAt(index);
+    page_id_t overflow_page_id = leaf->OverflowPageIdAt(index);
+    if (overflow_page_id != INVALID_PAGE_ID) {
+      if (!InsertIntoOverflowChain(overflow_page_id, value)) {
+        return false;
+      }
+      // only the count of the entry changes, so it always fits
+      leaf->SetPostingAt(index, {}, overflow_page_id, count + 1);
+      return true;
+    }
+    std::vector<ValueType> values;
+    leaf->ValuesAt(index, &values);
+    auto it = std::lower_bound(values.begin(), values.end(), value, ValueLess);
+    if (it != values.end() && *it == value) {
+      return false;
+    }
+    values.insert(it, value);
+    if (LeafPage::PostingSize(values) > static_cast<int>(LEAF_PAGE_MAX_INLINE_POSTING_SIZE)) {
+      leaf->SetPostingAt(index, {}, WriteOverflowChain(values), count + 1);
+      return true;
+    }
+    fits = leaf->SetPostingAt(index, values, INVALID_PAGE_ID, count + 1);
+  } else {
+    fits = leaf->InsertEntryAt(index, key, {value}, INVALID_PAGE_ID, 1);
+  }
+
+  if (fits) {
+    if (allow_split && leaf->GetSize() >= leaf->GetMaxSize()) {
+      Page *new_page = SplitLeaf(leaf);
+      auto *new_leaf = reinterpret_cast<LeafPage *>(new_page->GetData());
+      InsertIntoParent(leaf, new_leaf->KeyAt(0), new_leaf);
+      WUnlatchEarly(new_page);
+      buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+    }
+    return true;
+  }
+
+  // the leaf ran out of bytes, split it and retry on the half the key belongs to
+  BUSTUB_ASSERT(allow_split, "a safe leaf always has room for one more value");
+  Page *new_page = SplitLeaf(leaf);
+  auto *new_leaf = reinterpret_cast<LeafPage *>(new_page->GetData());
+  InsertIntoParent(leaf, new_leaf->KeyAt(0), new_leaf);
+  LeafPage *target = comparator_(key, new_leaf->KeyAt(0)) < 0 ? leaf : new_leaf;
+  bool inserted = InsertIntoLeaf(target, key, value, false);
+  WUnlatchEarly(new_page);
+  buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+  return inserted;
+}
+
+/*
+ * Split the leaf, the returned new right sibling is pinned and write latched
+ * and must be released by the caller. Backward scans reach it through the prev
+ * link of its right neighbour as soon as that is set.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::SplitLeaf(LeafPage *leaf) -> Page * {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new page");
+  }
+  page->WLatch();
+  auto *new_leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  new_leaf->Init(page_id, leaf->GetParentPageId(), leaf_max_size_);
+  leaf->MoveHalfTo(new_leaf);
+  new_leaf->SetNextPageId(leaf->GetNextPageId());
+  new_leaf->SetPrevPageId(leaf->GetPageId());
+  leaf->SetNextPageId(page_id);
+  SetPrevLink(new_leaf->GetNextPageId(), page_id);
+  return page;
+}
+
+/*
+ * Point the prev link of leaf page_id to prev_page_id. The leaf is the right
+ * neighbour of a leaf that is write latched by the caller, latching from left
+ * to right keeps the order of the other writers.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetPrevLink(page_id_t page_id, page_id_t prev_page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  WLatch(page);
+  reinterpret_cast<LeafPage *>(page->GetData())->SetPrevPageId(prev_page_id);
+  WUnlatchEarly(page);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+/*
+ * Insert key & new_node into the parent of old_node after a split. A full
+ * parent is split together with the insertion, which may propagate up to the
+ * root.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node) {
+  if (old_node->IsRootPage()) {
+    page_id_t root_page_id;
+    Page *page = buffer_pool_manager_->NewPage(&root_page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new page");
+    }
+    auto *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(root_page_id, INVALID_PAGE_ID, internal_max_size_);
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    old_node->SetParentPageId(root_page_id);
+    new_node->SetParentPageId(root_page_id);
+    root_page_id_ = root_page_id;
+    UpdateRootPageId(0);
+    buffer_pool_manager_->UnpinPage(root_page_id, true);
+    return;
+  }
+
+  page_id_t parent_page_id = old_node->GetParentPageId();
+  auto *parent = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
+  if (parent->GetSize() < parent->GetMaxSize()) {
+    parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+    new_node->SetParentPageId(parent_page_id);
+    buffer_pool_manager_->UnpinPage(parent_page_id, true);
+    return;
+  }
+
+  page_id_t sibling_page_id;
+  Page *page = buffer_pool_manager_->NewPage(&sibling_page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new page");
+  }
+  auto *sibling = reinterpret_cast<InternalPage *>(page->GetData());
+  sibling->Init(sibling_page_id, parent->GetParentPageId(), internal_max_size_);
+  parent->MoveHalfTo(sibling, old_node->GetPageId(), key, new_node->GetPageId(), buffer_pool_manager_);
+  if (parent->ValueIndex(new_node->GetPageId()) != -1) {
+    new_node->SetParentPageId(parent_page_id);
+  }
+  InsertIntoParent(parent, sibling->KeyAt(0), sibling);
+  buffer_pool_manager_->UnpinPage(sibling_page_id, true);
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
 }
 
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
 /*
- * Delete key & value pair associated with input key
+ * Delete the key and all of its values
  * If current tree is empty, return immdiately.
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) { RemoveImpl(key, nullptr); }
+
+/*
+ * Delete a single key & value pair, the key itself is only removed together
+ * with its last value
+ * @return : false if the pair does not exist
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::Remove(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
+  return RemoveImpl(key, &value);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RemoveImpl(const KeyType &key, const ValueType *value) -> bool {
+  BeginOperation();
+  Page *page = FindLeafOptimistic(key);
+  if (page == nullptr) {
+    EndOperation();
+    return false;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  page_id_t page_id = leaf->GetPageId();
+  if (IsSafe(leaf, Operation::REMOVE)) {
+    bool removed = RemoveFromLeaf(leaf, key, value, nullptr);
+    EndOperation();
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, removed);
+    return removed;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+
+  WriteSet write_set;
+  root_latch_.WLock();
+  write_set.root_latched_ = true;
+  if (IsEmpty()) {
+    ReleaseWriteSet(&write_set);
+    return false;
+  }
+  page = FindLeafWrite(key, Operation::REMOVE, &write_set);
+  bool removed = RemoveFromLeaf(reinterpret_cast<LeafPage *>(page->GetData()), key, value, &write_set);
+  ReleaseWriteSet(&write_set);
+  return removed;
+}
+
+/*
+ * Remove value (or the whole key if value is nullptr) from the write latched
+ * leaf. If the entry of the key disappears and a write set is given, the leaf
+ * is merged or redistributed when it underflows.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RemoveFromLeaf(LeafPage *leaf, const KeyType &key, const ValueType *value, WriteSet *write_set)
+    -> bool {
+  int index = leaf->KeyIndex(key, comparator_);
+  if (index >= leaf->GetSize() || comparator_(leaf->KeyAt(index), key) != 0) {
+    return false;
+  }
+  int count = leaf->ValueCountAt(index);
+  page_id_t overflow_page_id = leaf->OverflowPageIdAt(index);
+  bool entry_removed = false;
+  if (value == nullptr) {
+    if (overflow_page_id != INVALID_PAGE_ID) {
+      DeleteOverflowChain(overflow_page_id);
+    }
+    leaf->RemoveAt(index);
+    entry_removed = true;
+  } else if (overflow_page_id != INVALID_PAGE_ID) {
+    if (!RemoveFromOverflowChain(&overflow_page_id, *value)) {
+      return false;
+    }
+    if (count == 1) {
+      leaf->RemoveAt(index);
+      entry_removed = true;
+    } else {
+      bool moved_inline = false;
+      if ((count - 1) * static_cast<int>(VarintUtil::MAX_VARINT_SIZE) <= LEAF_PAGE_MAX_INLINE_POSTING_SIZE / 2) {
+        // the posting list shrank well below the spill threshold, bring it back into the leaf if there is room
+        std::vector<ValueType> values;
+        BPlusTreeOverflowPage::ReadChain(buffer_pool_manager_, overflow_page_id, &values);
+        moved_inline = leaf->SetPostingAt(index, values, INVALID_PAGE_ID, count - 1);
+        if (moved_inline) {
+          DeleteOverflowChain(overflow_page_id);
+        }
+      }
+      if (!moved_inline) {
+        leaf->SetPostingAt(index, {}, overflow_page_id, count - 1);
+      }
+    }
+  } else {
+    std::vector<ValueType> values;
+    leaf->ValuesAt(index, &values);
+    auto it = std::lower_bound(values.begin(), values.end(), *value, ValueLess);
+    if (it == values.end() || !(*it == *value)) {
+      return false;
+    }
+    values.erase(it);
+    if (values.empty()) {
+      leaf->RemoveAt(index);
+      entry_removed = true;
+    } else {
+      leaf->SetPostingAt(index, values, INVALID_PAGE_ID, count - 1);
+    }
+  }
+
+  if (entry_removed && write_set != nullptr) {
+    CoalesceOrRedistribute(leaf, write_set);
+  }
+  return true;
+}
+
+/*
+ * If the node underflows, merge it with a sibling when both fit into one page,
+ * otherwise borrow one entry from that sibling. The right page of the pair is
+ * always merged into the left one. Merging removes an entry from the parent,
+ * which is then handled recursively.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CoalesceOrRedistribute(BPlusTreePage *node, WriteSet *write_set) {
+  if (node->IsRootPage()) {
+    AdjustRoot(node, write_set);
+    return;
+  }
+  if (node->GetSize() >= node->GetMinSize()) {
+    return;
+  }
+
+  page_id_t parent_page_id = node->GetParentPageId();
+  auto *parent = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
+  int index = parent->ValueIndex(node->GetPageId());
+  page_id_t sibling_page_id = parent->ValueAt(index == 0 ? 1 : index - 1);
+  Page *sibling_page = buffer_pool_manager_->FetchPage(sibling_page_id);
+  WLatch(sibling_page);
+  auto *sibling = reinterpret_cast<BPlusTreePage *>(sibling_page->GetData());
+
+  BPlusTreePage *left = index == 0 ? node : sibling;
+  BPlusTreePage *right = index == 0 ? sibling : node;
+  int right_index = index == 0 ? 1 : index;
+  page_id_t right_page_id = right->GetPageId();
+  bool merged = false;
+  if (node->IsLeafPage()) {
+    auto *left_leaf = reinterpret_cast<LeafPage *>(left);
+    auto *right_leaf = reinterpret_cast<LeafPage *>(right);
+    if (right_leaf->CanMergeInto(left_leaf)) {
+      right_leaf->MoveAllTo(left_leaf);
+      SetPrevLink(left_leaf->GetNextPageId(), left_leaf->GetPageId());
+      merged = true;
+    } else if (index == 0) {
+      if (right_leaf->MoveFirstToEndOf(left_leaf)) {
+        parent->SetKeyAt(right_index, right_leaf->KeyAt(0));
+      }
+    } else if (left_leaf->MoveLastToFrontOf(right_leaf)) {
+      parent->SetKeyAt(right_index, right_leaf->KeyAt(0));
+    }
+  } else {
+    auto *left_internal = reinterpret_cast<InternalPage *>(left);
+    auto *right_internal = reinterpret_cast<InternalPage *>(right);
+    KeyType middle_key = parent->KeyAt(right_index);
+    if (left_internal->GetSize() + right_internal->GetSize() <= internal_max_size_) {
+      right_internal->MoveAllTo(left_internal, middle_key, buffer_pool_manager_);
+      merged = true;
+    } else if (index == 0) {
+      right_internal->MoveFirstToEndOf(left_internal, middle_key, buffer_pool_manager_);
+      parent->SetKeyAt(right_index, right_internal->KeyAt(0));
+    } else {
+      left_internal->MoveLastToFrontOf(right_internal, middle_key, buffer_pool_manager_);
+      parent->SetKeyAt(right_index, right_internal->KeyAt(0));
+    }
+  }
+  WUnlatchEarly(sibling_page);
+  buffer_pool_manager_->UnpinPage(sibling_page_id, true);
+
+  if (merged) {
+    parent->Remove(right_index);
+    write_set->deleted_pages_.insert(right_page_id);
+    CoalesceOrRedistribute(parent, write_set);
+  }
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
+}
+
+/*
+ * Update root page if necessary
+ * NOTE: size of root page can be less than min size and this method is only
+ * called within CoalesceOrRedistribute() method
+ * case 1: when you delete the last element in root page, but root page still
+ * has one last child
+ * case 2: when you delete the last element in whole b+ tree
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node, WriteSet *write_set) {
+  if (old_root_node->IsLeafPage()) {
+    if (old_root_node->GetSize() == 0) {
+      write_set->deleted_pages_.insert(old_root_node->GetPageId());
+      root_page_id_ = INVALID_PAGE_ID;
+      UpdateRootPageId(0);
+    }
+    return;
+  }
+  if (old_root_node->GetSize() == 1) {
+    auto *root = reinterpret_cast<InternalPage *>(old_root_node);
+    page_id_t child_page_id = root->RemoveAndReturnOnlyChild();
+    auto *child = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(child_page_id)->GetData());
+    child->SetParentPageId(INVALID_PAGE_ID);
+    buffer_pool_manager_->UnpinPage(child_page_id, true);
+    write_set->deleted_pages_.insert(old_root_node->GetPageId());
+    root_page_id_ = child_page_id;
+    UpdateRootPageId(0);
+  }
+}
+
+/*****************************************************************************
+ * OVERFLOW CHAIN
+ *****************************************************************************/
+/*
+ * Store a sorted posting list on a new chain of overflow pages
+ * @return : the page id of the head of the chain
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::WriteOverflowChain(const std::vector<ValueType> &values) -> page_id_t {
+  // cut the list into runs that each fill one page
+  std::vector<std::pair<size_t, size_t>> runs;
+  size_t begin = 0;
+  while (begin < values.size()) {
+    size_t bytes = VarintUtil::EncodedSize(static_cast<uint64_t>(values[begin].Get()));
+    size_t end = begin + 1;
+    while (end < values.size()) {
+      size_t delta = static_cast<uint64_t>(values[end].Get()) - static_cast<uint64_t>(values[end - 1].Get());
+      if (bytes + VarintUtil::EncodedSize(delta) > OVERFLOW_PAGE_CAPACITY) {
+        break;
+      }
+      bytes += VarintUtil::EncodedSize(delta);
+      end++;
+    }
+    runs.emplace_back(begin, end);
+    begin = end;
+  }
+
+  // write the runs back to front so that every page knows its successor
+  page_id_t next_page_id = INVALID_PAGE_ID;
+  for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+    page_id_t page_id;
+    Page *page = buffer_pool_manager_->NewPage(&page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new page");
+    }
+    auto *overflow = reinterpret_cast<BPlusTreeOverflowPage *>(page->GetData());
+    overflow->Init(page_id, next_page_id);
+    overflow->SetValues(values, run->first, run->second);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    next_page_id = page_id;
+  }
+  return next_page_id;
+}
+
+/*
+ * Insert value into the page of the chain whose run covers it, a full page is
+ * split in two
+ * @return : false if the value already exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::InsertIntoOverflowChain(page_id_t head, const ValueType &value) -> bool {
+  page_id_t page_id = head;
+  auto *page = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+  while (page->GetNextPageId() != INVALID_PAGE_ID) {
+    page_id_t next_page_id = page->GetNextPageId();
+    auto *next = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager_->FetchPage(next_page_id)->GetData());
+    if (ValueLess(value, next->FirstValue())) {
+      buffer_pool_manager_->UnpinPage(next_page_id, false);
+      break;
+    }
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+    page = next;
+  }
+
+  std::vector<ValueType> values;
+  page->GetValues(&values);
+  auto it = std::lower_bound(values.begin(), values.end(), value, ValueLess);
+  if (it != values.end() && *it == value) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return false;
+  }
+  values.insert(it, value);
+  if (!page->SetValues(values, 0, values.size())) {
+    page_id_t sibling_page_id;
+    Page *sibling_page = buffer_pool_manager_->NewPage(&sibling_page_id);
+    if (sibling_page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new page");
+    }
+    auto *sibling = reinterpret_cast<BPlusTreeOverflowPage *>(sibling_page->GetData());
+    sibling->Init(sibling_page_id, page->GetNextPageId());
+    sibling->SetValues(values, values.size() / 2, values.size());
+    page->SetValues(values, 0, values.size() / 2);
+    page->SetNextPageId(sibling_page_id);
+    buffer_pool_manager_->UnpinPage(sibling_page_id, true);
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  return true;
+}
+
+/*
+ * Remove value from the chain, pages that become empty are unlinked and deleted
+ * @return : false if the value does not exist
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RemoveFromOverflowChain(page_id_t *head, const ValueType &value) -> bool {
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  page_id_t page_id = *head;
+  auto *page = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+  while (page->GetNextPageId() != INVALID_PAGE_ID) {
+    page_id_t next_page_id = page->GetNextPageId();
+    auto *next = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager_->FetchPage(next_page_id)->GetData());
+    if (ValueLess(value, next->FirstValue())) {
+      buffer_pool_manager_->UnpinPage(next_page_id, false);
+      break;
+    }
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    prev_page_id = page_id;
+    page_id = next_page_id;
+    page = next;
+  }
+
+  std::vector<ValueType> values;
+  page->GetValues(&values);
+  auto it = std::lower_bound(values.begin(), values.end(), value, ValueLess);
+  if (it == values.end() || !(*it == value)) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return false;
+  }
+  values.erase(it);
+  if (!values.empty()) {
+    page->SetValues(values, 0, values.size());
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    return true;
+  }
+
+  page_id_t next_page_id = page->GetNextPageId();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  buffer_pool_manager_->DeletePage(page_id);
+  if (prev_page_id == INVALID_PAGE_ID) {
+    *head = next_page_id;
+  } else {
+    auto *prev = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager_->FetchPage(prev_page_id)->GetData());
+    prev->SetNextPageId(next_page_id);
+    buffer_pool_manager_->UnpinPage(prev_page_id, true);
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeleteOverflowChain(page_id_t head) {
+  page_id_t page_id = head;
+  while (page_id != INVALID_PAGE_ID) {
+    auto *page = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+}
 
 /*****************************************************************************
  * INDEX ITERATOR
@@ -72,7 +870,13 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(); }
+auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
+  Page *page = FindLeafRead(KeyType{}, LeafPosition::LEFTMOST);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, 0);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -80,7 +884,14 @@ auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE()
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(); }
+auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
+  Page *page = FindLeafRead(key, LeafPosition::KEY);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index);
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -90,11 +901,46 @@ auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE { return IN
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(); }
 
+/*
+ * Input parameter is void, find the rightmost leaf page first, then construct
+ * an index iterator at its last key/value pair for backward iteration
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RBegin() -> INDEXITERATOR_TYPE {
+  Page *page = FindLeafRead(KeyType{}, LeafPosition::RIGHTMOST);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->GetSize() - 1;
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index, true);
+}
+
+/*
+ * Input parameter is high key, construct an index iterator at the last
+ * key/value pair whose key is not larger than the input key for backward
+ * iteration
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RBegin(const KeyType &key) -> INDEXITERATOR_TYPE {
+  Page *page = FindLeafRead(key, LeafPosition::KEY);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key, comparator_);
+  if (index == leaf->GetSize() || comparator_(leaf->KeyAt(index), key) > 0) {
+    index--;
+  }
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index, true);
+}
+
 /**
  * @return Page id of the root of this tree
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t { return 0; }
+auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t { return root_page_id_; }
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
@@ -110,16 +956,43 @@ auto BPLUSTREE_TYPE::GetRootPageId() -> page_id_t { return 0; }
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  // the header page is shared by the trees, the latch orders their changes
+  WLatch(header_page);
   if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
+    // create a new record<index_name + root_page_id> in header_page, the
+    // record is still there if the tree became empty and grows again
+    if (!header_page->InsertRecord(index_name_, root_page_id_)) {
+      header_page->UpdateRecord(index_name_, root_page_id_);
+    }
   } else {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
+  WUnlatchEarly(header_page);
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
+/*
+ * Open a tree whose root page id is on the header page already, e.g. an index
+ * that was recovered
+ * @return : false if the header page has no record of the tree
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LoadRootPageId() -> bool {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->RLatch();
+  page_id_t root_page_id;
+  bool found = header_page->GetRootId(index_name_, &root_page_id);
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (found) {
+    root_latch_.WLock();
+    root_page_id_ = root_page_id;
+    root_latch_.WUnlock();
+  }
+  return found;
+}
+
 /*
  * This method is used for test only
  * Read data from file and insert one by one
@@ -16,10 +16,13 @@ namespace bustub {
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                                     LogManager *log_manager)
     : Index(std::move(metadata)),
+      log_manager_(log_manager),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE,
+                 GetMetadata()->IsUnique(), log_manager) {}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
@@ -27,6 +30,7 @@ void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *t
   KeyType index_key;
   index_key.SetFromKey(key);
 
+  LogIndexWrite(LogRecordType::INDEX_INSERT, key, rid, transaction);
   container_.Insert(index_key, rid, transaction);
 }
 
@@ -36,7 +40,8 @@ void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *t
   KeyType index_key;
   index_key.SetFromKey(key);
 
-  container_.Remove(index_key, transaction);
+  LogIndexWrite(LogRecordType::INDEX_DELETE, key, rid, transaction);
+  container_.Remove(index_key, rid, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -57,6 +62,32 @@ auto BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) -> INDEXITERATOR
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_INDEX_TYPE::GetEndIterator() -> INDEXITERATOR_TYPE { return container_.End(); }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator() -> INDEXITERATOR_TYPE { return container_.RBegin(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE {
+  return container_.RBegin(key);
+}
+
+/*
+ * The record goes to the log before the tree changes, undo of a write that did
+ * not happen finds nothing to roll back
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::LogIndexWrite(LogRecordType log_record_type, const Tuple &key, RID rid,
+                                         Transaction *transaction) {
+  if (!enable_logging || log_manager_ == nullptr || transaction == nullptr) {
+    return;
+  }
+  LogRecord log_record(transaction->GetTransactionId(), transaction->GetPrevLSN(), log_record_type, GetName(), rid,
+                       key);
+  if (transaction->IsRollingBack()) {
+    log_record.SetUndoNext(transaction->GetUndoNextLSN());
+  }
+  transaction->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
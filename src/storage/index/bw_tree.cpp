@@ -0,0 +1,531 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree.cpp
+//
+// Identification: src/storage/index/bw_tree.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/bw_tree.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+enum class BwNodeType : uint8_t { LEAF, INNER, INSERT, DELETE, SPLIT, INDEX_ENTRY };
+
+/**
+ * Common part of base nodes and deltas. Every element of a chain carries the
+ * attributes of the logical node as of its installation, so a reader finds
+ * them in the head of the chain.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+struct BWTREE_TYPE::Node {
+  Node(BwNodeType type, uint32_t level) : type_(type), level_(level) {}
+  virtual ~Node() = default;
+
+  /** Put this delta on top of head, taking over the attributes of the logical node */
+  void Stack(Node *head) {
+    next_ = head;
+    depth_ = head->depth_ + 1;
+    size_ = head->size_;
+    high_ = head->high_;
+    right_ = head->right_;
+  }
+
+  const BwNodeType type_;
+  /** Leaves are on level 0 */
+  const uint32_t level_;
+  /** The element below in the chain, nullptr for a base node */
+  Node *next_{nullptr};
+  /** Number of deltas from here down to the base node */
+  uint32_t depth_{0};
+  /** Number of entries of a leaf or children of an inner node */
+  int size_{0};
+  /** Exclusive upper bound of the key range, none for the rightmost node of a level */
+  std::optional<MappingType> high_;
+  /** Right sibling on the same level */
+  page_id_t right_{INVALID_PAGE_ID};
+};
+
+INDEX_TEMPLATE_ARGUMENTS
+struct BWTREE_TYPE::LeafNode : public Node {
+  explicit LeafNode(std::vector<MappingType> entries) : Node(BwNodeType::LEAF, 0), entries_(std::move(entries)) {}
+  /** Sorted entries */
+  const std::vector<MappingType> entries_;
+};
+
+/** Child i covers the keys from keys_[i - 1] up to keys_[i], keys_ has one element less than children_ */
+INDEX_TEMPLATE_ARGUMENTS
+struct BWTREE_TYPE::InnerNode : public Node {
+  InnerNode(uint32_t level, std::vector<MappingType> keys, std::vector<page_id_t> children)
+      : Node(BwNodeType::INNER, level), keys_(std::move(keys)), children_(std::move(children)) {}
+  const std::vector<MappingType> keys_;
+  const std::vector<page_id_t> children_;
+};
+
+INDEX_TEMPLATE_ARGUMENTS
+struct BWTREE_TYPE::InsertDelta : public Node {
+  InsertDelta(Node *head, const MappingType &entry) : Node(BwNodeType::INSERT, 0), entry_(entry) {
+    this->Stack(head);
+    this->size_++;
+  }
+  const MappingType entry_;
+};
+
+INDEX_TEMPLATE_ARGUMENTS
+struct BWTREE_TYPE::DeleteDelta : public Node {
+  DeleteDelta(Node *head, const MappingType &entry) : Node(BwNodeType::DELETE, 0), entry_(entry) {
+    this->Stack(head);
+    this->size_--;
+  }
+  const MappingType entry_;
+};
+
+/** The keys from separator_ on moved to sibling_ */
+INDEX_TEMPLATE_ARGUMENTS
+struct BWTREE_TYPE::SplitDelta : public Node {
+  SplitDelta(Node *head, const MappingType &separator, page_id_t sibling, int size)
+      : Node(BwNodeType::SPLIT, head->level_), separator_(separator), sibling_(sibling) {
+    this->Stack(head);
+    this->size_ = size;
+    this->high_ = separator;
+    this->right_ = sibling;
+  }
+  const MappingType separator_;
+  const page_id_t sibling_;
+};
+
+/** The keys from low_ up to high_bound_ are found in child_ */
+INDEX_TEMPLATE_ARGUMENTS
+struct BWTREE_TYPE::IndexEntryDelta : public Node {
+  IndexEntryDelta(Node *head, const MappingType &low, std::optional<MappingType> high_bound, page_id_t child)
+      : Node(BwNodeType::INDEX_ENTRY, head->level_), low_(low), high_bound_(std::move(high_bound)), child_(child) {
+    this->Stack(head);
+    this->size_++;
+  }
+  const MappingType low_;
+  const std::optional<MappingType> high_bound_;
+  const page_id_t child_;
+};
+
+INDEX_TEMPLATE_ARGUMENTS
+BWTREE_TYPE::BwTree(const KeyComparator &comparator, bool unique_keys, int leaf_max_size, int inner_max_size)
+    : comparator_(comparator),
+      unique_keys_(unique_keys),
+      leaf_max_size_(std::max(leaf_max_size, 2)),
+      inner_max_size_(std::max(inner_max_size, 3)) {
+  root_page_id_.store(NewPage(new LeafNode({})));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+BWTREE_TYPE::~BwTree() {
+  for (auto &chunk : mapping_) {
+    std::atomic<Node *> *slots = chunk.load();
+    if (slots == nullptr) {
+      continue;
+    }
+    for (size_t i = 0; i < MAPPING_CHUNK_SIZE; i++) {
+      DeleteChain(slots[i].load());
+    }
+    delete[] slots;
+  }
+}
+
+/*****************************************************************************
+ * OPERATIONS
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::Insert(const KeyType &key, const ValueType &value) -> bool {
+  EpochGuard guard(&epoch_manager_);
+  MappingType entry{key, value};
+  page_id_t page_id = root_page_id_.load();
+  Node *head = Descend(&page_id, entry, false, 0);
+  while (true) {
+    ValueType existing;
+    if (LeafContains(head, entry, &existing)) {
+      return false;
+    }
+    auto *delta = new InsertDelta(head, entry);
+    if (Cas(page_id, head, delta)) {
+      Restructure(page_id, delta);
+      return true;
+    }
+    delete delta;
+    // the leaf changed under us, it may also have been split
+    head = LoadNode(&page_id, entry, false);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::Remove(const KeyType &key, const ValueType &value) -> bool {
+  EpochGuard guard(&epoch_manager_);
+  MappingType entry{key, value};
+  page_id_t page_id = root_page_id_.load();
+  Node *head = Descend(&page_id, entry, false, 0);
+  while (true) {
+    ValueType existing;
+    // a unique key only goes away with the value it belongs to
+    if (!LeafContains(head, entry, &existing) || !(existing == value)) {
+      return false;
+    }
+    auto *delta = new DeleteDelta(head, entry);
+    if (Cas(page_id, head, delta)) {
+      Restructure(page_id, delta);
+      return true;
+    }
+    delete delta;
+    head = LoadNode(&page_id, entry, false);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result) -> bool {
+  EpochGuard guard(&epoch_manager_);
+  MappingType probe{key, ValueType{}};
+  page_id_t page_id = root_page_id_.load();
+  Node *head = Descend(&page_id, probe, !unique_keys_, 0);
+  if (unique_keys_) {
+    ValueType value;
+    if (!LeafContains(head, probe, &value)) {
+      return false;
+    }
+    result->push_back(value);
+    return true;
+  }
+
+  // the values of a key are ordered and may continue in the right siblings
+  size_t found = result->size();
+  while (true) {
+    for (const auto &entry : CollectLeaf(head)) {
+      if (comparator_(entry.first, key) == 0) {
+        result->push_back(entry.second);
+      }
+    }
+    if (!head->high_.has_value() || comparator_(head->high_->first, key) > 0) {
+      break;
+    }
+    page_id = head->right_;
+    head = LoadNode(&page_id, probe, true);
+  }
+  return result->size() > found;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::GetHeight() -> uint32_t {
+  EpochGuard guard(&epoch_manager_);
+  return Slot(root_page_id_.load()).load()->level_ + 1;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::Compare(const MappingType &probe, const MappingType &entry, bool lowest) const -> int {
+  int result = comparator_(probe.first, entry.first);
+  if (result != 0 || unique_keys_) {
+    return result;
+  }
+  if (lowest) {
+    return -1;
+  }
+  int64_t lhs = probe.second.Get();
+  int64_t rhs = entry.second.Get();
+  return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::LoadNode(page_id_t *page_id, const MappingType &probe, bool lowest) -> Node * {
+  Node *head = Slot(*page_id).load();
+  while (head->high_.has_value() && Compare(probe, *head->high_, lowest) >= 0) {
+    *page_id = head->right_;
+    head = Slot(*page_id).load();
+  }
+  return head;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::Descend(page_id_t *page_id, const MappingType &probe, bool lowest, uint32_t level) -> Node * {
+  Node *head = LoadNode(page_id, probe, lowest);
+  while (head->level_ > level) {
+    *page_id = FindChild(head, probe, lowest);
+    head = LoadNode(page_id, probe, lowest);
+  }
+  return head;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::FindChild(Node *head, const MappingType &probe, bool lowest) -> page_id_t {
+  // split deltas need no check, the key range in the head is already the narrowest
+  for (Node *node = head;; node = node->next_) {
+    if (node->type_ == BwNodeType::INDEX_ENTRY) {
+      auto *delta = static_cast<IndexEntryDelta *>(node);
+      if (Compare(probe, delta->low_, lowest) >= 0 &&
+          (!delta->high_bound_.has_value() || Compare(probe, *delta->high_bound_, lowest) < 0)) {
+        return delta->child_;
+      }
+    } else if (node->type_ == BwNodeType::INNER) {
+      auto *inner = static_cast<InnerNode *>(node);
+      auto it = std::upper_bound(inner->keys_.begin(), inner->keys_.end(), probe,
+                                 [&](const MappingType &lhs, const MappingType &rhs) {
+                                   return Compare(lhs, rhs, lowest) < 0;
+                                 });
+      return inner->children_[it - inner->keys_.begin()];
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::LeafContains(Node *head, const MappingType &probe, ValueType *value) -> bool {
+  // entries beyond the key range of the head are never equal to probe, as LoadNode moved right past them
+  for (Node *node = head;; node = node->next_) {
+    if (node->type_ == BwNodeType::INSERT) {
+      auto *delta = static_cast<InsertDelta *>(node);
+      if (Compare(probe, delta->entry_) == 0) {
+        *value = delta->entry_.second;
+        return true;
+      }
+    } else if (node->type_ == BwNodeType::DELETE) {
+      if (Compare(probe, static_cast<DeleteDelta *>(node)->entry_) == 0) {
+        return false;
+      }
+    } else if (node->type_ == BwNodeType::LEAF) {
+      const auto &entries = static_cast<LeafNode *>(node)->entries_;
+      auto it = std::lower_bound(entries.begin(), entries.end(), probe,
+                                 [&](const MappingType &lhs, const MappingType &rhs) { return Compare(lhs, rhs) < 0; });
+      if (it == entries.end() || Compare(probe, *it) != 0) {
+        return false;
+      }
+      *value = it->second;
+      return true;
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::CollectLeaf(Node *head) -> std::vector<MappingType> {
+  std::vector<Node *> deltas;
+  Node *node = head;
+  for (; node->type_ != BwNodeType::LEAF; node = node->next_) {
+    deltas.push_back(node);
+  }
+  std::vector<MappingType> entries = static_cast<LeafNode *>(node)->entries_;
+  auto less = [&](const MappingType &lhs, const MappingType &rhs) { return Compare(lhs, rhs) < 0; };
+
+  // replay the deltas oldest first
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    if ((*it)->type_ == BwNodeType::INSERT) {
+      const auto &entry = static_cast<InsertDelta *>(*it)->entry_;
+      entries.insert(std::lower_bound(entries.begin(), entries.end(), entry, less), entry);
+    } else if ((*it)->type_ == BwNodeType::DELETE) {
+      const auto &entry = static_cast<DeleteDelta *>(*it)->entry_;
+      auto pos = std::lower_bound(entries.begin(), entries.end(), entry, less);
+      if (pos != entries.end() && Compare(entry, *pos) == 0) {
+        entries.erase(pos);
+      }
+    }
+  }
+
+  // what is beyond the high key moved to the right siblings
+  if (head->high_.has_value()) {
+    entries.erase(std::lower_bound(entries.begin(), entries.end(), *head->high_, less), entries.end());
+  }
+  return entries;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::CollectInner(Node *head, std::vector<MappingType> *keys, std::vector<page_id_t> *children) {
+  std::vector<IndexEntryDelta *> deltas;
+  Node *node = head;
+  for (; node->type_ != BwNodeType::INNER; node = node->next_) {
+    if (node->type_ == BwNodeType::INDEX_ENTRY) {
+      deltas.push_back(static_cast<IndexEntryDelta *>(node));
+    }
+  }
+  auto *inner = static_cast<InnerNode *>(node);
+  *keys = inner->keys_;
+  *children = inner->children_;
+  auto less = [&](const MappingType &lhs, const MappingType &rhs) { return Compare(lhs, rhs) < 0; };
+
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    auto pos = std::upper_bound(keys->begin(), keys->end(), (*it)->low_, less) - keys->begin();
+    keys->insert(keys->begin() + pos, (*it)->low_);
+    children->insert(children->begin() + pos + 1, (*it)->child_);
+  }
+
+  if (head->high_.has_value()) {
+    while (!keys->empty() && Compare(keys->back(), *head->high_) >= 0) {
+      keys->pop_back();
+      children->pop_back();
+    }
+  }
+}
+
+/*****************************************************************************
+ * STRUCTURE MODIFICATIONS
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::Restructure(page_id_t page_id, Node *head) {
+  bool leaf = head->level_ == 0;
+  if (head->size_ > (leaf ? leaf_max_size_ : inner_max_size_)) {
+    Split(page_id, head);
+  } else if (head->depth_ >= (leaf ? LEAF_CHAIN_THRESHOLD : INNER_CHAIN_THRESHOLD)) {
+    Consolidate(page_id, head);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::Consolidate(page_id_t page_id, Node *head) {
+  Node *base;
+  if (head->level_ == 0) {
+    base = new LeafNode(CollectLeaf(head));
+  } else {
+    std::vector<MappingType> keys;
+    std::vector<page_id_t> children;
+    CollectInner(head, &keys, &children);
+    base = new InnerNode(head->level_, std::move(keys), std::move(children));
+  }
+  base->size_ = head->size_;
+  base->high_ = head->high_;
+  base->right_ = head->right_;
+
+  if (!Cas(page_id, head, base)) {
+    // another writer got there first, it will consolidate the chain again
+    delete base;
+    return;
+  }
+  epoch_manager_.Retire([head] { DeleteChain(head); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::Split(page_id_t page_id, Node *head) {
+  Node *sibling;
+  MappingType separator;
+  int left_size;
+  if (head->level_ == 0) {
+    auto entries = CollectLeaf(head);
+    left_size = static_cast<int>(entries.size() / 2);
+    separator = entries[left_size];
+    sibling = new LeafNode(std::vector<MappingType>(entries.begin() + left_size, entries.end()));
+    sibling->size_ = static_cast<int>(entries.size()) - left_size;
+  } else {
+    std::vector<MappingType> keys;
+    std::vector<page_id_t> children;
+    CollectInner(head, &keys, &children);
+    // the separator moves up, it is not needed in either half
+    left_size = static_cast<int>(children.size() / 2);
+    separator = keys[left_size - 1];
+    sibling = new InnerNode(head->level_, std::vector<MappingType>(keys.begin() + left_size, keys.end()),
+                            std::vector<page_id_t>(children.begin() + left_size, children.end()));
+    sibling->size_ = static_cast<int>(children.size()) - left_size;
+  }
+  sibling->high_ = head->high_;
+  sibling->right_ = head->right_;
+
+  page_id_t sibling_page_id = NewPage(sibling);
+  auto *delta = new SplitDelta(head, separator, sibling_page_id, left_size);
+  if (!Cas(page_id, head, delta)) {
+    // the sibling was never reachable, its page id is just left unused
+    Slot(sibling_page_id).store(nullptr);
+    delete sibling;
+    delete delta;
+    return;
+  }
+
+  PostSeparator(head->level_ + 1, separator, head->high_, page_id, sibling_page_id);
+  Consolidate(page_id, delta);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::PostSeparator(uint32_t level, const MappingType &separator, const std::optional<MappingType> &high,
+                                page_id_t left, page_id_t right) {
+  while (true) {
+    page_id_t page_id = root_page_id_.load();
+    Node *root = Slot(page_id).load();
+    if (root->level_ < level) {
+      if (page_id != left) {
+        // the root split below us is still installing the new root
+        std::this_thread::yield();
+        continue;
+      }
+      auto *new_root = new InnerNode(level, {separator}, {left, right});
+      new_root->size_ = 2;
+      page_id_t new_root_page_id = NewPage(new_root);
+      if (root_page_id_.compare_exchange_strong(page_id, new_root_page_id)) {
+        return;
+      }
+      // the node split again and its other half became the new root first
+      Slot(new_root_page_id).store(nullptr);
+      delete new_root;
+      continue;
+    }
+
+    Node *parent = Descend(&page_id, separator, false, level);
+    while (true) {
+      auto *delta = new IndexEntryDelta(parent, separator, high, right);
+      if (Cas(page_id, parent, delta)) {
+        Restructure(page_id, delta);
+        return;
+      }
+      delete delta;
+      parent = LoadNode(&page_id, separator, false);
+    }
+  }
+}
+
+/*****************************************************************************
+ * MAPPING TABLE
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::NewPage(Node *node) -> page_id_t {
+  page_id_t page_id = next_page_id_.fetch_add(1);
+  auto chunk_index = static_cast<size_t>(page_id) / MAPPING_CHUNK_SIZE;
+  if (chunk_index >= MAPPING_CHUNKS) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "Bw-tree mapping table is full");
+  }
+  auto &chunk = mapping_[chunk_index];
+  if (chunk.load() == nullptr) {
+    auto *fresh = new std::atomic<Node *>[MAPPING_CHUNK_SIZE]();
+    std::atomic<Node *> *expected = nullptr;
+    if (!chunk.compare_exchange_strong(expected, fresh)) {
+      delete[] fresh;
+    }
+  }
+  Slot(page_id).store(node);
+  return page_id;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::Slot(page_id_t page_id) -> std::atomic<Node *> & {
+  auto index = static_cast<size_t>(page_id);
+  return mapping_[index / MAPPING_CHUNK_SIZE].load()[index % MAPPING_CHUNK_SIZE];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BWTREE_TYPE::Cas(page_id_t page_id, Node *expected, Node *desired) -> bool {
+  return Slot(page_id).compare_exchange_strong(expected, desired);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::DeleteChain(Node *head) {
+  while (head != nullptr) {
+    Node *next = head->next_;
+    delete head;
+    head = next;
+  }
+}
+
+template class BwTree<GenericKey<4>, RID, GenericComparator<4>>;
+template class BwTree<GenericKey<8>, RID, GenericComparator<8>>;
+template class BwTree<GenericKey<16>, RID, GenericComparator<16>>;
+template class BwTree<GenericKey<32>, RID, GenericComparator<32>>;
+template class BwTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
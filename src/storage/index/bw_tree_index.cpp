@@ -0,0 +1,54 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree_index.cpp
+//
+// Identification: src/storage/index/bw_tree_index.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/bw_tree_index.h"
+
+namespace bustub {
+
+/*
+ * Constructor
+ */
+INDEX_TEMPLATE_ARGUMENTS
+BWTREE_INDEX_TYPE::BwTreeIndex(std::unique_ptr<IndexMetadata> &&metadata)
+    : Index(std::move(metadata)),
+      comparator_(GetMetadata()->GetKeySchema()),
+      container_(comparator_, GetMetadata()->IsUnique()) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  KeyType index_key;
+  index_key.SetFromKey(key);
+
+  container_.Insert(index_key, rid);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  KeyType index_key;
+  index_key.SetFromKey(key);
+
+  container_.Remove(index_key, rid);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  KeyType index_key;
+  index_key.SetFromKey(key);
+
+  container_.GetValue(index_key, result);
+}
+
+template class BwTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
+template class BwTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
+template class BwTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
+template class BwTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
+template class BwTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
@@ -1,9 +1,14 @@
 /**
  * index_iterator.cpp
  */
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <thread>  // NOLINT
 
+#include "storage/index/b_plus_tree.h"
 #include "storage/index/index_iterator.h"
+#include "storage/page/b_plus_tree_overflow_page.h"
 
 namespace bustub {
 
@@ -15,16 +20,343 @@ INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;  // NOLINT
+INDEXITERATOR_TYPE::IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree,
+                                  BufferPoolManager *buffer_pool_manager, Page *page, int index, bool backward)
+    : tree_(tree), buffer_pool_manager_(buffer_pool_manager), page_(page), index_(index) {
+  page_id_ = reinterpret_cast<LeafPage *>(page_->GetData())->GetPageId();
+  if (backward) {
+    value_index_ = -1;
+    SettleBackward();
+  } else {
+    Settle();
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::IsEnd() -> bool { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE::IndexIterator(const IndexIterator &other)
+    : tree_(other.tree_),
+      buffer_pool_manager_(other.buffer_pool_manager_),
+      page_id_(other.page_id_),
+      index_(other.index_),
+      value_index_(other.value_index_),
+      values_(other.values_),
+      item_(other.item_),
+      positioned_(other.positioned_),
+      next_page_id_(other.next_page_id_),
+      high_key_(other.high_key_) {
+  if (page_id_ != INVALID_PAGE_ID) {
+    page_ = buffer_pool_manager_->FetchPage(page_id_);
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::operator*() -> const MappingType & { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
+    : tree_(other.tree_),
+      buffer_pool_manager_(other.buffer_pool_manager_),
+      page_(other.page_),
+      page_id_(other.page_id_),
+      index_(other.index_),
+      value_index_(other.value_index_),
+      values_(std::move(other.values_)),
+      item_(other.item_),
+      positioned_(other.positioned_),
+      next_page_id_(other.next_page_id_),
+      high_key_(other.high_key_) {
+  other.page_ = nullptr;
+  other.page_id_ = INVALID_PAGE_ID;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & { throw std::runtime_error("unimplemented"); }
+auto INDEXITERATOR_TYPE::operator=(const IndexIterator &other) -> IndexIterator & {
+  if (this != &other) {
+    *this = IndexIterator(other);
+  }
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::operator=(IndexIterator &&other) noexcept -> IndexIterator & {
+  if (this != &other) {
+    Release();
+    tree_ = other.tree_;
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    page_ = other.page_;
+    page_id_ = other.page_id_;
+    index_ = other.index_;
+    value_index_ = other.value_index_;
+    values_ = std::move(other.values_);
+    item_ = other.item_;
+    positioned_ = other.positioned_;
+    next_page_id_ = other.next_page_id_;
+    high_key_ = other.high_key_;
+    other.page_ = nullptr;
+    other.page_id_ = INVALID_PAGE_ID;
+  }
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() { Release(); }  // NOLINT
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::IsEnd() -> bool { return page_ == nullptr; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::operator*() -> const MappingType & { return item_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & {
+  if (IsEnd()) {
+    return *this;
+  }
+  value_index_++;
+  if (value_index_ < static_cast<int>(values_.size())) {
+    item_.second = values_[value_index_];
+    return *this;
+  }
+  index_++;
+  value_index_ = 0;
+  page_->RLatch();
+  Settle();
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::operator--() -> INDEXITERATOR_TYPE & {
+  if (IsEnd()) {
+    return *this;
+  }
+  value_index_--;
+  if (value_index_ >= 0) {
+    item_.second = values_[value_index_];
+    return *this;
+  }
+  index_--;
+  page_->RLatch();
+  SettleBackward();
+  return *this;
+}
+
+/*
+ * Move forward to the first entry after the position, crossing leaf boundaries
+ * if needed, and cache all values of that entry so that the leaf does not need
+ * to be latched again until the next entry. The leaf is read latched by the
+ * caller. Once a key was handed out, the entry is looked up by that key in
+ * whatever the leaf holds now. Keys above the position can only leave the leaf
+ * by a split, a merge or a redistribution, which change its next link, its
+ * last key or its first key; the leaf of the position is found again from the
+ * root then.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Settle() {
+  // only the leaf the position was read from may have changed since
+  bool resumed = positioned_;
+  while (true) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page_->GetData());
+    if (resumed) {
+      resumed = false;
+      if (HasChanged(leaf) || tree_->comparator_(leaf->KeyAt(0), item_.first) > 0) {
+        page_->RUnlatch();
+        if (!FindLeafAgain()) {
+          return;
+        }
+        continue;
+      }
+    }
+    if (positioned_) {
+      index_ = leaf->KeyIndex(item_.first, tree_->comparator_);
+      if (index_ < leaf->GetSize() && tree_->comparator_(leaf->KeyAt(index_), item_.first) == 0) {
+        index_++;
+      }
+    }
+    if (index_ < leaf->GetSize()) {
+      LoadValues(leaf);
+      if (values_.empty()) {
+        continue;
+      }
+      page_->RUnlatch();
+      item_.second = values_[value_index_];
+      return;
+    }
+    if (!MoveToNextLeaf(leaf)) {
+      return;
+    }
+  }
+}
+
+/*
+ * Mirror of MoveToPrevLeaf(): the next leaf is only taken while both leaves
+ * are latched, so that nothing moves between them unseen. If the next leaf is
+ * busy, the leaf of the position is found again from the root. Before the
+ * first key was handed out there is no position to lose, the iterator just
+ * waits for the next leaf then.
+ * @return : true with the new leaf latched, false at the end of the leaf level
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::MoveToNextLeaf(const LeafPage *leaf) -> bool {
+  page_id_t next_page_id = leaf->GetNextPageId();
+  if (next_page_id == INVALID_PAGE_ID) {
+    page_->RUnlatch();
+    Release();
+    return false;
+  }
+  Page *next_page = buffer_pool_manager_->FetchPage(next_page_id);
+  bool latched = next_page->TryRLatch();
+  if (latched || !positioned_) {
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id_, false);
+    if (!latched) {
+      next_page->RLatch();
+    }
+    page_ = next_page;
+    page_id_ = next_page_id;
+    index_ = 0;
+    value_index_ = 0;
+    Remember(reinterpret_cast<LeafPage *>(page_->GetData()));
+    return true;
+  }
+  buffer_pool_manager_->UnpinPage(next_page_id, false);
+  page_->RUnlatch();
+  std::this_thread::yield();
+  return FindLeafAgain();
+}
+
+/*
+ * Mirror of Settle(): move backward to the last entry before the position and
+ * position at its last value, the leaf is read latched by the caller. Once a
+ * key was handed out, the entry is looked up by that key in whatever the leaf
+ * holds now. Keys below the position can only leave the leaf to the right by
+ * a split, a merge or a redistribution, which change its next link or its last
+ * key; the leaf of the position is found again from the root then.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SettleBackward() {
+  while (true) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page_->GetData());
+    if (positioned_) {
+      if (HasChanged(leaf)) {
+        page_->RUnlatch();
+        if (!FindLeafAgain()) {
+          return;
+        }
+        continue;
+      }
+      index_ = leaf->KeyIndex(item_.first, tree_->comparator_) - 1;
+    } else if (index_ < 0 && leaf->GetSize() > 0) {
+      // no key of the leaf is small enough, the leaves to the left hold the keys below its first one
+      item_.first = leaf->KeyAt(0);
+      positioned_ = true;
+    }
+    index_ = std::min(index_, leaf->GetSize() - 1);
+    if (index_ >= 0) {
+      LoadValues(leaf);
+      if (values_.empty()) {
+        continue;
+      }
+      page_->RUnlatch();
+      value_index_ = static_cast<int>(values_.size()) - 1;
+      item_.second = values_[value_index_];
+      return;
+    }
+    if (!MoveToPrevLeaf(leaf)) {
+      return;
+    }
+  }
+}
+
+/*
+ * Writers latch siblings in both directions, so the previous leaf is only
+ * tried while the latched leaf is held. It is taken if it still links to the
+ * leaf: nothing lies between them then. Otherwise a sibling is being split or
+ * merged, and the leaf of the position is found again from the root.
+ * @return : true with the new leaf latched, false at the end of the leaf level
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::MoveToPrevLeaf(const LeafPage *leaf) -> bool {
+  page_id_t prev_page_id = leaf->GetPrevPageId();
+  if (prev_page_id == INVALID_PAGE_ID) {
+    page_->RUnlatch();
+    Release();
+    return false;
+  }
+  Page *prev_page = buffer_pool_manager_->FetchPage(prev_page_id);
+  if (prev_page->TryRLatch()) {
+    auto *prev_leaf = reinterpret_cast<LeafPage *>(prev_page->GetData());
+    if (prev_leaf->GetNextPageId() == page_id_) {
+      page_->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id_, false);
+      page_ = prev_page;
+      page_id_ = prev_page_id;
+      index_ = std::numeric_limits<int>::max();
+      Remember(prev_leaf);
+      return true;
+    }
+    prev_page->RUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(prev_page_id, false);
+  page_->RUnlatch();
+  std::this_thread::yield();
+  return FindLeafAgain();
+}
+
+/*
+ * Descend from the root to the leaf that holds the position, the current leaf
+ * must not be latched
+ * @return : true with the leaf latched, false if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::FindLeafAgain() -> bool {
+  KeyType key = item_.first;
+  Release();
+  page_ = tree_->FindLeafRead(key, BPLUSTREE_TYPE::LeafPosition::KEY);
+  if (page_ == nullptr) {
+    return false;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page_->GetData());
+  page_id_ = leaf->GetPageId();
+  positioned_ = true;
+  Remember(leaf);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Remember(const LeafPage *leaf) {
+  next_page_id_ = leaf->GetNextPageId();
+  if (leaf->GetSize() > 0) {
+    high_key_ = leaf->KeyAt(leaf->GetSize() - 1);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::HasChanged(const LeafPage *leaf) const -> bool {
+  return leaf->GetSize() == 0 || leaf->GetNextPageId() != next_page_id_ ||
+         tree_->comparator_(leaf->KeyAt(leaf->GetSize() - 1), high_key_) != 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::LoadValues(const LeafPage *leaf) {
+  values_.clear();
+  item_.first = leaf->KeyAt(index_);
+  positioned_ = true;
+  Remember(leaf);
+  page_id_t overflow_page_id = leaf->OverflowPageIdAt(index_);
+  if (overflow_page_id == INVALID_PAGE_ID) {
+    leaf->ValuesAt(index_, &values_);
+  } else {
+    BPlusTreeOverflowPage::ReadChain(buffer_pool_manager_, overflow_page_id, &values_);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Release() {
+  if (page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(page_id_, false);
+    page_ = nullptr;
+  }
+  page_id_ = INVALID_PAGE_ID;
+  index_ = 0;
+  value_index_ = 0;
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
@@ -9,10 +9,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "common/exception.h"
 #include "common/rid.h"
+#include "common/util/varint_util.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
@@ -27,16 +30,36 @@ namespace bustub {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+  SetPageType(IndexPageType::LEAF_PAGE);
+  SetLSN();
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(parent_id);
+  SetMaxSize(max_size);
+  next_page_id_ = INVALID_PAGE_ID;
+  prev_page_id_ = INVALID_PAGE_ID;
+  free_space_pointer_ = BUSTUB_PAGE_SIZE;
+  fragmented_bytes_ = 0;
+}
 
 /**
  * Helper methods to set/get next page id
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const -> page_id_t { return INVALID_PAGE_ID; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const -> page_id_t { return next_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+/**
+ * Helper methods to set/get prev page id
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetPrevPageId() const -> page_id_t { return prev_page_id_; }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetPrevPageId(page_id_t prev_page_id) { prev_page_id_ = prev_page_id; }
 
 /*
  * Helper method to find and return the key associated with input "index"(a.k.a
@@ -44,11 +67,341 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {}
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType {
-  // replace with your own code
-  KeyType key{};
+  KeyType key;
+  memcpy(&key, EntryAt(index), sizeof(KeyType));
   return key;
 }
 
+/*
+ * Helper method to find the first index i so that KeyAt(i) >= key
+ * NOTE: This method is only used when generating index iterator and when
+ * looking up the entry of a key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int {
+  int left = 0;
+  int right = GetSize();
+  while (left < right) {
+    int mid = left + (right - left) / 2;
+    if (comparator(KeyAt(mid), key) < 0) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left;
+}
+
+/*****************************************************************************
+ * POSTING LIST
+ *****************************************************************************/
+/*
+ * @return the total number of values associated with the entry at index,
+ * including the values stored on overflow pages
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::ValueCountAt(int index) const -> int {
+  int32_t count;
+  memcpy(&count, EntryAt(index) + sizeof(KeyType), sizeof(int32_t));
+  return count;
+}
+
+/*
+ * @return the head of the overflow chain of the entry at index, or
+ * INVALID_PAGE_ID if its posting list is stored inline
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::OverflowPageIdAt(int index) const -> page_id_t {
+  page_id_t overflow_page_id;
+  memcpy(&overflow_page_id, EntryAt(index) + sizeof(KeyType) + sizeof(int32_t), sizeof(page_id_t));
+  return overflow_page_id;
+}
+
+/*
+ * Append the inline values of the entry at index to values, in ascending RID
+ * order. Nothing is appended if the posting list lives on overflow pages.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::ValuesAt(int index, std::vector<ValueType> *values) const {
+  if (OverflowPageIdAt(index) != INVALID_PAGE_ID) {
+    return;
+  }
+  std::vector<uint64_t> encoded;
+  VarintUtil::DeltaDecode(EntryAt(index) + sizeof(KeyType) + LEAF_PAGE_ENTRY_HEADER_SIZE, ValueCountAt(index),
+                          &encoded);
+  for (auto value : encoded) {
+    values->emplace_back(static_cast<int64_t>(value));
+  }
+}
+
+/*
+ * @return the number of bytes needed to store a sorted list of values inline
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::PostingSize(const std::vector<ValueType> &values) -> int {
+  size_t size = 0;
+  uint64_t prev = 0;
+  for (const auto &value : values) {
+    auto encoded = static_cast<uint64_t>(value.Get());
+    size += VarintUtil::EncodedSize(encoded - prev);
+    prev = encoded;
+  }
+  return static_cast<int>(size);
+}
+
+/*****************************************************************************
+ * SPACE ACCOUNTING
+ *****************************************************************************/
+/*
+ * @return number of bytes that can still be used by new slots and entries,
+ * counting the bytes that are reclaimable by compaction
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetFreeSpace() const -> int { return ContiguousFreeSpace() + fragmented_bytes_; }
+
+/*
+ * A leaf is safe for insertion if adding one more value can neither make it
+ * reach max size nor run out of bytes, i.e. it will not be split
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::IsInsertSafe() const -> bool {
+  const int max_growth = sizeof(KeyType) + LEAF_PAGE_ENTRY_HEADER_SIZE + VarintUtil::MAX_VARINT_SIZE + LEAF_PAGE_SLOT_SIZE;
+  return GetSize() + 1 < GetMaxSize() && GetFreeSpace() >= max_growth;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Insert a new entry at index. values must be sorted and are ignored when the
+ * posting list is stored on overflow pages.
+ * @return false if the page does not have enough room for the entry
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::InsertEntryAt(int index, const KeyType &key, const std::vector<ValueType> &values,
+                                               page_id_t overflow_page_id, int value_count) -> bool {
+  char entry[BUSTUB_PAGE_SIZE];
+  int length = sizeof(KeyType) + LEAF_PAGE_ENTRY_HEADER_SIZE;
+  memcpy(entry, &key, sizeof(KeyType));
+  memcpy(entry + sizeof(KeyType), &value_count, sizeof(int32_t));
+  memcpy(entry + sizeof(KeyType) + sizeof(int32_t), &overflow_page_id, sizeof(page_id_t));
+  if (overflow_page_id == INVALID_PAGE_ID) {
+    if (length + PostingSize(values) > BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) {
+      return false;
+    }
+    uint64_t prev = 0;
+    for (const auto &value : values) {
+      auto encoded = static_cast<uint64_t>(value.Get());
+      length += VarintUtil::Encode(encoded - prev, entry + length);
+      prev = encoded;
+    }
+  }
+  return InsertRawAt(index, entry, length);
+}
+
+/*
+ * Replace the posting list of the entry at index, keeping its key
+ * @return false if the page does not have enough room for the grown entry
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::SetPostingAt(int index, const std::vector<ValueType> &values,
+                                              page_id_t overflow_page_id, int value_count) -> bool {
+  int new_length = sizeof(KeyType) + LEAF_PAGE_ENTRY_HEADER_SIZE;
+  if (overflow_page_id == INVALID_PAGE_ID) {
+    new_length += PostingSize(values);
+  }
+  int old_length = SlotAt(index)->length_;
+  if (new_length > old_length && GetFreeSpace() + old_length < new_length) {
+    return false;
+  }
+  // the old entry becomes garbage and the new one is written at the free space pointer
+  KeyType key = KeyAt(index);
+  RemoveAt(index);
+  return InsertEntryAt(index, key, values, overflow_page_id, value_count);
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Remove the entry at index, the bytes it used are reclaimed lazily
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAt(int index) {
+  Slot *slot = SlotAt(index);
+  if (slot->offset_ == free_space_pointer_) {
+    free_space_pointer_ += slot->length_;
+  } else {
+    fragmented_bytes_ += slot->length_;
+  }
+  memmove(reinterpret_cast<void *>(SlotAt(index)), reinterpret_cast<void *>(SlotAt(index + 1)),
+          (GetSize() - index - 1) * LEAF_PAGE_SLOT_SIZE);
+  IncreaseSize(-1);
+}
+
+/*****************************************************************************
+ * SPLIT
+ *****************************************************************************/
+/*
+ * Remove half of the entries from this page to "recipient" page. The split
+ * point is chosen so that both halves keep enough room for one more entry.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {
+  const int capacity = BUSTUB_PAGE_SIZE - LEAF_PAGE_HEADER_SIZE;
+  const int max_entry = sizeof(KeyType) + LEAF_PAGE_ENTRY_HEADER_SIZE + LEAF_PAGE_MAX_INLINE_POSTING_SIZE +
+                        VarintUtil::MAX_VARINT_SIZE + LEAF_PAGE_SLOT_SIZE;
+  int size = GetSize();
+  std::vector<int> prefix(size + 1, 0);
+  for (int i = 0; i < size; i++) {
+    prefix[i + 1] = prefix[i] + SlotAt(i)->length_ + LEAF_PAGE_SLOT_SIZE;
+  }
+
+  int split = GetMinSize();
+  if (split <= 0 || split >= size || prefix[split] > capacity - max_entry ||
+      prefix[size] - prefix[split] > capacity - max_entry) {
+    // entries differ too much in size, split by bytes instead of by count
+    split = 1;
+    while (split < size - 1 && prefix[split] * 2 < prefix[size]) {
+      split++;
+    }
+  }
+
+  for (int i = split; i < size; i++) {
+    recipient->InsertRawAt(recipient->GetSize(), EntryAt(i), SlotAt(i)->length_);
+  }
+  for (int i = size - 1; i >= split; i--) {
+    RemoveAt(i);
+  }
+}
+
+/*****************************************************************************
+ * MERGE
+ *****************************************************************************/
+/*
+ * @return true if all entries of this page fit into recipient
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::CanMergeInto(const BPlusTreeLeafPage *recipient) const -> bool {
+  if (GetSize() + recipient->GetSize() >= recipient->GetMaxSize()) {
+    return false;
+  }
+  int used = 0;
+  for (int i = 0; i < GetSize(); i++) {
+    used += SlotAt(i)->length_ + LEAF_PAGE_SLOT_SIZE;
+  }
+  return used <= recipient->GetFreeSpace();
+}
+
+/*
+ * Remove all of the entries from this page to the end of "recipient" page,
+ * then update the next page id of recipient. Caller must check CanMergeInto.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
+  for (int i = 0; i < GetSize(); i++) {
+    recipient->InsertRawAt(recipient->GetSize(), EntryAt(i), SlotAt(i)->length_);
+  }
+  recipient->SetNextPageId(GetNextPageId());
+  SetSize(0);
+  free_space_pointer_ = BUSTUB_PAGE_SIZE;
+  fragmented_bytes_ = 0;
+}
+
+/*****************************************************************************
+ * REDISTRIBUTE
+ *****************************************************************************/
+/*
+ * Remove the first entry from this page to the end of "recipient" page.
+ * @return false if recipient does not have room for the entry
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) -> bool {
+  if (!recipient->InsertRawAt(recipient->GetSize(), EntryAt(0), SlotAt(0)->length_)) {
+    return false;
+  }
+  RemoveAt(0);
+  return true;
+}
+
+/*
+ * Remove the last entry from this page to the head of "recipient" page.
+ * @return false if recipient does not have room for the entry
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) -> bool {
+  int last = GetSize() - 1;
+  if (!recipient->InsertRawAt(0, EntryAt(last), SlotAt(last)->length_)) {
+    return false;
+  }
+  RemoveAt(last);
+  return true;
+}
+
+/*****************************************************************************
+ * SLOTTED PAGE INTERNALS
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::SlotAt(int index) -> Slot * {
+  return reinterpret_cast<Slot *>(data_ + index * LEAF_PAGE_SLOT_SIZE);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::SlotAt(int index) const -> const Slot * {
+  return reinterpret_cast<const Slot *>(data_ + index * LEAF_PAGE_SLOT_SIZE);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::EntryAt(int index) const -> const char * {
+  return reinterpret_cast<const char *>(this) + SlotAt(index)->offset_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::ContiguousFreeSpace() const -> int {
+  return free_space_pointer_ - LEAF_PAGE_HEADER_SIZE - GetSize() * LEAF_PAGE_SLOT_SIZE;
+}
+
+/*
+ * Copy a serialized entry into the page and insert its slot at index
+ * @return false if the page does not have enough room
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::InsertRawAt(int index, const char *entry, int length) -> bool {
+  if (GetFreeSpace() < length + LEAF_PAGE_SLOT_SIZE) {
+    return false;
+  }
+  if (ContiguousFreeSpace() < length + LEAF_PAGE_SLOT_SIZE) {
+    Compact();
+  }
+  free_space_pointer_ -= length;
+  memcpy(reinterpret_cast<char *>(this) + free_space_pointer_, entry, length);
+  memmove(reinterpret_cast<void *>(SlotAt(index + 1)), reinterpret_cast<void *>(SlotAt(index)),
+          (GetSize() - index) * LEAF_PAGE_SLOT_SIZE);
+  SlotAt(index)->offset_ = free_space_pointer_;
+  SlotAt(index)->length_ = length;
+  IncreaseSize(1);
+  return true;
+}
+
+/*
+ * Rewrite all entries contiguously at the end of the page so that the bytes
+ * freed by removed or shrunk entries become usable again
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Compact() {
+  char buffer[BUSTUB_PAGE_SIZE];
+  uint16_t pointer = BUSTUB_PAGE_SIZE;
+  for (int i = 0; i < GetSize(); i++) {
+    Slot *slot = SlotAt(i);
+    pointer -= slot->length_;
+    memcpy(buffer + pointer, EntryAt(i), slot->length_);
+    slot->offset_ = pointer;
+  }
+  memcpy(reinterpret_cast<char *>(this) + pointer, buffer + pointer, BUSTUB_PAGE_SIZE - pointer);
+  free_space_pointer_ = pointer;
+  fragmented_bytes_ = 0;
+}
+
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>>;
@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/page/b_plus_tree_overflow_page.cpp
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/b_plus_tree_overflow_page.h"
+
+#include "common/util/varint_util.h"
+
+namespace bustub {
+
+/*
+ * Init method after creating a new overflow page
+ */
+void BPlusTreeOverflowPage::Init(page_id_t page_id, page_id_t next_page_id) {
+  SetPageType(IndexPageType::OVERFLOW_PAGE);
+  SetLSN();
+  SetSize(0);
+  SetMaxSize(OVERFLOW_PAGE_CAPACITY);
+  SetPageId(page_id);
+  SetParentPageId(INVALID_PAGE_ID);
+  next_page_id_ = next_page_id;
+  byte_size_ = 0;
+}
+
+auto BPlusTreeOverflowPage::GetNextPageId() const -> page_id_t { return next_page_id_; }
+
+void BPlusTreeOverflowPage::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+/*
+ * The first delta is relative to zero, so the first value can be decoded
+ * without reading the rest of the page
+ */
+auto BPlusTreeOverflowPage::FirstValue() const -> RID {
+  uint64_t value;
+  VarintUtil::Decode(data_, &value);
+  return RID(static_cast<int64_t>(value));
+}
+
+void BPlusTreeOverflowPage::GetValues(std::vector<RID> *values) const {
+  std::vector<uint64_t> encoded;
+  VarintUtil::DeltaDecode(data_, GetSize(), &encoded);
+  for (auto value : encoded) {
+    values->emplace_back(static_cast<int64_t>(value));
+  }
+}
+
+auto BPlusTreeOverflowPage::SetValues(const std::vector<RID> &values, size_t begin, size_t end) -> bool {
+  std::vector<uint64_t> encoded;
+  encoded.reserve(end - begin);
+  for (size_t i = begin; i < end; i++) {
+    encoded.push_back(static_cast<uint64_t>(values[i].Get()));
+  }
+  size_t byte_size = VarintUtil::DeltaEncodedSize(encoded);
+  if (byte_size > OVERFLOW_PAGE_CAPACITY) {
+    return false;
+  }
+  VarintUtil::DeltaEncode(encoded, data_);
+  byte_size_ = static_cast<int32_t>(byte_size);
+  SetSize(static_cast<int>(end - begin));
+  return true;
+}
+
+void BPlusTreeOverflowPage::ReadChain(BufferPoolManager *buffer_pool_manager, page_id_t head,
+                                      std::vector<RID> *values) {
+  page_id_t page_id = head;
+  while (page_id != INVALID_PAGE_ID) {
+    auto *page = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager->FetchPage(page_id)->GetData());
+    page->GetValues(values);
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+}  // namespace bustub
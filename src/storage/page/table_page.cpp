@@ -71,21 +71,36 @@ auto TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
     SetTupleCount(GetTupleCount() + 1);
   }
 
-  /**
-   * Removed to support new lock manager API for p4 (multilevel locking); Big hack energy
-   * This clause was used in logging and recovery projects previously; not being used right now
-   */
-  //  // Write the log record.
-  //  if (enable_logging) {
-  //    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid) && !txn->IsExclusiveLocked(*rid), "A new tuple should not be locked.");
-  //    // Acquire an exclusive lock on the new tuple.
-  //    bool locked = lock_manager->LockExclusive(txn, *rid);
-  //    BUSTUB_ENSURE(locked, "Locking a new tuple should always work.");
-  //    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, *rid, tuple);
-  //    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-  //    SetLSN(lsn);
-  //    txn->SetPrevLSN(lsn);
-  //  }
+  // Write the log record. The tuple is locked by the caller through the lock manager.
+  if (IsLogged(txn, log_manager)) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, *rid, tuple);
+    AppendLogRecord(&log_record, txn, log_manager);
+  }
+  return true;
+}
+
+auto TablePage::InsertTupleAt(const Tuple &tuple, const RID &rid) -> bool {
+  BUSTUB_ASSERT(tuple.size_ > 0, "Cannot have empty tuples.");
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num < GetTupleCount() && GetTupleSize(slot_num) != 0) {
+    return false;
+  }
+  uint32_t new_slots = slot_num < GetTupleCount() ? 0 : slot_num + 1 - GetTupleCount();
+  if (GetFreeSpaceRemaining() < tuple.size_ + new_slots * SIZE_TUPLE) {
+    return false;
+  }
+
+  // The slots between the old last one and the tuple's are free.
+  for (uint32_t i = GetTupleCount(); i < slot_num; i++) {
+    SetTupleOffsetAtSlot(i, 0);
+    SetTupleSize(i, 0);
+  }
+  SetTupleCount(GetTupleCount() + new_slots);
+
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  SetTupleOffsetAtSlot(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
   return true;
 }
 
@@ -109,25 +124,11 @@ auto TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
     return false;
   }
 
-  /**
-   * Removed to support new lock manager API for p4 (multilevel locking); Big hack energy
-   * This clause was used in logging and recovery projects previously; not being used right now
-   */
-  //  if (enable_logging) {
-  //    // Acquire an exclusive lock, upgrading from a shared lock if necessary.
-  //    if (txn->IsSharedLocked(rid)) {
-  //      if (!lock_manager->LockUpgrade(txn, rid)) {
-  //        return false;
-  //      }
-  //    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
-  //      return false;
-  //    }
-  //    Tuple dummy_tuple;
-  //    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::MARKDELETE, rid, dummy_tuple);
-  //    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-  //    SetLSN(lsn);
-  //    txn->SetPrevLSN(lsn);
-  //  }
+  if (IsLogged(txn, log_manager)) {
+    Tuple dummy_tuple;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::MARKDELETE, rid, dummy_tuple);
+    AppendLogRecord(&log_record, txn, log_manager);
+  }
 
   // Mark the tuple as deleted.
   if (tuple_size > 0) {
@@ -171,22 +172,11 @@ auto TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
   old_tuple->rid_ = rid;
   old_tuple->allocated_ = true;
 
-  /**
-   * Removed to support new lock manager API for p4 (multilevel locking); Big hack energy
-   * This clause was used in logging and recovery projects previously; not being used right now
-   */
-  //  if (enable_logging) {
-  //    // Acquire an exclusive lock, upgrading from shared if necessary.
-  //    if (txn->IsSharedLocked(rid)) {
-  //      if (!lock_manager->LockUpgrade(txn, rid)) {
-  //        return false;
-  //      }
-  //    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
-  //      return false;
-  //    }
-  //    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, *old_tuple,
-  //    new_tuple); lsn_t lsn = log_manager->AppendLogRecord(&log_record); SetLSN(lsn); txn->SetPrevLSN(lsn);
-  //  }
+  if (IsLogged(txn, log_manager)) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, *old_tuple,
+                         new_tuple);
+    AppendLogRecord(&log_record, txn, log_manager);
+  }
 
   // Perform the update.
   uint32_t free_space_pointer = GetFreeSpacePointer();
@@ -228,18 +218,15 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
   delete_tuple.rid_ = rid;
   delete_tuple.allocated_ = true;
 
-  /**
-   * Removed to support new lock manager API for p4 (multilevel locking); Big hack energy
-   * This clause was used in logging and recovery projects previously; not being used right now
-   */
-  //  if (enable_logging) {
-  //    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own the exclusive lock!");
-  //
-  //    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE, rid, delete_tuple);
-  //    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-  //    SetLSN(lsn);
-  //    txn->SetPrevLSN(lsn);
-  //  }
+  if (IsLogged(txn, log_manager)) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE, rid, delete_tuple);
+    AppendLogRecord(&log_record, txn, log_manager);
+  } else if (enable_logging && log_manager != nullptr) {
+    // Garbage collection frees the slot without a transaction. Redo has to free it as well before the slot is reused,
+    // but there is nothing to undo: the record belongs to no transaction.
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::APPLYDELETE, rid, delete_tuple);
+    SetLSN(log_manager->AppendLogRecord(&log_record));
+  }
 
   uint32_t free_space_pointer = GetFreeSpacePointer();
   BUSTUB_ASSERT(tuple_offset >= free_space_pointer, "Free space appears before tuples.");
@@ -261,16 +248,11 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
 
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager) {
   // Log the rollback.
-  /**
-   * Removed to support new lock manager API for p4 (multilevel locking); Big hack energy
-   * This clause was used in logging and recovery projects previously; not being used right now
-   */
-  //  if (enable_logging) {
-  //    BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own an exclusive lock on the RID.");
-  //    Tuple dummy_tuple;
-  //    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE, rid,
-  //    dummy_tuple); lsn_t lsn = log_manager->AppendLogRecord(&log_record); SetLSN(lsn); txn->SetPrevLSN(lsn);
-  //  }
+  if (IsLogged(txn, log_manager)) {
+    Tuple dummy_tuple;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE, rid, dummy_tuple);
+    AppendLogRecord(&log_record, txn, log_manager);
+  }
 
   uint32_t slot_num = rid.GetSlotNum();
   BUSTUB_ASSERT(slot_num < GetTupleCount(), "We can't have more slots than tuples.");
@@ -282,6 +264,19 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log
   }
 }
 
+auto TablePage::IsLogged(Transaction *txn, LogManager *log_manager) -> bool {
+  return enable_logging && txn != nullptr && log_manager != nullptr;
+}
+
+void TablePage::AppendLogRecord(LogRecord *log_record, Transaction *txn, LogManager *log_manager) {
+  if (txn->IsRollingBack()) {
+    log_record->SetUndoNext(txn->GetUndoNextLSN());
+  }
+  lsn_t lsn = log_manager->AppendLogRecord(log_record);
+  SetLSN(lsn);
+  txn->SetPrevLSN(lsn);
+}
+
 auto TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) -> bool {
   // Get the current slot number.
   uint32_t slot_num = rid.GetSlotNum();
@@ -326,10 +321,10 @@ auto TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
   return true;
 }
 
-auto TablePage::GetFirstTupleRid(RID *first_rid) -> bool {
+auto TablePage::GetFirstTupleRid(RID *first_rid, bool include_deleted) -> bool {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (!IsDeleted(include_deleted ? UnsetDeletedFlag(GetTupleSize(i)) : GetTupleSize(i))) {
       first_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -338,11 +333,11 @@ auto TablePage::GetFirstTupleRid(RID *first_rid) -> bool {
   return false;
 }
 
-auto TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid) -> bool {
+auto TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted) -> bool {
   BUSTUB_ASSERT(cur_rid.GetPageId() == GetTablePageId(), "Wrong table!");
   // Find and return the first valid tuple after our current slot number.
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (!IsDeleted(include_deleted ? UnsetDeletedFlag(GetTupleSize(i)) : GetTupleSize(i))) {
       next_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -13,6 +13,7 @@
 #include <cassert>
 
 #include "common/logger.h"
+#include "concurrency/transaction_manager.h"
 #include "fmt/format.h"
 #include "storage/table/table_heap.h"
 
@@ -47,6 +48,8 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  // a new page may be logged before the insert, there is nothing to undo of it
+  lsn_t prev_lsn = txn->GetPrevLSN();
 
   cur_page->WLatch();
 
@@ -82,53 +85,43 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
       cur_page = new_page;
     }
   }
+  // The new tuple did not exist before, older snapshots must not see it.
+  if (TransactionManager::SavesVersions(txn)) {
+    bool first_write;
+    version_store_.BeginWrite(txn, *rid, nullptr, &first_write);
+    txn->SetVersionedWrites(true);
+  }
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
   // Update the transaction's write set.
-  txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
+  txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this, prev_lsn);
   return true;
 }
 
 auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
-  // TODO(Amadou): remove empty page
-  // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
-  // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
-    txn->SetState(TransactionState::ABORTED);
-    return false;
+  // An optimistic transaction installs its deletes at commit; rollbacks always go to the page.
+  if (txn->IsOptimistic() && txn->GetState() != TransactionState::ABORTED) {
+    txn->GetBufferedWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
+    return true;
   }
-  // Otherwise, mark the tuple as deleted.
-  page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
-  // Update the transaction's write set.
-  txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
-  return true;
+  return MarkDeleteInPlace(rid, txn);
 }
 
 auto TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) -> bool {
-  // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
-  // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
-    txn->SetState(TransactionState::ABORTED);
-    return false;
-  }
-  // Update the tuple; but first save the old value for rollbacks.
-  Tuple old_tuple;
-  page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
-  // Update the transaction's write set.
-  if (is_updated && txn->GetState() != TransactionState::ABORTED) {
-    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+  // An optimistic transaction installs its updates at commit; rollbacks always go to the page.
+  if (txn->IsOptimistic() && txn->GetState() != TransactionState::ABORTED) {
+    txn->GetBufferedWriteSet()->emplace_back(rid, WType::UPDATE, tuple, this);
+    return true;
   }
-  return is_updated;
+  return UpdateTupleInPlace(tuple, rid, txn);
+}
+
+auto TableHeap::InstallWrite(const TableWriteRecord &record, Transaction *txn) -> bool {
+  bool installed = record.wtype_ == WType::DELETE ? MarkDeleteInPlace(record.rid_, txn)
+                                                  : UpdateTupleInPlace(record.tuple_, record.rid_, txn);
+  return installed && txn->GetState() != TransactionState::ABORTED;
 }
 
 void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
@@ -157,6 +150,21 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
 }
 
 auto TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, bool acquire_read_lock) -> bool {
+  // An optimistic transaction reads its own buffered writes first, and validates everything else it reads.
+  if (txn != nullptr && txn->IsOptimistic()) {
+    auto buffered_write_set = txn->GetBufferedWriteSet();
+    for (auto it = buffered_write_set->rbegin(); it != buffered_write_set->rend(); ++it) {
+      if (it->table_ == this && it->rid_ == rid) {
+        if (it->wtype_ == WType::DELETE) {
+          return false;
+        }
+        *tuple = it->tuple_;
+        tuple->rid_ = rid;
+        return true;
+      }
+    }
+    txn->GetReadSet()->emplace_back(rid, this);
+  }
   // Find the page which contains the tuple.
   auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -164,11 +172,23 @@ auto TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, bool ac
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
-  // Read the tuple from the page.
+  // Read the tuple from the page, or the version of the snapshot of the transaction.
   if (acquire_read_lock) {
     page->RLatch();
   }
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res = false;
+  switch (IsSnapshotRead(txn) ? version_store_.GetVisible(txn, rid, tuple) : VersionStore::Visibility::IN_PLACE) {
+    case VersionStore::Visibility::IN_PLACE:
+      res = page->GetTuple(rid, tuple, txn, lock_manager_);
+      break;
+    case VersionStore::Visibility::UNDO:
+      tuple->rid_ = rid;
+      res = true;
+      break;
+    case VersionStore::Visibility::INVISIBLE:
+      res = false;
+      break;
+  }
   if (acquire_read_lock) {
     page->RUnlatch();
   }
@@ -185,7 +205,7 @@ auto TableHeap::Begin(Transaction *txn) -> TableIterator {
     auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
     page->RLatch();
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
+    auto found_tuple = page->GetFirstTupleRid(&rid, IsSnapshotRead(txn));
     page->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, false);
     if (found_tuple) {
@@ -196,6 +216,84 @@ auto TableHeap::Begin(Transaction *txn) -> TableIterator {
   return {this, rid, txn};
 }
 
+auto TableHeap::MarkDeleteInPlace(const RID &rid, Transaction *txn) -> bool {
+  // TODO(Amadou): remove empty page
+  // Find the page which contains the tuple.
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  // If the page could not be found, then abort the transaction.
+  if (page == nullptr) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  // Otherwise, keep the old version and mark the tuple as deleted.
+  page->WLatch();
+  bool first_write = false;
+  if (!BeginWrite(page, rid, txn, &first_write)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
+  lsn_t prev_lsn = txn->GetPrevLSN();
+  bool is_marked = page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  if (!is_marked && first_write) {
+    version_store_.Abort(txn->GetTransactionId(), rid);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_marked);
+  // Update the transaction's write set.
+  if (is_marked) {
+    txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this, prev_lsn);
+  }
+  return is_marked;
+}
+
+auto TableHeap::UpdateTupleInPlace(const Tuple &tuple, const RID &rid, Transaction *txn) -> bool {
+  // Find the page which contains the tuple.
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  // If the page could not be found, then abort the transaction.
+  if (page == nullptr) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  // Update the tuple; but first save the old value for rollbacks and older snapshots.
+  Tuple old_tuple;
+  page->WLatch();
+  bool first_write = false;
+  if (!BeginWrite(page, rid, txn, &first_write)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
+  lsn_t prev_lsn = txn->GetPrevLSN();
+  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  if (!is_updated && first_write) {
+    version_store_.Abort(txn->GetTransactionId(), rid);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
+  // Update the transaction's write set.
+  if (is_updated && txn->GetState() != TransactionState::ABORTED) {
+    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this, prev_lsn);
+  }
+  return is_updated;
+}
+
+auto TableHeap::IsSnapshotRead(Transaction *txn) -> bool { return txn != nullptr && txn->IsSnapshotRead(); }
+
+auto TableHeap::BeginWrite(TablePage *page, const RID &rid, Transaction *txn, bool *first_write) -> bool {
+  // rollbacks restore the version that is already saved
+  if (txn->GetState() == TransactionState::ABORTED || !TransactionManager::SavesVersions(txn)) {
+    return true;
+  }
+  Tuple before;
+  if (!page->GetTuple(rid, &before, txn, lock_manager_)) {
+    // the page write fails on its own
+    return true;
+  }
+  txn->SetVersionedWrites(true);
+  return version_store_.BeginWrite(txn, rid, &before, first_write);
+}
+
 auto TableHeap::End() -> TableIterator { return {this, RID(INVALID_PAGE_ID, 0), nullptr}; }
 
 }  // namespace bustub
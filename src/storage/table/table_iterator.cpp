@@ -22,7 +22,11 @@ TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
     : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     if (!table_heap_->GetTuple(tuple_->rid_, tuple_, txn_)) {
-      throw bustub::Exception("read non-existing tuple");
+      // a snapshot read skips tuples that did not exist at its snapshot
+      if (!TableHeap::IsSnapshotRead(txn_)) {
+        throw bustub::Exception("read non-existing tuple");
+      }
+      ++(*this);
     }
   }
 }
@@ -42,27 +46,34 @@ auto TableIterator::operator++() -> TableIterator & {
   auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
   BUSTUB_ENSURE(cur_page != nullptr, "BPM full");  // all pages are pinned
 
+  // a snapshot read also visits tuples that are only marked as deleted, their older versions may be visible
+  bool snapshot_read = TableHeap::IsSnapshotRead(txn_);
   cur_page->RLatch();
-  RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 &next_tuple_rid)) {  // end of this page
-    while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
-        break;
+  while (true) {
+    RID next_tuple_rid;
+    if (!cur_page->GetNextTupleRid(tuple_->rid_, &next_tuple_rid, snapshot_read)) {  // end of this page
+      while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
+        auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+        cur_page->RUnlatch();
+        buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
+        cur_page = next_page;
+        cur_page->RLatch();
+        if (cur_page->GetFirstTupleRid(&next_tuple_rid, snapshot_read)) {
+          break;
+        }
       }
     }
-  }
-  tuple_->rid_ = next_tuple_rid;
+    tuple_->rid_ = next_tuple_rid;
 
-  if (*this != table_heap_->End()) {
+    if (*this == table_heap_->End()) {
+      break;
+    }
     // DO NOT ACQUIRE READ LOCK twice in a single thread otherwise it may deadlock.
     // See https://users.rust-lang.org/t/how-bad-is-the-potential-deadlock-mentioned-in-rwlocks-document/67234
-    if (!table_heap_->GetTuple(tuple_->rid_, tuple_, txn_, false)) {
+    if (table_heap_->GetTuple(tuple_->rid_, tuple_, txn_, false)) {
+      break;
+    }
+    if (!snapshot_read) {
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
       throw bustub::Exception("read non-existing tuple");
@@ -13,6 +13,7 @@
 #include "binder/binder.h"
 #include <memory>
 #include "binder/bound_statement.h"
+#include "binder/statement/index_statement.h"
 #include "catalog/catalog.h"
 #include "gtest/gtest.h"
 
@@ -147,6 +148,18 @@ TEST(BinderTest, BindInsert) { TryBind("INSERT INTO y VALUES (1,2,3,4,5), (6,7,8
 
 TEST(BinderTest, BindInsertSelect) { TryBind("INSERT INTO y SELECT * FROM y WHERE x < 500"); }
 
+TEST(BinderTest, BindCreateIndex) {
+  auto statements = TryBind(
+      "CREATE INDEX i1 ON y(x); CREATE INDEX i2 ON y USING art (z); CREATE INDEX i3 ON y(a); "
+      "CREATE INDEX i4 ON y USING bwtree (b)");
+  ASSERT_EQ(statements.size(), 4);
+  EXPECT_EQ(dynamic_cast<const IndexStatement &>(*statements[0]).index_type_, IndexType::BPlusTreeIndex);
+  EXPECT_EQ(dynamic_cast<const IndexStatement &>(*statements[1]).index_type_, IndexType::ARTIndex);
+  EXPECT_EQ(dynamic_cast<const IndexStatement &>(*statements[2]).index_type_, IndexType::BPlusTreeIndex);
+  EXPECT_EQ(dynamic_cast<const IndexStatement &>(*statements[3]).index_type_, IndexType::BwTreeIndex);
+  EXPECT_THROW(TryBind("CREATE INDEX i5 ON y USING hash (c)"), NotImplementedException);
+}
+
 TEST(BinderTest, BindVarchar) {
   TryBind(R"(INSERT INTO c VALUES ('1', '2'))");
   TryBind(R"(INSERT INTO c VALUES ('', ''))");
@@ -18,12 +18,13 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
+#include "recovery/log_manager.h"
 
 namespace bustub {
 
 // NOLINTNEXTLINE
 // Check whether pages containing terminal characters can be recovered
-TEST(BufferPoolManagerInstanceTest, DISABLED_BinaryDataTest) {
+TEST(BufferPoolManagerInstanceTest, BinaryDataTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 10;
   const size_t k = 5;
@@ -89,7 +90,7 @@ TEST(BufferPoolManagerInstanceTest, DISABLED_BinaryDataTest) {
 }
 
 // NOLINTNEXTLINE
-TEST(BufferPoolManagerInstanceTest, DISABLED_SampleTest) {
+TEST(BufferPoolManagerInstanceTest, SampleTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 10;
   const size_t k = 5;
@@ -145,4 +146,60 @@ TEST(BufferPoolManagerInstanceTest, DISABLED_SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+// Check that a page ahead of the log is evicted last, and only after the log holds its changes
+TEST(BufferPoolManagerInstanceTest, WalEvictionTest) {
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(2, disk_manager, 2, log_manager);
+  // no flush thread, the log only moves when it is flushed
+  enable_logging = true;
+
+  // page a is the least recently used one, its change is not in the durable log; page b's change is
+  page_id_t page_a;
+  page_id_t page_b;
+  page_id_t page_id_temp;
+  Page *page = bpm->NewPage(&page_a);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "a");
+  page = bpm->NewPage(&page_b);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), BUSTUB_PAGE_SIZE, "b");
+  LogRecord record_b(0, INVALID_LSN, LogRecordType::BEGIN);
+  page->SetLSN(log_manager->AppendLogRecord(&record_b));
+  log_manager->Flush();
+  LogRecord record_a(1, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t lsn_a = log_manager->AppendLogRecord(&record_a);
+  bpm->FetchPage(page_a)->SetLSN(lsn_a);
+  ASSERT_TRUE(bpm->UnpinPage(page_a, true));
+  ASSERT_TRUE(bpm->UnpinPage(page_a, true));
+  ASSERT_TRUE(bpm->UnpinPage(page_b, true));
+
+  // Scenario: the new page takes the frame of page b, the log is not forced
+  lsn_t persistent_lsn = log_manager->GetPersistentLSN();
+  ASSERT_LT(persistent_lsn, lsn_a);
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(persistent_lsn, log_manager->GetPersistentLSN());
+  char data[BUSTUB_PAGE_SIZE];
+  disk_manager->ReadPage(page_b, data);
+  EXPECT_EQ(0, strcmp(data, "b"));
+
+  // Scenario: page a is the only choice left, the log is forced up to its change before it is written
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_GE(log_manager->GetPersistentLSN(), lsn_a);
+  disk_manager->ReadPage(page_a, data);
+  EXPECT_EQ(0, strcmp(data, "a"));
+
+  enable_logging = false;
+  disk_manager->ShutDown();
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+}
+
 }  // namespace bustub
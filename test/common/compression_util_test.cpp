@@ -0,0 +1,70 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util_test.cpp
+//
+// Identification: test/common/compression_util_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/compression_util.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+namespace {
+
+auto RoundTrip(const std::string &data) -> size_t {
+  std::vector<char> compressed(CompressionUtil::MaxCompressedSize(data.size()));
+  size_t compressed_size = CompressionUtil::Compress(data.data(), data.size(), compressed.data());
+  EXPECT_LE(compressed_size, compressed.size());
+  std::string decompressed(data.size(), '\0');
+  EXPECT_TRUE(CompressionUtil::Decompress(compressed.data(), compressed_size, decompressed.data(), data.size()));
+  EXPECT_EQ(data, decompressed);
+  return compressed_size;
+}
+
+}  // namespace
+
+TEST(CompressionUtilTest, RoundTripTest) {
+  EXPECT_EQ(1, RoundTrip(""));
+  RoundTrip("short");
+
+  // repetitive data shrinks, long runs included
+  std::string repetitive;
+  for (int i = 0; i < 1000; i++) {
+    repetitive += "record " + std::to_string(i % 10) + std::string(i % 300, 'x');
+  }
+  EXPECT_LT(RoundTrip(repetitive), repetitive.size() / 10);
+
+  // random data stays within the bound
+  std::mt19937 generator(42);
+  std::string random(100000, '\0');
+  for (auto &c : random) {
+    c = static_cast<char>(generator());
+  }
+  EXPECT_LE(RoundTrip(random), CompressionUtil::MaxCompressedSize(random.size()));
+}
+
+TEST(CompressionUtilTest, CorruptBlockTest) {
+  std::string data(1000, 'a');
+  std::vector<char> compressed(CompressionUtil::MaxCompressedSize(data.size()));
+  size_t compressed_size = CompressionUtil::Compress(data.data(), data.size(), compressed.data());
+  std::string decompressed(data.size(), '\0');
+
+  // a block that is cut off or decompresses to another size is rejected
+  EXPECT_FALSE(CompressionUtil::Decompress(compressed.data(), compressed_size - 1, decompressed.data(), data.size()));
+  EXPECT_FALSE(CompressionUtil::Decompress(compressed.data(), compressed_size, decompressed.data(), data.size() - 1));
+  // as is a match before the start of the block
+  compressed[2] = static_cast<char>(0xff);
+  compressed[3] = static_cast<char>(0xff);
+  EXPECT_FALSE(CompressionUtil::Decompress(compressed.data(), compressed_size, decompressed.data(), data.size()));
+}
+
+}  // namespace bustub
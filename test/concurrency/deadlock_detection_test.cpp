@@ -2,9 +2,12 @@
  * deadlock_detection_test.cpp
  */
 
+#include <algorithm>
 #include <atomic>
 #include <random>
 #include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -21,7 +24,7 @@
       << "Test Failed Due to Time Out";
 
 namespace bustub {
-TEST(LockManagerDeadlockDetectionTest, DISABLED_EdgeTest) {
+TEST(LockManagerDeadlockDetectionTest, EdgeTest) {
   LockManager lock_mgr{};
 
   const int num_nodes = 100;
@@ -63,7 +66,7 @@ TEST(LockManagerDeadlockDetectionTest, DISABLED_EdgeTest) {
   }
 }
 
-TEST(LockManagerDeadlockDetectionTest, DISABLED_BasicDeadlockDetectionTest) {
+TEST(LockManagerDeadlockDetectionTest, BasicDeadlockDetectionTest) {
   LockManager lock_mgr{};
   TransactionManager txn_mgr{&lock_mgr};
 
@@ -122,4 +125,185 @@ TEST(LockManagerDeadlockDetectionTest, DISABLED_BasicDeadlockDetectionTest) {
   delete txn0;
   delete txn1;
 }
+
+TEST(LockManagerDeadlockDetectionTest, WaitsForGraphTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  table_oid_t toid{0};
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  auto *txn2 = txn_mgr.Begin();
+
+  EXPECT_TRUE(lock_mgr.LockTable(txn0, LockManager::LockMode::EXCLUSIVE, toid));
+  std::thread t1([&] { EXPECT_TRUE(lock_mgr.LockTable(txn1, LockManager::LockMode::SHARED, toid)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::thread t2([&] { EXPECT_TRUE(lock_mgr.LockTable(txn2, LockManager::LockMode::EXCLUSIVE, toid)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // the blocked requests add their edges, txn 2 waits for the holder and for the shared request ahead of it
+  auto edges = lock_mgr.GetEdgeList();
+  std::sort(edges.begin(), edges.end());
+  std::vector<std::pair<txn_id_t, txn_id_t>> expected{{1, 0}, {2, 0}, {2, 1}};
+  EXPECT_EQ(expected, edges);
+
+  // granted requests remove them
+  lock_mgr.UnlockTable(txn0, toid);
+  t1.join();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  edges = lock_mgr.GetEdgeList();
+  expected = {{2, 1}};
+  EXPECT_EQ(expected, edges);
+
+  lock_mgr.UnlockTable(txn1, toid);
+  t2.join();
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+
+  txn_mgr.Commit(txn0);
+  txn_mgr.Commit(txn1);
+  txn_mgr.Commit(txn2);
+  delete txn0;
+  delete txn1;
+  delete txn2;
+}
+
+TEST(LockManagerDeadlockDetectionTest, GrantRemovesEdgesTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t toid{0};
+
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(txn0, LockManager::LockMode::EXCLUSIVE, toid));
+  std::thread t1([&] { EXPECT_TRUE(lock_mgr.LockTable(txn1, LockManager::LockMode::EXCLUSIVE, toid)); });
+  while (lock_mgr.GetEdgeList().empty()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ((std::vector<std::pair<txn_id_t, txn_id_t>>{{txn1->GetTransactionId(), txn0->GetTransactionId()}}),
+            lock_mgr.GetEdgeList());
+
+  // the grant removes the edges of txn1, whether or not it woke up yet
+  EXPECT_TRUE(lock_mgr.UnlockTable(txn0, toid));
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+  t1.join();
+  txn_mgr.Commit(txn0);
+  txn_mgr.Commit(txn1);
+  delete txn0;
+  delete txn1;
+}
+
+TEST(LockManagerDeadlockDetectionTest, WaitDieTest) {
+  LockManager lock_mgr{LockManager::DeadlockPolicy::WAIT_DIE};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  table_oid_t toid{0};
+  RID rid0{0, 0};
+  RID rid1{1, 1};
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(txn0, LockManager::LockMode::INTENTION_EXCLUSIVE, toid));
+  EXPECT_TRUE(lock_mgr.LockTable(txn1, LockManager::LockMode::INTENTION_EXCLUSIVE, toid));
+  EXPECT_TRUE(lock_mgr.LockRow(txn0, LockManager::LockMode::EXCLUSIVE, toid, rid0));
+  EXPECT_TRUE(lock_mgr.LockRow(txn1, LockManager::LockMode::EXCLUSIVE, toid, rid1));
+
+  // the older txn0 waits for txn1
+  std::thread t0([&] {
+    EXPECT_TRUE(lock_mgr.LockRow(txn0, LockManager::LockMode::EXCLUSIVE, toid, rid1));
+    txn_mgr.Commit(txn0);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(TransactionState::GROWING, txn0->GetState());
+
+  // the younger txn1 dies right away instead of waiting for txn0
+  EXPECT_FALSE(lock_mgr.LockRow(txn1, LockManager::LockMode::EXCLUSIVE, toid, rid0));
+  EXPECT_EQ(TransactionState::ABORTED, txn1->GetState());
+  txn_mgr.Abort(txn1);
+
+  t0.join();
+  EXPECT_EQ(TransactionState::COMMITTED, txn0->GetState());
+  delete txn0;
+  delete txn1;
+}
+
+TEST(LockManagerDeadlockDetectionTest, WoundWaitTest) {
+  LockManager lock_mgr{LockManager::DeadlockPolicy::WOUND_WAIT};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  table_oid_t toid{0};
+  RID rid0{0, 0};
+  RID rid1{1, 1};
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(txn0, LockManager::LockMode::INTENTION_EXCLUSIVE, toid));
+  EXPECT_TRUE(lock_mgr.LockTable(txn1, LockManager::LockMode::INTENTION_EXCLUSIVE, toid));
+  EXPECT_TRUE(lock_mgr.LockRow(txn0, LockManager::LockMode::EXCLUSIVE, toid, rid0));
+  EXPECT_TRUE(lock_mgr.LockRow(txn1, LockManager::LockMode::EXCLUSIVE, toid, rid1));
+
+  // the younger txn1 waits for txn0
+  std::thread t1([&] {
+    EXPECT_FALSE(lock_mgr.LockRow(txn1, LockManager::LockMode::EXCLUSIVE, toid, rid0));
+    EXPECT_EQ(TransactionState::ABORTED, txn1->GetState());
+    txn_mgr.Abort(txn1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(TransactionState::GROWING, txn1->GetState());
+
+  // the older txn0 wounds the waiting txn1 and gets the lock once txn1 rolled back
+  EXPECT_TRUE(lock_mgr.LockRow(txn0, LockManager::LockMode::EXCLUSIVE, toid, rid1));
+  EXPECT_EQ(TransactionState::GROWING, txn0->GetState());
+  txn_mgr.Commit(txn0);
+
+  t1.join();
+  delete txn0;
+  delete txn1;
+}
+
+TEST(LockManagerDeadlockDetectionTest, WoundCommittingTest) {
+  LockManager lock_mgr{LockManager::DeadlockPolicy::WOUND_WAIT};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t toid{0};
+
+  // txn1 is in the middle of its commit, it holds its lock until the commit releases it
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(txn1, LockManager::LockMode::EXCLUSIVE, toid));
+  txn1->SetState(TransactionState::COMMITTED);
+  std::thread t0([&] { EXPECT_TRUE(lock_mgr.LockTable(txn0, LockManager::LockMode::EXCLUSIVE, toid)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // the older txn0 does not turn the committing txn1 into an aborted one
+  EXPECT_EQ(TransactionState::COMMITTED, txn1->GetState());
+  EXPECT_TRUE(txn_mgr.Commit(txn1));
+  t0.join();
+  EXPECT_TRUE(txn_mgr.Commit(txn0));
+  delete txn0;
+  delete txn1;
+
+  // txn3 is wounded before it gets to commit, the commit rolls it back instead
+  auto *txn2 = txn_mgr.Begin();
+  auto *txn3 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(txn3, LockManager::LockMode::EXCLUSIVE, toid));
+  std::thread t2([&] { EXPECT_TRUE(lock_mgr.LockTable(txn2, LockManager::LockMode::EXCLUSIVE, toid)); });
+  while (txn3->GetState() != TransactionState::ABORTED) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(txn_mgr.Commit(txn3));
+  t2.join();
+  EXPECT_TRUE(txn_mgr.Commit(txn2));
+  delete txn2;
+  delete txn3;
+
+  // the younger transaction commits while the older one requests its lock, it either commits or is wounded first
+  for (int round = 0; round < 100; round++) {
+    auto *older = txn_mgr.Begin();
+    auto *younger = txn_mgr.Begin();
+    EXPECT_TRUE(lock_mgr.LockTable(younger, LockManager::LockMode::EXCLUSIVE, toid));
+    std::thread requester([&] { EXPECT_TRUE(lock_mgr.LockTable(older, LockManager::LockMode::EXCLUSIVE, toid)); });
+    bool committed = txn_mgr.Commit(younger);
+    EXPECT_EQ(committed ? TransactionState::COMMITTED : TransactionState::ABORTED, younger->GetState());
+    requester.join();
+    EXPECT_TRUE(txn_mgr.Commit(older));
+    delete older;
+    delete younger;
+  }
+}
 }  // namespace bustub
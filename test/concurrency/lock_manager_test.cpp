@@ -4,8 +4,11 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <atomic>
 #include <random>
+#include <set>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/transaction_manager.h"
@@ -109,7 +112,7 @@ void TableLockTest1() {
     delete txns[i];
   }
 }
-TEST(LockManagerTest, DISABLED_TableLockTest1) { TableLockTest1(); }  // NOLINT
+TEST(LockManagerTest, TableLockTest1) { TableLockTest1(); }  // NOLINT
 
 /** Upgrading single transaction from S -> X */
 void TableLockUpgradeTest1() {
@@ -134,7 +137,7 @@ void TableLockUpgradeTest1() {
 
   delete txn1;
 }
-TEST(LockManagerTest, DISABLED_TableLockUpgradeTest1) { TableLockUpgradeTest1(); }  // NOLINT
+TEST(LockManagerTest, TableLockUpgradeTest1) { TableLockUpgradeTest1(); }  // NOLINT
 
 void RowLockTest1() {
   LockManager lock_mgr{};
@@ -190,7 +193,7 @@ void RowLockTest1() {
     delete txns[i];
   }
 }
-TEST(LockManagerTest, DISABLED_RowLockTest1) { RowLockTest1(); }  // NOLINT
+TEST(LockManagerTest, RowLockTest1) { RowLockTest1(); }  // NOLINT
 
 void TwoPLTest1() {
   LockManager lock_mgr{};
@@ -239,6 +242,188 @@ void TwoPLTest1() {
   delete txn;
 }
 
-TEST(LockManagerTest, DISABLED_TwoPLTest1) { TwoPLTest1(); }  // NOLINT
+TEST(LockManagerTest, TwoPLTest1) { TwoPLTest1(); }  // NOLINT
+
+/** Many transactions update overlapping sets of rows spread over all shards of the row lock table */
+void RowLockExclusionTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+
+  const int num_threads = 8;
+  const int txns_per_thread = 50;
+  const int rows_per_txn = 4;
+  const int num_rows = 100;
+  std::vector<int> counters(num_rows, 0);
+
+  auto task = [&](int tid) {
+    std::mt19937 rng(tid);
+    for (int i = 0; i < txns_per_thread; i++) {
+      // locking rows in ascending order cannot deadlock
+      std::set<int> rows;
+      while (rows.size() < static_cast<size_t>(rows_per_txn)) {
+        rows.insert(static_cast<int>(rng() % num_rows));
+      }
+      auto *txn = txn_mgr.Begin();
+      EXPECT_TRUE(lock_mgr.LockTable(txn, LockManager::LockMode::INTENTION_EXCLUSIVE, oid));
+      for (int row : rows) {
+        EXPECT_TRUE(lock_mgr.LockRow(txn, LockManager::LockMode::EXCLUSIVE, oid, RID(row, row)));
+        // the exclusive lock makes the read-modify-write atomic
+        counters[row]++;
+      }
+      CheckTxnRowLockSize(txn, oid, 0, rows_per_txn);
+      txn_mgr.Commit(txn);
+      CheckTxnRowLockSize(txn, oid, 0, 0);
+      delete txn;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(task, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int total = 0;
+  for (int counter : counters) {
+    total += counter;
+  }
+  EXPECT_EQ(num_threads * txns_per_thread * rows_per_txn, total);
+}
+TEST(LockManagerTest, RowLockExclusionTest) { RowLockExclusionTest(); }  // NOLINT
+
+/** Row locks beyond the threshold are escalated to a table lock */
+void LockEscalationTest() {
+  LockManager lock_mgr{};
+  lock_mgr.SetLockEscalationThreshold(10);
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+
+  auto *writer = txn_mgr.Begin();
+  auto *reader = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(writer, LockManager::LockMode::INTENTION_EXCLUSIVE, oid));
+  EXPECT_TRUE(lock_mgr.LockTable(reader, LockManager::LockMode::INTENTION_SHARED, oid));
+  EXPECT_TRUE(lock_mgr.LockRow(reader, LockManager::LockMode::SHARED, oid, RID(1, 0)));
+
+  // the reader's IS lock blocks X on the table, so the writer keeps its row locks
+  for (uint32_t i = 0; i < 20; i++) {
+    EXPECT_TRUE(lock_mgr.LockRow(writer, LockManager::LockMode::EXCLUSIVE, oid, RID(0, i)));
+  }
+  CheckTxnRowLockSize(writer, oid, 0, 20);
+  CheckTableLockSizes(writer, 0, 0, 0, 1, 0);
+  EXPECT_FALSE(writer->IsTableEscalated(oid));
+
+  // once the reader is gone the next row lock escalates
+  EXPECT_TRUE(lock_mgr.UnlockRow(reader, oid, RID(1, 0)));
+  EXPECT_TRUE(lock_mgr.UnlockTable(reader, oid));
+  txn_mgr.Commit(reader);
+  EXPECT_TRUE(lock_mgr.LockRow(writer, LockManager::LockMode::EXCLUSIVE, oid, RID(0, 20)));
+  CheckTxnRowLockSize(writer, oid, 0, 0);
+  CheckTableLockSizes(writer, 0, 1, 0, 0, 0);
+  EXPECT_TRUE(writer->IsTableEscalated(oid));
+
+  // rows are covered by the table lock from now on
+  EXPECT_TRUE(lock_mgr.LockRow(writer, LockManager::LockMode::EXCLUSIVE, oid, RID(0, 21)));
+  CheckTxnRowLockSize(writer, oid, 0, 0);
+  EXPECT_TRUE(lock_mgr.UnlockRow(writer, oid, RID(0, 21)));
+  CheckShrinking(writer);
+
+  txn_mgr.Commit(writer);
+  CheckTableLockSizes(writer, 0, 0, 0, 0, 0);
+  EXPECT_FALSE(writer->IsTableEscalated(oid));
+
+  // the table is free again
+  auto *other = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(other, LockManager::LockMode::EXCLUSIVE, oid));
+  txn_mgr.Commit(other);
+
+  delete writer;
+  delete reader;
+  delete other;
+}
+TEST(LockManagerTest, LockEscalationTest) { LockEscalationTest(); }  // NOLINT
+
+void LockHandoffTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+
+  auto *holder = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(holder, LockManager::LockMode::EXCLUSIVE, oid));
+
+  // two readers queue up, then a writer behind them
+  std::atomic<int> granted{0};
+  std::vector<Transaction *> waiters;
+  std::vector<std::thread> threads;
+  for (auto lock_mode : {LockManager::LockMode::SHARED, LockManager::LockMode::SHARED,
+                         LockManager::LockMode::EXCLUSIVE}) {
+    auto *txn = txn_mgr.Begin();
+    waiters.push_back(txn);
+    threads.emplace_back([&, txn, lock_mode] {
+      EXPECT_TRUE(lock_mgr.LockTable(txn, lock_mode, oid));
+      granted++;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  EXPECT_EQ(0, granted);
+
+  // the commit hands the lock to both readers, the writer keeps waiting for them
+  txn_mgr.Commit(holder);
+  threads[0].join();
+  threads[1].join();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(2, granted);
+  CheckTableLockSizes(holder, 0, 0, 0, 0, 0);
+
+  txn_mgr.Commit(waiters[0]);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(2, granted);
+  txn_mgr.Commit(waiters[1]);
+  threads[2].join();
+  EXPECT_EQ(3, granted);
+  txn_mgr.Commit(waiters[2]);
+
+  delete holder;
+  for (auto *txn : waiters) {
+    delete txn;
+  }
+}
+TEST(LockManagerTest, LockHandoffTest) { LockHandoffTest(); }  // NOLINT
+
+void RowQueueCleanupTest() {
+  LockManager lock_mgr{};
+  lock_mgr.SetLockEscalationThreshold(0);
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+
+  // a scan locks every row it reads until it commits
+  auto *scan = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(scan, LockManager::LockMode::INTENTION_EXCLUSIVE, oid));
+  const int rows = 100;
+  for (int slot = 0; slot < rows; slot++) {
+    EXPECT_TRUE(lock_mgr.LockRow(scan, LockManager::LockMode::SHARED, oid, RID{0, static_cast<uint32_t>(slot)}));
+  }
+  EXPECT_TRUE(lock_mgr.LockRow(scan, LockManager::LockMode::EXCLUSIVE, oid, RID{1, 0}));
+  EXPECT_EQ(rows + 1, lock_mgr.GetRowQueueCount());
+
+  // a writer queues up behind the exclusive row lock
+  auto *writer = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(writer, LockManager::LockMode::INTENTION_EXCLUSIVE, oid));
+  std::thread waiter([&] { EXPECT_TRUE(lock_mgr.LockRow(writer, LockManager::LockMode::EXCLUSIVE, oid, RID{1, 0})); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // the rows nobody waits for lose their queues with the commit, the last one with the writer's
+  txn_mgr.Commit(scan);
+  waiter.join();
+  EXPECT_EQ(1, lock_mgr.GetRowQueueCount());
+  txn_mgr.Commit(writer);
+  EXPECT_EQ(0, lock_mgr.GetRowQueueCount());
+
+  delete scan;
+  delete writer;
+}
+TEST(LockManagerTest, RowQueueCleanupTest) { RowQueueCleanupTest(); }  // NOLINT
 
 }  // namespace bustub
@@ -0,0 +1,137 @@
+/**
+ * transaction_manager_test.cpp
+ */
+
+#include "concurrency/transaction_manager.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "catalog/schema.h"
+#include "concurrency/lock_manager.h"
+#include "gtest/gtest.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+TEST(TransactionManagerTest, RegistryTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  EXPECT_EQ(txn0, TransactionManager::GetTransaction(txn0->GetTransactionId()));
+  EXPECT_EQ(txn1, TransactionManager::GetTransaction(txn1->GetTransactionId()));
+
+  // finished transactions are not running any more
+  txn_mgr.Commit(txn0);
+  txn_mgr.Abort(txn1);
+  EXPECT_EQ(nullptr, TransactionManager::GetTransaction(txn0->GetTransactionId()));
+  EXPECT_EQ(nullptr, TransactionManager::GetTransaction(txn1->GetTransactionId()));
+
+  delete txn0;
+  delete txn1;
+}
+
+TEST(TransactionManagerTest, CheckpointQuiescenceTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  auto *running = txn_mgr.Begin();
+
+  // the checkpoint waits for the running transaction
+  std::atomic<bool> blocked{false};
+  std::thread checkpoint([&] {
+    txn_mgr.BlockAllTransactions();
+    blocked = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(blocked);
+  txn_mgr.Commit(running);
+  checkpoint.join();
+  EXPECT_TRUE(blocked);
+
+  // new transactions wait for the checkpoint
+  std::atomic<bool> begun{false};
+  Transaction *waiting = nullptr;
+  std::thread begin([&] {
+    waiting = txn_mgr.Begin();
+    begun = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(begun);
+  txn_mgr.ResumeTransactions();
+  begin.join();
+  EXPECT_TRUE(begun);
+  txn_mgr.Commit(waiting);
+
+  delete running;
+  delete waiting;
+}
+
+TEST(TransactionManagerTest, UnversionedWritesTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  auto disk_manager = std::make_unique<DiskManagerUnlimitedMemory>();
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(10, disk_manager.get());
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  auto make_tuple = [&](int32_t value) {
+    return Tuple{std::vector<Value>{ValueFactory::GetIntegerValue(value)}, &schema};
+  };
+  auto value_of = [&](const Tuple &tuple) { return tuple.GetValue(&schema, 0).GetAs<int32_t>(); };
+
+  auto *setup = txn_mgr.Begin();
+  TableHeap table(bpm.get(), &lock_mgr, nullptr, setup);
+  RID kept;
+  RID deleted;
+  ASSERT_TRUE(table.InsertTuple(make_tuple(1), &kept, setup));
+  ASSERT_TRUE(table.InsertTuple(make_tuple(2), &deleted, setup));
+  txn_mgr.Commit(setup);
+  delete setup;
+
+  // without snapshot transactions a two-phase locking transaction saves no versions and deletes at commit
+  EXPECT_EQ(0, table.GetVersionStore()->Size());
+  auto *writer = txn_mgr.Begin();
+  ASSERT_TRUE(table.MarkDelete(deleted, writer));
+  ASSERT_TRUE(table.UpdateTuple(make_tuple(10), kept, writer));
+  EXPECT_EQ(0, table.GetVersionStore()->Size());
+
+  // a snapshot transaction waits until the writes without versions are committed
+  std::atomic<bool> begun{false};
+  Transaction *reader = nullptr;
+  std::thread begin([&] {
+    reader = txn_mgr.Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+    begun = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(begun);
+  EXPECT_TRUE(txn_mgr.Commit(writer));
+  delete writer;
+  begin.join();
+  Tuple tuple;
+  EXPECT_FALSE(table.GetTuple(deleted, &tuple, reader));
+  ASSERT_TRUE(table.GetTuple(kept, &tuple, reader));
+  EXPECT_EQ(10, value_of(tuple));
+
+  // while the snapshot runs, the other transactions save the versions it reads
+  auto *updater = txn_mgr.Begin();
+  ASSERT_TRUE(table.UpdateTuple(make_tuple(20), kept, updater));
+  EXPECT_EQ(1, table.GetVersionStore()->Size());
+  EXPECT_TRUE(txn_mgr.Commit(updater));
+  delete updater;
+  ASSERT_TRUE(table.GetTuple(kept, &tuple, reader));
+  EXPECT_EQ(10, value_of(tuple));
+
+  // the last snapshot prunes the versions it kept alive
+  EXPECT_TRUE(txn_mgr.Commit(reader));
+  delete reader;
+  EXPECT_EQ(0, table.GetVersionStore()->Size());
+}
+
+}  // namespace bustub
@@ -0,0 +1,170 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store_test.cpp
+//
+// Identification: test/concurrency/version_store_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/version_store.h"
+
+#include <vector>
+
+#include "catalog/schema.h"
+#include "gtest/gtest.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+auto MakeTuple(const Schema &schema, int32_t value) -> Tuple {
+  return Tuple{std::vector<Value>{ValueFactory::GetIntegerValue(value)}, &schema};
+}
+
+auto ValueOf(const Schema &schema, const Tuple &tuple) -> int32_t {
+  return tuple.GetValue(&schema, 0).GetAs<int32_t>();
+}
+
+}  // namespace
+
+TEST(VersionStoreTest, SnapshotVisibilityTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  VersionStore store;
+  RID rid{0, 0};
+  bool first_write;
+  Tuple tuple;
+
+  // the tuple is inserted by txn 0 and committed at 1
+  Transaction inserter(0, IsolationLevel::SNAPSHOT_ISOLATION);
+  inserter.SetReadTs(0);
+  ASSERT_TRUE(store.BeginWrite(&inserter, rid, nullptr, &first_write));
+  EXPECT_TRUE(first_write);
+
+  Transaction early(1, IsolationLevel::SNAPSHOT_ISOLATION);
+  early.SetReadTs(0);
+  EXPECT_EQ(VersionStore::Visibility::INVISIBLE, store.GetVisible(&early, rid, &tuple));
+  EXPECT_EQ(VersionStore::Visibility::IN_PLACE, store.GetVisible(&inserter, rid, &tuple));
+  store.Commit(0, rid, 1);
+  EXPECT_EQ(VersionStore::Visibility::INVISIBLE, store.GetVisible(&early, rid, &tuple));
+
+  // txn 2 updates 10 to 20 and commits at 2
+  Transaction updater(2, IsolationLevel::SNAPSHOT_ISOLATION);
+  updater.SetReadTs(1);
+  Tuple before = MakeTuple(schema, 10);
+  ASSERT_TRUE(store.BeginWrite(&updater, rid, &before, &first_write));
+  EXPECT_TRUE(first_write);
+  Tuple again = MakeTuple(schema, 20);
+  ASSERT_TRUE(store.BeginWrite(&updater, rid, &again, &first_write));
+  EXPECT_FALSE(first_write);
+
+  Transaction middle(3, IsolationLevel::SNAPSHOT_ISOLATION);
+  middle.SetReadTs(1);
+  ASSERT_EQ(VersionStore::Visibility::UNDO, store.GetVisible(&middle, rid, &tuple));
+  EXPECT_EQ(10, ValueOf(schema, tuple));
+  store.Commit(2, rid, 2);
+  ASSERT_EQ(VersionStore::Visibility::UNDO, store.GetVisible(&middle, rid, &tuple));
+  EXPECT_EQ(10, ValueOf(schema, tuple));
+  EXPECT_EQ(VersionStore::Visibility::INVISIBLE, store.GetVisible(&early, rid, &tuple));
+
+  Transaction late(4, IsolationLevel::SNAPSHOT_ISOLATION);
+  late.SetReadTs(2);
+  EXPECT_EQ(VersionStore::Visibility::IN_PLACE, store.GetVisible(&late, rid, &tuple));
+}
+
+TEST(VersionStoreTest, WriteConflictTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  VersionStore store;
+  RID rid{0, 0};
+  bool first_write;
+  Tuple before = MakeTuple(schema, 10);
+
+  Transaction txn0(0, IsolationLevel::SNAPSHOT_ISOLATION);
+  Transaction txn1(1, IsolationLevel::SNAPSHOT_ISOLATION);
+  txn0.SetReadTs(0);
+  txn1.SetReadTs(0);
+
+  // first updater wins while it is active
+  ASSERT_TRUE(store.BeginWrite(&txn0, rid, &before, &first_write));
+  EXPECT_FALSE(store.BeginWrite(&txn1, rid, &before, &first_write));
+  EXPECT_EQ(TransactionState::ABORTED, txn1.GetState());
+
+  // and after it committed past the snapshot of the other writer
+  store.Commit(0, rid, 1);
+  Transaction txn2(2, IsolationLevel::SNAPSHOT_ISOLATION);
+  txn2.SetReadTs(0);
+  EXPECT_FALSE(store.BeginWrite(&txn2, rid, &before, &first_write));
+  EXPECT_EQ(TransactionState::ABORTED, txn2.GetState());
+
+  // a writer that sees the committed version may overwrite it
+  Transaction txn3(3, IsolationLevel::SNAPSHOT_ISOLATION);
+  txn3.SetReadTs(1);
+  EXPECT_TRUE(store.BeginWrite(&txn3, rid, &before, &first_write));
+  EXPECT_EQ(TransactionState::GROWING, txn3.GetState());
+}
+
+TEST(VersionStoreTest, AbortAndPruneTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  VersionStore store;
+  RID rid{0, 0};
+  bool first_write;
+  Tuple tuple;
+
+  Transaction txn0(0, IsolationLevel::SNAPSHOT_ISOLATION);
+  txn0.SetReadTs(0);
+  Tuple before = MakeTuple(schema, 10);
+  ASSERT_TRUE(store.BeginWrite(&txn0, rid, &before, &first_write));
+  EXPECT_EQ(1, store.Size());
+  store.Abort(0, rid);
+  EXPECT_EQ(0, store.Size());
+
+  Transaction txn1(1, IsolationLevel::SNAPSHOT_ISOLATION);
+  txn1.SetReadTs(0);
+  ASSERT_TRUE(store.BeginWrite(&txn1, rid, &before, &first_write));
+  store.Commit(1, rid, 1);
+  Transaction txn2(2, IsolationLevel::SNAPSHOT_ISOLATION);
+  txn2.SetReadTs(1);
+  Tuple middle = MakeTuple(schema, 20);
+  ASSERT_TRUE(store.BeginWrite(&txn2, rid, &middle, &first_write));
+  store.Commit(2, rid, 2);
+
+  // a snapshot at 1 still needs the version of txn 1
+  EXPECT_FALSE(store.Prune(rid, 1));
+  Transaction reader(3, IsolationLevel::SNAPSHOT_ISOLATION);
+  reader.SetReadTs(1);
+  ASSERT_EQ(VersionStore::Visibility::UNDO, store.GetVisible(&reader, rid, &tuple));
+  EXPECT_EQ(20, ValueOf(schema, tuple));
+
+  EXPECT_TRUE(store.Prune(rid, 2));
+  EXPECT_EQ(0, store.Size());
+  EXPECT_EQ(VersionStore::Visibility::IN_PLACE, store.GetVisible(&reader, rid, &tuple));
+}
+
+TEST(VersionStoreTest, LatestCommitTsTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  VersionStore store;
+  RID rid{0, 0};
+  bool first_write;
+  Tuple before = MakeTuple(schema, 10);
+
+  // without a chain the tuple is older than every snapshot, which is what optimistic validation relies on
+  EXPECT_EQ(0, store.LatestCommitTs(rid));
+
+  Transaction txn0(0, IsolationLevel::REPEATABLE_READ, ConcurrencyControl::OPTIMISTIC);
+  txn0.SetReadTs(0);
+  ASSERT_TRUE(store.BeginWrite(&txn0, rid, &before, &first_write));
+  EXPECT_EQ(0, store.LatestCommitTs(rid));
+  store.Commit(0, rid, 3);
+  EXPECT_EQ(3, store.LatestCommitTs(rid));
+
+  // an uncommitted writer does not change the newest committed version
+  Transaction txn1(1, IsolationLevel::REPEATABLE_READ);
+  ASSERT_TRUE(store.BeginWrite(&txn1, rid, &before, &first_write));
+  EXPECT_EQ(3, store.LatestCommitTs(rid));
+  store.Abort(1, rid);
+  EXPECT_EQ(3, store.LatestCommitTs(rid));
+}
+
+}  // namespace bustub
@@ -0,0 +1,150 @@
+/**
+ * adaptive_radix_tree_test.cpp
+ */
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "container/art/adaptive_radix_tree.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+namespace {
+
+// fixed width big endian keys are prefix free and share long prefixes
+auto IntKey(uint64_t key) -> std::string {
+  std::string encoded(8, '\0');
+  for (int i = 7; i >= 0; i--) {
+    encoded[i] = static_cast<char>(key & 0xFF);
+    key >>= 8;
+  }
+  return encoded;
+}
+
+}  // namespace
+
+TEST(AdaptiveRadixTreeTest, SampleTest) {
+  auto tree = std::make_unique<AdaptiveRadixTree>();
+  RID rid;
+
+  EXPECT_FALSE(tree->Get(IntKey(1), &rid));
+  EXPECT_TRUE(tree->Insert(IntKey(1), RID(1, 1)));
+  EXPECT_TRUE(tree->Insert(IntKey(2), RID(2, 2)));
+  EXPECT_FALSE(tree->Insert(IntKey(1), RID(3, 3)));
+
+  EXPECT_TRUE(tree->Get(IntKey(1), &rid));
+  EXPECT_EQ(RID(1, 1), rid);
+  EXPECT_TRUE(tree->Get(IntKey(2), &rid));
+  EXPECT_EQ(RID(2, 2), rid);
+  EXPECT_FALSE(tree->Get(IntKey(3), &rid));
+
+  EXPECT_TRUE(tree->Remove(IntKey(1)));
+  EXPECT_FALSE(tree->Remove(IntKey(1)));
+  EXPECT_FALSE(tree->Get(IntKey(1), &rid));
+  EXPECT_TRUE(tree->Get(IntKey(2), &rid));
+  EXPECT_EQ(RID(2, 2), rid);
+}
+
+TEST(AdaptiveRadixTreeTest, PathCompressionTest) {
+  auto tree = std::make_unique<AdaptiveRadixTree>();
+  // the keys share prefixes longer than the part of a prefix stored in a node
+  std::vector<std::string> keys = {std::string(20, 'a') + "x" + '\0', std::string(20, 'a') + "y" + '\0',
+                                   std::string(10, 'a') + "b" + '\0', std::string(30, 'a') + '\0'};
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_TRUE(tree->Insert(keys[i], RID(i, 0)));
+  }
+
+  RID rid;
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_TRUE(tree->Get(keys[i], &rid));
+    EXPECT_EQ(RID(i, 0), rid);
+  }
+  EXPECT_FALSE(tree->Get(std::string(20, 'a') + "z" + '\0', &rid));
+
+  std::vector<RID> result;
+  EXPECT_TRUE(tree->ScanPrefix(std::string(20, 'a'), &result));
+  EXPECT_EQ((std::vector<RID>{RID(3, 0), RID(0, 0), RID(1, 0)}), result);
+
+  // removing keys collapses the branches again
+  EXPECT_TRUE(tree->Remove(keys[0]));
+  EXPECT_TRUE(tree->Remove(keys[3]));
+  EXPECT_TRUE(tree->Get(keys[1], &rid));
+  EXPECT_EQ(RID(1, 0), rid);
+  EXPECT_TRUE(tree->Get(keys[2], &rid));
+  EXPECT_EQ(RID(2, 0), rid);
+  result.clear();
+  EXPECT_TRUE(tree->ScanPrefix(std::string(10, 'a'), &result));
+  EXPECT_EQ((std::vector<RID>{RID(1, 0), RID(2, 0)}), result);
+}
+
+TEST(AdaptiveRadixTreeTest, GrowAndShrinkTest) {
+  auto tree = std::make_unique<AdaptiveRadixTree>();
+  // 256 keys below a common prefix grow one node through all node types
+  for (uint64_t key = 0; key < 256; key++) {
+    EXPECT_TRUE(tree->Insert(IntKey((1 << 16) | key), RID(0, key)));
+  }
+  std::vector<RID> result;
+  EXPECT_TRUE(tree->ScanPrefix(IntKey(1 << 16).substr(0, 7), &result));
+  ASSERT_EQ(256U, result.size());
+  for (uint32_t key = 0; key < 256; key++) {
+    EXPECT_EQ(RID(0, key), result[key]);
+  }
+
+  // and removing them shrinks it back
+  for (uint64_t key = 0; key < 256; key++) {
+    EXPECT_TRUE(tree->Remove(IntKey((1 << 16) | key)));
+    RID rid;
+    for (uint64_t other = key + 1; other < 256; other += 17) {
+      EXPECT_TRUE(tree->Get(IntKey((1 << 16) | other), &rid));
+      EXPECT_EQ(RID(0, other), rid);
+    }
+  }
+  result.clear();
+  EXPECT_FALSE(tree->ScanPrefix(IntKey(1 << 16).substr(0, 7), &result));
+}
+
+TEST(AdaptiveRadixTreeTest, ConcurrentTest) {
+  const int num_threads = 4;
+  const uint64_t keys_per_thread = 20000;
+  auto tree = std::make_unique<AdaptiveRadixTree>();
+
+  // every thread inserts, reads back and removes its own keys, interleaved with the keys of the others
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&tree, tid] {
+      std::mt19937_64 rng(tid);
+      std::vector<uint64_t> keys;
+      for (uint64_t i = 0; i < keys_per_thread; i++) {
+        keys.push_back(i * num_threads + tid);
+      }
+      std::shuffle(keys.begin(), keys.end(), rng);
+      for (uint64_t key : keys) {
+        EXPECT_TRUE(tree->Insert(IntKey(key), RID(0, key)));
+      }
+      RID rid;
+      for (uint64_t key : keys) {
+        EXPECT_TRUE(tree->Get(IntKey(key), &rid));
+        EXPECT_EQ(RID(0, key), rid);
+      }
+      for (size_t i = 0; i < keys.size(); i += 2) {
+        EXPECT_TRUE(tree->Remove(IntKey(keys[i])));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<RID> result;
+  EXPECT_TRUE(tree->ScanPrefix("", &result));
+  EXPECT_EQ(num_threads * keys_per_thread / 2, result.size());
+  EXPECT_TRUE(std::is_sorted(result.begin(), result.end(),
+                             [](const RID &a, const RID &b) { return a.GetSlotNum() < b.GetSlotNum(); }));
+}
+
+}  // namespace bustub
@@ -10,7 +10,7 @@
 
 namespace bustub {
 
-TEST(ExtendibleHashTableTest, DISABLED_SampleTest) {
+TEST(ExtendibleHashTableTest, SampleTest) {
   auto table = std::make_unique<ExtendibleHashTable<int, std::string>>(2);
 
   table->Insert(1, "a");
@@ -42,7 +42,7 @@ TEST(ExtendibleHashTableTest, DISABLED_SampleTest) {
   EXPECT_FALSE(table->Remove(20));
 }
 
-TEST(ExtendibleHashTableTest, DISABLED_ConcurrentInsertTest) {
+TEST(ExtendibleHashTableTest, ConcurrentInsertTest) {
   const int num_runs = 50;
   const int num_threads = 3;
 
@@ -68,4 +68,45 @@ TEST(ExtendibleHashTableTest, DISABLED_ConcurrentInsertTest) {
   }
 }
 
+TEST(ExtendibleHashTableTest, ConcurrentMixedTest) {
+  const int num_threads = 4;
+  const int num_keys = 5000;
+  // a bucket spans several tag groups
+  auto table = std::make_unique<ExtendibleHashTable<int, int>>(20);
+
+  // every thread owns the keys that are equal to its id modulo num_threads
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([tid, &table]() {
+      for (int key = tid; key < num_keys; key += num_threads) {
+        table->Insert(key, key);
+      }
+      for (int key = tid; key < num_keys; key += num_threads) {
+        table->Insert(key, key * 2);
+      }
+      for (int key = tid; key < num_keys; key += 2 * num_threads) {
+        EXPECT_TRUE(table->Remove(key));
+      }
+      for (int key = tid; key < num_keys; key += num_threads) {
+        int val;
+        EXPECT_EQ((key / num_threads) % 2 != 0, table->Find(key, val));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // every second key of a thread was removed, the others hold their updated value
+  for (int key = 0; key < num_keys; key++) {
+    int val;
+    bool removed = (key / num_threads) % 2 == 0;
+    EXPECT_EQ(!removed, table->Find(key, val));
+    if (!removed) {
+      EXPECT_EQ(key * 2, val);
+    }
+  }
+}
+
 }  // namespace bustub
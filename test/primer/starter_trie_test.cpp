@@ -10,11 +10,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <bitset>
 #include <functional>
 #include <numeric>
 #include <random>
+#include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -304,4 +307,55 @@ TEST(StarterTrieTest, ConcurrentTest1) {
   threads.clear();
 }
 
+TEST(StarterTrieTest, ConcurrentReadWriteTest) {
+  Trie trie;
+  constexpr int num_stable = 256;
+  constexpr int num_writers = 2;
+  constexpr int num_readers = 4;
+  constexpr int num_rounds = 20;
+  for (int i = 0; i < num_stable; i++) {
+    EXPECT_TRUE(trie.Insert("stable" + std::to_string(i), i));
+  }
+
+  // readers must see every stable key while writers keep replacing the paths around them
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_writers; tid++) {
+    threads.emplace_back([&trie, tid] {
+      for (int round = 0; round < num_rounds; round++) {
+        for (int i = 0; i < 32; i++) {
+          std::string key = "stable" + std::to_string(i) + "w" + std::to_string(tid);
+          EXPECT_TRUE(trie.Insert(key, round));
+        }
+        for (int i = 0; i < 32; i++) {
+          std::string key = "stable" + std::to_string(i) + "w" + std::to_string(tid);
+          EXPECT_TRUE(trie.Remove(key));
+        }
+      }
+    });
+  }
+  for (int tid = 0; tid < num_readers; tid++) {
+    threads.emplace_back([&trie, &done] {
+      while (!done) {
+        for (int i = 0; i < num_stable; i++) {
+          bool success = false;
+          EXPECT_EQ(trie.GetValue<int>("stable" + std::to_string(i), &success), i);
+          EXPECT_TRUE(success);
+        }
+      }
+    });
+  }
+  for (int tid = 0; tid < num_writers; tid++) {
+    threads[tid].join();
+  }
+  done = true;
+  for (size_t tid = num_writers; tid < threads.size(); tid++) {
+    threads[tid].join();
+  }
+
+  bool success = true;
+  trie.GetValue<int>("stable0w0", &success);
+  EXPECT_FALSE(success);
+}
+
 }  // namespace bustub
@@ -0,0 +1,136 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// checkpoint_manager_test.cpp
+//
+// Identification: test/recovery/checkpoint_manager_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/checkpoint_manager.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "recovery/log_recovery.h"
+
+namespace bustub {
+
+class CheckpointManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+  }
+};
+
+TEST_F(CheckpointManagerTest, FuzzyCheckpointTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  log_manager.RunFlushThread();
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, &log_manager);
+  BufferPoolManagerInstance bpm(4, &disk_manager, LRUK_REPLACER_K, &log_manager);
+  CheckpointManager checkpoint_manager(&txn_manager, &log_manager, &bpm);
+  // pages 0 to 2
+  page_id_t new_page_id;
+  for (int i = 0; i < 3; i++) {
+    bpm.NewPage(&new_page_id);
+    bpm.UnpinPage(new_page_id, false);
+  }
+  auto set_lsn = [&](page_id_t page_id, lsn_t lsn) {
+    Page *page = bpm.FetchPage(page_id);
+    page->WLatch();
+    page->SetLSN(lsn);
+    page->WUnlatch();
+    bpm.UnpinPage(page_id, true);
+  };
+  auto rec_lsn = [&](page_id_t page_id) {
+    lsn_t lsn = bpm.FetchPage(page_id)->GetRecLSN();
+    bpm.UnpinPage(page_id, false);
+    return lsn;
+  };
+
+  auto *old_txn = txn_manager.Begin();
+  txn_manager.Commit(old_txn);
+  auto *committed = txn_manager.Begin();
+  auto *loser = txn_manager.Begin();
+  // page 1 is dirty before the checkpoint and written out by it, the loser changes page 2 during the checkpoint
+  lsn_t page_lsn = committed->GetPrevLSN();
+  set_lsn(1, page_lsn);
+
+  checkpoint_manager.BeginCheckpoint();
+  // transactions keep running during the checkpoint
+  LogRecord new_page(loser->GetTransactionId(), loser->GetPrevLSN(), LogRecordType::NEWPAGE, INVALID_PAGE_ID, 2);
+  loser->SetPrevLSN(log_manager.AppendLogRecord(&new_page));
+  set_lsn(2, loser->GetPrevLSN());
+  txn_manager.Commit(committed);
+  auto *late = txn_manager.Begin();
+  checkpoint_manager.EndCheckpoint();
+
+  // page 1 is on disk, after the log it carries
+  Page page;
+  disk_manager.ReadPage(1, page.GetData());
+  EXPECT_EQ(page_lsn, page.GetLSN());
+  EXPECT_LE(page_lsn, log_manager.GetPersistentLSN());
+  EXPECT_EQ(INVALID_LSN, rec_lsn(1));
+  EXPECT_EQ(loser->GetPrevLSN(), rec_lsn(2));
+
+  auto *after = txn_manager.Begin();
+  txn_manager.Commit(after);
+  log_manager.StopFlushThread();
+
+  // redo starts at the recLSN of page 2 instead of the start of the log, the losers are found through the
+  // checkpoint and the records after it
+  LogRecovery log_recovery(&disk_manager, nullptr);
+  EXPECT_EQ(loser->GetPrevLSN(), log_recovery.Analyze());
+  auto active_txns = log_recovery.GetActiveTxns();
+  EXPECT_EQ(2, active_txns.size());
+  EXPECT_EQ(loser->GetPrevLSN(), active_txns[loser->GetTransactionId()]);
+  EXPECT_EQ(late->GetPrevLSN(), active_txns[late->GetTransactionId()]);
+  auto dirty_pages = log_recovery.GetDirtyPages();
+  EXPECT_EQ(1, dirty_pages.size());
+  EXPECT_EQ(loser->GetPrevLSN(), dirty_pages[2]);
+
+  txn_manager.Abort(loser);
+  txn_manager.Abort(late);
+  delete old_txn;
+  delete committed;
+  delete loser;
+  delete late;
+  delete after;
+  disk_manager.ShutDown();
+}
+
+TEST_F(CheckpointManagerTest, AnalysisWithoutCheckpointTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+
+  LogRecord begin(0, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t begin_lsn = log_manager.AppendLogRecord(&begin);
+  LogRecord new_page(0, begin_lsn, LogRecordType::NEWPAGE, INVALID_PAGE_ID, 3);
+  lsn_t new_page_lsn = log_manager.AppendLogRecord(&new_page);
+  LogRecord other_begin(1, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t other_begin_lsn = log_manager.AppendLogRecord(&other_begin);
+  LogRecord other_commit(1, other_begin_lsn, LogRecordType::COMMIT);
+  log_manager.AppendLogRecord(&other_commit);
+  log_manager.Flush();
+
+  // without a master record the whole log is analyzed
+  LogRecovery log_recovery(&disk_manager, nullptr);
+  EXPECT_EQ(new_page_lsn, log_recovery.Analyze());
+  auto active_txns = log_recovery.GetActiveTxns();
+  EXPECT_EQ(1, active_txns.size());
+  EXPECT_EQ(new_page_lsn, active_txns[0]);
+  disk_manager.ShutDown();
+}
+
+}  // namespace bustub
@@ -0,0 +1,208 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_page_logger_test.cpp
+//
+// Identification: test/recovery/index_page_logger_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/index_page_logger.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "recovery/log_recovery.h"
+#include "storage/index/b_plus_tree_index.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+using Tree = BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
+using TreeIndex = BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
+
+void CreateHeaderPage(BufferPoolManager *bpm) {
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  ASSERT_EQ(HEADER_PAGE_ID, page_id);
+  bpm->UnpinPage(page_id, true);
+}
+
+auto PageImage(BufferPoolManager *bpm, page_id_t page_id) -> std::vector<char> {
+  const char *data = bpm->FetchPage(page_id)->GetData();
+  std::vector<char> image(data, data + BUSTUB_PAGE_SIZE);
+  bpm->UnpinPage(page_id, false);
+  return image;
+}
+
+/** @return the number of page ids the pool handed out */
+auto AllocatedPages(BufferPoolManager *bpm) -> page_id_t {
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(page_id, false);
+  bpm->DeletePage(page_id);
+  return page_id;
+}
+
+/** Make a new pool hand out page ids from num_pages on, the ones before are taken by the pages on disk */
+void SkipPages(BufferPoolManager *bpm, page_id_t num_pages) {
+  for (page_id_t i = 0; i < num_pages; i++) {
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    bpm->UnpinPage(page_id, false);
+    bpm->DeletePage(page_id);
+  }
+}
+
+auto ContainsKey(Index *index, int64_t key) -> bool {
+  Tuple tuple({ValueFactory::GetBigIntValue(key)}, index->GetKeySchema());
+  std::vector<RID> rids;
+  index->ScanKey(tuple, &rids, nullptr);
+  return !rids.empty();
+}
+
+}  // namespace
+
+class IndexPageLoggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+  }
+};
+
+TEST_F(IndexPageLoggerTest, RedoTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  // the pool holds the whole tree, none of the pages are written out
+  BufferPoolManagerInstance bpm(1000, &disk_manager);
+  CreateHeaderPage(&bpm);
+
+  // pages this small split and merge at every level, the root changes on the way
+  const int64_t num_keys = 500;
+  log_manager.RunFlushThread();
+  {
+    Tree tree("foo_pk", &bpm, comparator, 4, 5, true, &log_manager);
+    GenericKey<8> index_key;
+    for (int64_t key = 1; key <= num_keys; key++) {
+      index_key.SetFromInteger(key);
+      ASSERT_TRUE(tree.Insert(index_key, RID(static_cast<int32_t>(key), 0)));
+    }
+    for (int64_t key = 1; key <= num_keys; key++) {
+      if (key % 3 != 0) {
+        index_key.SetFromInteger(key);
+        ASSERT_TRUE(tree.Remove(index_key, RID(static_cast<int32_t>(key), 0)));
+      }
+    }
+  }
+  log_manager.StopFlushThread();
+
+  // none of the pages made it to disk, the log has all of them; the pages the tree still holds are the dirty ones
+  BufferPoolManagerInstance recovered(16, &disk_manager);
+  LogRecovery log_recovery(&disk_manager, &recovered, 4);
+  log_recovery.Redo();
+  log_recovery.Undo();
+  for (const auto &[page_id, rec_lsn] : bpm.GetDirtyPageTable()) {
+    EXPECT_EQ(PageImage(&bpm, page_id), PageImage(&recovered, page_id)) << page_id;
+  }
+
+  Tree tree("foo_pk", &recovered, comparator, 4, 5);
+  ASSERT_TRUE(tree.LoadRootPageId());
+  int64_t expected = 3;
+  for (auto it = tree.Begin(); it != tree.End(); ++it) {
+    EXPECT_EQ(expected, (*it).second.GetPageId());
+    expected += 3;
+  }
+  EXPECT_EQ(num_keys / 3 * 3 + 3, expected);
+  disk_manager.ShutDown();
+}
+
+TEST_F(IndexPageLoggerTest, UndoTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  Schema schema({Column("a", TypeId::BIGINT)});
+  auto metadata = [&schema] {
+    return std::make_unique<IndexMetadata>("foo_pk", "foo", &schema, std::vector<uint32_t>{0}, true);
+  };
+  BufferPoolManagerInstance bpm(64, &disk_manager);
+  CreateHeaderPage(&bpm);
+
+  // the loser inserts keys and deletes committed ones, which splits and merges leaves of committed keys
+  const int64_t num_keys = 2000;
+  log_manager.RunFlushThread();
+  {
+    TreeIndex index(metadata(), &bpm, &log_manager);
+    Transaction committed(0);
+    Transaction loser(1);
+    for (int64_t key = 1; key <= num_keys; key++) {
+      Tuple tuple({ValueFactory::GetBigIntValue(key)}, index.GetKeySchema());
+      index.InsertEntry(tuple, RID(static_cast<int32_t>(key), 0), key <= num_keys / 2 ? &committed : &loser);
+    }
+    LogRecord commit(committed.GetTransactionId(), committed.GetPrevLSN(), LogRecordType::COMMIT);
+    log_manager.AppendLogRecord(&commit);
+    for (int64_t key = 1; key <= num_keys / 4; key++) {
+      Tuple tuple({ValueFactory::GetBigIntValue(key)}, index.GetKeySchema());
+      index.DeleteEntry(tuple, RID(static_cast<int32_t>(key), 0), &loser);
+    }
+    ASSERT_FALSE(ContainsKey(&index, 1));
+  }
+  log_manager.StopFlushThread();
+
+  // undo splits and merges pages again, which must not reuse the ids of the pages of the tree
+  BufferPoolManagerInstance recovered(16, &disk_manager);
+  SkipPages(&recovered, AllocatedPages(&bpm));
+  LogRecovery log_recovery(&disk_manager, &recovered, 4);
+  log_recovery.Redo();
+  TreeIndex index(metadata(), &recovered);
+  ASSERT_TRUE(index.LoadRootPageId());
+  log_recovery.RegisterIndex(&index);
+  log_recovery.Undo();
+
+  // the committed keys are back, the keys the loser inserted are gone
+  for (int64_t key = 1; key <= num_keys; key++) {
+    EXPECT_EQ(key <= num_keys / 2, ContainsKey(&index, key)) << key;
+  }
+  disk_manager.ShutDown();
+}
+
+TEST_F(IndexPageLoggerTest, TornGroupTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+
+  // a complete group of two records and the first record of a group the log ends in
+  PageDelta first{1, true, {{100, "first"}}};
+  PageDelta last{2, false, {{100, "last"}}};
+  PageDelta torn{3, true, {{100, "torn"}}};
+  LogRecord first_record(INVALID_LSN, true, {first});
+  lsn_t first_lsn = log_manager.AppendLogRecord(&first_record);
+  LogRecord last_record(first_lsn, false, {last});
+  log_manager.AppendLogRecord(&last_record);
+  LogRecord torn_record(INVALID_LSN, true, {torn});
+  log_manager.AppendLogRecord(&torn_record);
+  log_manager.Flush();
+
+  BufferPoolManagerInstance recovered(4, &disk_manager);
+  LogRecovery log_recovery(&disk_manager, &recovered);
+  log_recovery.Redo();
+  EXPECT_EQ(0, memcmp(PageImage(&recovered, 1).data() + 100, "first", 5));
+  EXPECT_EQ(0, memcmp(PageImage(&recovered, 2).data() + 100, "last", 4));
+  EXPECT_EQ(std::vector<char>(BUSTUB_PAGE_SIZE), PageImage(&recovered, 3));
+  disk_manager.ShutDown();
+}
+
+}  // namespace bustub
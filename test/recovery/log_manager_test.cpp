@@ -0,0 +1,561 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/log_manager.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/bustub_instance.h"
+#include "common/exception.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_recovery.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return the records of the log file in order, with their lsns */
+auto ReadLogFile(DiskManager *disk_manager) -> std::vector<std::pair<lsn_t, LogRecord>> {
+  LogRecovery log_recovery(disk_manager, nullptr);
+  std::vector<std::pair<lsn_t, LogRecord>> log_records;
+  std::vector<char> block(LOG_BUFFER_SIZE);
+  std::vector<char> records(LOG_BUFFER_SIZE);
+  log_offset_t offset = 0;
+  while (disk_manager->ReadLog(block.data(), LOG_BUFFER_SIZE, offset)) {
+    LogBlockHeader header;
+    const char *data = LogRecovery::DecodeLogBlock(block.data(), LOG_BUFFER_SIZE, offset, records.data(), &header);
+    if (data == nullptr) {
+      break;
+    }
+    size_t pos = 0;
+    for (lsn_t lsn = header.base_lsn_; pos < header.raw_size_; lsn++) {
+      LogRecord log_record;
+      if (!log_recovery.DeserializeLogRecord(data + pos, &log_record, header.raw_size_ - pos)) {
+        return log_records;
+      }
+      pos += log_record.GetSize();
+      log_records.emplace_back(lsn, log_record);
+    }
+    offset += sizeof(LogBlockHeader) + header.stored_size_;
+  }
+  return log_records;
+}
+
+}  // namespace
+
+class LogManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+    saved_log_timeout_ = log_timeout;
+    saved_window_ = group_commit_window;
+    saved_size_ = group_commit_size;
+    saved_compression_ = enable_log_compression;
+    // no periodic flush gets in between the commits of a test
+    log_timeout = std::chrono::seconds(100);
+  }
+
+  void TearDown() override {
+    log_timeout = saved_log_timeout_;
+    group_commit_window = saved_window_;
+    group_commit_size = saved_size_;
+    enable_log_compression = saved_compression_;
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+  }
+
+ private:
+  std::chrono::duration<int64_t> saved_log_timeout_;
+  std::chrono::microseconds saved_window_;
+  size_t saved_size_;
+  bool saved_compression_;
+};
+
+TEST_F(LogManagerTest, GroupCommitTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  // the group is only flushed once all committers joined it
+  group_commit_window = std::chrono::seconds(100);
+  group_commit_size = 4;
+  log_manager.RunFlushThread();
+
+  std::vector<std::thread> committers;
+  std::vector<lsn_t> lsns(4);
+  for (txn_id_t txn_id = 0; txn_id < 4; txn_id++) {
+    committers.emplace_back([&, txn_id] {
+      LogRecord record(txn_id, INVALID_LSN, LogRecordType::COMMIT);
+      lsns[txn_id] = log_manager.AppendLogRecord(&record);
+      log_manager.WaitForDurable(lsns[txn_id]);
+      EXPECT_GE(log_manager.GetPersistentLSN(), lsns[txn_id]);
+    });
+  }
+  for (auto &committer : committers) {
+    committer.join();
+  }
+
+  EXPECT_EQ(1, disk_manager.GetNumFlushes());
+  EXPECT_EQ(3, log_manager.GetPersistentLSN());
+  log_manager.StopFlushThread();
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, GroupWindowTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  // a lonely committer does not wait for a full group
+  group_commit_window = std::chrono::milliseconds(10);
+  group_commit_size = 4;
+  log_manager.RunFlushThread();
+
+  auto start = std::chrono::steady_clock::now();
+  LogRecord begin(0, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t begin_lsn = log_manager.AppendLogRecord(&begin);
+  LogRecord commit(0, begin_lsn, LogRecordType::COMMIT);
+  lsn_t commit_lsn = log_manager.AppendLogRecord(&commit);
+  log_manager.WaitForDurable(commit_lsn);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+  EXPECT_EQ(1, disk_manager.GetNumFlushes());
+  EXPECT_EQ(commit_lsn, log_manager.GetPersistentLSN());
+
+  // an explicit flush does not wait for the window
+  group_commit_window = std::chrono::seconds(100);
+  LogRecord other(1, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t other_lsn = log_manager.AppendLogRecord(&other);
+  log_manager.Flush();
+  EXPECT_EQ(other_lsn, log_manager.GetPersistentLSN());
+  EXPECT_EQ(2, disk_manager.GetNumFlushes());
+
+  log_manager.StopFlushThread();
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, AsyncCommitTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, &log_manager);
+  log_timeout = std::chrono::seconds(1);
+  log_manager.RunFlushThread();
+
+  // the commit returns before its record is flushed
+  auto *txn = txn_manager.Begin();
+  txn->SetSynchronousCommit(false);
+  auto start = std::chrono::steady_clock::now();
+  txn_manager.Commit(txn);
+  lsn_t commit_lsn = txn->GetPrevLSN();
+  if (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500)) {
+    EXPECT_LT(log_manager.GetPersistentLSN(), commit_lsn);
+  }
+
+  // and the flush thread writes it within log_timeout
+  while (log_manager.GetPersistentLSN() < commit_lsn) {
+    ASSERT_LT(std::chrono::steady_clock::now() - start, 3 * log_timeout);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_LE(std::chrono::steady_clock::now() - start, log_timeout + std::chrono::milliseconds(500));
+
+  // synchronous commits of other transactions still wait for their record
+  auto *other = txn_manager.Begin();
+  txn_manager.Commit(other);
+  EXPECT_GE(log_manager.GetPersistentLSN(), other->GetPrevLSN());
+
+  log_manager.StopFlushThread();
+  delete txn;
+  delete other;
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, SessionAsyncCommitTest) {
+  auto bustub = std::make_unique<BustubInstance>("test.db");
+  auto *log_manager = bustub->log_manager_;
+  log_manager->RunFlushThread();
+  NoopWriter writer;
+
+  // the session variable turns asynchronous commits on for the statements after it
+  bustub->ExecuteSql("SET synchronous_commit = off;", writer);
+  ASSERT_TRUE(bustub->ExecuteSql("SELECT 1;", writer));
+  lsn_t commit_lsn = log_manager->GetNextLSN() - 1;
+  EXPECT_LT(log_manager->GetPersistentLSN(), commit_lsn);
+
+  // set back on, a commit returns once its record and every one before it is durable
+  bustub->ExecuteSql("SET synchronous_commit = on;", writer);
+  ASSERT_TRUE(bustub->ExecuteSql("SELECT 1;", writer));
+  EXPECT_GE(log_manager->GetPersistentLSN(), log_manager->GetNextLSN() - 1);
+  log_manager->StopFlushThread();
+}
+
+TEST_F(LogManagerTest, AbortRecordTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager txn_manager(&lock_manager, &log_manager);
+  log_manager.RunFlushThread();
+
+  // an aborted transaction ends with an abort record, recovery leaves it alone
+  auto *txn = txn_manager.Begin();
+  lsn_t begin_lsn = txn->GetPrevLSN();
+  txn_manager.Abort(txn);
+  log_manager.StopFlushThread();
+
+  auto log_records = ReadLogFile(&disk_manager);
+  ASSERT_EQ(2, log_records.size());
+  EXPECT_EQ(LogRecordType::ABORT, log_records[1].second.GetLogRecordType());
+  EXPECT_EQ(txn->GetPrevLSN(), log_records[1].first);
+  EXPECT_EQ(begin_lsn, log_records[1].second.GetPrevLSN());
+  LogRecovery log_recovery(&disk_manager, nullptr);
+  log_recovery.Analyze();
+  EXPECT_TRUE(log_recovery.GetActiveTxns().empty());
+  delete txn;
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, RollbackTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  Schema schema({Column("a", TypeId::INTEGER)});
+  auto make_tuple = [&schema](int32_t value) { return Tuple({ValueFactory::GetIntegerValue(value)}, &schema); };
+  RID first;
+  RID second;
+  txn_id_t loser_id;
+  {
+    BufferPoolManagerInstance bpm(8, &disk_manager, LRUK_REPLACER_K, &log_manager);
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, &log_manager);
+    log_manager.RunFlushThread();
+    auto *txn = txn_manager.Begin();
+    TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+    ASSERT_TRUE(table.InsertTuple(make_tuple(1), &first, txn));
+    txn_manager.Commit(txn);
+    delete txn;
+
+    // the rollback of every write of the loser is logged as a compensation record
+    txn = txn_manager.Begin();
+    loser_id = txn->GetTransactionId();
+    ASSERT_TRUE(table.InsertTuple(make_tuple(2), &second, txn));
+    ASSERT_TRUE(table.UpdateTuple(make_tuple(3), first, txn));
+    ASSERT_TRUE(table.MarkDelete(first, txn));
+    txn_manager.Abort(txn);
+    delete txn;
+    log_manager.StopFlushThread();
+  }
+
+  // the compensation records come in reverse order and point back past the write they undo
+  std::vector<LogRecord> writes;
+  std::vector<LogRecord> compensations;
+  for (auto &[lsn, log_record] : ReadLogFile(&disk_manager)) {
+    auto type = log_record.GetLogRecordType();
+    if (log_record.GetTxnId() == loser_id && type != LogRecordType::BEGIN && type != LogRecordType::ABORT) {
+      (log_record.IsCompensation() ? compensations : writes).push_back(log_record);
+    }
+  }
+  ASSERT_EQ(3, writes.size());
+  ASSERT_EQ(3, compensations.size());
+  std::vector<LogRecordType> undo_types{LogRecordType::ROLLBACKDELETE, LogRecordType::UPDATE,
+                                        LogRecordType::APPLYDELETE};
+  for (size_t i = 0; i < compensations.size(); i++) {
+    EXPECT_EQ(undo_types[i], compensations[i].GetLogRecordType());
+    EXPECT_EQ(writes[writes.size() - 1 - i].GetPrevLSN(), compensations[i].GetUndoNextLSN());
+  }
+
+  // none of the pages made it to disk, redo of the writes and their compensations leaves the committed tuple
+  BufferPoolManagerInstance bpm(8, &disk_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm);
+  log_recovery.Redo();
+  EXPECT_TRUE(log_recovery.GetActiveTxns().empty());
+  log_recovery.Undo();
+  auto *page = static_cast<TablePage *>(bpm.FetchPage(first.GetPageId()));
+  Tuple tuple;
+  ASSERT_TRUE(page->GetTuple(first, &tuple, nullptr, nullptr));
+  EXPECT_EQ(1, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  RID rid;
+  ASSERT_TRUE(page->GetFirstTupleRid(&rid));
+  EXPECT_FALSE(page->GetNextTupleRid(rid, &rid));
+  bpm.UnpinPage(first.GetPageId(), false);
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, GarbageDeleteTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  Schema schema({Column("a", TypeId::INTEGER)});
+  auto make_tuple = [&schema](int32_t value) { return Tuple({ValueFactory::GetIntegerValue(value)}, &schema); };
+  RID first;
+  RID reused;
+  page_id_t page_id;
+  lsn_t delete_lsn;
+  {
+    BufferPoolManagerInstance bpm(8, &disk_manager, LRUK_REPLACER_K, &log_manager);
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, &log_manager);
+    log_manager.RunFlushThread();
+    auto *txn = txn_manager.Begin();
+    TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+    ASSERT_TRUE(table.InsertTuple(make_tuple(1), &first, txn));
+    txn_manager.Commit(txn);
+    delete txn;
+
+    // garbage collection frees the slot of a tuple without a transaction, the next insert takes the slot
+    page_id = first.GetPageId();
+    table.ApplyDelete(first, nullptr);
+    delete_lsn = bpm.FetchPage(page_id)->GetLSN();
+    bpm.UnpinPage(page_id, false);
+    txn = txn_manager.Begin();
+    ASSERT_TRUE(table.InsertTuple(make_tuple(2), &reused, txn));
+    EXPECT_EQ(first, reused);
+    txn_manager.Commit(txn);
+    delete txn;
+    log_manager.StopFlushThread();
+  }
+
+  // the delete is logged and stamped on the page, but belongs to no transaction
+  auto log_records = ReadLogFile(&disk_manager);
+  auto it = std::find_if(log_records.begin(), log_records.end(),
+                         [&](const auto &entry) { return entry.first == delete_lsn; });
+  ASSERT_NE(log_records.end(), it);
+  EXPECT_EQ(LogRecordType::APPLYDELETE, it->second.GetLogRecordType());
+  EXPECT_EQ(INVALID_TXN_ID, it->second.GetTxnId());
+
+  // none of the pages made it to disk, redo frees the slot before the second insert reuses it
+  BufferPoolManagerInstance bpm(8, &disk_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm);
+  log_recovery.Redo();
+  EXPECT_TRUE(log_recovery.GetActiveTxns().empty());
+  auto *page = static_cast<TablePage *>(bpm.FetchPage(page_id));
+  Tuple tuple;
+  ASSERT_TRUE(page->GetTuple(reused, &tuple, nullptr, nullptr));
+  EXPECT_EQ(2, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  RID rid;
+  ASSERT_TRUE(page->GetFirstTupleRid(&rid));
+  EXPECT_FALSE(page->GetNextTupleRid(rid, &rid));
+  bpm.UnpinPage(page_id, false);
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, FullBufferTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  group_commit_window = std::chrono::seconds(100);
+  log_manager.RunFlushThread();
+
+  // appenders that run out of buffer space move on to the next buffer of the ring instead of waiting for a commit,
+  // once every buffer is sealed they wait for the oldest ones to be written
+  const int records = (LogManager::LOG_BUFFER_COUNT + 2) * LOG_BUFFER_SIZE / 4;
+  lsn_t lsn = INVALID_LSN;
+  for (int i = 0; i < records; i++) {
+    LogRecord record(0, lsn, LogRecordType::BEGIN);
+    lsn = log_manager.AppendLogRecord(&record);
+  }
+  EXPECT_GE(disk_manager.GetNumFlushes(), 2);
+  log_manager.Flush();
+  EXPECT_EQ(records - 1, log_manager.GetPersistentLSN());
+
+  // every record made it to the log file, in order
+  auto log_records = ReadLogFile(&disk_manager);
+  ASSERT_EQ(records, log_records.size());
+  for (lsn_t expected = 0; expected < records; expected++) {
+    EXPECT_EQ(expected, log_records[expected].first);
+    EXPECT_EQ(LogRecordType::BEGIN, log_records[expected].second.GetLogRecordType());
+  }
+
+  log_manager.StopFlushThread();
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, ConcurrentAppendTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  group_commit_window = std::chrono::seconds(100);
+  log_manager.RunFlushThread();
+
+  // appenders reserve their space without a latch and fill several buffers of the ring concurrently
+  const int num_threads = 4;
+  const int records_per_thread = 2 * LOG_BUFFER_SIZE / 4;
+  std::vector<std::thread> appenders;
+  std::vector<std::vector<lsn_t>> lsns(num_threads);
+  for (int t = 0; t < num_threads; t++) {
+    appenders.emplace_back([&, t] {
+      for (int i = 0; i < records_per_thread; i++) {
+        LogRecord record(t, INVALID_LSN, LogRecordType::BEGIN);
+        lsns[t].push_back(log_manager.AppendLogRecord(&record));
+      }
+    });
+  }
+  for (auto &appender : appenders) {
+    appender.join();
+  }
+  const int records = num_threads * records_per_thread;
+  EXPECT_EQ(records, log_manager.GetNextLSN());
+  log_manager.Flush();
+  EXPECT_EQ(records - 1, log_manager.GetPersistentLSN());
+
+  // every lsn is handed out once, and a thread gets increasing lsns
+  std::vector<int> txn_of_lsn(records, -1);
+  for (int t = 0; t < num_threads; t++) {
+    for (int i = 0; i < records_per_thread; i++) {
+      if (i > 0) {
+        EXPECT_LT(lsns[t][i - 1], lsns[t][i]);
+      }
+      ASSERT_EQ(-1, txn_of_lsn[lsns[t][i]]);
+      txn_of_lsn[lsns[t][i]] = t;
+    }
+  }
+
+  // the log file holds the records in lsn order, each one written by the thread that got its lsn
+  auto log_records = ReadLogFile(&disk_manager);
+  ASSERT_EQ(records, log_records.size());
+  for (lsn_t expected = 0; expected < records; expected++) {
+    ASSERT_EQ(expected, log_records[expected].first);
+    EXPECT_EQ(txn_of_lsn[expected], log_records[expected].second.GetTxnId());
+  }
+
+  log_manager.StopFlushThread();
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, InlineDurableTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+
+  // without a flush thread the committers write the log themselves, also while another appender has overflowed the
+  // current buffer but not sealed it yet
+  const int num_threads = 8;
+  const int records_per_commit = 16;
+  const int commits_per_thread = LOG_BUFFER_SIZE / 4 / records_per_commit;
+  std::vector<std::thread> committers;
+  for (int t = 0; t < num_threads; t++) {
+    committers.emplace_back([&, t] {
+      for (int i = 0; i < commits_per_thread; i++) {
+        lsn_t lsn = INVALID_LSN;
+        for (int j = 0; j < records_per_commit; j++) {
+          LogRecord record(t, lsn, LogRecordType::BEGIN);
+          lsn = log_manager.AppendLogRecord(&record);
+        }
+        log_manager.WaitForDurable(lsn);
+        ASSERT_GE(log_manager.GetPersistentLSN(), lsn);
+        log_manager.FlushUntil(lsn);
+        ASSERT_GE(log_manager.GetPersistentLSN(), lsn);
+      }
+    });
+  }
+  for (auto &committer : committers) {
+    committer.join();
+  }
+  const int records = num_threads * commits_per_thread * records_per_commit;
+  EXPECT_EQ(records - 1, log_manager.GetPersistentLSN());
+  EXPECT_EQ(records, ReadLogFile(&disk_manager).size());
+
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, CompactRecordTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  enable_log_compression = true;
+  Schema schema({Column("a", TypeId::INTEGER), Column("b", TypeId::VARCHAR, 200), Column("c", TypeId::INTEGER)});
+
+  // updates of wide tuples log the changed column only, and the blocks of similar records compress well
+  const int records = 1000;
+  std::string wide(200, 'x');
+  size_t image_size = 0;
+  uint32_t tuple_length = 0;
+  lsn_t lsn = INVALID_LSN;
+  for (int i = 0; i < records; i++) {
+    Tuple old_tuple({ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(wide),
+                     ValueFactory::GetIntegerValue(0)},
+                    &schema);
+    Tuple new_tuple({ValueFactory::GetIntegerValue(i), ValueFactory::GetVarcharValue(wide),
+                     ValueFactory::GetIntegerValue(i + 1)},
+                    &schema);
+    LogRecord update(0, lsn, LogRecordType::UPDATE, RID(i, 0), old_tuple, new_tuple);
+    EXPECT_LT(update.GetSize(), 32);
+    image_size += old_tuple.GetLength() + new_tuple.GetLength();
+    tuple_length = new_tuple.GetLength();
+    lsn = log_manager.AppendLogRecord(&update);
+  }
+  log_manager.Flush();
+  EXPECT_LT(disk_manager.GetLogSize(), image_size / 20);
+
+  auto log_records = ReadLogFile(&disk_manager);
+  ASSERT_EQ(records, log_records.size());
+  for (lsn_t expected = 0; expected < records; expected++) {
+    auto &update = log_records[expected].second;
+    EXPECT_EQ(expected, log_records[expected].first);
+    EXPECT_EQ(expected - 1, update.GetPrevLSN());
+    EXPECT_EQ(RID(expected, 0), update.GetUpdateRID());
+    // the old and the new value of c differ in their lowest bytes, followed by the unchanged bytes of c
+    EXPECT_EQ(update.GetOriginalTuple().GetLength(), update.GetUpdateTuple().GetLength());
+    EXPECT_LE(update.GetUpdateTuple().GetLength(), sizeof(int32_t));
+    EXPECT_EQ(tuple_length, update.GetUpdatePrefix() + update.GetUpdateTuple().GetLength() + update.GetUpdateSuffix());
+  }
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, RecycleLogTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+
+  // every flush writes a block of its own
+  std::vector<lsn_t> lsns;
+  for (txn_id_t txn_id = 0; txn_id < 4; txn_id++) {
+    LogRecord record(txn_id, INVALID_LSN, LogRecordType::COMMIT);
+    lsns.push_back(log_manager.AppendLogRecord(&record));
+    log_manager.Flush();
+  }
+  log_offset_t offset = log_manager.GetLogOffset(lsns[2]);
+  ASSERT_GT(offset, log_manager.GetLogOffset(lsns[1]));
+
+  // the blocks before the log start are forgotten, the ones after it are still found
+  log_manager.RecycleLog(offset);
+  EXPECT_EQ(-1, log_manager.GetLogOffset(lsns[0]));
+  EXPECT_EQ(-1, log_manager.GetLogOffset(lsns[1]));
+  EXPECT_EQ(offset, log_manager.GetLogOffset(lsns[2]));
+  EXPECT_LT(offset, log_manager.GetLogOffset(lsns[3]));
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogManagerTest, FailedWriteTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  // a directory in place of the first segment makes the write fail
+  ASSERT_EQ(0, mkdir("test.log.0", 0755));
+  LogRecord first(0, INVALID_LSN, LogRecordType::COMMIT);
+  lsn_t first_lsn = log_manager.AppendLogRecord(&first);
+  EXPECT_THROW(log_manager.Flush(), Exception);
+  EXPECT_EQ(INVALID_LSN, log_manager.GetPersistentLSN());
+  EXPECT_EQ(0, disk_manager.GetLogSize());
+  ASSERT_EQ(0, rmdir("test.log.0"));
+
+  // the failed block is written again before the ones after it
+  LogRecord second(1, INVALID_LSN, LogRecordType::COMMIT);
+  lsn_t second_lsn = log_manager.AppendLogRecord(&second);
+  log_manager.Flush();
+  EXPECT_EQ(second_lsn, log_manager.GetPersistentLSN());
+  auto log_records = ReadLogFile(&disk_manager);
+  ASSERT_EQ(2, log_records.size());
+  EXPECT_EQ(first_lsn, log_records[0].first);
+  EXPECT_EQ(second_lsn, log_records[1].first);
+  disk_manager.ShutDown();
+}
+
+}  // namespace bustub
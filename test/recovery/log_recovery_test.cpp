@@ -0,0 +1,370 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_recovery_test.cpp
+//
+// Identification: test/recovery/log_recovery_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/log_recovery.h"
+
+#include <climits>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/page/table_page.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return the tuples on a table page, fetched through the buffer pool */
+auto CountTuples(BufferPoolManager *bpm, page_id_t page_id) -> int {
+  auto *page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+  int count = 0;
+  RID rid;
+  for (bool found = page->GetFirstTupleRid(&rid); found; found = page->GetNextTupleRid(rid, &rid)) {
+    count++;
+  }
+  bpm->UnpinPage(page_id, false);
+  return count;
+}
+
+auto PageLSN(BufferPoolManager *bpm, page_id_t page_id) -> lsn_t {
+  lsn_t lsn = bpm->FetchPage(page_id)->GetLSN();
+  bpm->UnpinPage(page_id, false);
+  return lsn;
+}
+
+}  // namespace
+
+class LogRecoveryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+  }
+};
+
+TEST_F(LogRecoveryTest, ParallelRedoUndoTest) {
+  Schema schema({Column("a", TypeId::INTEGER)});
+  // a table of 8 pages, 3 transactions insert into all of them; transactions 1 and 2 commit, 3 does not
+  const page_id_t num_pages = 8;
+  const int inserts_per_page = 30;
+  {
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    lsn_t prev_lsn = INVALID_LSN;
+    for (page_id_t page_id = 1; page_id <= num_pages; page_id++) {
+      LogRecord new_page(0, prev_lsn, LogRecordType::NEWPAGE, page_id == 1 ? INVALID_PAGE_ID : page_id - 1, page_id);
+      prev_lsn = log_manager.AppendLogRecord(&new_page);
+    }
+    LogRecord commit(0, prev_lsn, LogRecordType::COMMIT);
+    log_manager.AppendLogRecord(&commit);
+
+    std::vector<lsn_t> last_lsns(4, INVALID_LSN);
+    for (int i = 0; i < inserts_per_page; i++) {
+      for (page_id_t page_id = 1; page_id <= num_pages; page_id++) {
+        txn_id_t txn_id = i % 3 + 1;
+        Tuple tuple({ValueFactory::GetIntegerValue(i * num_pages + page_id)}, &schema);
+        LogRecord insert(txn_id, last_lsns[txn_id], LogRecordType::INSERT, RID(page_id, i), tuple);
+        last_lsns[txn_id] = log_manager.AppendLogRecord(&insert);
+      }
+    }
+    // transaction 1 updates the first tuple of every page and deletes the second
+    for (page_id_t page_id = 1; page_id <= num_pages; page_id++) {
+      Tuple old_tuple({ValueFactory::GetIntegerValue(page_id)}, &schema);
+      Tuple new_tuple({ValueFactory::GetIntegerValue(-page_id)}, &schema);
+      LogRecord update(1, last_lsns[1], LogRecordType::UPDATE, RID(page_id, 0), old_tuple, new_tuple);
+      last_lsns[1] = log_manager.AppendLogRecord(&update);
+      LogRecord mark_delete(1, last_lsns[1], LogRecordType::MARKDELETE, RID(page_id, 1), Tuple());
+      last_lsns[1] = log_manager.AppendLogRecord(&mark_delete);
+    }
+    for (txn_id_t txn_id = 1; txn_id <= 2; txn_id++) {
+      LogRecord txn_commit(txn_id, last_lsns[txn_id], LogRecordType::COMMIT);
+      log_manager.AppendLogRecord(&txn_commit);
+    }
+    // transaction 3 updates the first tuples again, undo restores them from the tuples on the pages
+    for (page_id_t page_id = 1; page_id <= num_pages; page_id++) {
+      Tuple old_tuple({ValueFactory::GetIntegerValue(-page_id)}, &schema);
+      Tuple new_tuple({ValueFactory::GetIntegerValue(page_id * 1000)}, &schema);
+      LogRecord update(3, last_lsns[3], LogRecordType::UPDATE, RID(page_id, 0), old_tuple, new_tuple);
+      last_lsns[3] = log_manager.AppendLogRecord(&update);
+    }
+    log_manager.Flush();
+    disk_manager.ShutDown();
+  }
+
+  // Recovery on one worker and on four, each from an empty database. The pool is smaller than the table, so the
+  // pages are written out and read back.
+  auto recover = [&](size_t num_threads, bool undo) {
+    DiskManager disk_manager("test.db");
+    BufferPoolManagerInstance bpm(4, &disk_manager);
+    LogRecovery log_recovery(&disk_manager, &bpm, num_threads);
+    log_recovery.Redo();
+    if (undo) {
+      log_recovery.Undo();
+    }
+    for (page_id_t page_id = 1; page_id <= num_pages; page_id++) {
+      // the pages are linked and hold the tuples of transactions 1 and 2 but the deleted one
+      auto *page = static_cast<TablePage *>(bpm.FetchPage(page_id));
+      EXPECT_EQ(page_id == num_pages ? INVALID_PAGE_ID : page_id + 1, page->GetNextPageId());
+      Tuple tuple;
+      EXPECT_TRUE(page->GetTuple(RID(page_id, 0), &tuple, nullptr, nullptr));
+      EXPECT_EQ(-page_id, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+      bpm.UnpinPage(page_id, false);
+      EXPECT_EQ(2 * inserts_per_page / 3 - 1, CountTuples(&bpm, page_id));
+    }
+    bpm.FlushAllPages();
+    std::vector<char> image((num_pages + 1) * BUSTUB_PAGE_SIZE);
+    for (page_id_t page_id = 1; page_id <= num_pages; page_id++) {
+      disk_manager.ReadPage(page_id, image.data() + page_id * BUSTUB_PAGE_SIZE);
+    }
+    disk_manager.ShutDown();
+    return image;
+  };
+  remove("test.db");
+  auto image = recover(1, true);
+  remove("test.db");
+  EXPECT_EQ(image, recover(4, true));
+  // redo of the recovered database finds every change on the pages already and leaves them as they are
+  EXPECT_EQ(image, recover(4, false));
+}
+
+TEST_F(LogRecoveryTest, CompensationTest) {
+  Schema schema({Column("a", TypeId::INTEGER)});
+  {
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    LogRecord new_page(0, INVALID_LSN, LogRecordType::NEWPAGE, INVALID_PAGE_ID, 1);
+    LogRecord commit(0, log_manager.AppendLogRecord(&new_page), LogRecordType::COMMIT);
+    log_manager.AppendLogRecord(&commit);
+
+    // transaction 1 inserts three tuples and crashes while rolling back, after it compensated the last insert
+    std::vector<lsn_t> lsns{INVALID_LSN};
+    for (int i = 0; i < 3; i++) {
+      Tuple tuple({ValueFactory::GetIntegerValue(i)}, &schema);
+      LogRecord insert(1, lsns.back(), LogRecordType::INSERT, RID(1, i), tuple);
+      lsns.push_back(log_manager.AppendLogRecord(&insert));
+    }
+    Tuple tuple({ValueFactory::GetIntegerValue(2)}, &schema);
+    LogRecord compensation(1, lsns.back(), LogRecordType::APPLYDELETE, RID(1, 2), tuple);
+    compensation.SetUndoNext(lsns[2]);
+    log_manager.AppendLogRecord(&compensation);
+    log_manager.Flush();
+    disk_manager.ShutDown();
+  }
+
+  // undo goes on at the record before the compensated one and logs its own compensation records and the abort
+  lsn_t undo_lsn;
+  {
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    BufferPoolManagerInstance bpm(2, &disk_manager);
+    LogRecovery log_recovery(&disk_manager, &bpm);
+    log_recovery.SetLogManager(&log_manager);
+    log_recovery.Redo();
+    log_recovery.Undo();
+    EXPECT_EQ(0, CountTuples(&bpm, 1));
+    undo_lsn = PageLSN(&bpm, 1);
+    EXPECT_EQ(9, log_manager.GetNextLSN());
+    EXPECT_EQ(7, undo_lsn);
+    log_manager.Flush();
+    bpm.FlushAllPages();
+    disk_manager.ShutDown();
+  }
+
+  // the transaction is rolled back, the next recovery finds the page on disk with every change and leaves it alone
+  DiskManager disk_manager("test.db");
+  BufferPoolManagerInstance bpm(2, &disk_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm);
+  log_recovery.Redo();
+  EXPECT_TRUE(log_recovery.GetActiveTxns().empty());
+  EXPECT_EQ(0, CountTuples(&bpm, 1));
+  EXPECT_EQ(undo_lsn, PageLSN(&bpm, 1));
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogRecoveryTest, SlotTest) {
+  Schema schema({Column("a", TypeId::INTEGER)});
+  Tuple first({ValueFactory::GetIntegerValue(1)}, &schema);
+  Tuple second({ValueFactory::GetIntegerValue(2)}, &schema);
+  {
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    LogRecord new_page(0, INVALID_LSN, LogRecordType::NEWPAGE, INVALID_PAGE_ID, 1);
+    lsn_t lsn = log_manager.AppendLogRecord(&new_page);
+    LogRecord insert_first(0, lsn, LogRecordType::INSERT, RID(1, 0), first);
+    lsn = log_manager.AppendLogRecord(&insert_first);
+    LogRecord insert_second(0, lsn, LogRecordType::INSERT, RID(1, 1), second);
+    lsn = log_manager.AppendLogRecord(&insert_second);
+    // the first slot is free once transaction 0 commits
+    LogRecord mark_first(0, lsn, LogRecordType::MARKDELETE, RID(1, 0), Tuple());
+    lsn = log_manager.AppendLogRecord(&mark_first);
+    LogRecord apply_first(0, lsn, LogRecordType::APPLYDELETE, RID(1, 0), first);
+    lsn = log_manager.AppendLogRecord(&apply_first);
+    LogRecord commit(0, lsn, LogRecordType::COMMIT);
+    log_manager.AppendLogRecord(&commit);
+
+    // transaction 1 deletes the second tuple and does not commit
+    LogRecord mark_second(1, INVALID_LSN, LogRecordType::MARKDELETE, RID(1, 1), Tuple());
+    lsn = log_manager.AppendLogRecord(&mark_second);
+    LogRecord apply_second(1, lsn, LogRecordType::APPLYDELETE, RID(1, 1), second);
+    log_manager.AppendLogRecord(&apply_second);
+    log_manager.Flush();
+    disk_manager.ShutDown();
+  }
+
+  // undo puts the tuple back into its own slot rather than the first free one, the mark delete is undone there
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  BufferPoolManagerInstance bpm(2, &disk_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm);
+  log_recovery.SetLogManager(&log_manager);
+  log_recovery.Redo();
+  log_recovery.Undo();
+  EXPECT_EQ(1, CountTuples(&bpm, 1));
+  auto *page = static_cast<TablePage *>(bpm.FetchPage(1));
+  Tuple tuple;
+  EXPECT_FALSE(page->GetTuple(RID(1, 0), &tuple, nullptr, nullptr));
+  EXPECT_TRUE(page->GetTuple(RID(1, 1), &tuple, nullptr, nullptr));
+  EXPECT_EQ(2, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  bpm.UnpinPage(1, false);
+  log_manager.Flush();
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogRecoveryTest, LongLogTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+
+  // the log spans several prefetched chunks and blocks are cut off at their ends, only the last transaction
+  // does not commit
+  const txn_id_t num_txns = 3 * LogRecovery::PREFETCH_SIZE / 8;
+  lsn_t last_lsn = INVALID_LSN;
+  for (txn_id_t txn_id = 0; txn_id < num_txns; txn_id++) {
+    LogRecord begin(txn_id, INVALID_LSN, LogRecordType::BEGIN);
+    last_lsn = log_manager.AppendLogRecord(&begin);
+    if (txn_id + 1 < num_txns) {
+      LogRecord commit(txn_id, last_lsn, LogRecordType::COMMIT);
+      log_manager.AppendLogRecord(&commit);
+    }
+  }
+  log_manager.Flush();
+  ASSERT_GT(disk_manager.GetLogSize(), 2 * LogRecovery::PREFETCH_SIZE);
+
+  LogRecovery log_recovery(&disk_manager, nullptr);
+  EXPECT_EQ(INVALID_LSN, log_recovery.Analyze());
+  auto active_txns = log_recovery.GetActiveTxns();
+  ASSERT_EQ(1, active_txns.size());
+  EXPECT_EQ(last_lsn, active_txns[num_txns - 1]);
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogRecoveryTest, HighOffsetTest) {
+  // the log goes on at a segment that starts beyond what 32 bits can address
+  const int first_segment = static_cast<int>(INT32_MAX / LOG_SEGMENT_SIZE) + 2;
+  FILE *segment = fopen(("test.log." + std::to_string(first_segment)).c_str(), "w");
+  ASSERT_NE(nullptr, segment);
+  fclose(segment);
+  {
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    LogRecord begin(0, INVALID_LSN, LogRecordType::BEGIN);
+    lsn_t begin_lsn = log_manager.AppendLogRecord(&begin);
+    LogRecord commit(0, begin_lsn, LogRecordType::COMMIT);
+    log_manager.AppendLogRecord(&commit);
+    LogRecord loser(1, INVALID_LSN, LogRecordType::BEGIN);
+    log_manager.AppendLogRecord(&loser);
+    log_manager.Flush();
+    ASSERT_GT(log_manager.GetLogOffset(begin_lsn), INT32_MAX);
+    MasterRecord master;
+    master.checkpoint_offset_ = log_manager.GetLogOffset(begin_lsn);
+    master.redo_offset_ = master.checkpoint_offset_;
+    master.log_start_offset_ = master.checkpoint_offset_;
+    disk_manager.WriteMasterRecord(reinterpret_cast<const char *>(&master), sizeof(master));
+    log_manager.RecycleLog(master.log_start_offset_);
+    disk_manager.ShutDown();
+  }
+
+  // analysis starts at the offset of the master record and finds the transaction left running
+  DiskManager disk_manager("test.db");
+  LogRecovery log_recovery(&disk_manager, nullptr);
+  log_recovery.Analyze();
+  auto active_txns = log_recovery.GetActiveTxns();
+  EXPECT_EQ(1, active_txns.size());
+  EXPECT_EQ(1, active_txns.count(1));
+  disk_manager.ShutDown();
+}
+
+TEST_F(LogRecoveryTest, RecycledSegmentTest) {
+  Schema schema({Column("a", TypeId::VARCHAR, 2000)});
+  Tuple tuple({ValueFactory::GetVarcharValue(std::string(2000, 'x'))}, &schema);
+  const txn_id_t num_txns = 100000;
+  {
+    // the first run fills more than two segments with committed transactions and leaves the last one running, the
+    // log before it is recycled
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    txn_id_t txn_id = 0;
+    for (; log_manager.GetNextLSN() < 5 * LOG_SEGMENT_SIZE / 2000; txn_id++) {
+      LogRecord insert(txn_id, INVALID_LSN, LogRecordType::INSERT, RID(1, txn_id), tuple);
+      lsn_t lsn = log_manager.AppendLogRecord(&insert);
+      LogRecord commit(txn_id, lsn, LogRecordType::COMMIT);
+      log_manager.AppendLogRecord(&commit);
+    }
+    LogRecord begin(txn_id, INVALID_LSN, LogRecordType::BEGIN);
+    lsn_t begin_lsn = log_manager.AppendLogRecord(&begin);
+    log_manager.Flush();
+    ASSERT_GT(log_manager.GetLogOffset(begin_lsn), 2 * LOG_SEGMENT_SIZE);
+    MasterRecord master;
+    master.checkpoint_offset_ = log_manager.GetLogOffset(begin_lsn);
+    master.redo_offset_ = master.checkpoint_offset_;
+    master.log_start_offset_ = master.checkpoint_offset_;
+    disk_manager.WriteMasterRecord(reinterpret_cast<const char *>(&master), sizeof(master));
+    disk_manager.RecycleLog(master.log_start_offset_);
+    disk_manager.ShutDown();
+  }
+  {
+    // the second run starts at the fourth segment, which is a recycled one and holds its stale blocks
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    ASSERT_EQ(3 * LOG_SEGMENT_SIZE, disk_manager.GetLogSize());
+    LogRecord begin(num_txns, INVALID_LSN, LogRecordType::BEGIN);
+    log_manager.AppendLogRecord(&begin);
+    log_manager.Flush();
+    disk_manager.ShutDown();
+  }
+
+  DiskManager disk_manager("test.db");
+  // a block is only read at the offset it was written at
+  std::vector<char> block(LOG_BUFFER_SIZE);
+  std::vector<char> records(LOG_BUFFER_SIZE);
+  LogBlockHeader header;
+  ASSERT_TRUE(disk_manager.ReadLog(block.data(), LOG_BUFFER_SIZE, 3 * LOG_SEGMENT_SIZE));
+  EXPECT_NE(nullptr, LogRecovery::DecodeLogBlock(block.data(), LOG_BUFFER_SIZE, 3 * LOG_SEGMENT_SIZE, records.data(),
+                                                 &header));
+  EXPECT_EQ(nullptr, LogRecovery::DecodeLogBlock(block.data(), LOG_BUFFER_SIZE, 0, records.data(), &header));
+
+  // analysis reads the rest of the first run and the second run but none of the stale blocks
+  LogRecovery log_recovery(&disk_manager, nullptr);
+  log_recovery.Analyze();
+  auto active_txns = log_recovery.GetActiveTxns();
+  EXPECT_EQ(2, active_txns.size());
+  EXPECT_EQ(1, active_txns.count(num_txns));
+  disk_manager.ShutDown();
+}
+
+}  // namespace bustub
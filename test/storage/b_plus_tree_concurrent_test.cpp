@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
@@ -100,7 +101,7 @@ void DeleteHelperSplit(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree
   delete transaction;
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
+TEST(BPlusTreeConcurrentTest, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -152,7 +153,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
+TEST(BPlusTreeConcurrentTest, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -203,7 +204,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
+TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -245,7 +246,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
+TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -288,7 +289,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
+TEST(BPlusTreeConcurrentTest, MixTest) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -333,4 +334,118 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+TEST(BPlusTreeConcurrentTest, ReverseScanTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(100, disk_manager);
+  // small pages split and merge all the time
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // the even keys stay in the tree, the odd ones come and go while it is scanned backward
+  const int64_t scale = 400;
+  std::vector<int64_t> keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 0; key < scale; key++) {
+    (key % 2 == 0 ? keys : odd_keys).push_back(key);
+  }
+  InsertHelper(&tree, keys);
+
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int round = 0; round < 20; round++) {
+      InsertHelper(&tree, odd_keys);
+      DeleteHelper(&tree, odd_keys);
+    }
+    done = true;
+  });
+  auto scan = [&](uint64_t thread_itr) {
+    do {
+      int64_t previous = scale;
+      int64_t even_keys = 0;
+      for (auto iterator = tree.RBegin(); !iterator.IsEnd(); --iterator) {
+        int64_t key = (*iterator).second.GetSlotNum();
+        // every key is handed out once and in order, none of the keys that stay is skipped
+        ASSERT_LT(key, previous);
+        ASSERT_GE(key, previous - (previous % 2 == 0 ? 2 : 1));
+        even_keys += key % 2 == 0 ? 1 : 0;
+        previous = key;
+      }
+      ASSERT_EQ(scale / 2, even_keys);
+    } while (!done);
+  };
+  LaunchParallelTest(2, scan);
+  writer.join();
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, ForwardScanTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(100, disk_manager);
+  // small pages split and merge all the time
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // the even keys stay in the tree, the odd ones come and go while it is scanned forward
+  const int64_t scale = 400;
+  std::vector<int64_t> keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 0; key < scale; key++) {
+    (key % 2 == 0 ? keys : odd_keys).push_back(key);
+  }
+  InsertHelper(&tree, keys);
+
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int round = 0; round < 20; round++) {
+      InsertHelper(&tree, odd_keys);
+      DeleteHelper(&tree, odd_keys);
+    }
+    done = true;
+  });
+  auto scan = [&](uint64_t thread_itr) {
+    do {
+      int64_t previous = -1;
+      int64_t even_keys = 0;
+      for (auto iterator = tree.Begin(); !iterator.IsEnd(); ++iterator) {
+        int64_t key = (*iterator).second.GetSlotNum();
+        // every key is handed out once and in order, none of the keys that stay is skipped
+        ASSERT_GT(key, previous);
+        ASSERT_LE(key, previous + (previous % 2 == 0 ? 2 : 1));
+        even_keys += key % 2 == 0 ? 1 : 0;
+        previous = key;
+      }
+      ASSERT_EQ(scale / 2, even_keys);
+    } while (!done);
+  };
+  LaunchParallelTest(2, scan);
+  writer.join();
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
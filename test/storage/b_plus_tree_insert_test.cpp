@@ -20,7 +20,7 @@
 
 namespace bustub {
 
-TEST(BPlusTreeTests, DISABLED_InsertTest1) {
+TEST(BPlusTreeTests, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -64,7 +64,7 @@ TEST(BPlusTreeTests, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeTests, DISABLED_InsertTest2) {
+TEST(BPlusTreeTests, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -127,7 +127,7 @@ TEST(BPlusTreeTests, DISABLED_InsertTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeTests, DISABLED_InsertTest3) {
+TEST(BPlusTreeTests, InsertTest3) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -195,4 +195,144 @@ TEST(BPlusTreeTests, DISABLED_InsertTest3) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, DuplicateKeyInsertTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree that allows duplicate keys
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_idx", bpm, comparator, 3, 3, false);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  // enough values for one key to spill its posting list to overflow pages
+  int64_t scale = 2000;
+  std::vector<int64_t> keys = {1, 2, 3};
+  for (int64_t i = scale - 1; i >= 0; i--) {
+    for (auto key : keys) {
+      if (key != 2 && i >= 10) {
+        continue;
+      }
+      rid.Set(static_cast<int32_t>(key), i);
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+    }
+  }
+  // the same pair can only be inserted once
+  rid.Set(2, 0);
+  index_key.SetFromInteger(2);
+  EXPECT_FALSE(tree.Insert(index_key, rid, transaction));
+
+  std::vector<RID> rids;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    ASSERT_EQ(rids.size(), key == 2 ? scale : 10);
+    for (size_t i = 0; i < rids.size(); i++) {
+      EXPECT_EQ(rids[i].GetPageId(), key);
+      EXPECT_EQ(rids[i].GetSlotNum(), i);
+    }
+  }
+
+  // the iterator yields one pair per value
+  int64_t count = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(count, scale + 20);
+
+  // remove single values, then the whole key
+  for (int64_t i = 0; i < scale; i += 2) {
+    rid.Set(2, i);
+    index_key.SetFromInteger(2);
+    EXPECT_TRUE(tree.Remove(index_key, rid, transaction));
+  }
+  rids.clear();
+  EXPECT_TRUE(tree.GetValue(index_key, &rids));
+  EXPECT_EQ(rids.size(), scale / 2);
+  tree.Remove(index_key, transaction);
+  rids.clear();
+  EXPECT_FALSE(tree.GetValue(index_key, &rids));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, ReverseIteratorTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  ASSERT_EQ(page_id, HEADER_PAGE_ID);
+  (void)header_page;
+
+  // even keys only, so that a search key can fall between two leaves
+  int64_t scale = 100;
+  for (int64_t key = 0; key < scale; key += 2) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+
+  int64_t current_key = scale - 2;
+  for (auto iterator = tree.RBegin(); iterator != tree.End(); --iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key -= 2;
+  }
+  EXPECT_EQ(current_key, -2);
+
+  // start from the largest key not larger than an absent key
+  current_key = 48;
+  index_key.SetFromInteger(49);
+  for (auto iterator = tree.RBegin(index_key); iterator != tree.End(); --iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key -= 2;
+  }
+  EXPECT_EQ(current_key, -2);
+
+  // the iterator can change direction
+  index_key.SetFromInteger(10);
+  {
+    auto iterator = tree.Begin(index_key);
+    ++iterator;
+    ++iterator;
+    --iterator;
+    EXPECT_EQ((*iterator).second.GetSlotNum(), 12);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
 }  // namespace bustub
@@ -0,0 +1,163 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree_test.cpp
+//
+// Identification: test/storage/bw_tree_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/index/bw_tree.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+using BwTreeType = BwTree<GenericKey<8>, RID, GenericComparator<8>>;
+
+namespace {
+
+auto Key(int64_t key) -> GenericKey<8> {
+  GenericKey<8> index_key;
+  index_key.SetFromInteger(key);
+  return index_key;
+}
+
+auto Lookup(BwTreeType *tree, int64_t key) -> std::vector<RID> {
+  std::vector<RID> result;
+  tree->GetValue(Key(key), &result);
+  return result;
+}
+
+}  // namespace
+
+TEST(BwTreeTest, InsertRemoveTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  // small nodes, so the keys spread over several levels of splits and consolidations
+  BwTreeType tree(comparator, true, 4, 4);
+
+  std::vector<int64_t> keys(500);
+  for (size_t i = 0; i < keys.size(); i++) {
+    keys[i] = static_cast<int64_t>(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  for (auto key : keys) {
+    EXPECT_TRUE(tree.Insert(Key(key), RID(0, key)));
+  }
+  EXPECT_FALSE(tree.Insert(Key(7), RID(1, 7)));
+  EXPECT_GT(tree.GetHeight(), 2);
+
+  for (auto key : keys) {
+    EXPECT_EQ(std::vector<RID>{RID(0, key)}, Lookup(&tree, key));
+  }
+  EXPECT_TRUE(Lookup(&tree, 500).empty());
+
+  // a unique key is only removed together with its value
+  EXPECT_FALSE(tree.Remove(Key(7), RID(1, 7)));
+  for (int64_t key = 0; key < 500; key += 2) {
+    EXPECT_TRUE(tree.Remove(Key(key), RID(0, key)));
+  }
+  EXPECT_FALSE(tree.Remove(Key(0), RID(0, 0)));
+  for (int64_t key = 0; key < 500; key++) {
+    EXPECT_EQ(key % 2 == 0 ? 0 : 1, Lookup(&tree, key).size());
+  }
+  EXPECT_TRUE(tree.Insert(Key(0), RID(2, 0)));
+  EXPECT_EQ(std::vector<RID>{RID(2, 0)}, Lookup(&tree, 0));
+}
+
+TEST(BwTreeTest, NonUniqueTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  BwTreeType tree(comparator, false, 4, 4);
+
+  // the values of key 5 fill several leaves
+  for (uint32_t slot = 0; slot < 20; slot++) {
+    EXPECT_TRUE(tree.Insert(Key(5), RID(0, slot)));
+    EXPECT_TRUE(tree.Insert(Key(slot % 2 == 0 ? 4 : 6), RID(1, slot)));
+  }
+  EXPECT_FALSE(tree.Insert(Key(5), RID(0, 3)));
+
+  auto values = Lookup(&tree, 5);
+  ASSERT_EQ(20, values.size());
+  for (uint32_t slot = 0; slot < 20; slot++) {
+    EXPECT_EQ(RID(0, slot), values[slot]);
+  }
+  EXPECT_EQ(10, Lookup(&tree, 4).size());
+  EXPECT_EQ(10, Lookup(&tree, 6).size());
+
+  EXPECT_TRUE(tree.Remove(Key(5), RID(0, 3)));
+  EXPECT_FALSE(tree.Remove(Key(5), RID(0, 3)));
+  EXPECT_EQ(19, Lookup(&tree, 5).size());
+}
+
+TEST(BwTreeTest, ConcurrentSequentialInsertTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  BwTreeType tree(comparator, true, 8, 8);
+
+  // interleaved increasing keys make every thread append to the rightmost leaf
+  const int64_t num_threads = 4;
+  const int64_t keys_per_thread = 5000;
+  std::vector<std::thread> threads;
+  for (int64_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      for (int64_t i = 0; i < keys_per_thread; i++) {
+        int64_t key = i * num_threads + t;
+        EXPECT_TRUE(tree.Insert(Key(key), RID(0, key)));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int64_t key = 0; key < num_threads * keys_per_thread; key++) {
+    ASSERT_EQ(std::vector<RID>{RID(0, key)}, Lookup(&tree, key));
+  }
+}
+
+TEST(BwTreeTest, ConcurrentMixedTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  BwTreeType tree(comparator, true, 8, 8);
+
+  // even keys are there from the start, writers remove them and add the odd keys while readers look them up
+  const int64_t num_keys = 4000;
+  for (int64_t key = 0; key < num_keys; key += 2) {
+    tree.Insert(Key(key), RID(0, key));
+  }
+  std::vector<std::thread> threads;
+  for (int64_t t = 0; t < 2; t++) {
+    threads.emplace_back([&, t] {
+      for (int64_t key = t; key < num_keys; key += 2) {
+        if (t == 0) {
+          EXPECT_TRUE(tree.Remove(Key(key), RID(0, key)));
+        } else {
+          EXPECT_TRUE(tree.Insert(Key(key), RID(0, key)));
+        }
+      }
+    });
+    threads.emplace_back([&, t] {
+      for (int64_t key = t; key < num_keys; key += 2) {
+        EXPECT_LE(Lookup(&tree, key).size(), 1);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int64_t key = 0; key < num_keys; key++) {
+    EXPECT_EQ(key % 2 == 0 ? 0 : 1, Lookup(&tree, key).size());
+  }
+}
+
+}  // namespace bustub
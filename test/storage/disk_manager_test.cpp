@@ -10,7 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdio>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -23,13 +29,13 @@ class DiskManagerTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    DiskManager::RemoveLogFiles("test.db");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
-    remove("test.log");
+    DiskManager::RemoveLogFiles("test.db");
   };
 };
 
@@ -72,7 +78,118 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  // two log buffers of three quarters of a segment each, the second one is split across the first two segments
+  std::vector<std::vector<char>> data(2, std::vector<char>(LOG_SEGMENT_SIZE / 4 * 3));
+  for (size_t i = 0; i < data[0].size(); i++) {
+    data[0][i] = static_cast<char>(i % 251);
+    data[1][i] = static_cast<char>(i % 241);
+  }
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  dm.WriteLog(data[0].data(), static_cast<int>(data[0].size()));
+  dm.WriteLog(data[1].data(), static_cast<int>(data[1].size()));
+  int log_size = static_cast<int>(2 * data[0].size());
+  EXPECT_EQ(log_size, dm.GetLogSize());
+  // the segments are preallocated
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.log.1", &stat_buf));
+  EXPECT_EQ(LOG_SEGMENT_SIZE, stat_buf.st_size);
+
+  // a read across the segments, the bytes past the end of the log read as zeros
+  std::vector<char> buf(data[0].size() + 100);
+  ASSERT_TRUE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), log_size / 2 - 100));
+  EXPECT_EQ(0, memcmp(buf.data(), data[0].data() + data[0].size() - 100, 100));
+  EXPECT_EQ(0, memcmp(buf.data() + 100, data[1].data(), data[1].size()));
+  ASSERT_TRUE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), log_size - 10));
+  EXPECT_EQ(std::vector<char>(buf.size() - 10, 0), std::vector<char>(buf.begin() + 10, buf.end()));
+  EXPECT_FALSE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), log_size));
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, RecycleLogTest) {
+  std::vector<std::vector<char>> data(2, std::vector<char>(LOG_SEGMENT_SIZE / 4 * 3));
+  for (size_t i = 0; i < data[0].size(); i++) {
+    data[0][i] = static_cast<char>(i % 251);
+    data[1][i] = static_cast<char>(i % 241);
+  }
+  std::string db_file("test.db");
+  {
+    auto dm = DiskManager(db_file);
+    for (int i = 0; i < 4; i++) {
+      dm.WriteLog(data[i % 2].data(), static_cast<int>(data[i % 2].size()));
+    }
+    // segments 0 and 1 are before the offset, they become spares
+    dm.RecycleLog(LOG_SEGMENT_SIZE * 2 + 10);
+    EXPECT_NE(0, access("test.log.0", F_OK));
+    EXPECT_NE(0, access("test.log.1", F_OK));
+    EXPECT_EQ(0, access("test.log.spare.1", F_OK));
+    std::vector<char> buf(100);
+    EXPECT_FALSE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), 0));
+    ASSERT_TRUE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), static_cast<int>(data[0].size() * 3)));
+    EXPECT_EQ(0, memcmp(buf.data(), data[1].data(), buf.size()));
+
+    // the next segment is a spare renamed
+    dm.WriteLog(data[0].data(), static_cast<int>(data[0].size()));
+    EXPECT_EQ(0, access("test.log.3", F_OK));
+    EXPECT_NE(0, access("test.log.spare.1", F_OK));
+    dm.ShutDown();
+  }
+
+  // a restarted log goes on at the next segment, the spare left is used for it
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(LOG_SEGMENT_SIZE * 4, dm.GetLogSize());
+  std::vector<char> buf(100);
+  EXPECT_FALSE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), LOG_SEGMENT_SIZE));
+  ASSERT_TRUE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), static_cast<int>(data[0].size() * 4)));
+  EXPECT_EQ(0, memcmp(buf.data(), data[0].data(), buf.size()));
+  dm.WriteLog(data[1].data(), 100);
+  EXPECT_EQ(0, access("test.log.4", F_OK));
+  EXPECT_NE(0, access("test.log.spare.0", F_OK));
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LongLogTest) {
+  // a log continued at a segment that starts beyond what 32 bits can address
+  const int first_segment = static_cast<int>(INT32_MAX / LOG_SEGMENT_SIZE) + 2;
+  std::string segment_name = "test.log." + std::to_string(first_segment);
+  FILE *segment = fopen(segment_name.c_str(), "w");
+  ASSERT_NE(nullptr, segment);
+  fclose(segment);
+
+  std::vector<char> data(LOG_SEGMENT_SIZE / 4 * 3);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(i % 251);
+  }
+  auto dm = DiskManager("test.db");
+  log_offset_t start = static_cast<log_offset_t>(first_segment + 1) * LOG_SEGMENT_SIZE;
+  ASSERT_GT(start, INT32_MAX);
+  EXPECT_EQ(start, dm.GetLogSize());
+  std::vector<char> copy(data);
+  dm.WriteLog(data.data(), static_cast<int>(data.size()));
+  dm.WriteLog(copy.data(), static_cast<int>(copy.size()));
+  EXPECT_EQ(start + 2 * static_cast<log_offset_t>(data.size()), dm.GetLogSize());
+
+  // a read across the end of a segment
+  std::vector<char> buf(100);
+  log_offset_t segment_end = start + static_cast<log_offset_t>(data.size()) - 50;
+  ASSERT_TRUE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), segment_end));
+  EXPECT_EQ(0, memcmp(buf.data(), data.data() + data.size() - 50, 50));
+  EXPECT_EQ(0, memcmp(buf.data() + 50, data.data(), 50));
+
+  // the segment of the last run is recycled, the log after it stays
+  dm.RecycleLog(start);
+  EXPECT_NE(0, access(segment_name.c_str(), F_OK));
+  EXPECT_FALSE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), start - 100));
+  ASSERT_TRUE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), start));
+  EXPECT_EQ(0, memcmp(buf.data(), data.data(), buf.size()));
+  dm.ShutDown();
+}
+
 }  // namespace bustub
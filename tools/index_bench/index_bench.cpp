@@ -0,0 +1,235 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/exception.h"
+#include "container/art/adaptive_radix_tree.h"
+#include "fmt/core.h"
+#include "storage/disk/disk_manager_memory.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/bw_tree.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
+
+#include <sys/time.h>
+
+auto ClockMs() -> uint64_t {
+  struct timeval tm;
+  gettimeofday(&tm, nullptr);
+  return static_cast<uint64_t>(tm.tv_sec * 1000) + static_cast<uint64_t>(tm.tv_usec / 1000);
+}
+
+static const size_t BUSTUB_INDEX_BENCH_THREAD = 4;
+static const size_t BUSTUB_INDEX_BENCH_KEYS = 1000000;
+static const size_t BUSTUB_INDEX_BENCH_POOL_SIZE = 4096;
+
+using KeyType = bustub::GenericKey<8>;
+using ComparatorType = bustub::GenericComparator<8>;
+
+/**
+ * Insert num_keys increasing keys from num_threads threads. The keys are handed out by a shared counter, so the
+ * threads always insert next to each other at the right end of the index, which is where latch crabbing
+ * writers of the B+ tree serialize.
+ */
+void RunInserts(const std::string &name, size_t num_threads, size_t num_keys,
+                const std::function<bool(const KeyType &, const bustub::RID &)> &insert) {
+  std::atomic<int64_t> next_key{0};
+  std::atomic<size_t> failed{0};
+  std::vector<std::thread> threads;
+
+  uint64_t start = ClockMs();
+  for (size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+    threads.emplace_back([&] {
+      KeyType index_key;
+      for (int64_t key = next_key.fetch_add(1); key < static_cast<int64_t>(num_keys); key = next_key.fetch_add(1)) {
+        index_key.SetFromInteger(key);
+        if (!insert(index_key, bustub::RID(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key)))) {
+          failed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  uint64_t elapsed = std::max<uint64_t>(ClockMs() - start, 1);
+
+  fmt::print("{}: {} keys, {} threads, {} ms, {:.0f} inserts/s, {} failed\n", name, num_keys, num_threads, elapsed,
+             static_cast<double>(num_keys) * 1000 / static_cast<double>(elapsed), failed.load());
+}
+
+void BenchBwTree(size_t num_threads, size_t num_keys, const ComparatorType &comparator) {
+  bustub::BwTree<KeyType, bustub::RID, ComparatorType> tree(comparator);
+  RunInserts("bwtree", num_threads, num_keys,
+             [&](const KeyType &key, const bustub::RID &rid) { return tree.Insert(key, rid); });
+}
+
+void BenchBPlusTree(size_t num_threads, size_t num_keys, const ComparatorType &comparator) {
+  try {
+    auto disk_manager = std::make_unique<bustub::DiskManagerUnlimitedMemory>();
+    auto bpm = std::make_unique<bustub::BufferPoolManagerInstance>(BUSTUB_INDEX_BENCH_POOL_SIZE, disk_manager.get());
+    // the tree creates its header page through the buffer pool
+    bustub::page_id_t header_page_id;
+    bpm->NewPage(&header_page_id);
+    bpm->UnpinPage(header_page_id, true);
+    bustub::BPlusTree<KeyType, bustub::RID, ComparatorType> tree("index_bench", bpm.get(), comparator);
+    RunInserts("bplustree", num_threads, num_keys, [&](const KeyType &key, const bustub::RID &rid) {
+      bustub::Transaction transaction(0);
+      return tree.Insert(key, rid, &transaction);
+    });
+  } catch (const bustub::Exception &e) {
+    std::cerr << "bplustree: skipped, " << e.what() << std::endl;
+  }
+}
+
+/**
+ * Look up num_lookups random keys out of [0, num_keys) from num_threads threads. The index is filled before the
+ * clock starts, so only the point lookups are timed.
+ */
+void RunLookups(const std::string &name, size_t num_threads, size_t num_keys, size_t num_lookups,
+                const std::function<bool(int64_t)> &lookup) {
+  std::atomic<size_t> missed{0};
+  std::vector<std::thread> threads;
+
+  uint64_t start = ClockMs();
+  for (size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+    threads.emplace_back([&, thread_id] {
+      std::mt19937_64 rng(thread_id);
+      std::uniform_int_distribution<int64_t> dist(0, static_cast<int64_t>(num_keys) - 1);
+      for (size_t i = thread_id; i < num_lookups; i += num_threads) {
+        if (!lookup(dist(rng))) {
+          missed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  uint64_t elapsed = std::max<uint64_t>(ClockMs() - start, 1);
+
+  fmt::print("{}: {} keys, {} threads, {} ms, {:.0f} lookups/s, {} missed\n", name, num_keys, num_threads, elapsed,
+             static_cast<double>(num_lookups) * 1000 / static_cast<double>(elapsed), missed.load());
+}
+
+/** Encode a key the way ARTIndex encodes a bigint column: big endian with the sign bit flipped. */
+auto EncodeArtKey(int64_t key) -> std::string {
+  auto bits = static_cast<uint64_t>(key) ^ (uint64_t{1} << 63);
+  std::string out;
+  for (size_t i = sizeof(uint64_t); i > 0; i--) {
+    out.push_back(static_cast<char>((bits >> ((i - 1) * 8)) & 0xFF));
+  }
+  return out;
+}
+
+void BenchArtLookups(size_t num_threads, size_t num_keys, size_t num_lookups) {
+  bustub::AdaptiveRadixTree tree;
+  for (size_t key = 0; key < num_keys; key++) {
+    tree.Insert(EncodeArtKey(static_cast<int64_t>(key)), bustub::RID(0, static_cast<uint32_t>(key)));
+  }
+  RunLookups("art", num_threads, num_keys, num_lookups, [&](int64_t key) {
+    bustub::RID rid;
+    return tree.Get(EncodeArtKey(key), &rid);
+  });
+}
+
+void BenchBPlusTreeLookups(size_t num_threads, size_t num_keys, size_t num_lookups,
+                           const ComparatorType &comparator) {
+  try {
+    auto disk_manager = std::make_unique<bustub::DiskManagerUnlimitedMemory>();
+    auto bpm = std::make_unique<bustub::BufferPoolManagerInstance>(BUSTUB_INDEX_BENCH_POOL_SIZE, disk_manager.get());
+    bustub::page_id_t header_page_id;
+    bpm->NewPage(&header_page_id);
+    bpm->UnpinPage(header_page_id, true);
+    bustub::BPlusTree<KeyType, bustub::RID, ComparatorType> tree("index_bench", bpm.get(), comparator);
+    bustub::Transaction transaction(0);
+    KeyType index_key;
+    for (size_t key = 0; key < num_keys; key++) {
+      index_key.SetFromInteger(static_cast<int64_t>(key));
+      tree.Insert(index_key, bustub::RID(0, static_cast<uint32_t>(key)), &transaction);
+    }
+    RunLookups("bplustree", num_threads, num_keys, num_lookups, [&](int64_t key) {
+      KeyType lookup_key;
+      lookup_key.SetFromInteger(key);
+      std::vector<bustub::RID> result;
+      return tree.GetValue(lookup_key, &result);
+    });
+  } catch (const bustub::Exception &e) {
+    std::cerr << "bplustree: skipped, " << e.what() << std::endl;
+  }
+}
+
+// NOLINTNEXTLINE
+auto main(int argc, char **argv) -> int {
+  argparse::ArgumentParser program("bustub-index-bench");
+  program.add_argument("--workload").help("insert or lookup");
+  program.add_argument("--index").help("bwtree, bplustree, art or both");
+  program.add_argument("--threads").help("number of inserting threads");
+  program.add_argument("--keys").help("number of keys to insert");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  std::string workload = "insert";
+  if (program.present("--workload")) {
+    workload = program.get("--workload");
+  }
+  if (workload != "insert" && workload != "lookup") {
+    std::cerr << "unknown workload " << workload << std::endl;
+    return 1;
+  }
+  std::string index = "both";
+  if (program.present("--index")) {
+    index = program.get("--index");
+  }
+  if (index != "bwtree" && index != "bplustree" && index != "art" && index != "both") {
+    std::cerr << "unknown index " << index << std::endl;
+    return 1;
+  }
+  if ((workload == "insert" && index == "art") || (workload == "lookup" && index == "bwtree")) {
+    std::cerr << "index " << index << " is not part of the " << workload << " workload" << std::endl;
+    return 1;
+  }
+  size_t num_threads = BUSTUB_INDEX_BENCH_THREAD;
+  if (program.present("--threads")) {
+    num_threads = std::stoul(program.get("--threads"));
+  }
+  size_t num_keys = BUSTUB_INDEX_BENCH_KEYS;
+  if (program.present("--keys")) {
+    num_keys = std::stoul(program.get("--keys"));
+  }
+
+  auto key_schema = bustub::ParseCreateStatement("a bigint");
+  ComparatorType comparator(key_schema.get());
+
+  // the lookup workload compares the adaptive radix tree with the B+ tree, the insert workload the Bw-tree with it
+  if (workload == "lookup") {
+    if (index == "art" || index == "both") {
+      BenchArtLookups(num_threads, num_keys, num_keys);
+    }
+    if (index == "bplustree" || index == "both") {
+      BenchBPlusTreeLookups(num_threads, num_keys, num_keys, comparator);
+    }
+    return 0;
+  }
+  if (index == "bwtree" || index == "both") {
+    BenchBwTree(num_threads, num_keys, comparator);
+  }
+  if (index == "bplustree" || index == "both") {
+    BenchBPlusTree(num_threads, num_keys, comparator);
+  }
+  return 0;
+}
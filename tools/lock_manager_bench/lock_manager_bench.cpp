@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+#include "common/exception.h"
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction.h"
+#include "concurrency/transaction_manager.h"
+#include "fmt/core.h"
+
+#include <sys/time.h>
+
+auto ClockMs() -> uint64_t {
+  struct timeval tm;
+  gettimeofday(&tm, nullptr);
+  return static_cast<uint64_t>(tm.tv_sec * 1000) + static_cast<uint64_t>(tm.tv_usec / 1000);
+}
+
+auto ClockUs() -> uint64_t {
+  struct timeval tm;
+  gettimeofday(&tm, nullptr);
+  return static_cast<uint64_t>(tm.tv_sec * 1000000) + static_cast<uint64_t>(tm.tv_usec);
+}
+
+static const size_t BUSTUB_LOCK_BENCH_THREAD = 4;
+static const size_t BUSTUB_LOCK_BENCH_ROWS = 1000;
+static const size_t BUSTUB_LOCK_BENCH_OPS_PER_TXN = 4;
+static const uint64_t BUSTUB_LOCK_BENCH_DURATION_MS = 5000;
+static const bustub::table_oid_t BUSTUB_LOCK_BENCH_TABLE = 0;
+
+/**
+ * Draws row numbers in [0, n) with P(i) proportional to 1 / (i + 1)^theta (Gray et al., "Quickly Generating
+ * Billion-Record Synthetic Databases"). theta = 0 is uniform, the larger theta the hotter the first rows.
+ */
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(uint64_t n, double theta, uint64_t seed) : n_(n), theta_(theta), rng_(seed) {
+    if (theta_ == 0) {
+      return;
+    }
+    double zeta2 = Zeta(2, theta_);
+    zetan_ = Zeta(n_, theta_);
+    alpha_ = 1.0 / (1.0 - theta_);
+    eta_ = (1 - std::pow(2.0 / static_cast<double>(n_), 1 - theta_)) / (1 - zeta2 / zetan_);
+  }
+
+  auto Next() -> uint64_t {
+    if (theta_ == 0) {
+      return std::uniform_int_distribution<uint64_t>(0, n_ - 1)(rng_);
+    }
+    double u = std::uniform_real_distribution<double>(0, 1)(rng_);
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    auto row = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return std::min(row, n_ - 1);
+  }
+
+  auto Random() -> std::mt19937_64 & { return rng_; }
+
+ private:
+  static auto Zeta(uint64_t n, double theta) -> double {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double zetan_{0};
+  double alpha_{0};
+  double eta_{0};
+  std::mt19937_64 rng_;
+};
+
+struct LockBenchConfig {
+  size_t threads_{BUSTUB_LOCK_BENCH_THREAD};
+  size_t rows_{BUSTUB_LOCK_BENCH_ROWS};
+  size_t ops_per_txn_{BUSTUB_LOCK_BENCH_OPS_PER_TXN};
+  uint64_t duration_ms_{BUSTUB_LOCK_BENCH_DURATION_MS};
+  double zipf_theta_{0.99};
+  double read_ratio_{0.5};
+  bustub::IsolationLevel isolation_level_{bustub::IsolationLevel::REPEATABLE_READ};
+};
+
+struct LockBenchMetrics {
+  uint64_t committed_txn_cnt_{0};
+  uint64_t aborted_txn_cnt_{0};
+  uint64_t granted_lock_cnt_{0};
+  /** Time spent in every LockRow call, granted or not */
+  std::vector<uint64_t> wait_us_;
+};
+
+auto ParseDeadlockPolicy(const std::string &str) -> bustub::LockManager::DeadlockPolicy {
+  if (str == "detection") {
+    return bustub::LockManager::DeadlockPolicy::DETECTION;
+  }
+  if (str == "wound-wait") {
+    return bustub::LockManager::DeadlockPolicy::WOUND_WAIT;
+  }
+  if (str == "wait-die") {
+    return bustub::LockManager::DeadlockPolicy::WAIT_DIE;
+  }
+  throw bustub::Exception(fmt::format("unexpected deadlock policy: {}", str));
+}
+
+auto ParseIsolationLevel(const std::string &str) -> bustub::IsolationLevel {
+  if (str == "ru") {
+    return bustub::IsolationLevel::READ_UNCOMMITTED;
+  }
+  if (str == "rc") {
+    return bustub::IsolationLevel::READ_COMMITTED;
+  }
+  if (str == "rr") {
+    return bustub::IsolationLevel::REPEATABLE_READ;
+  }
+  throw bustub::Exception(fmt::format("unexpected isolation level: {}", str));
+}
+
+/**
+ * Run one transaction that locks ops_per_txn rows. Reads take shared locks the way the executors do: not at all
+ * under READ_UNCOMMITTED, released right after the read under READ_COMMITTED and held to commit under
+ * REPEATABLE_READ. A row that is read and written in the same transaction is locked exclusively once.
+ * @return true if the transaction committed
+ */
+auto RunTxn(bustub::TransactionManager *txn_manager, bustub::LockManager *lock_manager, const LockBenchConfig &config,
+            ZipfianGenerator *generator, LockBenchMetrics *metrics) -> bool {
+  using LockMode = bustub::LockManager::LockMode;
+  std::vector<std::pair<uint64_t, bool>> ops;
+  std::map<uint64_t, size_t> positions;
+  bool writes = false;
+  std::bernoulli_distribution is_read(config.read_ratio_);
+  while (ops.size() < config.ops_per_txn_ && ops.size() < config.rows_) {
+    uint64_t row = generator->Next();
+    bool write = !is_read(generator->Random());
+    writes = writes || write;
+    auto it = positions.find(row);
+    if (it == positions.end()) {
+      positions.emplace(row, ops.size());
+      ops.emplace_back(row, write);
+    } else if (write) {
+      ops[it->second].second = true;
+    }
+  }
+
+  auto *txn = txn_manager->Begin(nullptr, config.isolation_level_);
+  bool success = true;
+  try {
+    bool read_uncommitted = config.isolation_level_ == bustub::IsolationLevel::READ_UNCOMMITTED;
+    LockMode table_mode = writes || read_uncommitted ? LockMode::INTENTION_EXCLUSIVE : LockMode::INTENTION_SHARED;
+    success = lock_manager->LockTable(txn, table_mode, BUSTUB_LOCK_BENCH_TABLE);
+    for (size_t i = 0; success && i < ops.size(); i++) {
+      auto [row, write] = ops[i];
+      if (!write && read_uncommitted) {
+        continue;
+      }
+      bustub::RID rid(static_cast<bustub::page_id_t>(row / 64), static_cast<uint32_t>(row % 64));
+      uint64_t start = ClockUs();
+      LockMode row_mode = write ? LockMode::EXCLUSIVE : LockMode::SHARED;
+      success = lock_manager->LockRow(txn, row_mode, BUSTUB_LOCK_BENCH_TABLE, rid);
+      metrics->wait_us_.push_back(ClockUs() - start);
+      if (!success) {
+        break;
+      }
+      metrics->granted_lock_cnt_++;
+      if (!write && config.isolation_level_ == bustub::IsolationLevel::READ_COMMITTED) {
+        lock_manager->UnlockRow(txn, BUSTUB_LOCK_BENCH_TABLE, rid);
+      }
+    }
+  } catch (bustub::TransactionAbortException &e) {
+    success = false;
+  }
+
+  if (success && txn->GetState() != bustub::TransactionState::ABORTED) {
+    txn_manager->Commit(txn);
+    metrics->committed_txn_cnt_++;
+  } else {
+    txn_manager->Abort(txn);
+    metrics->aborted_txn_cnt_++;
+    success = false;
+  }
+  delete txn;
+  return success;
+}
+
+auto Percentile(const std::vector<uint64_t> &sorted, double percentile) -> uint64_t {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto index = static_cast<size_t>(percentile / 100 * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+// NOLINTNEXTLINE
+auto main(int argc, char **argv) -> int {
+  argparse::ArgumentParser program("bustub-lock-manager-bench");
+  program.add_argument("--threads").help("number of client threads");
+  program.add_argument("--rows").help("number of rows in the locked table");
+  program.add_argument("--ops-per-txn").help("rows locked by every transaction");
+  program.add_argument("--duration").help("run for n milliseconds");
+  program.add_argument("--zipf").help("zipfian skew of the row choice, 0 is uniform");
+  program.add_argument("--read-ratio").help("fraction of row accesses that are reads");
+  program.add_argument("--isolation-level").help("ru, rc or rr");
+  program.add_argument("--deadlock-policy").help("detection, wound-wait or wait-die");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  LockBenchConfig config;
+  std::string isolation_level = "rr";
+  std::string deadlock_policy = "detection";
+  try {
+    if (program.present("--threads")) {
+      config.threads_ = std::stoul(program.get("--threads"));
+    }
+    if (program.present("--rows")) {
+      config.rows_ = std::max<size_t>(std::stoul(program.get("--rows")), 2);
+    }
+    if (program.present("--ops-per-txn")) {
+      config.ops_per_txn_ = std::stoul(program.get("--ops-per-txn"));
+    }
+    if (program.present("--duration")) {
+      config.duration_ms_ = std::stoull(program.get("--duration"));
+    }
+    if (program.present("--zipf")) {
+      config.zipf_theta_ = std::stod(program.get("--zipf"));
+    }
+    if (program.present("--read-ratio")) {
+      config.read_ratio_ = std::clamp(std::stod(program.get("--read-ratio")), 0.0, 1.0);
+    }
+    if (program.present("--isolation-level")) {
+      isolation_level = program.get("--isolation-level");
+    }
+    config.isolation_level_ = ParseIsolationLevel(isolation_level);
+    if (program.present("--deadlock-policy")) {
+      deadlock_policy = program.get("--deadlock-policy");
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (config.zipf_theta_ < 0 || config.zipf_theta_ == 1) {
+    std::cerr << "zipf skew must be >= 0 and not 1" << std::endl;
+    return 1;
+  }
+
+  bustub::LockManager lock_manager(ParseDeadlockPolicy(deadlock_policy));
+  bustub::TransactionManager txn_manager(&lock_manager);
+  fmt::print("x: {} threads, {} rows, {} ops/txn, zipf {}, read ratio {}, isolation {}, deadlock policy {}\n",
+             config.threads_, config.rows_, config.ops_per_txn_, config.zipf_theta_, config.read_ratio_,
+             isolation_level, deadlock_policy);
+
+  std::vector<LockBenchMetrics> metrics(config.threads_);
+  std::vector<std::thread> threads;
+  uint64_t start = ClockMs();
+  for (size_t thread_id = 0; thread_id < config.threads_; thread_id++) {
+    threads.emplace_back([&, thread_id] {
+      ZipfianGenerator generator(config.rows_, config.zipf_theta_, thread_id);
+      while (ClockMs() - start < config.duration_ms_) {
+        RunTxn(&txn_manager, &lock_manager, config, &generator, &metrics[thread_id]);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double elapsed_s = static_cast<double>(std::max<uint64_t>(ClockMs() - start, 1)) / 1000;
+
+  LockBenchMetrics total;
+  for (auto &thread_metrics : metrics) {
+    total.committed_txn_cnt_ += thread_metrics.committed_txn_cnt_;
+    total.aborted_txn_cnt_ += thread_metrics.aborted_txn_cnt_;
+    total.granted_lock_cnt_ += thread_metrics.granted_lock_cnt_;
+    total.wait_us_.insert(total.wait_us_.end(), thread_metrics.wait_us_.begin(), thread_metrics.wait_us_.end());
+  }
+  std::sort(total.wait_us_.begin(), total.wait_us_.end());
+
+  fmt::print("<<< BEGIN\n");
+  fmt::print("committed_txn: {}\n", total.committed_txn_cnt_);
+  fmt::print("aborted_txn: {}\n", total.aborted_txn_cnt_);
+  fmt::print("txn_per_sec: {:.0f}\n", static_cast<double>(total.committed_txn_cnt_) / elapsed_s);
+  fmt::print("lock_ops_per_sec: {:.0f}\n", static_cast<double>(total.granted_lock_cnt_) / elapsed_s);
+  fmt::print("lock_wait_p50_us: {}\n", Percentile(total.wait_us_, 50));
+  fmt::print("lock_wait_p90_us: {}\n", Percentile(total.wait_us_, 90));
+  fmt::print("lock_wait_p99_us: {}\n", Percentile(total.wait_us_, 99));
+  fmt::print("lock_wait_p999_us: {}\n", Percentile(total.wait_us_, 99.9));
+  fmt::print("lock_wait_max_us: {}\n", total.wait_us_.empty() ? 0 : total.wait_us_.back());
+  fmt::print(">>> END\n");
+  return 0;
+}
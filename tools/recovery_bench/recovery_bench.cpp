@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction.h"
+#include "concurrency/transaction_manager.h"
+#include "fmt/core.h"
+#include "recovery/checkpoint_manager.h"
+#include "recovery/log_recovery.h"
+#include "storage/page/table_page.h"
+#include "type/value_factory.h"
+
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+auto ClockMs() -> uint64_t {
+  struct timeval tm;
+  gettimeofday(&tm, nullptr);
+  return static_cast<uint64_t>(tm.tv_sec * 1000) + static_cast<uint64_t>(tm.tv_usec / 1000);
+}
+
+auto ClockUs() -> uint64_t {
+  struct timeval tm;
+  gettimeofday(&tm, nullptr);
+  return static_cast<uint64_t>(tm.tv_sec * 1000000) + static_cast<uint64_t>(tm.tv_usec);
+}
+
+static const size_t BUSTUB_RECOVERY_BENCH_THREAD = 4;
+static const size_t BUSTUB_RECOVERY_BENCH_PAGES_PER_THREAD = 64;
+static const size_t BUSTUB_RECOVERY_BENCH_OPS_PER_TXN = 4;
+static const size_t BUSTUB_RECOVERY_BENCH_TUPLE_SIZE = 100;
+static const uint64_t BUSTUB_RECOVERY_BENCH_DURATION_MS = 5000;
+
+/**
+ * A buffer pool that keeps every page it ever held: a page is read from disk when it is first fetched and written
+ * back when it is flushed. Nothing is evicted, so the only page writes are the ones of the checkpoints.
+ */
+class MemoryBufferPoolManager : public bustub::BufferPoolManager {
+ public:
+  /** @param disk_pages the pages before this one are on disk, the others read as zeros */
+  explicit MemoryBufferPoolManager(bustub::DiskManager *disk_manager, bustub::page_id_t disk_pages = 0)
+      : disk_manager_(disk_manager), disk_pages_(disk_pages) {}
+
+  auto GetPoolSize() -> size_t override {
+    std::scoped_lock latch(latch_);
+    return pages_.size();
+  }
+
+  auto GetDirtyPageTable() -> std::vector<std::pair<bustub::page_id_t, bustub::lsn_t>> override {
+    std::scoped_lock latch(latch_);
+    std::vector<std::pair<bustub::page_id_t, bustub::lsn_t>> dirty_pages;
+    for (const auto &[page_id, page] : pages_) {
+      bustub::lsn_t rec_lsn = page->GetRecLSN();
+      if (rec_lsn != bustub::INVALID_LSN) {
+        dirty_pages.emplace_back(page_id, rec_lsn);
+      }
+    }
+    return dirty_pages;
+  }
+
+ protected:
+  auto FetchPgImp(bustub::page_id_t page_id) -> bustub::Page * override {
+    std::scoped_lock latch(latch_);
+    auto &page = pages_[page_id];
+    if (page == nullptr) {
+      page = std::make_unique<bustub::Page>();
+      if (page_id < disk_pages_) {
+        disk_manager_->ReadPage(page_id, page->GetData());
+      }
+    }
+    return page.get();
+  }
+
+  auto UnpinPgImp(bustub::page_id_t page_id, bool is_dirty) -> bool override { return true; }
+
+  auto FlushPgImp(bustub::page_id_t page_id) -> bool override {
+    bustub::Page *page;
+    {
+      std::scoped_lock latch(latch_);
+      auto it = pages_.find(page_id);
+      if (it == pages_.end()) {
+        return false;
+      }
+      page = it->second.get();
+    }
+    disk_manager_->WritePage(page_id, page->GetData());
+    return true;
+  }
+
+  auto NewPgImp(bustub::page_id_t *page_id) -> bustub::Page * override {
+    std::scoped_lock latch(latch_);
+    *page_id = next_page_id_++;
+    auto &page = pages_[*page_id];
+    page = std::make_unique<bustub::Page>();
+    return page.get();
+  }
+
+  auto DeletePgImp(bustub::page_id_t page_id) -> bool override { return false; }
+
+  void FlushAllPgsImp() override {}
+
+ private:
+  bustub::DiskManager *disk_manager_;
+  bustub::page_id_t disk_pages_;
+  std::mutex latch_;
+  std::map<bustub::page_id_t, std::unique_ptr<bustub::Page>> pages_;
+  bustub::page_id_t next_page_id_{0};
+};
+
+struct RecoveryBenchConfig {
+  size_t threads_{BUSTUB_RECOVERY_BENCH_THREAD};
+  size_t pages_per_thread_{BUSTUB_RECOVERY_BENCH_PAGES_PER_THREAD};
+  size_t ops_per_txn_{BUSTUB_RECOVERY_BENCH_OPS_PER_TXN};
+  size_t tuple_size_{BUSTUB_RECOVERY_BENCH_TUPLE_SIZE};
+  uint64_t duration_ms_{BUSTUB_RECOVERY_BENCH_DURATION_MS};
+  double update_ratio_{0.5};
+  double delete_ratio_{0.25};
+  /** Fraction of the transactions that commit asynchronously */
+  double async_ratio_{0};
+  /** 0 takes no checkpoints */
+  uint64_t checkpoint_interval_ms_{0};
+  size_t recovery_threads_{std::max(std::thread::hardware_concurrency(), 1U)};
+};
+
+struct RecoveryBenchMetrics {
+  uint64_t committed_txn_cnt_{0};
+  uint64_t write_cnt_{0};
+  /** Time spent in every Commit call */
+  std::vector<uint64_t> commit_us_;
+};
+
+/**
+ * The pages a client thread writes to and the committed tuples on them. No other thread writes these pages, so the
+ * transactions of different threads never write the same tuple, which undo relies on.
+ */
+struct ClientTable {
+  std::vector<bustub::page_id_t> page_ids_;
+  std::vector<bustub::RID> live_;
+  /** Tuples the last transaction deleted, the next one applies the deletes */
+  std::vector<std::pair<bustub::RID, bustub::Tuple>> deleted_;
+};
+
+using PageChange = std::function<bool(bustub::TablePage *page, bustub::LogRecord *log_record)>;
+
+/**
+ * Change a table page with logging on, the way the table heap did before the logging was taken out of TablePage: the
+ * change and its log record are made under the page latch, then the page and the transaction carry the lsn.
+ * @return false if the page could not take the change
+ */
+auto ChangePage(bustub::BufferPoolManager *bpm, bustub::LogManager *log_manager, bustub::Transaction *txn,
+                bustub::page_id_t page_id, const PageChange &change) -> bool {
+  auto *page = static_cast<bustub::TablePage *>(bpm->FetchPage(page_id));
+  page->WLatch();
+  bustub::LogRecord log_record;
+  bool changed = change(page, &log_record);
+  if (changed) {
+    bustub::lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+    page->SetLSN(lsn);
+    txn->SetPrevLSN(lsn);
+  }
+  page->WUnlatch();
+  bpm->UnpinPage(page_id, changed);
+  return changed;
+}
+
+/** Create the pages of every client thread in one transaction, they are chained like the pages of a table heap */
+auto CreateTables(bustub::TransactionManager *txn_manager, bustub::BufferPoolManager *bpm,
+                  bustub::LogManager *log_manager, const RecoveryBenchConfig &config) -> std::vector<ClientTable> {
+  std::vector<ClientTable> tables(config.threads_);
+  auto *txn = txn_manager->Begin();
+  bustub::page_id_t prev_page_id = bustub::INVALID_PAGE_ID;
+  for (size_t i = 0; i < config.threads_ * config.pages_per_thread_; i++) {
+    bustub::page_id_t page_id;
+    auto *page = static_cast<bustub::TablePage *>(bpm->NewPage(&page_id));
+    page->WLatch();
+    page->Init(page_id, bustub::BUSTUB_PAGE_SIZE, prev_page_id, log_manager, txn);
+    page->WUnlatch();
+    bpm->UnpinPage(page_id, true);
+    if (prev_page_id != bustub::INVALID_PAGE_ID) {
+      auto *prev_page = static_cast<bustub::TablePage *>(bpm->FetchPage(prev_page_id));
+      prev_page->WLatch();
+      prev_page->SetNextPageId(page_id);
+      prev_page->WUnlatch();
+      bpm->UnpinPage(prev_page_id, true);
+    }
+    tables[i % config.threads_].page_ids_.push_back(page_id);
+    prev_page_id = page_id;
+  }
+  txn_manager->Commit(txn);
+  delete txn;
+  return tables;
+}
+
+/**
+ * Run one transaction of ops_per_txn inserts, updates and deletes on the pages of the client. Updates and deletes
+ * pick a committed tuple at random, inserts go to the first page with room from a random one on; an update rewrites
+ * the integer column only, so its record carries a few bytes. Deletes are marked and applied by the next
+ * transaction of the client, like the table heap applies them once the deleting transaction committed.
+ */
+void RunTxn(bustub::TransactionManager *txn_manager, bustub::BufferPoolManager *bpm, bustub::LogManager *log_manager,
+            const RecoveryBenchConfig &config, const bustub::Schema &schema, const std::string &payload,
+            ClientTable *table, std::mt19937_64 *rng, RecoveryBenchMetrics *metrics) {
+  auto *txn = txn_manager->Begin();
+  txn->SetSynchronousCommit(!std::bernoulli_distribution(config.async_ratio_)(*rng));
+  const bustub::txn_id_t txn_id = txn->GetTransactionId();
+
+  for (const auto &[rid, tuple] : table->deleted_) {
+    ChangePage(bpm, log_manager, txn, rid.GetPageId(), [&](bustub::TablePage *page, bustub::LogRecord *log_record) {
+      page->ApplyDelete(rid, txn, log_manager);
+      *log_record = bustub::LogRecord(txn_id, txn->GetPrevLSN(), bustub::LogRecordType::APPLYDELETE, rid, tuple);
+      return true;
+    });
+    metrics->write_cnt_++;
+  }
+  table->deleted_.clear();
+
+  std::vector<bustub::RID> inserted;
+  std::vector<std::pair<bustub::RID, bustub::Tuple>> deleted;
+  std::uniform_real_distribution<double> dice(0, 1);
+  for (size_t i = 0; i < config.ops_per_txn_; i++) {
+    double op = dice(*rng);
+    auto value = static_cast<int32_t>((*rng)());
+    bustub::Tuple new_tuple(
+        {bustub::ValueFactory::GetIntegerValue(value), bustub::ValueFactory::GetVarcharValue(payload)}, &schema);
+    if (op < config.delete_ratio_ + config.update_ratio_ && !table->live_.empty()) {
+      size_t pos = std::uniform_int_distribution<size_t>(0, table->live_.size() - 1)(*rng);
+      bustub::RID rid = table->live_[pos];
+      if (op < config.delete_ratio_) {
+        table->live_[pos] = table->live_.back();
+        table->live_.pop_back();
+        ChangePage(bpm, log_manager, txn, rid.GetPageId(), [&](bustub::TablePage *page, bustub::LogRecord *log_record) {
+          // the tuple is kept for the record of the applied delete, which undo inserts it back from
+          bustub::Tuple tuple;
+          page->GetTuple(rid, &tuple, txn, nullptr);
+          page->MarkDelete(rid, txn, nullptr, log_manager);
+          *log_record = bustub::LogRecord(txn_id, txn->GetPrevLSN(), bustub::LogRecordType::MARKDELETE, rid, tuple);
+          deleted.emplace_back(rid, std::move(tuple));
+          return true;
+        });
+      } else {
+        ChangePage(bpm, log_manager, txn, rid.GetPageId(), [&](bustub::TablePage *page, bustub::LogRecord *log_record) {
+          bustub::Tuple old_tuple;
+          if (!page->UpdateTuple(new_tuple, &old_tuple, rid, txn, nullptr, log_manager)) {
+            return false;
+          }
+          *log_record =
+              bustub::LogRecord(txn_id, txn->GetPrevLSN(), bustub::LogRecordType::UPDATE, rid, old_tuple, new_tuple);
+          return true;
+        });
+      }
+      metrics->write_cnt_++;
+      continue;
+    }
+    size_t first = std::uniform_int_distribution<size_t>(0, table->page_ids_.size() - 1)(*rng);
+    for (size_t j = 0; j < table->page_ids_.size(); j++) {
+      bustub::page_id_t page_id = table->page_ids_[(first + j) % table->page_ids_.size()];
+      bool inserted_tuple =
+          ChangePage(bpm, log_manager, txn, page_id, [&](bustub::TablePage *page, bustub::LogRecord *log_record) {
+            bustub::RID rid;
+            if (!page->InsertTuple(new_tuple, &rid, txn, nullptr, log_manager)) {
+              return false;
+            }
+            *log_record = bustub::LogRecord(txn_id, txn->GetPrevLSN(), bustub::LogRecordType::INSERT, rid, new_tuple);
+            inserted.push_back(rid);
+            return true;
+          });
+      if (inserted_tuple) {
+        metrics->write_cnt_++;
+        break;
+      }
+    }
+  }
+
+  uint64_t start = ClockUs();
+  txn_manager->Commit(txn);
+  metrics->commit_us_.push_back(ClockUs() - start);
+  metrics->committed_txn_cnt_++;
+  table->live_.insert(table->live_.end(), inserted.begin(), inserted.end());
+  table->deleted_ = std::move(deleted);
+  delete txn;
+}
+
+auto Percentile(const std::vector<uint64_t> &sorted, double percentile) -> uint64_t {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto index = static_cast<size_t>(percentile / 100 * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+/**
+ * The workload, run in the child process: the clients run transactions for duration_ms, the metrics of that window are
+ * printed and the parent is told through done_fd. The clients keep running until the parent kills the process, so
+ * the crash leaves transactions in flight and log buffers unwritten.
+ */
+[[noreturn]] void RunWorkload(const std::string &db_file, const RecoveryBenchConfig &config, int done_fd) {
+  bustub::DiskManager disk_manager(db_file);
+  bustub::LogManager log_manager(&disk_manager);
+  MemoryBufferPoolManager bpm(&disk_manager);
+  bustub::LockManager lock_manager;
+  bustub::TransactionManager txn_manager(&lock_manager, &log_manager);
+  bustub::CheckpointManager checkpoint_manager(&txn_manager, &log_manager, &bpm);
+  bustub::Schema schema({bustub::Column("a", bustub::TypeId::INTEGER),
+                         bustub::Column("b", bustub::TypeId::VARCHAR, static_cast<uint32_t>(config.tuple_size_))});
+  log_manager.RunFlushThread();
+  auto tables = CreateTables(&txn_manager, &bpm, &log_manager, config);
+
+  std::vector<RecoveryBenchMetrics> metrics(config.threads_);
+  std::vector<std::atomic<bool>> measured(config.threads_);
+  std::vector<std::thread> threads;
+  bustub::log_offset_t start_log_size = disk_manager.GetLogSize();
+  int start_flushes = disk_manager.GetNumFlushes();
+  uint64_t start = ClockMs();
+  for (size_t thread_id = 0; thread_id < config.threads_; thread_id++) {
+    threads.emplace_back([&, thread_id] {
+      std::mt19937_64 rng(thread_id);
+      std::string payload(config.tuple_size_, static_cast<char>('a' + thread_id % 26));
+      while (ClockMs() - start < config.duration_ms_) {
+        RunTxn(&txn_manager, &bpm, &log_manager, config, schema, payload, &tables[thread_id], &rng,
+               &metrics[thread_id]);
+      }
+      measured[thread_id] = true;
+      RecoveryBenchMetrics unmeasured;
+      while (true) {
+        RunTxn(&txn_manager, &bpm, &log_manager, config, schema, payload, &tables[thread_id], &rng, &unmeasured);
+        unmeasured.commit_us_.clear();
+      }
+    });
+  }
+  std::thread checkpoint_thread;
+  if (config.checkpoint_interval_ms_ > 0) {
+    checkpoint_thread = std::thread([&] {
+      while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(config.checkpoint_interval_ms_));
+        checkpoint_manager.BeginCheckpoint();
+        checkpoint_manager.EndCheckpoint();
+      }
+    });
+  }
+  for (auto &thread_measured : measured) {
+    while (!thread_measured) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  double elapsed_s = static_cast<double>(std::max<uint64_t>(ClockMs() - start, 1)) / 1000;
+  double log_mb = static_cast<double>(disk_manager.GetLogSize() - start_log_size) / (1 << 20);
+  int flushes = disk_manager.GetNumFlushes() - start_flushes;
+
+  RecoveryBenchMetrics total;
+  for (auto &thread_metrics : metrics) {
+    total.committed_txn_cnt_ += thread_metrics.committed_txn_cnt_;
+    total.write_cnt_ += thread_metrics.write_cnt_;
+    total.commit_us_.insert(total.commit_us_.end(), thread_metrics.commit_us_.begin(), thread_metrics.commit_us_.end());
+  }
+  std::sort(total.commit_us_.begin(), total.commit_us_.end());
+
+  fmt::print("<<< BEGIN\n");
+  fmt::print("committed_txn: {}\n", total.committed_txn_cnt_);
+  fmt::print("txn_per_sec: {:.0f}\n", static_cast<double>(total.committed_txn_cnt_) / elapsed_s);
+  fmt::print("writes_per_sec: {:.0f}\n", static_cast<double>(total.write_cnt_) / elapsed_s);
+  fmt::print("commit_p50_us: {}\n", Percentile(total.commit_us_, 50));
+  fmt::print("commit_p90_us: {}\n", Percentile(total.commit_us_, 90));
+  fmt::print("commit_p99_us: {}\n", Percentile(total.commit_us_, 99));
+  fmt::print("commit_p999_us: {}\n", Percentile(total.commit_us_, 99.9));
+  fmt::print("commit_max_us: {}\n", total.commit_us_.empty() ? 0 : total.commit_us_.back());
+  fmt::print("log_mb_per_sec: {:.2f}\n", log_mb / elapsed_s);
+  fmt::print("log_flushes: {}\n", flushes);
+  fmt::print("commits_per_flush: {:.1f}\n",
+             static_cast<double>(total.committed_txn_cnt_) / static_cast<double>(std::max(flushes, 1)));
+  std::fflush(stdout);
+  char done = 1;
+  if (write(done_fd, &done, 1) != 1) {
+    std::_Exit(1);
+  }
+  // the parent kills the process while the clients are running
+  while (true) {
+    pause();
+  }
+}
+
+/** Recover the database the workload left behind, timing the passes. Runs in the parent after the crash. */
+void RunRecovery(const std::string &db_file, const RecoveryBenchConfig &config) {
+  auto disk_pages = static_cast<bustub::page_id_t>(std::filesystem::file_size(db_file) / bustub::BUSTUB_PAGE_SIZE);
+  bustub::DiskManager disk_manager(db_file);
+  MemoryBufferPoolManager bpm(&disk_manager, disk_pages);
+  bustub::LogRecovery log_recovery(&disk_manager, &bpm, config.recovery_threads_);
+
+  uint64_t start = ClockUs();
+  log_recovery.Analyze();
+  uint64_t analyzed = ClockUs();
+  size_t loser_txns = log_recovery.GetActiveTxns().size();
+  size_t dirty_pages = log_recovery.GetDirtyPages().size();
+  log_recovery.Redo();
+  uint64_t redone = ClockUs();
+  log_recovery.Undo();
+  uint64_t undone = ClockUs();
+
+  fmt::print("loser_txn: {}\n", loser_txns);
+  fmt::print("dirty_pages: {}\n", dirty_pages);
+  fmt::print("analysis_ms: {:.1f}\n", static_cast<double>(analyzed - start) / 1000);
+  fmt::print("redo_ms: {:.1f}\n", static_cast<double>(redone - analyzed) / 1000);
+  fmt::print("undo_ms: {:.1f}\n", static_cast<double>(undone - redone) / 1000);
+  fmt::print("recovery_ms: {:.1f}\n", static_cast<double>(undone - start) / 1000);
+  fmt::print(">>> END\n");
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+auto main(int argc, char **argv) -> int {
+  argparse::ArgumentParser program("bustub-recovery-bench");
+  program.add_argument("--threads").help("number of client threads");
+  program.add_argument("--pages").help("table pages of every client thread");
+  program.add_argument("--ops-per-txn").help("writes of every transaction");
+  program.add_argument("--tuple-size").help("bytes of the varchar column of a tuple");
+  program.add_argument("--duration").help("measure the workload for n milliseconds before the crash");
+  program.add_argument("--update-ratio").help("fraction of writes that are updates");
+  program.add_argument("--delete-ratio").help("fraction of writes that are deletes, the others are inserts");
+  program.add_argument("--async-ratio").help("fraction of transactions that commit asynchronously");
+  program.add_argument("--group-commit-size").help("committers that make the log flush right away");
+  program.add_argument("--group-commit-window").help("microseconds a committer waits for a group to form");
+  program.add_argument("--log-timeout").help("seconds a log record waits for a flush at most");
+  program.add_argument("--compress").help("compress log blocks").default_value(false).implicit_value(true);
+  program.add_argument("--checkpoint-interval").help("milliseconds between checkpoints, 0 takes none");
+  program.add_argument("--recovery-threads").help("redo and undo workers");
+  program.add_argument("--db").help("database file, removed before and after the run");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  RecoveryBenchConfig config;
+  std::string db_file = "bustub_recovery_bench.db";
+  try {
+    if (program.present("--threads")) {
+      config.threads_ = std::max<size_t>(std::stoul(program.get("--threads")), 1);
+    }
+    if (program.present("--pages")) {
+      config.pages_per_thread_ = std::max<size_t>(std::stoul(program.get("--pages")), 1);
+    }
+    if (program.present("--ops-per-txn")) {
+      config.ops_per_txn_ = std::stoul(program.get("--ops-per-txn"));
+    }
+    if (program.present("--tuple-size")) {
+      config.tuple_size_ = std::clamp<size_t>(std::stoul(program.get("--tuple-size")), 1, bustub::BUSTUB_PAGE_SIZE / 4);
+    }
+    if (program.present("--duration")) {
+      config.duration_ms_ = std::stoull(program.get("--duration"));
+    }
+    if (program.present("--update-ratio")) {
+      config.update_ratio_ = std::clamp(std::stod(program.get("--update-ratio")), 0.0, 1.0);
+    }
+    if (program.present("--delete-ratio")) {
+      config.delete_ratio_ = std::clamp(std::stod(program.get("--delete-ratio")), 0.0, 1.0);
+    }
+    if (program.present("--async-ratio")) {
+      config.async_ratio_ = std::clamp(std::stod(program.get("--async-ratio")), 0.0, 1.0);
+    }
+    if (program.present("--group-commit-size")) {
+      bustub::group_commit_size = std::stoul(program.get("--group-commit-size"));
+    }
+    if (program.present("--group-commit-window")) {
+      bustub::group_commit_window = std::chrono::microseconds(std::stoll(program.get("--group-commit-window")));
+    }
+    if (program.present("--log-timeout")) {
+      bustub::log_timeout = std::chrono::seconds(std::stoll(program.get("--log-timeout")));
+    }
+    bustub::enable_log_compression = program.get<bool>("--compress");
+    if (program.present("--checkpoint-interval")) {
+      config.checkpoint_interval_ms_ = std::stoull(program.get("--checkpoint-interval"));
+    }
+    if (program.present("--recovery-threads")) {
+      config.recovery_threads_ = std::max<size_t>(std::stoul(program.get("--recovery-threads")), 1);
+    }
+    if (program.present("--db")) {
+      db_file = program.get("--db");
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (config.update_ratio_ + config.delete_ratio_ > 1) {
+    std::cerr << "update and delete ratio must add up to at most 1" << std::endl;
+    return 1;
+  }
+
+  fmt::print(
+      "x: {} threads, {} pages/thread, {} ops/txn, tuple size {}, update ratio {}, delete ratio {}, async ratio {}, "
+      "group commit size {}, group commit window {}us, compress {}, checkpoint interval {}ms, {} recovery threads\n",
+      config.threads_, config.pages_per_thread_, config.ops_per_txn_, config.tuple_size_, config.update_ratio_,
+      config.delete_ratio_, config.async_ratio_, bustub::group_commit_size, bustub::group_commit_window.count(),
+      bustub::enable_log_compression.load(), config.checkpoint_interval_ms_, config.recovery_threads_);
+  std::fflush(stdout);
+
+  std::remove(db_file.c_str());
+  bustub::DiskManager::RemoveLogFiles(db_file);
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) {
+    std::cerr << "failed to create a pipe" << std::endl;
+    return 1;
+  }
+  // the workload runs in a child process, killing it is the crash; nothing is shared but the files
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::cerr << "failed to fork" << std::endl;
+    return 1;
+  }
+  if (pid == 0) {
+    close(pipe_fds[0]);
+    RunWorkload(db_file, config, pipe_fds[1]);
+  }
+  close(pipe_fds[1]);
+  char done;
+  bool measured = read(pipe_fds[0], &done, 1) == 1;
+  close(pipe_fds[0]);
+  kill(pid, SIGKILL);
+  int status;
+  waitpid(pid, &status, 0);
+  if (!measured || !WIFSIGNALED(status) || WTERMSIG(status) != SIGKILL) {
+    std::cerr << "the workload ended before the crash" << std::endl;
+    return 1;
+  }
+
+  RunRecovery(db_file, config);
+  std::remove(db_file.c_str());
+  bustub::DiskManager::RemoveLogFiles(db_file);
+  return 0;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <memory>
@@ -13,6 +14,7 @@
 #include "common/bustub_instance.h"
 #include "common/exception.h"
 #include "common/util/string_util.h"
+#include "concurrency/lock_manager.h"
 #include "concurrency/transaction.h"
 #include "concurrency/transaction_manager.h"
 #include "fmt/core.h"
@@ -27,6 +29,12 @@ auto ClockMs() -> uint64_t {
   return static_cast<uint64_t>(tm.tv_sec * 1000) + static_cast<uint64_t>(tm.tv_usec / 1000);
 }
 
+auto ClockUs() -> uint64_t {
+  struct timeval tm;
+  gettimeofday(&tm, nullptr);
+  return static_cast<uint64_t>(tm.tv_sec * 1000000) + static_cast<uint64_t>(tm.tv_usec);
+}
+
 static const size_t BUSTUB_NFT_NUM = 30000;
 static const size_t BUSTUB_TERRIER_THREAD = 2;
 static const size_t BUSTUB_TERRIER_CNT = 100;
@@ -36,6 +44,7 @@ struct TerrierTotalMetrics {
   uint64_t committed_count_txn_cnt_{0};
   uint64_t aborted_update_txn_cnt_{0};
   uint64_t committed_update_txn_cnt_{0};
+  std::vector<uint64_t> update_latency_us_;
   uint64_t start_time_{0};
   std::mutex mutex_;
 
@@ -47,21 +56,41 @@ struct TerrierTotalMetrics {
     committed_count_txn_cnt_ += committed_cnt;
   }
 
-  void ReportUpdate(uint64_t aborted_cnt, uint64_t committed_cnt) {
+  void ReportUpdate(uint64_t aborted_cnt, uint64_t committed_cnt, const std::vector<uint64_t> &latency_us) {
     std::unique_lock<std::mutex> l(mutex_);
     aborted_update_txn_cnt_ += aborted_cnt;
     committed_update_txn_cnt_ += committed_cnt;
+    update_latency_us_.insert(update_latency_us_.end(), latency_us.begin(), latency_us.end());
   }
 
-  void Report() {
+  auto UpdateLatencyP99() -> uint64_t {
+    if (update_latency_us_.empty()) {
+      return 0;
+    }
+    auto p99 = update_latency_us_.begin() + update_latency_us_.size() * 99 / 100;
+    std::nth_element(update_latency_us_.begin(), p99, update_latency_us_.end());
+    return *p99;
+  }
+
+  static auto AbortRate(uint64_t aborted_cnt, uint64_t committed_cnt) -> double {
+    auto total = aborted_cnt + committed_cnt;
+    return total == 0 ? 0 : aborted_cnt / static_cast<double>(total);
+  }
+
+  void Report(const std::string &deadlock_policy, const std::string &concurrency_control) {
     auto now = ClockMs();
     auto elsped = now - start_time_;
     auto count_txn_per_sec = committed_count_txn_cnt_ / static_cast<double>(elsped) * 1000;
     auto update_txn_per_sec = committed_update_txn_cnt_ / static_cast<double>(elsped) * 1000;
 
     fmt::print("<<< BEGIN\n");
+    fmt::print("deadlock_policy: {}\n", deadlock_policy);
+    fmt::print("concurrency_control: {}\n", concurrency_control);
     fmt::print("update: {}\n", update_txn_per_sec);
     fmt::print("count: {}\n", count_txn_per_sec);
+    fmt::print("update_abort_rate: {:.4}\n", AbortRate(aborted_update_txn_cnt_, committed_update_txn_cnt_));
+    fmt::print("count_abort_rate: {:.4}\n", AbortRate(aborted_count_txn_cnt_, committed_count_txn_cnt_));
+    fmt::print("update_p99_latency_us: {}\n", UpdateLatencyP99());
     fmt::print(">>> END\n");
   }
 };
@@ -73,6 +102,8 @@ struct TerrierMetrics {
   uint64_t last_aborted_txn_cnt_{0};
   uint64_t committed_txn_cnt_{0};
   uint64_t aborted_txn_cnt_{0};
+  /** Latency of every transaction, only kept by the update threads */
+  std::vector<uint64_t> latency_us_;
   std::string reporter_;
   uint64_t duration_ms_;
 
@@ -114,12 +145,46 @@ auto ParseBool(const std::string &str) -> bool {
   throw bustub::Exception(fmt::format("unexpected arg: {}", str));
 }
 
+auto ParseDeadlockPolicy(const std::string &str) -> bustub::LockManager::DeadlockPolicy {
+  if (str == "detection") {
+    return bustub::LockManager::DeadlockPolicy::DETECTION;
+  }
+  if (str == "wound-wait") {
+    return bustub::LockManager::DeadlockPolicy::WOUND_WAIT;
+  }
+  if (str == "wait-die") {
+    return bustub::LockManager::DeadlockPolicy::WAIT_DIE;
+  }
+  throw bustub::Exception(fmt::format("unexpected deadlock policy: {}", str));
+}
+
+auto ParseConcurrencyControl(const std::string &str) -> bustub::ConcurrencyControl {
+  if (str == "2pl") {
+    return bustub::ConcurrencyControl::TWO_PHASE_LOCKING;
+  }
+  if (str == "occ") {
+    return bustub::ConcurrencyControl::OPTIMISTIC;
+  }
+  throw bustub::Exception(fmt::format("unexpected concurrency control: {}", str));
+}
+
+/** Commit txn if it succeeded so far, abort it otherwise. An optimistic transaction may still fail at commit. */
+auto CommitOrAbort(bustub::TransactionManager *txn_manager, bustub::Transaction *txn, bool txn_success) -> bool {
+  if (!txn_success) {
+    txn_manager->Abort(txn);
+    return false;
+  }
+  return txn_manager->Commit(txn);
+}
+
 // NOLINTNEXTLINE
 auto main(int argc, char **argv) -> int {
   argparse::ArgumentParser program("bustub-terrier-bench");
   program.add_argument("--duration").help("run terrier bench for n milliseconds");
   program.add_argument("--force-create-index").help("create index in terrier bench");
   program.add_argument("--force-enable-update").help("use update statement in terrier bench");
+  program.add_argument("--deadlock-policy").help("detection, wound-wait or wait-die");
+  program.add_argument("--concurrency-control").help("2pl or occ");
 
   try {
     program.parse_args(argc, argv);
@@ -132,6 +197,20 @@ auto main(int argc, char **argv) -> int {
   auto bustub = std::make_unique<bustub::BustubInstance>();
   auto writer = bustub::SimpleStreamWriter(std::cerr);
 
+  std::string deadlock_policy = "detection";
+  if (program.present("--deadlock-policy")) {
+    deadlock_policy = program.get("--deadlock-policy");
+  }
+  bustub->lock_manager_->SetDeadlockPolicy(ParseDeadlockPolicy(deadlock_policy));
+  std::cerr << "x: deadlock policy " << deadlock_policy << std::endl;
+
+  std::string concurrency_control_str = "2pl";
+  if (program.present("--concurrency-control")) {
+    concurrency_control_str = program.get("--concurrency-control");
+  }
+  auto concurrency_control = ParseConcurrencyControl(concurrency_control_str);
+  std::cerr << "x: concurrency control " << concurrency_control_str << std::endl;
+
   // create schema
   auto schema = "CREATE TABLE nft(id int, terrier int);";
   std::cerr << "x: create schema" << std::endl;
@@ -213,7 +292,8 @@ auto main(int argc, char **argv) -> int {
   total_metrics.Begin();
 
   for (size_t thread_id = 0; thread_id < BUSTUB_TERRIER_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &bustub, enable_update, duration_ms, &total_metrics] {
+    threads.emplace_back(std::thread([thread_id, &bustub, enable_update, duration_ms, concurrency_control,
+                                      &total_metrics] {
       const size_t nft_range_size = BUSTUB_NFT_NUM / BUSTUB_TERRIER_THREAD;
       const size_t nft_range_begin = thread_id * nft_range_size;
       const size_t nft_range_end = (thread_id + 1) * nft_range_size;
@@ -231,9 +311,10 @@ auto main(int argc, char **argv) -> int {
         auto nft_id = nft_uniform_dist(gen);
         auto terrier_id = terrier_uniform_dist(gen);
         bool txn_success = true;
+        auto txn_begin_us = ClockUs();
 
         if (enable_update) {
-          auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+          auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ, concurrency_control);
           std::string query = fmt::format("UPDATE nft SET terrier = {} WHERE id = {}", terrier_id, nft_id);
           if (!bustub->ExecuteSqlTxn(query, writer, txn)) {
             txn_success = false;
@@ -244,16 +325,14 @@ auto main(int argc, char **argv) -> int {
             exit(1);
           }
 
-          if (txn_success) {
-            bustub->txn_manager_->Commit(txn);
+          if (CommitOrAbort(bustub->txn_manager_, txn, txn_success)) {
             metrics.TxnCommitted();
           } else {
-            bustub->txn_manager_->Abort(txn);
             metrics.TxnAborted();
           }
           delete txn;
         } else {
-          auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+          auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ, concurrency_control);
 
           std::string query = fmt::format("DELETE FROM nft WHERE id = {}", nft_id);
           if (!bustub->ExecuteSqlTxn(query, writer, txn)) {
@@ -265,15 +344,13 @@ auto main(int argc, char **argv) -> int {
             exit(1);
           }
 
-          if (!txn_success) {
-            bustub->txn_manager_->Abort(txn);
+          if (!CommitOrAbort(bustub->txn_manager_, txn, txn_success)) {
             metrics.TxnAborted();
             delete txn;
           } else {
-            bustub->txn_manager_->Commit(txn);
             delete txn;
 
-            txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+            txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ, concurrency_control);
 
             query = fmt::format("INSERT INTO nft VALUES ({}, {})", nft_id, terrier_id);
             if (!bustub->ExecuteSqlTxn(query, writer, txn)) {
@@ -285,26 +362,25 @@ auto main(int argc, char **argv) -> int {
               exit(1);
             }
 
-            if (!txn_success) {
-              bustub->txn_manager_->Abort(txn);
-              metrics.TxnAborted();
-            } else {
-              bustub->txn_manager_->Commit(txn);
+            if (CommitOrAbort(bustub->txn_manager_, txn, txn_success)) {
               metrics.TxnCommitted();
+            } else {
+              metrics.TxnAborted();
             }
             delete txn;
           }
         }
 
+        metrics.latency_us_.push_back(ClockUs() - txn_begin_us);
         metrics.Report();
       }
 
-      total_metrics.ReportUpdate(metrics.aborted_txn_cnt_, metrics.committed_txn_cnt_);
+      total_metrics.ReportUpdate(metrics.aborted_txn_cnt_, metrics.committed_txn_cnt_, metrics.latency_us_);
     }));
   }
 
   for (size_t thread_id = 0; thread_id < BUSTUB_TERRIER_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &bustub, duration_ms, &total_metrics] {
+    threads.emplace_back(std::thread([thread_id, &bustub, duration_ms, concurrency_control, &total_metrics] {
       std::random_device r;
       std::default_random_engine gen(r());
       std::uniform_int_distribution<int> terrier_uniform_dist(0, BUSTUB_TERRIER_CNT - 1);
@@ -317,7 +393,7 @@ auto main(int argc, char **argv) -> int {
         auto writer = bustub::SimpleStreamWriter(ss, true);
         auto terrier_id = terrier_uniform_dist(gen);
 
-        auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+        auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ, concurrency_control);
         bool txn_success = true;
 
         std::string query = fmt::format("SELECT count(*) FROM nft WHERE terrier = {}", terrier_id);
@@ -325,11 +401,9 @@ auto main(int argc, char **argv) -> int {
           txn_success = false;
         }
 
-        if (txn_success) {
-          bustub->txn_manager_->Commit(txn);
+        if (CommitOrAbort(bustub->txn_manager_, txn, txn_success)) {
           metrics.TxnCommitted();
         } else {
-          bustub->txn_manager_->Abort(txn);
           metrics.TxnAborted();
         }
         delete txn;
@@ -358,7 +432,7 @@ auto main(int argc, char **argv) -> int {
     }
   }
 
-  total_metrics.Report();
+  total_metrics.Report(deadlock_policy, concurrency_control_str);
 
   return 0;
 }